@@ -0,0 +1,67 @@
+#version 430
+
+/*
+ * Builds the view space AABB for every cluster in the light grid. Clusters split the
+ * screen into tiles, and split depth exponentially between the near and far planes so
+ * that clusters near the camera are not stretched out. This only needs to be run when
+ * the camera's projection or the screen size changes
+*/
+
+layout(local_size_x = 64) in;
+
+#include "../fragments/light_clusters.glsl"
+
+layout(std430, binding = 7) writeonly buffer b_ClusterBounds {
+    ClusterBounds Bounds[];
+};
+
+layout(location = 0) uniform mat4  u_InverseProjection;
+layout(location = 1) uniform ivec3 u_GridSize;
+layout(location = 2) uniform vec2  u_ScreenSize;
+layout(location = 3) uniform vec2  u_NearFar;
+layout(location = 4) uniform bool  u_IsOrtho;
+
+// Converts a point in screen space (pixels) into view space, on the near plane
+vec3 ScreenToView(vec2 screen) {
+    vec2 ndc = (screen / u_ScreenSize) * 2.0 - 1.0;
+    vec4 view = u_InverseProjection * vec4(ndc, -1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+// Finds where the line from the eye through the given near plane point crosses the plane at depth z
+vec3 IntersectDepth(vec3 point, float z) {
+    // Orthographic rays are parallel, so they keep their x and y
+    return u_IsOrtho ? vec3(point.xy, z) : point * (z / point.z);
+}
+
+void main() {
+    uvec3 gridSize = uvec3(u_GridSize);
+    uint index = gl_GlobalInvocationID.x;
+    uint total = gridSize.x * gridSize.y * gridSize.z;
+    if (index >= total) {
+        return;
+    }
+
+    uvec3 cluster = uvec3(
+        index % gridSize.x,
+        (index / gridSize.x) % gridSize.y,
+        index / (gridSize.x * gridSize.y)
+    );
+
+    // Screen space extents of the tile
+    vec2 tileSize = u_ScreenSize / vec2(gridSize.xy);
+    vec3 minPoint = ScreenToView(vec2(cluster.xy) * tileSize);
+    vec3 maxPoint = ScreenToView(vec2(cluster.xy + 1) * tileSize);
+
+    // Exponential depth slices, view space looks down -z
+    float sliceNear = -u_NearFar.x * pow(u_NearFar.y / u_NearFar.x, float(cluster.z) / float(gridSize.z));
+    float sliceFar  = -u_NearFar.x * pow(u_NearFar.y / u_NearFar.x, float(cluster.z + 1) / float(gridSize.z));
+
+    vec3 a = IntersectDepth(minPoint, sliceNear);
+    vec3 b = IntersectDepth(minPoint, sliceFar);
+    vec3 c = IntersectDepth(maxPoint, sliceNear);
+    vec3 d = IntersectDepth(maxPoint, sliceFar);
+
+    Bounds[index].Min = vec4(min(min(a, b), min(c, d)), 0.0);
+    Bounds[index].Max = vec4(max(max(a, b), max(c, d)), 0.0);
+}
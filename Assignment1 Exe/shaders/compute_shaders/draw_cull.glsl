@@ -0,0 +1,141 @@
+#version 440
+
+/*
+ * Culls the draws collected by MultiDrawRenderer against the camera frustum, and optionally
+ * against a Hi-Z pyramid built from the previous frame's depth. Each invocation handles a
+ * single draw, and writes it's command into the output buffer only if it is visible.
+ *
+ * When compacting, surviving commands are packed to the front of their batch's range and
+ * counted per batch for glMultiDrawElementsIndirectCount. Otherwise every command keeps it's
+ * slot and culled ones get an instance count of 0
+*/
+
+layout(local_size_x = 64) in;
+
+// Matches DrawElementsIndirectCommand
+struct DrawCommand {
+    uint Count;
+    uint InstanceCount;
+    uint FirstIndex;
+    int  BaseVertex;
+    uint BaseInstance;
+};
+
+// Matches MultiDrawRenderer::DrawData
+struct DrawData {
+    mat4 ModelViewProjection;
+    mat4 Model;
+    mat4 NormalMatrix;
+};
+
+// Matches MultiDrawRenderer::CullData
+struct CullData {
+    // Model space bounding sphere, center in xyz and radius in w
+    vec4 BoundingSphere;
+    uint Batch;
+    uint BatchStart;
+    uint Padding0;
+    uint Padding1;
+};
+
+layout(std430, binding = 11) readonly buffer b_DrawData {
+    DrawData Draws[];
+};
+layout(std430, binding = 12) readonly buffer b_InputCommands {
+    DrawCommand InputCommands[];
+};
+layout(std430, binding = 13) readonly buffer b_CullData {
+    CullData Culling[];
+};
+layout(std430, binding = 14) writeonly buffer b_OutputCommands {
+    DrawCommand OutputCommands[];
+};
+// Reset to 0 before every dispatch
+layout(std430, binding = 15) buffer b_BatchCounts {
+    uint BatchCounts[];
+};
+
+layout(binding = 0) uniform sampler2D s_HiZ;
+
+layout(location = 0) uniform int  u_NumDraws;
+layout(location = 1) uniform bool u_Compact;
+layout(location = 2) uniform bool u_UseHiZ;
+// The view projection the Hi-Z pyramid was rendered with
+layout(location = 3) uniform mat4 u_HiZViewProjection;
+layout(location = 4) uniform vec2 u_HiZSize;
+layout(location = 5) uniform int  u_HiZLevels;
+// Normalized world space planes, pointing inwards
+layout(location = 6) uniform vec4 u_FrustumPlanes[6];
+
+bool IsInFrustum(vec4 sphere) {
+    for (int ix = 0; ix < 6; ix++) {
+        if (dot(u_FrustumPlanes[ix].xyz, sphere.xyz) + u_FrustumPlanes[ix].w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsOccluded(vec4 sphere) {
+    // Project the corners of the sphere's bounding box into the previous frame's screen
+    vec3 minNdc = vec3(1.0);
+    vec3 maxNdc = vec3(-1.0);
+    for (int ix = 0; ix < 8; ix++) {
+        vec3 corner = sphere.xyz + sphere.w * vec3((ix & 1) != 0 ? 1 : -1, (ix & 2) != 0 ? 1 : -1, (ix & 4) != 0 ? 1 : -1);
+        vec4 clip = u_HiZViewProjection * vec4(corner, 1.0);
+        // Anything crossing the near plane can't be tested reliably, so we assume it's visible
+        if (clip.w <= 0.0) {
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        minNdc = min(minNdc, ndc);
+        maxNdc = max(maxNdc, ndc);
+    }
+
+    vec2 minUv = clamp(minNdc.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 maxUv = clamp(maxNdc.xy * 0.5 + 0.5, 0.0, 1.0);
+    float nearestDepth = minNdc.z * 0.5 + 0.5;
+
+    // Pick the mip where the rectangle covers at most 2x2 texels, so 4 samples cover all of it
+    vec2 size = (maxUv - minUv) * u_HiZSize;
+    float level = clamp(ceil(log2(max(max(size.x, size.y), 1.0))), 0.0, float(u_HiZLevels - 1));
+
+    float furthest = max(
+        max(textureLod(s_HiZ, minUv, level).r, textureLod(s_HiZ, vec2(maxUv.x, minUv.y), level).r),
+        max(textureLod(s_HiZ, vec2(minUv.x, maxUv.y), level).r, textureLod(s_HiZ, maxUv, level).r)
+    );
+    return nearestDepth > furthest;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= uint(u_NumDraws)) {
+        return;
+    }
+
+    CullData cull = Culling[index];
+    mat4 model = Draws[index].Model;
+
+    // Move the sphere to world space, scaling by the largest axis so it stays conservative
+    float scale = sqrt(max(max(dot(model[0].xyz, model[0].xyz), dot(model[1].xyz, model[1].xyz)), dot(model[2].xyz, model[2].xyz)));
+    vec4 sphere = vec4((model * vec4(cull.BoundingSphere.xyz, 1.0)).xyz, cull.BoundingSphere.w * scale);
+
+    bool visible = IsInFrustum(sphere) && !(u_UseHiZ && IsOccluded(sphere));
+
+    // The vertex shader finds it's draw data at BaseInstance + gl_DrawID, where gl_DrawID is the
+    // command's slot within the batch, so BaseInstance has to undo wherever we put the command
+    uint slot;
+    if (u_Compact) {
+        if (!visible) {
+            return;
+        }
+        slot = atomicAdd(BatchCounts[cull.Batch], 1u);
+    } else {
+        slot = index - cull.BatchStart;
+    }
+
+    DrawCommand command = InputCommands[index];
+    command.InstanceCount = visible ? 1u : 0u;
+    command.BaseInstance = index - slot;
+    OutputCommands[cull.BatchStart + slot] = command;
+}
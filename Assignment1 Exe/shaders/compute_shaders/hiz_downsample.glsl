@@ -0,0 +1,41 @@
+#version 440
+
+/*
+ * Builds one level of the Hi-Z pyramid used for occlusion culling. Level 0 is copied from the
+ * depth buffer, every other level keeps the furthest depth of the texels it covers in the level
+ * above, so a single sample can tell if anything in an area could be in front of a given depth
+*/
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D s_Depth;
+layout(binding = 0, r32f) uniform readonly image2D  i_Source;
+layout(binding = 1, r32f) uniform writeonly image2D i_Dest;
+
+layout(location = 0) uniform bool  u_FromDepth;
+layout(location = 1) uniform ivec2 u_SourceSize;
+layout(location = 2) uniform ivec2 u_DestSize;
+
+void main() {
+    ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(coord, u_DestSize))) {
+        return;
+    }
+
+    if (u_FromDepth) {
+        imageStore(i_Dest, coord, vec4(texelFetch(s_Depth, coord, 0).r));
+        return;
+    }
+
+    // Odd sized levels need to fold in the extra row or column, or it would be lost
+    ivec2 base = coord * 2;
+    ivec2 extent = ivec2(2) + ivec2(greaterThan(u_SourceSize & 1, ivec2(0))) * ivec2(equal(coord, u_DestSize - 1));
+    float furthest = 0.0;
+    for (int y = 0; y < extent.y; y++) {
+        for (int x = 0; x < extent.x; x++) {
+            ivec2 source = min(base + ivec2(x, y), u_SourceSize - 1);
+            furthest = max(furthest, imageLoad(i_Source, source).r);
+        }
+    }
+    imageStore(i_Dest, coord, vec4(furthest));
+}
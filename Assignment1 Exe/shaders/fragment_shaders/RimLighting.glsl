@@ -3,29 +3,27 @@
 #include "../fragments/fs_common_inputs.glsl"
 #include "../fragments/multiple_point_lights.glsl"
 #include "../fragments/frame_uniforms.glsl"
-#include "../fragments/color_correction.glsl"
 
 layout(location = 0) out vec4 frag_color;
 
 struct Material {
-	sampler2D Diffuse;
-	sampler2D Specular;
 	float Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Specular;
 
 
 void main() {
 	vec3 normal = normalize(inNormal);
 	float rimIntensity = dot(eye, normal);
 
-	float specPower = texture(u_Material.Specular, inUV).r;
+	float specPower = texture(s_Specular, inUV).r;
 	vec3 eye = normalize(u_CamPos.xyz - inWorldPos);
-	vec4 texColor = texture(u_Material.Diffuse, inUV);
+	vec4 texColor = texture(s_Diffuse, inUV);
 	vec3 lightColor = vec3(1.0, 1.0, 1.0);
 
-	float strength = texture(u_Material.Specular, inUV).r;
+	float strength = texture(s_Specular, inUV).r;
 	
 	vec3 viewDirection = normalize(u_CamPos.xyz - inWorldPos);
 	vec3 reflectDirection = reflect(-viewDirection, normal); //to point towards player
@@ -21,11 +21,10 @@ layout(location = 0) out vec4 frag_color;
 // For instance, you can think of this like material settings in 
 // Unity
 struct Material {
-	sampler2D Diffuse;
 	float     Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_Diffuse;
 
 uniform sampler2D s_NormalMap;
 
@@ -34,7 +33,6 @@ uniform sampler2D s_NormalMap;
 ////////////////////////////////////////////////////////////////
 
 #include "../fragments/multiple_point_lights.glsl"
-#include "../fragments/color_correction.glsl"
 
 const float LOG_MAX = 2.40823996531;
 
@@ -53,10 +51,10 @@ void main() {
 	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, u_Material.Shininess);
 
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
 	// combine for the final result
 	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
 
-	frag_color = vec4(ColorCorrect(result), textureColor.a);
+	frag_color = vec4(result, textureColor.a);
 }
\ No newline at end of file
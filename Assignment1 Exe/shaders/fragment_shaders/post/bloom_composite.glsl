@@ -0,0 +1,18 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler2D s_Bloom;
+
+uniform layout(location = 0) float u_Intensity;
+
+void main() {
+    vec4 color = texture(s_Image, inUV);
+    // The bloom target is smaller than the image, the bilinear fetch does the upsample
+    vec3 bloom = texture(s_Bloom, inUV).rgb;
+
+    frag_color = vec4(color.rgb + bloom * u_Intensity, color.a);
+}
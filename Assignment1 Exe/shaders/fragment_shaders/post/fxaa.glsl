@@ -0,0 +1,124 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+uniform layout(location = 0) vec2  u_TexelSize;
+uniform layout(location = 1) float u_EdgeThreshold;
+uniform layout(location = 2) float u_EdgeThresholdMin;
+uniform layout(location = 3) float u_SubpixelQuality;
+
+// The number of steps taken along an edge to find it's ends, and how far each step goes
+#define EDGE_STEPS 8
+const float STEP_SIZES[EDGE_STEPS] = float[](1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 4.0, 8.0);
+
+float Luma(vec3 color) {
+    return sqrt(dot(color, vec3(0.299, 0.587, 0.114)));
+}
+
+float LumaAt(vec2 uv) {
+    return Luma(textureLod(s_Image, uv, 0.0).rgb);
+}
+
+void main() {
+    vec4 center = textureLod(s_Image, inUV, 0.0);
+    float lumaC = Luma(center.rgb);
+    float lumaN = LumaAt(inUV + vec2( 0.0,  1.0) * u_TexelSize);
+    float lumaS = LumaAt(inUV + vec2( 0.0, -1.0) * u_TexelSize);
+    float lumaE = LumaAt(inUV + vec2( 1.0,  0.0) * u_TexelSize);
+    float lumaW = LumaAt(inUV + vec2(-1.0,  0.0) * u_TexelSize);
+
+    // Skip pixels that aren't on an edge
+    float lumaMin = min(lumaC, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+    float lumaMax = max(lumaC, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+    float range = lumaMax - lumaMin;
+    if (range < max(u_EdgeThresholdMin, lumaMax * u_EdgeThreshold)) {
+        frag_color = center;
+        return;
+    }
+
+    float lumaNE = LumaAt(inUV + vec2( 1.0,  1.0) * u_TexelSize);
+    float lumaNW = LumaAt(inUV + vec2(-1.0,  1.0) * u_TexelSize);
+    float lumaSE = LumaAt(inUV + vec2( 1.0, -1.0) * u_TexelSize);
+    float lumaSW = LumaAt(inUV + vec2(-1.0, -1.0) * u_TexelSize);
+
+    // Figure out if the edge runs horizontally or vertically
+    float edgeH = abs(lumaNW + lumaNE - 2.0 * lumaN) + 2.0 * abs(lumaW + lumaE - 2.0 * lumaC) + abs(lumaSW + lumaSE - 2.0 * lumaS);
+    float edgeV = abs(lumaNW + lumaSW - 2.0 * lumaW) + 2.0 * abs(lumaN + lumaS - 2.0 * lumaC) + abs(lumaNE + lumaSE - 2.0 * lumaE);
+    bool isHorizontal = edgeH >= edgeV;
+
+    // Pick which side of the pixel the edge is on
+    float luma1 = isHorizontal ? lumaS : lumaW;
+    float luma2 = isHorizontal ? lumaN : lumaE;
+    float gradient1 = luma1 - lumaC;
+    float gradient2 = luma2 - lumaC;
+    bool isSide1 = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+    float stepLength = isHorizontal ? u_TexelSize.y : u_TexelSize.x;
+    float lumaLocalAverage;
+    if (isSide1) {
+        stepLength = -stepLength;
+        lumaLocalAverage = 0.5 * (luma1 + lumaC);
+    } else {
+        lumaLocalAverage = 0.5 * (luma2 + lumaC);
+    }
+
+    // Move onto the edge itself, then walk along it in both directions until we leave it
+    vec2 edgeUV = inUV;
+    if (isHorizontal) {
+        edgeUV.y += stepLength * 0.5;
+    } else {
+        edgeUV.x += stepLength * 0.5;
+    }
+    vec2 offset = isHorizontal ? vec2(u_TexelSize.x, 0.0) : vec2(0.0, u_TexelSize.y);
+
+    vec2 uv1 = edgeUV - offset;
+    vec2 uv2 = edgeUV + offset;
+    float lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+    float lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+    bool reached1 = abs(lumaEnd1) >= gradientScaled;
+    bool reached2 = abs(lumaEnd2) >= gradientScaled;
+
+    for (int ix = 1; ix < EDGE_STEPS && !(reached1 && reached2); ix++) {
+        if (!reached1) {
+            uv1 -= offset * STEP_SIZES[ix];
+            lumaEnd1 = LumaAt(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2) {
+            uv2 += offset * STEP_SIZES[ix];
+            lumaEnd2 = LumaAt(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    // The closer end of the edge decides how far across it we blend
+    float distance1 = isHorizontal ? (inUV.x - uv1.x) : (inUV.y - uv1.y);
+    float distance2 = isHorizontal ? (uv2.x - inUV.x) : (uv2.y - inUV.y);
+    bool isDirection1 = distance1 < distance2;
+    float distanceFinal = min(distance1, distance2);
+    float edgeLength = distance1 + distance2;
+
+    bool isLumaCenterSmaller = lumaC < lumaLocalAverage;
+    bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+    float pixelOffset = correctVariation ? (-distanceFinal / edgeLength + 0.5) : 0.0;
+
+    // Sub-pixel aliasing, based on how different the pixel is from it's 3x3 neighbourhood
+    float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaN + lumaS + lumaE + lumaW) + lumaNE + lumaNW + lumaSE + lumaSW);
+    float subPixelOffset = clamp(abs(lumaAverage - lumaC) / range, 0.0, 1.0);
+    subPixelOffset = (-2.0 * subPixelOffset + 3.0) * subPixelOffset * subPixelOffset;
+    subPixelOffset = subPixelOffset * subPixelOffset * u_SubpixelQuality;
+    pixelOffset = max(pixelOffset, subPixelOffset);
+
+    vec2 finalUV = inUV;
+    if (isHorizontal) {
+        finalUV.y += pixelOffset * stepLength;
+    } else {
+        finalUV.x += pixelOffset * stepLength;
+    }
+    frag_color = vec4(textureLod(s_Image, finalUV, 0.0).rgb, center.a);
+}
@@ -0,0 +1,41 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+// Must match ToneMapOperator in ToneMappingEffect.h
+#define TONEMAP_REINHARD 0
+#define TONEMAP_ACES     1
+#define TONEMAP_CLAMP    2
+
+uniform layout(location = 0) int   u_Operator;
+uniform layout(location = 1) float u_Exposure;
+
+// Krzysztof Narkowicz's fit of the ACES filmic curve
+vec3 Aces(vec3 x) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return (x * (a * x + b)) / (x * (c * x + d) + e);
+}
+
+void main() {
+    vec4 color = texture(s_Image, inUV);
+    vec3 hdr = color.rgb * u_Exposure;
+
+    vec3 result;
+    if (u_Operator == TONEMAP_REINHARD) {
+        result = hdr / (hdr + vec3(1.0));
+    } else if (u_Operator == TONEMAP_ACES) {
+        result = Aces(hdr);
+    } else {
+        result = hdr;
+    }
+
+    frag_color = vec4(clamp(result, 0.0, 1.0), color.a);
+}
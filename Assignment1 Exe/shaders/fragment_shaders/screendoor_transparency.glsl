@@ -9,12 +9,11 @@ layout(location = 0) out vec4 frag_color;
 // For instance, you can think of this like material settings in 
 // Unity
 struct Material {
-	sampler2D Diffuse;
 	float     Shininess;
     float     Threshold;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_Diffuse;
 
 #include "../fragments/multiple_point_lights.glsl"
 #include "../fragments/frame_uniforms.glsl"
@@ -22,12 +21,18 @@ uniform Material u_Material;
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
     if (textureColor.a < u_Material.Threshold) {
         discard;
     }
 
+#ifdef DEPTH_PREPASS
+    // The depth pre-pass only needs our alpha test, everything else can be compiled out
+    frag_color = vec4(0.0);
+    return;
+#endif
+
 	// Normalize our input normal
 	vec3 normal = normalize(inNormal);
 
@@ -13,12 +13,11 @@ layout(location = 0) out vec4 frag_color;
 // For instance, you can think of this like material settings in 
 // Unity
 struct Material {
-	sampler2D Diffuse;
-	sampler2D Specular;
 	float Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Specular;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
@@ -31,14 +30,13 @@ uniform Material u_Material;
 ////////////////////////////////////////////////////////////////
 
 #include "../fragments/frame_uniforms.glsl"
-#include "../fragments/color_correction.glsl"
 
 // https://learnopengl.com/Advanced-Lighting/Advanced-Lighting
 void main() {
 	// Normalize our input normal
 	vec3 normal = normalize(inNormal);
 
-	float specPower = texture(u_Material.Specular, inUV).r;
+	float specPower = texture(s_Specular, inUV).r;
 	
 	vec3 toEye = normalize(u_CamPos.xyz - inWorldPos);
 	vec3 environmentDir = reflect(-toEye, normal);
@@ -48,10 +46,10 @@ void main() {
 	vec3 lightAccumulation = CalcAllLightContribution(inWorldPos, normal, u_CamPos.xyz, specPower);
 
 	// Get the albedo from the diffuse / albedo map
-	vec4 textureColor = texture(u_Material.Diffuse, inUV);
+	vec4 textureColor = texture(s_Diffuse, inUV);
 
 	// combine for the final result
 	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
 
-	frag_color = vec4(ColorCorrect(mix(result, reflected, specPower)), textureColor.a);
+	frag_color = vec4(mix(result, reflected, specPower), textureColor.a);
 }
\ No newline at end of file
@@ -17,6 +17,8 @@ layout (std140, binding = 0) uniform b_FrameLevelUniforms {
 };
 
 // Stores uniforms that change every object/instance
+// Multi-draw variants read these per draw instead, see vs_common.glsl
+#ifndef MULTI_DRAW
 layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     // Complete MVP
     uniform mat4 u_ModelViewProjection;
@@ -25,8 +27,13 @@ layout (std140, binding = 1) uniform b_InstanceLevelUniforms {
     // Normal Matrix for transforming normals
     uniform mat4 u_NormalMatrix;
 };
+#endif
 
 #define FLAG_ENABLE_COLOR_CORRECTION (1 << 0)
+#define FLAG_ENABLE_DEPTH_PREPASS    (1 << 1)
+#define FLAG_ENABLE_MULTI_DRAW       (1 << 2)
+#define FLAG_ENABLE_GPU_CULLING      (1 << 3)
+#define FLAG_ENABLE_OCCLUSION_CULLING (1 << 4)
 
 bool IsFlagSet(uint flag) {
     return (u_Flags & flag) != 0;
@@ -0,0 +1,21 @@
+/*
+ * Shared definitions for clustered lighting, used by both the compute
+ * passes that build the light grid and the fragment shaders that read it
+*/
+
+// The most lights a single cluster can reference, must match ClusteredLightGrid::MAX_LIGHTS_PER_CLUSTER
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+// Represents a single light source
+struct Light {
+	// Stores position in xyz, and the radius past which the light has no effect in w
+	vec4  Position;
+	// Stores color in RBG and attenuation in w
+	vec4  ColorAttenuation;
+};
+
+// The view space bounds of a single cluster
+struct ClusterBounds {
+	vec4 Min;
+	vec4 Max;
+};
@@ -9,15 +9,12 @@
  * vec3 lighting = CalculateAllLightContribution(inWorldPos, normal, u_CamPos);
 */
 
-// The maximum number of lights the shader supports, increasing this will lower performance!
-#define MAX_LIGHTS 8
-
-// Represents a single light source
-struct Light {
-	vec4  Position;
-	// Stores color in RBG and attenuation in w
-	vec4  ColorAttenuation;
-};
+// Light and cluster structures shared with the light culling compute pass
+#include "light_clusters.glsl"
+// We need the view matrix to find which depth slice a fragment is in
+#include "frame_uniforms.glsl"
+// Shadow atlas lookups for the sun and point lights
+#include "shadows.glsl"
 
 // Our uniform buffer that will store all our lighting data
 // so that it can be shared between shaders
@@ -26,14 +23,36 @@ layout (std140, binding = 2) uniform b_LightBlock {
 	// of lights in w, allowing for easier struct packing
 	// on the C++ side
     vec4  AmbientColAndNumLights;
-
-    // Our array of all lights
-    Light Lights[MAX_LIGHTS];
+    // The direction the sun is shining in
+    vec4  SunDirection;
+    // The color of the sun, black if the scene has no sun
+    vec4  SunColor;
 
     // The rotation of the skybox/environment map
 	mat3  EnvironmentRotation;
 };
 
+// Describes the layout of the light grid, see ClusteredLightGrid
+layout (std140, binding = 4) uniform b_ClusterParams {
+    // The number of clusters along x, y and depth
+    uvec4 ClusterGridSize;
+    // xy is the reciprocal of the tile size in pixels, z and w are the scale and bias
+    // to map log(view depth) to a depth slice
+    vec4  ClusterScaleBias;
+};
+
+// All the lights in the scene, as many as we like
+layout (std430, binding = 4) readonly buffer b_Lights {
+    Light Lights[];
+};
+// For each cluster, the offset and count of it's lights in LightIndices
+layout (std430, binding = 5) readonly buffer b_LightGrid {
+    uvec2 LightGrid[];
+};
+layout (std430, binding = 6) readonly buffer b_LightIndices {
+    uint LightIndices[];
+};
+
 // Uniform for our environment map / skybox, bound to slot 0 by default
 uniform layout(binding=15) samplerCube s_EnvironmentMap;
 
@@ -77,13 +96,38 @@ vec3 CalcPointLightContribution(vec3 worldPos, vec3 normal, vec3 viewDir, Light
 	// We'll use a modified distance squared attenuation factor to keep it simple
 	// We add the one to prevent divide by zero errors
 	float attenuation = clamp(1.0 / (1.0 + light.ColorAttenuation.w * pow(dist, 2)), 0, 1);
+	// Fade out to nothing at the light's radius, so there's no seam where it's culled
+	float falloff = clamp(1.0 - pow(dist / light.Position.w, 4), 0, 1);
+	attenuation *= falloff * falloff;
 
 	return (diffuseOut + specularOut) * attenuation;
 }
 
+// Calculates the contribution of the scene's directional light
+// @param normal    The fragment's normal (normalized)
+// @param viewDir   Direction between camera and fragment
+// @param shininess The specular power for the fragment, between 0 and 1
+vec3 CalcSunContribution(vec3 normal, vec3 viewDir, float shininess) {
+	vec3 toLight = -SunDirection.xyz;
+	vec3 halfDir = normalize(toLight + viewDir);
+
+	float specPower     = pow(max(dot(normal, halfDir), 0.0), pow(256, shininess));
+	float diffuseFactor = max(dot(normal, toLight), 0);
+	return (diffuseFactor + specPower) * SunColor.rgb;
+}
+
+// Finds the index of the cluster that the current fragment belongs to
+// @param depth    The fragment's distance from the camera along the view direction
+uint GetClusterIndex(float depth) {
+	depth = max(depth, 0.0001);
+	uint  slice = uint(clamp(log(depth) * ClusterScaleBias.z + ClusterScaleBias.w, 0.0, float(ClusterGridSize.z - 1)));
+	uvec2 tile  = min(uvec2(gl_FragCoord.xy * ClusterScaleBias.xy), ClusterGridSize.xy - 1);
+	return tile.x + ClusterGridSize.x * (tile.y + ClusterGridSize.y * slice);
+}
+
 /*
- * Calculates the lighting contribution for all lights in the scene
- * for a given fragment
+ * Calculates the lighting contribution for all lights affecting the
+ * fragment's cluster
  * @param worldPos The fragment's position in world space
  * @param normal The normalized surface normal for the fragment
  * @param camPos The camera's position in world space
@@ -94,11 +138,19 @@ vec3 CalcAllLightContribution(vec3 worldPos, vec3 normal, vec3 camPos, float shi
 
 	// Direction between camera and fragment will be shared for all lights
 	vec3 viewDir  = normalize(camPos - worldPos);
-	
-	// Iterate over all lights
-	for(int ix = 0; ix < AmbientColAndNumLights.w && ix < MAX_LIGHTS; ix++) {
+	float viewDepth = -(u_View * vec4(worldPos, 1.0)).z;
+
+	if (dot(SunColor.rgb, SunColor.rgb) > 0.0) {
+		lightAccumulation += CalcSunContribution(normal, viewDir, shininess) * CalcSunShadow(worldPos, normal, viewDepth);
+	}
+
+	// Only iterate over the lights that the culling pass found in our cluster
+	uvec2 cluster = LightGrid[GetClusterIndex(viewDepth)];
+	for(uint ix = 0; ix < cluster.y; ix++) {
+		uint  lightIndex = LightIndices[cluster.x + ix];
+		Light light = Lights[lightIndex];
 		// Additive lighting model
-		lightAccumulation += CalcPointLightContribution(worldPos, normal, viewDir, Lights[ix], shininess);
+		lightAccumulation += CalcPointLightContribution(worldPos, normal, viewDir, light, shininess) * CalcPointShadow(lightIndex, worldPos, normal, light.Position.xyz);
 	}
 
 	return lightAccumulation;
@@ -1,3 +1,7 @@
+#ifdef MULTI_DRAW
+// Extensions have to come before anything else in the shader, which is why this lives up here
+#extension GL_ARB_shader_draw_parameters : require
+#endif
 
 // Vertex inputs
 layout(location = 0) in vec3 inPosition;
@@ -8,6 +12,10 @@ layout(location = 3) in vec2 inUV;
 layout(location = 4) in vec3 inTangent;
 layout(location = 5) in vec3 inBiTangent;
 
+// The depth pre-pass draws with a different program and the main pass tests with GL_EQUAL,
+// so every program needs to produce bit-identical positions for the same inputs
+invariant gl_Position;
+
 // Standard vertex shader outputs
 layout(location = 0) out vec3 outWorldPos;
 layout(location = 1) out vec3 outColor;
@@ -17,3 +25,21 @@ layout(location = 4) out mat3 outTBN;
 
 // Include the matrices and frame level parameters
 #include "frame_uniforms.glsl"
+
+#ifdef MULTI_DRAW
+// Matches MultiDrawRenderer::DrawData
+struct DrawData {
+    mat4 ModelViewProjection;
+    mat4 Model;
+    mat4 NormalMatrix;
+};
+layout (std430, binding = 11) readonly buffer b_DrawData {
+    DrawData Draws[];
+};
+
+// Each batch starts it's commands at BaseInstance, and gl_DrawID counts up from there
+#define DRAW_INDEX (gl_BaseInstanceARB + gl_DrawIDARB)
+#define u_ModelViewProjection Draws[DRAW_INDEX].ModelViewProjection
+#define u_Model Draws[DRAW_INDEX].Model
+#define u_NormalMatrix Draws[DRAW_INDEX].NormalMatrix
+#endif
@@ -0,0 +1,9 @@
+#version 440
+
+// Position-only vertex shader for the depth pre-pass. This must calculate gl_Position
+// exactly the same way as basic.glsl, so that the main pass can test with GL_EQUAL
+#include "../fragments/vs_common.glsl"
+
+void main() {
+	gl_Position = u_ModelViewProjection * vec4(inPosition, 1.0);
+}
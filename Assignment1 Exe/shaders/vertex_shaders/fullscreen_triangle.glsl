@@ -0,0 +1,11 @@
+#version 440
+
+// Builds a single triangle that covers the whole viewport from gl_VertexID, so
+// full-screen passes don't need any vertex buffers
+layout(location = 0) out vec2 outUV;
+
+void main() {
+    vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    outUV = uv;
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,87 @@
+#version 430
+
+/*
+ * Bins all the scene's lights into the cluster grid. Each invocation handles a single
+ * cluster, and the work group loads lights into shared memory in batches so that every
+ * light is only read from the buffer and transformed into view space once per group
+*/
+
+layout(local_size_x = 128) in;
+
+#include "../fragments/light_clusters.glsl"
+
+layout(std430, binding = 4) readonly buffer b_Lights {
+    Light Lights[];
+};
+layout(std430, binding = 5) writeonly buffer b_LightGrid {
+    uvec2 LightGrid[];
+};
+layout(std430, binding = 6) writeonly buffer b_LightIndices {
+    uint LightIndices[];
+};
+layout(std430, binding = 7) readonly buffer b_ClusterBounds {
+    ClusterBounds Bounds[];
+};
+// Reset to 0 before every dispatch
+layout(std430, binding = 9) buffer b_LightIndexCounter {
+    uint NextLightIndex;
+};
+
+layout(location = 0) uniform mat4 u_View;
+layout(location = 1) uniform int  u_NumLights;
+layout(location = 2) uniform int  u_NumClusters;
+
+// View space position in xyz, radius in w
+shared vec4 s_Lights[gl_WorkGroupSize.x];
+
+bool SphereIntersectsAabb(vec4 sphere, ClusterBounds bounds) {
+    vec3 closest = clamp(sphere.xyz, bounds.Min.xyz, bounds.Max.xyz);
+    vec3 delta = closest - sphere.xyz;
+    return dot(delta, delta) <= sphere.w * sphere.w;
+}
+
+void main() {
+    uint numLights = uint(u_NumLights);
+    uint numClusters = uint(u_NumClusters);
+    uint cluster = gl_GlobalInvocationID.x;
+    bool isValid = cluster < numClusters;
+
+    ClusterBounds bounds;
+    if (isValid) {
+        bounds = Bounds[cluster];
+    }
+
+    uint visible[MAX_LIGHTS_PER_CLUSTER];
+    uint count = 0;
+
+    for (uint batchStart = 0; batchStart < numLights; batchStart += gl_WorkGroupSize.x) {
+        // Every invocation loads one light of the batch, even if it has no cluster of its own
+        uint lightIndex = batchStart + gl_LocalInvocationIndex;
+        if (lightIndex < numLights) {
+            vec4 light = Lights[lightIndex].Position;
+            s_Lights[gl_LocalInvocationIndex] = vec4((u_View * vec4(light.xyz, 1.0)).xyz, light.w);
+        }
+        barrier();
+
+        uint batchSize = min(gl_WorkGroupSize.x, numLights - batchStart);
+        if (isValid) {
+            for (uint ix = 0; ix < batchSize && count < MAX_LIGHTS_PER_CLUSTER; ix++) {
+                if (SphereIntersectsAabb(s_Lights[ix], bounds)) {
+                    visible[count++] = batchStart + ix;
+                }
+            }
+        }
+        barrier();
+    }
+
+    if (!isValid) {
+        return;
+    }
+
+    // Reserve space in the shared index list, then copy our lights over
+    uint offset = atomicAdd(NextLightIndex, count);
+    for (uint ix = 0; ix < count; ix++) {
+        LightIndices[offset + ix] = visible[ix];
+    }
+    LightGrid[cluster] = uvec2(offset, count);
+}
@@ -3,17 +3,15 @@
 #include "../fragments/fs_common_inputs.glsl"
 #include "../fragments/multiple_point_lights.glsl"
 #include "../fragments/frame_uniforms.glsl"
-#include "../fragments/color_correction.glsl"
 
 layout(location = 0) out vec4 frag_color;
 
 struct Material {
-	sampler2D Diffuse;
-	sampler2D Specular;
 	float Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_Diffuse;
+uniform sampler2D s_Specular;
 
 void main() {
 	// Normalize our input normal
@@ -0,0 +1,5 @@
+#version 430
+
+// The depth pre-pass only needs depth, which is written for us
+void main() {
+}
@@ -21,19 +21,17 @@ layout(location = 0) out vec4 frag_color;
 // For instance, you can think of this like material settings in 
 // Unity
 struct Material {
-	sampler2D DiffuseA;
-	sampler2D DiffuseB;
 	float     Shininess;
 };
-// Create a uniform for the material
-uniform Material u_Material;
+#include "../fragments/material_uniforms.glsl"
+uniform sampler2D s_DiffuseA;
+uniform sampler2D s_DiffuseB;
 
 ////////////////////////////////////////////////////////////////
 ///////////// Application Level Uniforms ///////////////////////
 ////////////////////////////////////////////////////////////////
 
 #include "../fragments/multiple_point_lights.glsl"
-#include "../fragments/color_correction.glsl"
 
 const float LOG_MAX = 2.40823996531;
 
@@ -52,11 +50,11 @@ void main() {
 
 	// Perform our texture mixing, we'll calculate our albedo as the sum of the texture and it's weight
 	vec4 textureColor = 
-        texture(u_Material.DiffuseA, inUV) * texWeight.x + 
-        texture(u_Material.DiffuseB, inUV) * texWeight.y;
+        texture(s_DiffuseA, inUV) * texWeight.x + 
+        texture(s_DiffuseB, inUV) * texWeight.y;
 
 	// combine for the final result
 	vec3 result = lightAccumulation  * inColor * textureColor.rgb;
 
-	frag_color = vec4(ColorCorrect(result), textureColor.a);
+	frag_color = vec4(result, textureColor.a);
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+uniform layout(location = 0) float u_Threshold;
+uniform layout(location = 1) float u_SoftKnee;
+
+void main() {
+    vec3 color = texture(s_Image, inUV).rgb;
+    float brightness = max(color.r, max(color.g, color.b));
+
+    // Quadratic falloff below the threshold, so highlights fade in instead of popping
+    float knee = u_Threshold * u_SoftKnee + 0.0001;
+    float soft = clamp(brightness - u_Threshold + knee, 0.0, 2.0 * knee);
+    soft = (soft * soft) / (4.0 * knee);
+
+    float contribution = max(soft, brightness - u_Threshold) / max(brightness, 0.0001);
+    frag_color = vec4(color * contribution, 1.0);
+}
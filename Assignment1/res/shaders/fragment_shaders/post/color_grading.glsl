@@ -0,0 +1,19 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+uniform layout(binding = 1) sampler3D s_ColorLUT;
+
+uniform layout(location = 0) float u_Strength;
+
+void main() {
+    vec4 color = texture(s_Image, inUV);
+
+    // The LUT only covers [0, 1], HDR values would otherwise land on the edge texels anyways
+    vec3 graded = texture(s_ColorLUT, clamp(color.rgb, 0.0, 1.0)).rgb;
+
+    frag_color = vec4(mix(color.rgb, graded, u_Strength), color.a);
+}
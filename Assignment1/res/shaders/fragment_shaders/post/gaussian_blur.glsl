@@ -0,0 +1,23 @@
+#version 440
+
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 frag_color;
+
+uniform layout(binding = 0) sampler2D s_Image;
+
+// The size of one texel along the direction we're blurring in
+uniform layout(location = 0) vec2 u_Direction;
+
+// 9 tap gaussian, folded into 5 bilinear fetches by sampling between texel pairs
+const float OFFSETS[3] = float[](0.0, 1.3846153846, 3.2307692308);
+const float WEIGHTS[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
+
+void main() {
+    vec3 result = texture(s_Image, inUV).rgb * WEIGHTS[0];
+    for (int ix = 1; ix < 3; ix++) {
+        result += texture(s_Image, inUV + u_Direction * OFFSETS[ix]).rgb * WEIGHTS[ix];
+        result += texture(s_Image, inUV - u_Direction * OFFSETS[ix]).rgb * WEIGHTS[ix];
+    }
+    frag_color = vec4(result, 1.0);
+}
@@ -0,0 +1,9 @@
+// Non-texture material parameters are packed by the material into a shared uniform buffer,
+// so switching materials only needs a single range bind. Include this after declaring the
+// shader's Material struct.
+//
+// Samplers can't live in a uniform block, so textures are declared as plain s_* samplers
+// next to this include, and their slots are assigned by the material
+layout (std140, binding = 3) uniform b_MaterialUniforms {
+	Material u_Material;
+};
@@ -0,0 +1,101 @@
+/*
+ * Shadow lookups for the sun's cascades and for shadowed point lights. All shadow
+ * maps live in a single depth atlas, see ShadowRenderer for how it is laid out
+*/
+
+// Must match ShadowRenderer::MAX_SHADOW_VIEWS
+#define MAX_SHADOW_VIEWS 52
+
+// A single shadow map within the atlas
+struct ShadowView {
+    // Transforms world space into the view's clip space
+    mat4 ViewProjection;
+    // The view's region of the atlas in UV space, offset in xy and size in zw
+    vec4 AtlasRect;
+};
+
+layout (std140, binding = 5) uniform b_ShadowBlock {
+    // The view depth at the far end of each cascade
+    vec4 CascadeSplits;
+    // x is the number of sun cascades (0 if the sun has no shadows), y is the size of
+    // an atlas texel in UV space, z is the depth bias, w is the normal offset in world units
+    vec4 ShadowParams;
+    // Cascades come first, then 6 faces for each shadowed point light
+    ShadowView ShadowViews[MAX_SHADOW_VIEWS];
+};
+
+// For each light in b_Lights, the index of it's first shadow view or -1 if it has no shadows
+layout (std430, binding = 10) readonly buffer b_LightShadows {
+    int LightShadowView[];
+};
+
+uniform layout(binding=13) sampler2DShadow s_ShadowAtlas;
+
+// Samples a single shadow view with a 3x3 PCF kernel
+// @param view     The index of the view in ShadowViews
+// @param worldPos The position to test in world space
+// @returns 1 if the point is fully lit, 0 if it is fully shadowed
+float SampleShadowView(int view, vec3 worldPos) {
+    vec4 clip = ShadowViews[view].ViewProjection * vec4(worldPos, 1.0);
+    vec3 coords = (clip.xyz / clip.w) * 0.5 + 0.5;
+    // Anything outside of the view can't be shadowed by it
+    if (any(lessThan(coords, vec3(0.0))) || any(greaterThan(coords, vec3(1.0)))) {
+        return 1.0;
+    }
+
+    vec4  rect  = ShadowViews[view].AtlasRect;
+    float texel = ShadowParams.y;
+    vec2  uv    = rect.xy + coords.xy * rect.zw;
+    // Keep the kernel from reading into neighbouring views
+    vec2  lower = rect.xy + vec2(texel * 1.5);
+    vec2  upper = rect.xy + rect.zw - vec2(texel * 1.5);
+    float depth = coords.z - ShadowParams.z;
+
+    float result = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            result += texture(s_ShadowAtlas, vec3(clamp(uv + vec2(x, y) * texel, lower, upper), depth));
+        }
+    }
+    return result / 9.0;
+}
+
+// Gets how much of the sun reaches the given point
+// @param worldPos  The position in world space
+// @param normal    The surface normal, used to push the lookup away from the surface
+// @param viewDepth The distance of the point from the camera along it's view direction
+float CalcSunShadow(vec3 worldPos, vec3 normal, float viewDepth) {
+    int numCascades = int(ShadowParams.x);
+    for (int ix = 0; ix < numCascades; ix++) {
+        if (viewDepth <= CascadeSplits[ix]) {
+            // Texels get bigger in the further cascades, so the offset needs to grow with them
+            return SampleShadowView(ix, worldPos + normal * ShadowParams.w * float(1 << ix));
+        }
+    }
+    return 1.0;
+}
+
+// Gets how much of a point light reaches the given point
+// @param lightIndex The index of the light in b_Lights
+// @param worldPos   The position in world space
+// @param normal     The surface normal, used to push the lookup away from the surface
+// @param lightPos   The position of the light in world space
+float CalcPointShadow(uint lightIndex, vec3 worldPos, vec3 normal, vec3 lightPos) {
+    int firstView = LightShadowView[lightIndex];
+    if (firstView < 0) {
+        return 1.0;
+    }
+
+    // Pick the cube face the point falls in, faces are ordered +X, -X, +Y, -Y, +Z, -Z
+    vec3 dir = worldPos - lightPos;
+    vec3 absDir = abs(dir);
+    int face;
+    if (absDir.x >= absDir.y && absDir.x >= absDir.z) {
+        face = dir.x > 0.0 ? 0 : 1;
+    } else if (absDir.y >= absDir.z) {
+        face = dir.y > 0.0 ? 2 : 3;
+    } else {
+        face = dir.z > 0.0 ? 4 : 5;
+    }
+    return SampleShadowView(firstView + face, worldPos + normal * ShadowParams.w);
+}
@@ -0,0 +1,12 @@
+#version 430
+
+// Depth-only vertex shader used to render shadow maps, only positions are needed
+
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) uniform mat4 u_LightViewProjection;
+layout(location = 1) uniform mat4 u_Model;
+
+void main() {
+	gl_Position = u_LightViewProjection * u_Model * vec4(inPosition, 1.0);
+}
@@ -7,6 +7,9 @@
 #include "Logging.h"
 #include "Gameplay/InputEngine.h"
 #include "Application/Timing.h"
+#include "Utils/Profiler.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/FrameArena.h"
 #include <filesystem>
 #include "Layers/GLAppLayer.h"
 #include "Utils/FileHelpers.h"
@@ -59,6 +62,9 @@
 #include "Layers/ImGuiDebugLayer.h"
 #include "Layers/InstancedRenderingTestLayer.h"
 #include "Layers/ParticleLayer.h"
+#include "Layers/PostProcessingLayer.h"
+#include "Layers/GuiBenchmarkLayer.h"
+#include "Layers/BenchmarkLayer.h"
 
 Application* Application::_singleton = nullptr;
 std::string Application::_applicationName = "INFR-2350U - DEMO";
@@ -71,6 +77,8 @@ Application::Application() :
 	_windowSize({DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT}),
 	_isRunning(false),
 	_isEditor(true),
+	_isHeadless(false),
+	_fixedDeltaTime(0.0f),
 	_windowTitle("100781346 - Assignment 1"),
 	_currentScene(nullptr),
 	_targetScene(nullptr),
@@ -87,6 +95,7 @@ Application& Application::Get() {
 void Application::Start(int argCount, char** arguments) {
 	LOG_ASSERT(_singleton == nullptr, "Application has already been started!");
 	_singleton = new Application();
+	_singleton->_launchArguments = _ParseArguments(argCount, arguments);
 	_singleton->_Run();
 }
 
@@ -112,13 +121,29 @@ void Application::Quit() {
 	_isRunning = false;
 }
 
+bool Application::IsHeadless() const {
+	return _isHeadless;
+}
+
+void Application::SetFixedDeltaTime(float value) {
+	_fixedDeltaTime = value < 0.0f ? 0.0f : value;
+}
+
+float Application::GetFixedDeltaTime() const {
+	return _fixedDeltaTime;
+}
+
 bool Application::LoadScene(const std::string& path) {
 	if (std::filesystem::exists(path)) { 
 
 		std::string manifestPath = std::filesystem::path(path).stem().string() + "-manifest.json";
 		if (std::filesystem::exists(manifestPath)) {
 			LOG_INFO("Loading manifest from \"{}\"", manifestPath);
+			// Let the driver compile all the scene's shaders in parallel, materials will use
+			// a fallback until theirs are ready
+			ShaderProgram::BeginCompileBatch();
 			ResourceManager::LoadManifest(manifestPath);
+			ShaderProgram::EndCompileBatch();
 		}
 
 		Gameplay::Scene::Sptr scene = Gameplay::Scene::Load(path);
@@ -146,13 +171,28 @@ void Application::SaveSettings()
 
 void Application::_Run()
 {
+	// Benchmarks run without the editor, and load their scene from disk instead of building the default one
+	if (JsonGet(_launchArguments, "benchmark", false)) {
+		_isHeadless = true;
+		_isEditor = false;
+	}
+
 	// TODO: Register layers
 	_layers.push_back(std::make_shared<GLAppLayer>());
-	_layers.push_back(std::make_shared<DefaultSceneLayer>());
+	if (_isHeadless) {
+		_layers.push_back(std::make_shared<BenchmarkLayer>());
+	} else {
+		_layers.push_back(std::make_shared<DefaultSceneLayer>());
+	}
 	_layers.push_back(std::make_shared<LogicUpdateLayer>());
 	_layers.push_back(std::make_shared<RenderLayer>());
 	_layers.push_back(std::make_shared<ParticleLayer>());
+	_layers.push_back(std::make_shared<PostProcessingLayer>());
 	//_layers.push_back(std::make_shared<InstancedRenderingTestLayer>());
+	// The GUI benchmark fills the scene with HUD elements and logs it's timings, so it's only added when asked for
+	if (JsonGet(_launchArguments, "gui-benchmark", false)) {
+		_layers.push_back(std::make_shared<GuiBenchmarkLayer>());
+	}
 	_layers.push_back(std::make_shared<InterfaceLayer>());
 
 	// If we're in editor mode, we add all the editor layers
@@ -183,8 +223,13 @@ void Application::_Run()
 	// Done loading, app is now running!
 	_isRunning = true;
 
+	Profiler::SetThreadName("Main");
+
 	// Infinite loop as long as the application is running
 	while (_isRunning) {
+		Profiler::BeginFrame();
+		FrameArena::BeginFrame();
+
 		// Handle scene switching
 		if (_targetScene != nullptr) {
 			_HandleSceneChange();
@@ -193,6 +238,9 @@ void Application::_Run()
 		// Receive events like input and window position/size changes from GLFW
 		glfwPollEvents();
 
+		// Finish linking any shaders the driver has compiled in the background
+		ShaderProgram::PollPendingPrograms();
+
 		// Handle closing the app via the close button
 		if (glfwWindowShouldClose(_window)) {
 			_isRunning = false;
@@ -203,7 +251,7 @@ void Application::_Run()
 
 		// Figure out the current time, and the time since the last frame
 		double thisFrame = glfwGetTime();
-		float dt = static_cast<float>(thisFrame - lastFrame);
+		float dt = _fixedDeltaTime > 0.0f ? _fixedDeltaTime : static_cast<float>(thisFrame - lastFrame);
 		float scaledDt = dt * timing._timeScale;
 
 		// Update all timing values
@@ -231,7 +279,13 @@ void Application::_Run()
 		InputEngine::EndFrame();
 		ImGuiHelper::EndFrame();
 
-		glfwSwapBuffers(_window);
+		{
+			PROFILE_SCOPE("Swap Buffers");
+			glfwSwapBuffers(_window);
+		}
+
+		MemoryTracker::EndFrame();
+		Profiler::EndFrame();
 
 	}
 
@@ -293,8 +347,11 @@ void Application::_Load() {
 }
 
 void Application::_Update() {
+	PROFILE_SCOPE("Update");
+	MEMORY_SCOPE(Scene);
 	for (const auto& layer : _layers) {
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnUpdate)) {
+			PROFILE_SCOPE(layer->Name.c_str());
 			layer->OnUpdate();
 		}
 	}
@@ -306,8 +363,11 @@ void Application::_Update() {
 }
 
 void Application::_LateUpdate() {
+	PROFILE_SCOPE("Late Update");
+	MEMORY_SCOPE(Scene);
 	for (const auto& layer : _layers) {
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnLateUpdate)) {
+			PROFILE_SCOPE(layer->Name.c_str());
 			layer->OnLateUpdate();
 		}
 	}
@@ -315,6 +375,8 @@ void Application::_LateUpdate() {
 
 void Application::_PreRender()
 {
+	PROFILE_SCOPE("Pre Render");
+	MEMORY_SCOPE(Render);
 	glm::ivec2 size ={ 0, 0 };
 	glfwGetWindowSize(_window, &size.x, &size.y);
 	glViewport(0, 0, size.x, size.y);
@@ -325,16 +387,21 @@ void Application::_PreRender()
 
 	for (const auto& layer : _layers) {
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnPreRender)) {
+			PROFILE_SCOPE(layer->Name.c_str());
 			layer->OnPreRender();
 		}
 	}
 }
 
 void Application::_RenderScene() {
+	PROFILE_SCOPE("Render");
+	MEMORY_SCOPE(Render);
 
 	Framebuffer::Sptr result = nullptr;
 	for (const auto& layer : _layers) {
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnRender)) {
+			// Each layer is timed on the GPU as well, so we can see which ones are actually expensive to draw
+			PROFILE_RENDER_SCOPE(layer->Name.c_str());
 			layer->OnRender(result);
 			Framebuffer::Sptr layerResult = layer->GetRenderOutput(); 
 			result = layerResult != nullptr ? layerResult : result;
@@ -345,10 +412,13 @@ void Application::_RenderScene() {
 }
 
 void Application::_PostRender() {
+	PROFILE_SCOPE("Post Render");
+	MEMORY_SCOPE(Render);
 	// Note that we use a reverse iterator for post render
 	for (auto it = _layers.crbegin(); it != _layers.crend(); it++) {
 		const auto& layer = *it;
 		if (layer->Enabled && *(layer->Overrides & AppLayerFunctions::OnPostRender)) {
+			PROFILE_SCOPE(layer->Name.c_str());
 			layer->OnPostRender();
 			Framebuffer::Sptr layerResult = layer->GetPostRenderOutput();
 			_renderOutput = layerResult != nullptr ? layerResult : _renderOutput;
@@ -386,6 +456,13 @@ void Application::_Unload() {
 		}
 	}
 
+	// Release builds have no debug UI, so captures can be written out automatically instead
+	std::string tracePath = JsonGet<std::string>(_appSettings, "profiler_trace_path", "");
+	if (!tracePath.empty()) {
+		Profiler::ExportChromeTrace(tracePath);
+	}
+	Profiler::Cleanup();
+
 	// Clean up ImGui
 	ImGuiHelper::Cleanup();
 }
@@ -436,6 +513,12 @@ void Application::_ConfigureSettings() {
 	// Start with the defaul application settings
 	_appSettings = _GetDefaultAppSettings();
 
+	// Headless runs should be reproducible, so we ignore whatever the user has saved locally
+	if (_isHeadless) {
+		_ApplyLaunchArguments();
+		return;
+	}
+
 	// We'll store our settings in the %APPDATA% directory, under our application name
 	std::filesystem::path appdata = getenv("APPDATA");
 	std::filesystem::path settingsPath = appdata / _applicationName / "app-settings.json";
@@ -453,6 +536,61 @@ void Application::_ConfigureSettings() {
 	else {
 		SaveSettings();
 	}
+
+	// Applied after saving, so that they only last for this run
+	_ApplyLaunchArguments();
+}
+
+void Application::_ApplyLaunchArguments() {
+	for (const auto& [key, value] : _launchArguments.items()) {
+		if (key == "benchmark" || key == "gui-benchmark") {
+			continue;
+		}
+
+		// Global settings take priority, otherwise we look for the first layer that has a setting with that name
+		if (_appSettings.contains(key)) {
+			_appSettings[key] = value;
+			continue;
+		}
+		bool found = false;
+		for (const auto& layer : _layers) {
+			if (!layer->Name.empty() && _appSettings.contains(layer->Name) && _appSettings[layer->Name].contains(key)) {
+				_appSettings[layer->Name][key] = value;
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			LOG_WARN("Unknown argument \"--{}\", ignoring", key);
+		}
+	}
+}
+
+nlohmann::json Application::_ParseArguments(int argCount, char** arguments) {
+	nlohmann::json result = nlohmann::json::object();
+
+	// The first argument is the path to the executable
+	for (int ix = 1; ix < argCount; ix++) {
+		std::string arg = arguments[ix];
+		if (arg.rfind("--", 0) != 0) {
+			LOG_WARN("Unexpected argument \"{}\", arguments should start with --", arg);
+			continue;
+		}
+		std::string key = arg.substr(2);
+
+		// Flags without a value are treated as true
+		if (ix + 1 >= argCount || std::string(arguments[ix + 1]).rfind("--", 0) == 0) {
+			result[key] = true;
+			continue;
+		}
+
+		// Numbers and bools are parsed so they can be read back with JsonGet, anything else is kept as a string
+		std::string value = arguments[++ix];
+		nlohmann::json parsed = nlohmann::json::parse(value, nullptr, false);
+		result[key] = parsed.is_discarded() ? nlohmann::json(value) : parsed;
+	}
+
+	return result;
 }
 
 nlohmann::json Application::_GetDefaultAppSettings()
@@ -471,6 +609,8 @@ nlohmann::json Application::_GetDefaultAppSettings()
 
 	result["window_width"]  = DEFAULT_WINDOW_WIDTH;
 	result["window_height"] = DEFAULT_WINDOW_HEIGHT;
+	// When set, the profiler's frame history is written here as a Chrome trace when the app closes
+	result["profiler_trace_path"] = "";
 	return result;
 }
 
@@ -31,6 +31,10 @@ public:
 	/**
 	 * Called by the entry point to begin the application, creating the singleton 
 	 * intance and performing any library initialization
+	 * 
+	 * Arguments are given as --key value pairs (or just --key for flags), and override the app settings
+	 * for this run. Passing --benchmark runs the app headless with the BenchmarkLayer, see BenchmarkLayer.h,
+	 * and --gui-benchmark adds the GuiBenchmarkLayer
 	 */
 	static void Start(int argCount, char** arguments);
 
@@ -66,6 +70,23 @@ public:
 	 */
 	void Quit();
 
+	/**
+	 * Returns true if the application is running without a visible window or editor, ex for benchmarks
+	 */
+	bool IsHeadless() const;
+
+	/**
+	 * Sets a fixed amount of time that every frame will advance by, regardless of how long it actually took.
+	 * Set to 0 to use real time (the default)
+	 * 
+	 * @param value The fixed delta time, in seconds
+	 */
+	void SetFixedDeltaTime(float value);
+	/**
+	 * Gets the fixed delta time that frames advance by, or 0 if frames use real time
+	 */
+	float GetFixedDeltaTime() const;
+
 	/**
 	 * Loads a new scene into the application using a path on disk
 	 * 
@@ -125,12 +146,18 @@ protected:
 
 	// Not an idea way of distinguising, since we need to build editor into our game, but good 'nuff for GDW
 	bool        _isEditor;
+	// True when running without a visible window, editor or vsync
+	bool        _isHeadless;
+	// If non-zero, the delta time used for every frame instead of the real frame time
+	float       _fixedDeltaTime;
 
 	// The primary viewport that the game will render into, in client window bounds
 	glm::uvec4  _primaryViewport;
 
 	// Stores the current application settings
 	nlohmann::json _appSettings;
+	// The settings given on the command line, these are applied over top of the settings but never saved
+	nlohmann::json _launchArguments;
 
 	// The current scene that the application is working on
 	Gameplay::Scene::Sptr _currentScene;
@@ -154,8 +181,11 @@ protected:
 	void _HandleSceneChange();
 	void _HandleWindowSizeChanged(const glm::ivec2& newSize);
 	void _ConfigureSettings();
+	void _ApplyLaunchArguments();
 	nlohmann::json _GetDefaultAppSettings();
 
+	static nlohmann::json _ParseArguments(int argCount, char** arguments);
+
 	static Application* _singleton;
 	static std::string  _applicationName;
 };
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "BenchmarkLayer.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <GLFW/glfw3.h>
+#include "Logging.h"
+#include "Application/Application.h"
+#include "Gameplay/Scene.h"
+#include "Graphics/ShaderProgram.h"
+#include "Utils/FileHelpers.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/Profiler.h"
+#include "Utils/MemoryTracker.h"
+#include "Graphics/IGraphicsResource.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+
+const char* BenchmarkLayer::DEFAULT_STRESS_SCENE = "stress-scene.json";
+const char* BenchmarkLayer::DEFAULT_STRESS_MANIFEST = "stress-scene-manifest.json";
+
+BenchmarkLayer::BenchmarkLayer() :
+	ApplicationLayer(),
+	_scenePath(""),
+	_manifestPath(""),
+	_outputPath(""),
+	_warmupFrames(0),
+	_frameCount(0),
+	_fixedDt(0.0f),
+	_generate(false),
+	_overwrite(false),
+	_generatorSettings(),
+	_firstFrame(0),
+	_lastCollected(-1),
+	_framesCollected(0),
+	_isComplete(false)
+{
+	Name = "Benchmark";
+	Overrides = AppLayerFunctions::OnAppLoad | AppLayerFunctions::OnAppUnload | AppLayerFunctions::OnSceneLoad | AppLayerFunctions::OnUpdate;
+}
+
+BenchmarkLayer::~BenchmarkLayer() = default;
+
+nlohmann::json BenchmarkLayer::GetDefaultConfig() {
+	nlohmann::json result = {};
+	// Empty picks scene.json, or the stress scene when generating
+	result["scene"] = "";
+	result["manifest"] = "";
+	result["warmup_frames"] = 120;
+	result["frames"] = 1000;
+	result["dt"] = 1.0f / 60.0f;
+	result["output"] = "benchmark-results.json";
+	result["generate"] = false;
+	result["overwrite"] = false;
+	// Flattened in, so they can be set from the command line like everything else
+	result.merge_patch(Gameplay::StressSceneGenerator::Settings().ToJson());
+	return result;
+}
+
+void BenchmarkLayer::OnAppLoad(const nlohmann::json& config) {
+	Application& app = Application::Get();
+
+	nlohmann::json settings = config.contains(Name) ? config[Name] : GetDefaultConfig();
+	_scenePath    = JsonGet<std::string>(settings, "scene", "");
+	_manifestPath = JsonGet<std::string>(settings, "manifest", "");
+	_outputPath   = JsonGet<std::string>(settings, "output", "benchmark-results.json");
+	_warmupFrames = JsonGet<uint32_t>(settings, "warmup_frames", 120);
+	_frameCount   = std::max(JsonGet<uint32_t>(settings, "frames", 1000), 1u);
+	_fixedDt      = JsonGet<float>(settings, "dt", 1.0f / 60.0f);
+	_generate     = JsonGet<bool>(settings, "generate", false);
+	_overwrite    = JsonGet<bool>(settings, "overwrite", false);
+	_generatorSettings = Gameplay::StressSceneGenerator::Settings::FromJson(settings);
+	if (_scenePath.empty()) {
+		_scenePath = _generate ? DEFAULT_STRESS_SCENE : "scene.json";
+	}
+
+	// We need every frame's zones, including the GPU ones, even if that means stalling on the GPU
+	Profiler::SetEnabled(true);
+	Profiler::SetPaused(false);
+	Profiler::SetWaitForGpu(true);
+
+	// Every run should simulate exactly the same thing, regardless of how long frames take
+	app.SetFixedDeltaTime(_fixedDt);
+
+	LOG_INFO("Benchmarking \"{}\" for {} frames (+{} warmup) at dt={}", _scenePath, _frameCount, _warmupFrames, _fixedDt);
+
+	bool loaded = false;
+	if (_generate) {
+		std::string manifestPath = _manifestPath.empty() ? std::filesystem::path(_scenePath).stem().string() + "-manifest.json" : _manifestPath;
+
+		// Our own default files are replaced every run, anything else could be a scene someone is working on
+		bool isDefault = _scenePath == DEFAULT_STRESS_SCENE && manifestPath == DEFAULT_STRESS_MANIFEST;
+		if (!_overwrite && !isDefault && (std::filesystem::exists(_scenePath) || std::filesystem::exists(manifestPath))) {
+			LOG_ERROR("Refusing to replace \"{}\" or \"{}\" with a generated scene, pass --overwrite true to allow it", _scenePath, manifestPath);
+		} else {
+			// Written out so that the exact same scene can be re-run later, or opened in the editor
+			Gameplay::Scene::Sptr scene = Gameplay::StressSceneGenerator::Generate(_generatorSettings);
+			ResourceManager::SaveManifest(manifestPath);
+			scene->Save(_scenePath);
+			app.LoadScene(scene);
+			loaded = true;
+		}
+	} else if (_manifestPath.empty()) {
+		loaded = app.LoadScene(_scenePath);
+	} else if (std::filesystem::exists(_manifestPath) && std::filesystem::exists(_scenePath)) {
+		LOG_INFO("Loading manifest from \"{}\"", _manifestPath);
+		ShaderProgram::BeginCompileBatch();
+		ResourceManager::LoadManifest(_manifestPath);
+		ShaderProgram::EndCompileBatch();
+
+		Gameplay::Scene::Sptr scene = Gameplay::Scene::Load(_scenePath);
+		app.LoadScene(scene);
+		loaded = scene != nullptr;
+	}
+
+	if (!loaded) {
+		LOG_ERROR("Failed to load benchmark scene \"{}\"", _scenePath);
+		// The app isn't running yet so Quit would be overwritten, closing the window stops it after the first frame
+		glfwSetWindowShouldClose(app.GetWindow(), GLFW_TRUE);
+		_isComplete = true;
+	}
+}
+
+void BenchmarkLayer::OnAppUnload() {
+	// If we were closed early, write what we have so the run isn't a total loss
+	if (!_isComplete && _framesCollected > 0) {
+		LOG_WARN("Benchmark ended after {} of {} frames", _framesCollected, _frameCount);
+		_WriteResults();
+	}
+	Profiler::SetWaitForGpu(false);
+}
+
+void BenchmarkLayer::OnSceneLoad() {
+	_firstFrame = Profiler::GetFrameIndex() + _warmupFrames;
+	_lastCollected = -1;
+	_framesCollected = 0;
+	_frameCpuMs.clear();
+	_frameDrawCalls.clear();
+	_frameAllocations.clear();
+	_zones.clear();
+	MemoryTracker::ResetPeaks();
+}
+
+void BenchmarkLayer::OnUpdate() {
+	if (_isComplete) {
+		return;
+	}
+
+	// Materials draw with a fallback until their shader has linked, so warmup only counts once everything has
+	uint64_t frameIndex = Profiler::GetFrameIndex();
+	if (frameIndex < _firstFrame && ShaderProgram::GetPendingProgramCount() > 0) {
+		_firstFrame = frameIndex + _warmupFrames;
+	}
+
+	_CollectFrames();
+
+	if (_framesCollected >= _frameCount) {
+		_WriteResults();
+		_isComplete = true;
+		Application::Get().Quit();
+	}
+}
+
+void BenchmarkLayer::_CollectFrames() {
+	const std::deque<Profiler::FrameCapture>& frames = Profiler::GetFrames();
+	uint64_t frameIndex = Profiler::GetFrameIndex();
+
+	// Zone totals for a single frame, so zones that are entered several times in a frame count as one sample
+	struct FrameTotal {
+		double   CpuMs = 0.0;
+		double   GpuMs = 0.0;
+		uint32_t DrawCalls = 0;
+		uint32_t Allocations = 0;
+		bool     HasGpu = false;
+	};
+	std::map<std::string, FrameTotal> totals;
+
+	for (const Profiler::FrameCapture& frame : frames) {
+		if (_framesCollected >= _frameCount) {
+			break;
+		}
+		if (frame.Index < _firstFrame || static_cast<int64_t>(frame.Index) <= _lastCollected) {
+			continue;
+		}
+		// Frames are in order, so once we hit one that's still waiting on it's GPU timings the rest are too.
+		// Frames that are too old to still be pending had their queries dropped, and are taken without them
+		if (!frame.GpuResolved && frame.Index + Profiler::GPU_FRAME_LATENCY >= frameIndex) {
+			break;
+		}
+
+		totals.clear();
+		for (const Profiler::Event& event : frame.CpuEvents) {
+			FrameTotal& total = totals[event.Name];
+			total.CpuMs += (event.EndNs - event.StartNs) / 1000000.0;
+			total.DrawCalls += event.DrawCalls;
+			total.Allocations += event.Allocations;
+		}
+		for (const Profiler::Event& event : frame.GpuEvents) {
+			FrameTotal& total = totals[event.Name];
+			total.GpuMs += (event.EndNs - event.StartNs) / 1000000.0;
+			total.HasGpu = true;
+		}
+
+		for (const auto& [name, total] : totals) {
+			ZoneSamples& zone = _zones[name];
+			zone.CpuMs.push_back(total.CpuMs);
+			zone.DrawCalls.push_back(total.DrawCalls);
+			zone.Allocations.push_back(total.Allocations);
+			if (total.HasGpu) {
+				zone.GpuMs.push_back(total.GpuMs);
+			}
+		}
+
+		_frameCpuMs.push_back((frame.EndNs - frame.StartNs) / 1000000.0);
+		_frameDrawCalls.push_back(frame.DrawCalls);
+		_frameAllocations.push_back(frame.Allocations);
+
+		_lastCollected = static_cast<int64_t>(frame.Index);
+		_framesCollected++;
+	}
+}
+
+bool BenchmarkLayer::_WriteResults() {
+	using namespace nlohmann;
+
+	Application& app = Application::Get();
+
+	json zones = json::object();
+	for (const auto& [name, samples] : _zones) {
+		json zone = {
+			{ "samples",    samples.CpuMs.size() },
+			{ "cpu_ms",     _Summarize(samples.CpuMs) },
+			{ "draw_calls", _Summarize(samples.DrawCalls) },
+			{ "allocations", _Summarize(samples.Allocations) }
+		};
+		if (!samples.GpuMs.empty()) {
+			zone["gpu_ms"] = _Summarize(samples.GpuMs);
+		}
+		zones[name] = zone;
+	}
+
+	// Peaks are reset when the scene loads, so these are the high water marks over warmup and measurement
+	json memory = json::object();
+	for (size_t ix = 0; ix < MemoryTracker::TAG_COUNT; ix++) {
+		MemoryTag tag = static_cast<MemoryTag>(ix);
+		MemoryTracker::TagStats stats = MemoryTracker::GetStats(tag);
+		memory[~tag] = {
+			{ "current_bytes", stats.CurrentBytes },
+			{ "peak_bytes", stats.PeakBytes },
+			{ "live_allocations", stats.LiveAllocations }
+		};
+	}
+	json video = json::object();
+	for (const auto& [type, bytes] : IGraphicsResource::GetMemoryEstimates()) {
+		video[~type] = bytes;
+	}
+
+	const GLubyte* renderer = glGetString(GL_RENDERER);
+	const GLubyte* vendor = glGetString(GL_VENDOR);
+
+	json result = {
+		{ "scene",          _scenePath },
+		{ "renderer",       renderer != nullptr ? (const char*)renderer : "" },
+		{ "vendor",         vendor != nullptr ? (const char*)vendor : "" },
+		{ "resolution",     { app.GetWindowSize().x, app.GetWindowSize().y } },
+		{ "dt",             _fixedDt },
+		{ "warmup_frames",  _warmupFrames },
+		{ "frames",         _framesCollected },
+		{ "complete",       _framesCollected >= _frameCount },
+		{ "dropped_events", Profiler::GetDroppedEvents() },
+		{ "generator",      _generate ? _generatorSettings.ToJson() : json(nullptr) },
+		{ "frame", {
+			{ "cpu_ms",     _Summarize(_frameCpuMs) },
+			{ "draw_calls", _Summarize(_frameDrawCalls) },
+			{ "allocations", _Summarize(_frameAllocations) }
+		} },
+		{ "zones",          zones },
+		{ "memory", {
+			{ "tracking_enabled", MemoryTracker::IsEnabled() },
+			{ "tags",             memory },
+			{ "video_bytes",      video }
+		} }
+	};
+
+	try {
+		FileHelpers::WriteContentsToFile(_outputPath, result.dump(1, '\t'));
+	} catch (const std::exception& e) {
+		LOG_ERROR("Failed to write benchmark results to \"{}\": {}", _outputPath, e.what());
+		return false;
+	}
+
+	LOG_INFO("Benchmark results written to \"{}\", frame time p50 {:.3f}ms, p99 {:.3f}ms",
+			 _outputPath, result["frame"]["cpu_ms"].value("p50", 0.0), result["frame"]["cpu_ms"].value("p99", 0.0));
+	return true;
+}
+
+nlohmann::json BenchmarkLayer::_Summarize(std::vector<double> samples) {
+	if (samples.empty()) {
+		return nlohmann::json::object();
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	double sum = 0.0;
+	for (double sample : samples) {
+		sum += sample;
+	}
+
+	// Nearest-rank, so every percentile is a value that was actually measured
+	auto percentile = [&](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+
+	return {
+		{ "min",  samples.front() },
+		{ "mean", sum / samples.size() },
+		{ "p50",  percentile(50.0) },
+		{ "p90",  percentile(90.0) },
+		{ "p95",  percentile(95.0) },
+		{ "p99",  percentile(99.0) },
+		{ "max",  samples.back() }
+	};
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "Application/ApplicationLayer.h"
+#include <json.hpp>
+#include "Gameplay/StressSceneGenerator.h"
+
+/**
+ * Drives the application when it is started with --benchmark. Loads a scene from disk, lets it run
+ * at a fixed timestep for a set number of frames, then writes percentiles of the profiler's zone timings,
+ * draw calls and allocations, along with memory high water marks, to a JSON file and quits. The output is meant to be diffed by CI between builds
+ *
+ * Settings (all can be given on the command line, ex: --scene scenes/test.json --frames 1000):
+ *    scene         - The scene file to load, defaults to scene.json, or stress-scene.json when generating
+ *    manifest      - The resource manifest to load before the scene, defaults to the one next to the scene
+ *    warmup_frames - Frames to run before measuring, so shader compiles and first uploads are not counted
+ *    frames        - The number of frames to measure
+ *    dt            - The fixed timestep to advance each frame by, in seconds
+ *    output        - The path to write the results to
+ *    generate      - If true, a stress scene is generated and saved to scene/manifest before running, see
+ *                    StressSceneGenerator::Settings for the keys that control it (objects, hierarchy_depth, etc)
+ *    overwrite     - If true, generating may replace existing files other than the default stress scene
+ */
+class BenchmarkLayer final : public ApplicationLayer {
+public:
+	MAKE_PTRS(BenchmarkLayer)
+
+	BenchmarkLayer();
+	virtual ~BenchmarkLayer();
+
+	// Inherited from ApplicationLayer
+
+	virtual void OnAppLoad(const nlohmann::json& config) override;
+	virtual void OnAppUnload() override;
+	virtual void OnSceneLoad() override;
+	virtual void OnUpdate() override;
+	virtual nlohmann::json GetDefaultConfig() override;
+
+protected:
+	// Where generated scenes are saved when no path is given, kept apart from the editor's scene.json
+	static const char* DEFAULT_STRESS_SCENE;
+	static const char* DEFAULT_STRESS_MANIFEST;
+
+	// The values recorded for a single zone name, one entry per measured frame it appeared in
+	struct ZoneSamples {
+		std::vector<double> CpuMs;
+		std::vector<double> GpuMs;
+		std::vector<double> DrawCalls;
+		std::vector<double> Allocations;
+	};
+
+	std::string _scenePath;
+	std::string _manifestPath;
+	std::string _outputPath;
+	uint32_t    _warmupFrames;
+	uint32_t    _frameCount;
+	float       _fixedDt;
+	bool        _generate;
+	bool        _overwrite;
+	Gameplay::StressSceneGenerator::Settings _generatorSettings;
+
+	// The profiler frame index of the first frame we'll measure
+	uint64_t    _firstFrame;
+	// The profiler frame index of the last frame we collected
+	int64_t     _lastCollected;
+	uint32_t    _framesCollected;
+	bool        _isComplete;
+
+	std::vector<double> _frameCpuMs;
+	std::vector<double> _frameDrawCalls;
+	std::vector<double> _frameAllocations;
+	std::map<std::string, ZoneSamples> _zones;
+
+	/**
+	 * Takes any frames from the profiler's history that are ready and haven't been collected yet
+	 */
+	void _CollectFrames();
+
+	/**
+	 * Writes the results to the output path
+	 * @returns True if the file was written
+	 */
+	bool _WriteResults();
+
+	/**
+	 * Gets the min, max, mean and percentiles of the given samples as a JSON blob
+	 */
+	static nlohmann::json _Summarize(std::vector<double> samples);
+};
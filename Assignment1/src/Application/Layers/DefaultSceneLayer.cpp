@@ -8,6 +8,7 @@
 #include <GLM/gtx/common.hpp> // for fmod (floating modulus)
 
 #include <filesystem>
+#include <chrono>
 
 // Graphics
 #include "Graphics/Buffers/IndexBuffer.h"
@@ -95,6 +96,14 @@ void DefaultSceneLayer::_CreateScene()
 	if (loadScene && std::filesystem::exists("scene.json")) {
 		app.LoadScene("scene.json");
 	} else {
+		// Track how long shader creation takes, so we can compare a cold and warm binary cache
+		ShaderProgram::ResetBinaryCacheStats();
+		auto shaderStart = std::chrono::high_resolution_clock::now();
+
+		// Submit all our shaders as a batch so the driver can compile them in parallel, any
+		// materials using them will draw with a fallback shader until they're ready
+		ShaderProgram::BeginCompileBatch();
+
 		// This time we'll have 2 different shaders, and share data between both of them using the UBO
 		// This shader will handle reflective materials 
 		ShaderProgram::Sptr reflectiveShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
@@ -177,6 +186,11 @@ void DefaultSceneLayer::_CreateScene()
 		});
 		RimLighting->SetDebugName("Milena's Rim Lighting");
 
+		auto shaderEnd = std::chrono::high_resolution_clock::now();
+		const ShaderProgram::BinaryCacheStats& shaderStats = ShaderProgram::GetBinaryCacheStats();
+		LOG_INFO("Created shaders in {:.2f}ms ({} cached, {} compiled, {} rejected, {} still compiling)",
+			std::chrono::duration<float, std::milli>(shaderEnd - shaderStart).count(),
+			shaderStats.Hits, shaderStats.Misses, shaderStats.Rejected, ShaderProgram::GetPendingProgramCount());
 
 		// Load in the meshes
 
@@ -203,6 +217,7 @@ void DefaultSceneLayer::_CreateScene()
 			{ ShaderPartType::Vertex, "shaders/vertex_shaders/skybox_vert.glsl" },
 			{ ShaderPartType::Fragment, "shaders/fragment_shaders/skybox_frag.glsl" }
 		});
+		ShaderProgram::EndCompileBatch();
 
 		// Create an empty scene
 		Scene::Sptr scene = std::make_shared<Scene>(); 
@@ -222,37 +237,47 @@ void DefaultSceneLayer::_CreateScene()
 		scene->SetColorLUT(lutCool);
 
 		// Create our materials
-		// This will be our box material, with no environment reflections
+		// These all use the basic vertex shader and never discard, so they can share the pre-pass shader.
+		// Materials on the other shaders are left on Auto, which picks a variant or skips the pre-pass for them
 		
 		Material::Sptr groundMaterial = ResourceManager::CreateAsset<Material>(basicShader);
 		{
 			groundMaterial->Name = "Ground"; 
-			groundMaterial->Set("u_Material.Diffuse", groundTex);
+			groundMaterial->Set("s_Diffuse", groundTex);
 			groundMaterial->Set("u_Material.Shininess", 0.1f);
+			groundMaterial->SetPrepassMode(DepthPrepassMode::Shared);
 		}	
 		Material::Sptr leafMaterial = ResourceManager::CreateAsset<Material>(basicShader);
 		{
 			leafMaterial->Name = "leaf1";
-			leafMaterial->Set("u_Material.Diffuse", leafTex);
+			leafMaterial->Set("s_Diffuse", leafTex);
 			leafMaterial->Set("u_Material.Shininess", 0.5f);
+			leafMaterial->SetPrepassMode(DepthPrepassMode::Shared);
 		}
 		Material::Sptr leaf2Material = ResourceManager::CreateAsset<Material>(basicShader);
 		{
 			leaf2Material->Name = "leaf2";
-			leaf2Material->Set("u_Material.Diffuse", leaf2Tex);
+			leaf2Material->Set("s_Diffuse", leaf2Tex);
 			leaf2Material->Set("u_Material.Shininess", 0.5f);
+			leaf2Material->SetPrepassMode(DepthPrepassMode::Shared);
 		} 
 		Material::Sptr logMaterial = ResourceManager::CreateAsset<Material>(basicShader);
 		{
 			logMaterial->Name = "log";
-			logMaterial->Set("u_Material.Diffuse", logTex);
+			logMaterial->Set("s_Diffuse", logTex);
 			logMaterial->Set("u_Material.Shininess", 0.5f);
+			logMaterial->SetPrepassMode(DepthPrepassMode::Shared);
 		}
 		// Create some lights for our scene
 		scene->Lights.resize(3);
 		scene->Lights[0].Position = glm::vec3(-4.84f, -4.0f, 7.2f);
 		scene->Lights[0].Color = glm::vec3(1.0f, 1.0f, 1.0f);
 		scene->Lights[0].Range = 1000.0f;
+		scene->Lights[0].CastShadows = true;
+
+		// A soft sun so the scene has some directional shadows
+		scene->SetSunDirection(glm::vec3(-0.4f, 0.3f, -1.0f));
+		scene->SetSunColor(glm::vec3(0.4f));
 	
 		// We'll create a mesh that is a simple plane that we can resize later
 		MeshResource::Sptr planeMesh = ResourceManager::CreateAsset<MeshResource>();
@@ -288,6 +313,7 @@ void DefaultSceneLayer::_CreateScene()
 			log2->SetPostion(glm::vec3(-1.66f, -3.827, 0.64f));
 			log2->SetRotation(glm::vec3(90.0f, 0.0f, -47.0f));
 			log2->SetScale(glm::vec3(0.75));
+			log2->IsStatic = true;
 			RenderComponent::Sptr renderer = log2->Add<RenderComponent>();
 			renderer->SetMesh(logMesh);
 			renderer->SetMaterial(logMaterial);
@@ -308,6 +334,7 @@ void DefaultSceneLayer::_CreateScene()
 			plant3->SetPostion(glm::vec3(-2.21f, -4.3f, 0.15f));
 			plant3->SetRotation(glm::vec3(90.0f, 0.0f, 150.0f));
 			plant3->SetScale(glm::vec3(3.0f));
+			plant3->IsStatic = true;
 			RenderComponent::Sptr renderer = plant3->Add<RenderComponent>();
 			renderer->SetMesh(plant3Mesh);
 			renderer->SetMaterial(leafMaterial);
@@ -343,6 +370,7 @@ void DefaultSceneLayer::_CreateScene()
 		
 		GameObject::Sptr plane = scene->CreateGameObject("Plane");
 		{
+			plane->IsStatic = true;
 			// Make a big tiled mesh
 			MeshResource::Sptr tiledMesh = ResourceManager::CreateAsset<MeshResource>();
 			tiledMesh->AddParam(MeshBuilderParam::CreatePlane(ZERO, UNIT_Z, UNIT_X, glm::vec2(100.0f), glm::vec2(20.0f)));
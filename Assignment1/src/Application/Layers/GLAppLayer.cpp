@@ -2,6 +2,8 @@
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 #include "Application/Application.h"
+#include "Graphics/ShaderProgram.h"
+#include "Utils/JsonGlmHelpers.h"
 
 GLAppLayer::GLAppLayer() :
 	ApplicationLayer() {
@@ -11,22 +13,61 @@ GLAppLayer::GLAppLayer() :
 
 GLAppLayer::~GLAppLayer() = default;
 
+nlohmann::json GLAppLayer::GetDefaultConfig() {
+	nlohmann::json result = {};
+	// The API GLFW creates the context with when running headless, "native", "egl" or "osmesa" (software, for machines
+	// without a GPU). This only changes how the context is made, the hidden window still needs a display, see OnAppLoad
+	result["headless_context"] = "native";
+	return result;
+}
+
 void GLAppLayer::OnAppLoad(const nlohmann::json& config) {
 	// Initialize GLFW
 	LOG_ASSERT(glfwInit() == GLFW_TRUE, "Failed to initialize GLFW");
 
 	Application& app = Application::Get();
 
+	// Headless runs still need a window for GLFW to hang the context off of, but it's never shown.
+	//
+	// This is not truly headless: GLFW has no surfaceless or pbuffer contexts, so it still has to connect to a
+	// display server (X11, Wayland or a desktop session) to make the window, even with the EGL or OSMesa APIs.
+	// On a machine without one, run under a virtual display such as Xvfb (xvfb-run). A real surfaceless path
+	// would mean creating the context through EGL directly (EGL_MESA_platform_surfaceless or a pbuffer surface)
+	// and rendering into our own framebuffer instead of the window's
+	if (app._isHeadless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		nlohmann::json settings = config.contains(Name) ? config[Name] : GetDefaultConfig();
+		std::string contextApi = JsonGet<std::string>(settings, "headless_context", "native");
+		if (contextApi == "egl") {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+		} else if (contextApi == "osmesa") {
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+		} else if (contextApi != "native") {
+			LOG_WARN("Unknown headless context API \"{}\", using native", contextApi);
+		}
+	}
+
 	//Create a new GLFW window and make it current
 	app._window = glfwCreateWindow(app._windowSize.x, app._windowSize.y, app._windowTitle.c_str(), nullptr, nullptr);
+	LOG_ASSERT(app._window != nullptr || !app._isHeadless, "Failed to create the hidden benchmark window, headless runs still need a display server (try xvfb-run)");
+	LOG_ASSERT(app._window != nullptr, "Failed to create window");
 	glfwMakeContextCurrent(app._window);
 
+	// Frame times should only measure our own work, not how long we waited on the display
+	if (app._isHeadless) {
+		glfwSwapInterval(0);
+	}
+
 	// Set our window resized callback
 	glfwSetWindowSizeCallback(app._window, GlWindowResizedCallback);
 
 	LOG_ASSERT(gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) != 0, "Failed to initialize glad");
 
 	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	// Let the driver decide how many threads to use for background shader compiles
+	ShaderProgram::SetMaxCompilerThreads(0xFFFFFFFF);
 }
 
 void GLAppLayer::OnAppUnload()
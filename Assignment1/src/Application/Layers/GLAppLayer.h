@@ -20,6 +20,7 @@ public:
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
 	virtual void OnAppUnload() override;
+	virtual nlohmann::json GetDefaultConfig() override;
 
 protected:
 	static void GlDebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
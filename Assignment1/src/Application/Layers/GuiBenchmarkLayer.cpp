@@ -0,0 +1,204 @@
+#include "GuiBenchmarkLayer.h"
+#include <chrono>
+#include <GLM/gtc/matrix_transform.hpp>
+#include "Application/Application.h"
+#include "Gameplay/Scene.h"
+#include "Graphics/GuiBatcher.h"
+#include "Gameplay/Components/GUI/RectTransform.h"
+#include "Gameplay/Components/GUI/GuiPanel.h"
+#include "Gameplay/Components/GUI/GuiText.h"
+
+GuiBenchmarkLayer::GuiBenchmarkLayer() :
+	ApplicationLayer(),
+	_framesSinceLoad(0),
+	_font(nullptr)
+{
+	Name = "GUI Benchmark";
+	Overrides = AppLayerFunctions::OnSceneLoad | AppLayerFunctions::OnRender;
+}
+
+GuiBenchmarkLayer::~GuiBenchmarkLayer() = default;
+
+void GuiBenchmarkLayer::OnSceneLoad() {
+	using namespace Gameplay;
+
+	Scene::Sptr scene = Application::Get().CurrentScene();
+
+	if (_font == nullptr) {
+		_font = ResourceManager::CreateAsset<Font>("fonts/Roboto-Medium.ttf", 16.0f);
+		_font->Bake();
+	}
+
+	// Due to how scene stuff is handled in editor, we'll remove all existing elements and re-add them
+	for (auto& element : _elements) {
+		scene->RemoveGameObject(scene->FindObjectByGUID(element));
+	}
+	_elements.clear();
+
+	// Lay out panels in a grid, each with a text label as a child
+	const int panelCount = ELEMENT_COUNT / 2;
+	const int columns = 50;
+	_elements.reserve(panelCount);
+	for (int ix = 0; ix < panelCount; ix++) {
+		GameObject::Sptr panel = scene->CreateGameObject("Benchmark Panel");
+		panel->HideInHierarchy = true;
+
+		RectTransform::Sptr transform = panel->Add<RectTransform>();
+		transform->SetMin({ (ix % columns) * 24.0f, (ix / columns) * 14.0f });
+		transform->SetMax({ (ix % columns) * 24.0f + 22.0f, (ix / columns) * 14.0f + 12.0f });
+
+		GuiPanel::Sptr background = panel->Add<GuiPanel>();
+		background->SetColor(glm::vec4(1.0f, 1.0f, 1.0f, 0.5f));
+
+		GameObject::Sptr label = scene->CreateGameObject("Benchmark Label");
+		label->HideInHierarchy = true;
+
+		RectTransform::Sptr labelTransform = label->Add<RectTransform>();
+		labelTransform->SetMax({ 22.0f, 12.0f });
+
+		GuiText::Sptr text = label->Add<GuiText>();
+		text->SetFont(_font);
+		text->SetTextScale(0.5f);
+		text->SetText(std::to_string(ix));
+
+		panel->AddChild(label);
+
+		_elements.push_back(panel);
+		_elements.push_back(label);
+	}
+
+	_framesSinceLoad = 0;
+}
+
+void GuiBenchmarkLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
+	_framesSinceLoad++;
+	if (_framesSinceLoad != WARMUP_FRAMES) {
+		return;
+	}
+
+	Application& app = Application::Get();
+	bool wasRetained = GuiBatcher::GetRetainedMode();
+
+	// Match the GL state that the interface layer uses
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	GuiBatcher::SetProjection(glm::ortho(0.0f, (float)app.GetWindowSize().x, (float)app.GetWindowSize().y, 0.0f, -1.0f, 1.0f));
+
+	bool wasBindless = GuiBatcher::GetBindlessEnabled();
+
+	// Measure with the bound texture path, and with the bindless path if the driver supports it
+	for (int pass = 0; pass < (GuiBatcher::IsBindlessSupported() ? 2 : 1); pass++) {
+		GuiBatcher::SetBindlessEnabled(pass == 1);
+
+		uint32_t immediateDraws, retainedDraws, partialDraws;
+		double immediate = _Measure(false, 0, immediateDraws);
+		double retained  = _Measure(true, 0, retainedDraws);
+		double partial   = _Measure(true, 100, partialDraws);
+
+		LOG_INFO("GUI benchmark ({} elements, {} frames, {})", ELEMENT_COUNT, FRAME_COUNT, pass == 1 ? "bindless" : "bound textures");
+		LOG_INFO("\tImmediate mode:           {:.3f}ms / frame, {} draws", immediate, immediateDraws);
+		LOG_INFO("\tRetained mode (static):   {:.3f}ms / frame, {} draws", retained, retainedDraws);
+		LOG_INFO("\tRetained mode (1% dirty): {:.3f}ms / frame, {} draws", partial, partialDraws);
+	}
+
+	GuiBatcher::SetBindlessEnabled(wasBindless);
+
+	_MeasureFonts();
+	GuiBatcher::SetRetainedMode(wasRetained);
+
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+}
+
+double GuiBenchmarkLayer::_Measure(bool retained, int dirtyStride, uint32_t& drawCalls) {
+	Gameplay::Scene::Sptr scene = Application::Get().CurrentScene();
+	GuiBatcher::SetRetainedMode(retained);
+
+	// Render a single frame first, so that retained mode has built it's buffers
+	GuiBatcher::BeginFrame();
+	scene->RenderGUI();
+	GuiBatcher::Flush();
+	glFinish();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < FRAME_COUNT; frame++) {
+		// Simulate some gameplay code modifying a portion of the HUD
+		if (dirtyStride > 0) {
+			// Panels and their labels are interleaved, so we step over the labels to touch panels on every frame
+			for (size_t ix = (size_t)(frame % dirtyStride) * 2; ix < _elements.size(); ix += (size_t)dirtyStride * 2) {
+				Gameplay::GameObject::Sptr object = _elements[ix];
+				GuiPanel::Sptr panel = object != nullptr ? object->Get<GuiPanel>() : nullptr;
+				if (panel != nullptr) {
+					panel->SetColor(glm::vec4(1.0f, (frame % 2) * 1.0f, 1.0f, 0.5f));
+				}
+			}
+		}
+
+		GuiBatcher::BeginFrame();
+		scene->RenderGUI();
+		GuiBatcher::Flush();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	drawCalls = GuiBatcher::GetDrawCallCount();
+
+	return std::chrono::duration<double, std::milli>(end - start).count() / FRAME_COUNT;
+}
+
+void GuiBenchmarkLayer::_MeasureFonts() {
+	const std::string path = "fonts/Roboto-Medium.ttf";
+
+	// Logs the atlas memory and bake time for a font configuration
+	auto report = [](const std::string& label, const Font::Sptr& font) {
+		const Font::Stats& stats = font->GetStats();
+		LOG_INFO("\t{:<36} {:>8.2f}ms bake, {:>5} KB atlas, {:>5} glyphs, {:>5} misses, {:>5} evictions",
+			label, stats.BakeTimeMs, stats.AtlasBytes / 1024, stats.GlyphCount, stats.CacheMisses, stats.CacheEvictions);
+	};
+
+	LOG_INFO("Font atlas benchmark");
+
+	// The current approach needs a separate bitmap font for every size we want crisp text at
+	size_t bitmapBytes = 0;
+	for (float size : { 16.0f, 32.0f, 64.0f }) {
+		Font::Sptr bitmap = std::make_shared<Font>(path, size);
+		bitmap->SetAtlasSize(size > 32.0f ? 1024 : 512, size > 32.0f ? 1024 : 512);
+		bitmap->Bake();
+		report("Bitmap " + std::to_string((int)size) + "px (ASCII)", bitmap);
+		bitmapBytes += bitmap->GetStats().AtlasBytes;
+	}
+
+	// A single SDF atlas can serve all of those sizes
+	Font::Sptr sdf = std::make_shared<Font>(path, 32.0f);
+	sdf->SetAtlasMode(FontAtlasMode::Sdf);
+	sdf->SetAtlasSize(512, 512);
+	sdf->Bake();
+	report("SDF 32px (ASCII, all sizes)", sdf);
+	LOG_INFO("\t{:<36} {} KB bitmap vs {} KB SDF", "Total for 16/32/64px text", bitmapBytes / 1024, sdf->GetStats().AtlasBytes / 1024);
+
+	// A dynamic font with a small atlas, cycling through a large range of codepoints as a
+	// localized HUD might, memory stays fixed while glyphs are evicted as needed
+	Font::Sptr dynamic = std::make_shared<Font>(path, 32.0f);
+	dynamic->SetDynamic(true);
+	dynamic->SetAtlasSize(256, 256);
+	dynamic->Bake();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	const uint32_t glyphsPerFrame = 64;
+	for (uint32_t codepoint = 0x20; codepoint < 0x52F; codepoint++) {
+		if (codepoint % glyphsPerFrame == 0) {
+			Font::AdvanceFrame();
+		}
+		float x = 0.0f, y = 0.0f;
+		dynamic->GetGlyph(codepoint, x, y);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	report("Dynamic 32px (U+0020-U+052F)", dynamic);
+	LOG_INFO("\t{:<36} {:.2f}ms to stream {} codepoints through a {} glyph cache",
+		"", std::chrono::duration<double, std::milli>(end - start).count(), 0x52F - 0x20, dynamic->GetStats().CacheCapacity);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Application/ApplicationLayer.h"
+#include <json.hpp>
+#include "Gameplay/GameObject.h"
+#include "Graphics/Font.h"
+
+/**
+ * Spawns a large HUD and measures the CPU cost of building and drawing it with the
+ * GuiBatcher in both immediate and retained mode, as well as the cost of the different
+ * font atlas modes. Results are written to the log
+ */
+class GuiBenchmarkLayer final : public ApplicationLayer {
+public:
+	MAKE_PTRS(GuiBenchmarkLayer)
+
+	GuiBenchmarkLayer();
+	virtual ~GuiBenchmarkLayer();
+
+	// Inherited from ApplicationLayer
+
+	virtual void OnSceneLoad() override;
+	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
+
+protected:
+	// The number of GUI elements to generate, half panels and half text
+	const int ELEMENT_COUNT = 5000;
+	// The number of frames to measure for each mode
+	const int FRAME_COUNT = 200;
+	// The number of frames to wait after loading before measuring
+	const int WARMUP_FRAMES = 10;
+
+	int _framesSinceLoad;
+	Font::Sptr _font;
+	std::vector<Gameplay::GameObject::WeakRef> _elements;
+
+	/**
+	 * Runs the GUI rendering for the current scene FRAME_COUNT times
+	 * @param retained True to use the GuiBatcher's retained mode
+	 * @param dirtyStride If non-zero, every n'th panel will change color every frame
+	 * @param drawCalls Will store the number of draw calls issued in the last frame
+	 * @returns The average CPU time per frame, in milliseconds
+	 */
+	double _Measure(bool retained, int dirtyStride, uint32_t& drawCalls);
+
+	/**
+	 * Compares the atlas memory and bake time of bitmap, SDF and dynamic fonts, results
+	 * are written to the log
+	 */
+	void _MeasureFonts();
+};
@@ -3,6 +3,7 @@
 #include <GLM/glm.hpp>
 #include <GLM/gtc/matrix_transform.hpp>
 #include "../Application.h"
+#include "Utils/MemoryTracker.h"
 
 InterfaceLayer::InterfaceLayer() :
 	ApplicationLayer()
@@ -15,6 +16,7 @@ InterfaceLayer::~InterfaceLayer()
 { }
 
 void InterfaceLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
+	MEMORY_SCOPE(GUI);
 	// Gets the application instance
 	Application& app = Application::Get();
 
@@ -38,9 +40,10 @@ void InterfaceLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
 	GuiBatcher::SetProjection(proj);
 
 	// Iterate over and render all the GUI objects
+	GuiBatcher::BeginFrame();
 	app.CurrentScene()->RenderGUI();
 
-	// Flush the Gui Batch renderer
+	// Flush the Gui Batch renderer, retained and immediate elements are drawn in the order they were submitted
 	GuiBatcher::Flush();
 
 	// Disable alpha blending
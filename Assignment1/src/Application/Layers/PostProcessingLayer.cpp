@@ -0,0 +1,123 @@
+#include "PostProcessingLayer.h"
+#include "RenderLayer.h"
+#include "../Application.h"
+#include "Utils/Profiler.h"
+
+PostProcessingLayer::PostProcessingLayer() :
+	ApplicationLayer(),
+	_effects(std::vector<PostProcessingEffect::Sptr>()),
+	_pool(nullptr),
+	_output(nullptr),
+	_colorGrading(nullptr)
+{
+	Name = "Post Processing";
+	Overrides = AppLayerFunctions::OnAppLoad | AppLayerFunctions::OnRender;
+}
+
+PostProcessingLayer::~PostProcessingLayer() = default;
+
+void PostProcessingLayer::AddEffect(const PostProcessingEffect::Sptr& effect) {
+	_effects.push_back(effect);
+}
+
+const std::vector<PostProcessingEffect::Sptr>& PostProcessingLayer::GetEffects() const {
+	return _effects;
+}
+
+const FramebufferPool::Sptr& PostProcessingLayer::GetFramebufferPool() const {
+	return _pool;
+}
+
+void PostProcessingLayer::OnAppLoad(const nlohmann::json& config) {
+	_pool = FramebufferPool::Create();
+
+	// Bloom needs to see HDR values, and FXAA's edge detection expects the final LDR colors
+	BloomEffect::Sptr bloom = BloomEffect::Create();
+	bloom->Enabled = false;
+	ToneMappingEffect::Sptr toneMapping = ToneMappingEffect::Create();
+	toneMapping->Enabled = false;
+	_colorGrading = ColorGradingEffect::Create();
+
+	AddEffect(bloom);
+	AddEffect(toneMapping);
+	AddEffect(_colorGrading);
+	AddEffect(FxaaEffect::Create());
+}
+
+void PostProcessingLayer::OnRender(const Framebuffer::Sptr& prevLayer) {
+	// Last frame's result has been presented, so it can go back in the pool
+	_pool->Release(_output);
+	_output = nullptr;
+
+	if (prevLayer == nullptr) {
+		_pool->EndFrame();
+		return;
+	}
+
+	Application& app = Application::Get();
+
+	// The LUT is owned by the scene, and RenderLayer's flag is still the global switch for it
+	RenderLayer::Sptr renderLayer = app.GetLayer<RenderLayer>();
+	bool gradingEnabled = renderLayer == nullptr || *(renderLayer->GetRenderFlags() & RenderFlags::EnableColorCorrection);
+	_colorGrading->LUT = gradingEnabled ? app.CurrentScene()->GetColorLUT() : nullptr;
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_FALSE);
+
+	Framebuffer::Sptr current = prevLayer;
+	RenderTargetType format = prevLayer->GetDescription().RenderTargets.at(RenderTargetAttachment::Color0).Format;
+	for (const PostProcessingEffect::Sptr& effect : _effects) {
+		if (!effect->IsActive()) {
+			continue;
+		}
+
+		PROFILE_RENDER_SCOPE(effect->Name.c_str());
+
+		glm::ivec2 size = effect->GetOutputSize(current->GetSize());
+		format = effect->GetOutputFormat(format);
+
+		Framebuffer::Sptr output = _pool->Acquire(size, format);
+		output->Bind();
+		glViewport(0, 0, size.x, size.y);
+		effect->Apply(current, output, *_pool);
+
+		// The previous layer's FBO is not ours to give back
+		if (current != prevLayer) {
+			_pool->Release(current);
+		}
+		current = output;
+	}
+
+	// Effects that ran at reduced resolution leave us with a small image, scale it back up so the
+	// layers after us can draw at full resolution
+	if (current != prevLayer && current->GetSize() != prevLayer->GetSize()) {
+		Framebuffer::Sptr upscaled = _pool->Acquire(prevLayer->GetSize(), format);
+		current->Bind(FramebufferBinding::Read);
+		upscaled->Bind(FramebufferBinding::Write);
+		Framebuffer::Blit({ 0, 0, current->GetWidth(), current->GetHeight() }, { 0, 0, upscaled->GetWidth(), upscaled->GetHeight() }, BufferFlags::Color, MagFilter::Linear);
+		_pool->Release(current);
+		current = upscaled;
+	}
+
+	if (current != prevLayer) {
+		_output = current;
+	}
+
+	// Later layers draw straight into whatever is bound, so make sure that's our result
+	current->Bind();
+	glViewport(0, 0, current->GetWidth(), current->GetHeight());
+
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glDepthMask(GL_TRUE);
+
+	VertexArrayObject::Unbind();
+
+	_pool->EndFrame();
+}
+
+Framebuffer::Sptr PostProcessingLayer::GetRenderOutput() {
+	return _output;
+}
@@ -1 +1,67 @@
 #pragma once
+#include <vector>
+#include "../ApplicationLayer.h"
+#include "Graphics/FramebufferPool.h"
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+#include "Graphics/PostProcessing/ColorGradingEffect.h"
+#include "Graphics/PostProcessing/ToneMappingEffect.h"
+#include "Graphics/PostProcessing/BloomEffect.h"
+#include "Graphics/PostProcessing/FxaaEffect.h"
+
+/// <summary>
+/// Runs an ordered chain of full-screen effects over the previous layer's output (normally
+/// RenderLayer's primary FBO). Each effect writes to a target from a shared pool, and the target it
+/// read from goes back into the pool, so the chain only needs as many targets as are in flight at
+/// once. The final result is held until the start of the next frame, since later layers (GUI) draw
+/// on top of it before it's blitted to the screen
+/// </summary>
+class PostProcessingLayer final : public ApplicationLayer {
+public:
+	MAKE_PTRS(PostProcessingLayer);
+
+	PostProcessingLayer();
+	virtual ~PostProcessingLayer();
+
+	/// <summary>
+	/// Adds an effect to the end of the chain
+	/// </summary>
+	void AddEffect(const PostProcessingEffect::Sptr& effect);
+	/// <summary>
+	/// Gets the effects in the order they are applied
+	/// </summary>
+	const std::vector<PostProcessingEffect::Sptr>& GetEffects() const;
+
+	/// <summary>
+	/// Gets the first effect of the given type in the chain, or nullptr if there is none
+	/// </summary>
+	template <typename T, typename = typename std::enable_if<std::is_base_of<PostProcessingEffect, T>::value>::type>
+	std::shared_ptr<T> GetEffect() const {
+		for (const auto& effect : _effects) {
+			std::shared_ptr<T> result = std::dynamic_pointer_cast<T>(effect);
+			if (result != nullptr) {
+				return result;
+			}
+		}
+		return nullptr;
+	}
+
+	/// <summary>
+	/// Gets the pool that intermediate targets are taken from
+	/// </summary>
+	const FramebufferPool::Sptr& GetFramebufferPool() const;
+
+	// Inherited from ApplicationLayer
+
+	virtual void OnAppLoad(const nlohmann::json& config) override;
+	virtual void OnRender(const Framebuffer::Sptr& prevLayer) override;
+	virtual Framebuffer::Sptr GetRenderOutput() override;
+
+protected:
+	std::vector<PostProcessingEffect::Sptr> _effects;
+	FramebufferPool::Sptr _pool;
+
+	// The result of this frame's chain, or nullptr if no effects ran
+	Framebuffer::Sptr _output;
+
+	ColorGradingEffect::Sptr _colorGrading;
+};
@@ -7,6 +7,7 @@
 #include "../Timing.h"
 #include "Gameplay/Components/ComponentManager.h"
 #include "Gameplay/Components/RenderComponent.h"
+#include "Utils/Profiler.h"
 
 // GLM math library
 #include <GLM/glm.hpp>
@@ -22,8 +23,12 @@ RenderLayer::RenderLayer() :
 	_blitFbo(true),
 	_frameUniforms(nullptr),
 	_instanceUniforms(nullptr),
-	_renderFlags(RenderFlags::EnableColorCorrection),
-	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f })
+	_lightGrid(nullptr),
+	_shadows(nullptr),
+	_renderFlags(RenderFlags::EnableColorCorrection | RenderFlags::EnableMultiDraw | RenderFlags::EnableGpuCulling),
+	_clearColor({ 0.1f, 0.1f, 0.1f, 1.0f }),
+	_prepassedMaterials(),
+	_prepassArenaFrame(0)
 {
 	Name = "Rendering";
 	Overrides = AppLayerFunctions::OnAppLoad | AppLayerFunctions::OnRender | AppLayerFunctions::OnWindowResize;
@@ -37,6 +42,18 @@ void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 
 	Application& app = Application::Get();
 
+	// Grab shorthands to the camera and shader from the scene
+	Camera::Sptr camera = app.CurrentScene()->MainCamera;
+
+	// Shadow maps use their own framebuffer and viewports, so they need to be drawn before we bind ours
+	{
+		PROFILE_RENDER_SCOPE("Shadows");
+		_shadows->Render(app.CurrentScene().get(), camera);
+	}
+
+	// The shadow pass has refreshed every transform, so any static objects that moved have already bumped the scene's version
+	bool useStaticBatches = *(_renderFlags & RenderFlags::EnableStaticBatching) && _staticBatcher->Update(app.CurrentScene().get());
+
 	glViewport(0, 0, _primaryFBO->GetWidth(), _primaryFBO->GetHeight());
 
 	// We bind our framebuffer so we can render to it
@@ -46,9 +63,6 @@ void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 	glClearColor(_clearColor.x, _clearColor.y, _clearColor.z, _clearColor.w);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Grab shorthands to the camera and shader from the scene
-	Camera::Sptr camera = app.CurrentScene()->MainCamera;
-
 	// Cache the camera's viewprojection
 	glm::mat4 viewProj = camera->GetViewProjection();
 	DebugDrawer::Get().SetViewProjection(viewProj);
@@ -68,17 +82,24 @@ void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 		environment->Bind(15);
 	}
 
-	// Binding the color correction LUT
-	Texture3D::Sptr colorLUT = app.CurrentScene()->GetColorLUT();
-	if (colorLUT) {
-		colorLUT->Bind(14);
-	}
-
 	// Here we'll bind all the UBOs to their corresponding slots
 	app.CurrentScene()->PreRender();
 	_frameUniforms->Bind(FRAME_UBO_BINDING);
 	_instanceUniforms->Bind(INSTANCE_UBO_BINDING);
 
+	// Cull the scene's lights into the cluster grid, this reads the light buffer the scene just bound
+	{
+		PROFILE_RENDER_SCOPE("Light Culling");
+		_lightGrid->Update(
+			camera->GetView(), camera->GetProjection(),
+			glm::vec2(camera->GetNearPlane(), camera->GetFarPlane()), camera->GetOrthoEnabled(),
+			glm::ivec2(_primaryFBO->GetWidth(), _primaryFBO->GetHeight()),
+			app.CurrentScene()->GetNumGpuLights()
+		);
+	}
+	_lightGrid->Bind();
+	_shadows->Bind();
+
 	// Draw physics debug
 	app.CurrentScene()->DrawPhysicsDebug();
 
@@ -95,49 +116,131 @@ void RenderLayer::OnRender(const Framebuffer::Sptr& prevLayer)
 
 	Material::Sptr defaultMat = app.CurrentScene()->DefaultMaterial;
 
-	// Render all our objects
-	app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
-		// Early bail if mesh not set
-		if (renderable->GetMesh() == nullptr) {
-			return;
-		}
+	FrameArena::Renew(_prepassArenaFrame, _prepassedMaterials);
+	_prepassedMaterials.clear();
+	if (*(_renderFlags & RenderFlags::EnableDepthPrepass)) {
+		_RenderDepthPrepass(viewProj, useStaticBatches);
+	}
 
-		// If we don't have a material, try getting the scene's fallback material
-		// If none exists, do not draw anything
-		if (renderable->GetMaterial() == nullptr) {
-			if (defaultMat != nullptr) {
-				renderable->SetMaterial(defaultMat);
-			} else {
-				return;
-			}
-		}
+	bool useMultiDraw = *(_renderFlags & RenderFlags::EnableMultiDraw) && MultiDrawRenderer::IsSupported();
+	_multiDraw->Begin();
+	_multiDraw->EnableCulling = *(_renderFlags & RenderFlags::EnableGpuCulling);
+	_multiDraw->EnableOcclusionCulling = *(_renderFlags & RenderFlags::EnableOcclusionCulling);
 
-		// If the material has changed, we need to bind the new shader and set up our material and frame data
-		// Note: This is a good reason why we should be sorting the render components in ComponentManager
-		if (renderable->GetMaterial() != currentMat) {
-			currentMat = renderable->GetMaterial();
-			shader = currentMat->GetShader();
+	// If the material has changed, we need to bind the new shader and set up our material and frame data
+	// Note: This is a good reason why we should be sorting the render components in ComponentManager
+	auto useMaterial = [&](const Material::Sptr& material) {
+		if (material == currentMat) {
+			return;
+		}
+		currentMat = material;
 
+		// Materials whose shader is still compiling draw with a cheap stand-in until it's ready
+		if (currentMat->IsReady()) {
+			shader = currentMat->GetActiveShader();
 			shader->Bind();
 			currentMat->Apply();
+		} else {
+			shader = Material::GetFallbackShader();
+			shader->Bind();
 		}
 
-		// Grab the game object so we can do some stuff with it
-		GameObject* object = renderable->GetGameObject();
+		// Anything the pre-pass drew already has it's final depth, so we only shade the fragments that match it
+		if (_prepassedMaterials.count(currentMat.get()) > 0) {
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		} else {
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+		}
+	};
 
-		// Use our uniform buffer for our instance level uniforms
+	// Use our uniform buffer for our instance level uniforms, then draw the mesh
+	auto drawMesh = [&](const VertexArrayObject::Sptr& mesh, const glm::mat4& transform) {
 		auto& instanceData = _instanceUniforms->GetData();
-		instanceData.u_Model = object->GetTransform();
-		instanceData.u_ModelViewProjection = viewProj * object->GetTransform();
-		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(object->GetTransform())));
+		instanceData.u_Model = transform;
+		instanceData.u_ModelViewProjection = viewProj * transform;
+		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(transform)));
 		_instanceUniforms->Update();
 
-		// Draw the object
-		renderable->GetMesh()->Draw();
-	});
+		mesh->Draw();
+	};
+
+	// Render all our objects
+	{
+		PROFILE_RENDER_SCOPE("Opaque");
+		app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+			// Early bail if mesh not set
+			if (renderable->GetMesh() == nullptr) {
+				return;
+			}
+
+			// If we don't have a material, try getting the scene's fallback material
+			// If none exists, do not draw anything
+			if (renderable->GetMaterial() == nullptr) {
+				if (defaultMat != nullptr) {
+					renderable->SetMaterial(defaultMat);
+				} else {
+					return;
+				}
+			}
+
+			// Grab the game object so we can do some stuff with it
+			GameObject* object = renderable->GetGameObject();
+
+			// Static objects that were merged are drawn with their batch after the loop
+			if (useStaticBatches && object->IsStatic && _staticBatcher->IsBatched(renderable.get())) {
+				return;
+			}
+
+			// Meshes in the geometry arena get batched up and drawn together after the loop
+			if (useMultiDraw && _multiDraw->Submit(renderable->GetMaterial(), renderable->GetMesh(), object->GetTransform())) {
+				return;
+			}
+
+			useMaterial(renderable->GetMaterial());
+			drawMesh(renderable->GetMesh(), object->GetTransform());
+		});
+
+		// Static batches are already in world space, so they draw with an identity transform
+		if (useStaticBatches) {
+			for (const StaticBatcher::Batch& batch : _staticBatcher->GetBatches()) {
+				if (useMultiDraw && _multiDraw->Submit(batch.Material, batch.Mesh, glm::mat4(1.0f))) {
+					continue;
+				}
+				useMaterial(batch.Material);
+				drawMesh(batch.Mesh, glm::mat4(1.0f));
+			}
+		}
+	}
+
+	{
+		PROFILE_RENDER_SCOPE("Multi-Draw");
+		_multiDraw->Flush(viewProj, [&](Material* material) {
+			if (_prepassedMaterials.count(material) > 0) {
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+			} else {
+				glDepthFunc(GL_LESS);
+				glDepthMask(GL_TRUE);
+			}
+		});
+	}
+
+	// Next frame's occlusion culling tests against what we just drew
+	{
+		PROFILE_RENDER_SCOPE("Hi-Z");
+		_multiDraw->UpdateOcclusion(_primaryFBO->GetTextureAttachment(RenderTargetAttachment::DepthStencil), viewProj);
+	}
+
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
 
 	// Use our cubemap to draw our skybox
-	app.CurrentScene()->DrawSkybox();
+	{
+		PROFILE_RENDER_SCOPE("Skybox");
+		app.CurrentScene()->DrawSkybox();
+	}
 
 	// Unbind our primary framebuffer so subsequent draw calls do not modify it
 	//_primaryFBO->Unbind();
@@ -173,9 +276,9 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	fboDescriptor.GenerateUnsampled = false;
 	fboDescriptor.SampleCount = 1;
 
-	// Add a depth and color attachment (same as default)
+	// Add a depth and color attachment, color is kept in HDR so post processing can do bloom and tone mapping
 	fboDescriptor.RenderTargets[RenderTargetAttachment::DepthStencil] ={ true, RenderTargetType::DepthStencil };
-	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] ={ true, RenderTargetType::ColorRgb8 };
+	fboDescriptor.RenderTargets[RenderTargetAttachment::Color0] ={ true, RenderTargetType::ColorRgba16F };
 
 	// Create the primary FBO
 	_primaryFBO = std::make_shared<Framebuffer>(fboDescriptor);
@@ -183,6 +286,16 @@ void RenderLayer::OnAppLoad(const nlohmann::json& config)
 	// Create our common uniform buffers
 	_frameUniforms = std::make_shared<UniformBuffer<FrameLevelUniforms>>(BufferUsage::DynamicDraw);
 	_instanceUniforms = std::make_shared<UniformBuffer<InstanceLevelUniforms>>(BufferUsage::DynamicDraw);
+
+	_lightGrid = ClusteredLightGrid::Create();
+	_shadows = ShadowRenderer::Create();
+	_multiDraw = MultiDrawRenderer::Create();
+	_staticBatcher = StaticBatcher::Create();
+
+	_prepassShader = ShaderProgram::Create();
+	_prepassShader->LoadShaderPartFromFile("shaders/vertex_shaders/depth_prepass.glsl", ShaderPartType::Vertex);
+	_prepassShader->LoadShaderPartFromFile("shaders/fragment_shaders/depth_prepass.glsl", ShaderPartType::Fragment);
+	_prepassShader->Link();
 }
 
 const Framebuffer::Sptr& RenderLayer::GetPrimaryFBO() const {
@@ -216,3 +329,108 @@ void RenderLayer::SetRenderFlags(RenderFlags value) {
 RenderFlags RenderLayer::GetRenderFlags() const {
 	return _renderFlags;
 }
+
+const ShadowRenderer::Sptr& RenderLayer::GetShadowRenderer() const {
+	return _shadows;
+}
+
+const MultiDrawRenderer::Sptr& RenderLayer::GetMultiDrawRenderer() const {
+	return _multiDraw;
+}
+
+const StaticBatcher::Sptr& RenderLayer::GetStaticBatcher() const {
+	return _staticBatcher;
+}
+
+void RenderLayer::_RenderDepthPrepass(const glm::mat4& viewProj, bool useStaticBatches) {
+	using namespace Gameplay;
+
+	PROFILE_RENDER_SCOPE("Depth Pre-pass");
+
+	Application& app = Application::Get();
+	Material::Sptr defaultMat = app.CurrentScene()->DefaultMaterial;
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+
+	Material* currentMat = nullptr;
+	DepthPrepassMode mode = DepthPrepassMode::Disabled;
+
+	auto useMaterial = [&](Material* material) {
+		if (material != currentMat) {
+			currentMat = material;
+			mode = currentMat->GetPrepassMode();
+
+			// Materials that are still compiling are drawn with the fallback shader, which does not match our depth
+			if (!currentMat->IsReady()) {
+				mode = DepthPrepassMode::Disabled;
+			}
+
+			if (mode == DepthPrepassMode::Shared) {
+				if (_prepassShader->IsReady()) {
+					_prepassShader->Bind();
+				} else {
+					mode = DepthPrepassMode::Disabled;
+				}
+			} else if (mode == DepthPrepassMode::Variant) {
+				const ShaderProgram::Sptr& variant = currentMat->GetPrepassShader();
+				if (variant != nullptr && variant->IsReady()) {
+					variant->Bind();
+					currentMat->ApplyPrepass();
+				} else {
+					mode = DepthPrepassMode::Disabled;
+				}
+			}
+
+			if (mode != DepthPrepassMode::Disabled) {
+				_prepassedMaterials.insert(currentMat);
+			}
+		}
+	};
+
+	auto drawDepth = [&](const VertexArrayObject::Sptr& mesh, const glm::mat4& transform) {
+		auto& instanceData = _instanceUniforms->GetData();
+		instanceData.u_Model = transform;
+		instanceData.u_ModelViewProjection = viewProj * transform;
+		instanceData.u_NormalMatrix = glm::mat3(glm::transpose(glm::inverse(transform)));
+		_instanceUniforms->Update();
+
+		// The shared shader only reads positions, so we can skip fetching the rest of the vertex
+		VertexArrayObject::Sptr positions = mode == DepthPrepassMode::Shared ? mesh->GetPositionStream() : nullptr;
+		if (positions != nullptr) {
+			positions->Draw();
+		} else {
+			mesh->Draw();
+		}
+	};
+
+	app.CurrentScene()->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		const Material::Sptr& material = renderable->GetMaterial() != nullptr ? renderable->GetMaterial() : defaultMat;
+		if (renderable->GetMesh() == nullptr || material == nullptr) {
+			return;
+		}
+
+		// Batched objects have to go through the same geometry as the main pass, or their depths won't match exactly
+		GameObject* object = renderable->GetGameObject();
+		if (useStaticBatches && object->IsStatic && _staticBatcher->IsBatched(renderable.get())) {
+			return;
+		}
+
+		useMaterial(material.get());
+		if (mode != DepthPrepassMode::Disabled) {
+			drawDepth(renderable->GetMesh(), object->GetTransform());
+		}
+	});
+
+	if (useStaticBatches) {
+		for (const StaticBatcher::Batch& batch : _staticBatcher->GetBatches()) {
+			useMaterial(batch.Material.get());
+			if (mode != DepthPrepassMode::Disabled) {
+				drawDepth(batch.Mesh, glm::mat4(1.0f));
+			}
+		}
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
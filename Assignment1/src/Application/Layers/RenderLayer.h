@@ -1,11 +1,29 @@
 #pragma once
+#include <unordered_set>
 #include "../ApplicationLayer.h"
 #include "Graphics/Framebuffer.h"
 #include "Graphics/Buffers/UniformBuffer.h"
+#include "Graphics/ClusteredLightGrid.h"
+#include "Graphics/ShadowRenderer.h"
+#include "Graphics/MultiDrawRenderer.h"
+#include "Graphics/StaticBatcher.h"
+#include "Gameplay/Material.h"
+#include "Utils/FrameArena.h"
 
 ENUM_FLAGS(RenderFlags, uint32_t,
 	None = 0,
-	EnableColorCorrection = 1 << 0
+	// Grades the final image through the scene's color LUT, see PostProcessingLayer
+	EnableColorCorrection  = 1 << 0,
+	// Lays down scene depth before shading, so the main pass only shades visible fragments
+	EnableDepthPrepass     = 1 << 1,
+	// Draws meshes from the geometry arena in batches with glMultiDrawElementsIndirect
+	EnableMultiDraw        = 1 << 2,
+	// Culls multi-draw objects against the frustum in a compute pass
+	EnableGpuCulling       = 1 << 3,
+	// Also culls multi-draw objects hidden behind the previous frame's depth
+	EnableOcclusionCulling = 1 << 4,
+	// Draws static objects that share a material from merged world space meshes, see StaticBatcher
+	EnableStaticBatching   = 1 << 5
 );
 
 class RenderLayer final : public ApplicationLayer {
@@ -61,6 +79,19 @@ public:
 	void SetRenderFlags(RenderFlags value);
 	RenderFlags GetRenderFlags() const;
 
+	/// <summary>
+	/// Gets the renderer responsible for the scene's shadow maps
+	/// </summary>
+	const ShadowRenderer::Sptr& GetShadowRenderer() const;
+	/// <summary>
+	/// Gets the renderer that batches arena meshes into multi-draw calls
+	/// </summary>
+	const MultiDrawRenderer::Sptr& GetMultiDrawRenderer() const;
+	/// <summary>
+	/// Gets the batcher that merges static objects when RenderFlags::EnableStaticBatching is set
+	/// </summary>
+	const StaticBatcher::Sptr& GetStaticBatcher() const;
+
 	// Inherited from ApplicationLayer
 
 	virtual void OnAppLoad(const nlohmann::json& config) override;
@@ -79,4 +110,27 @@ protected:
 
 	const int INSTANCE_UBO_BINDING = 1;
 	UniformBuffer<InstanceLevelUniforms>::Sptr _instanceUniforms;
+
+	// Bins the scene's lights into clusters so fragments only shade the lights that can reach them
+	ClusteredLightGrid::Sptr _lightGrid;
+
+	ShadowRenderer::Sptr _shadows;
+
+	MultiDrawRenderer::Sptr _multiDraw;
+
+	StaticBatcher::Sptr _staticBatcher;
+
+	// Position only shader used by materials with DepthPrepassMode::Shared
+	ShaderProgram::Sptr _prepassShader;
+	// The materials whose depth was written by this frame's pre-pass, these draw with GL_EQUAL in the main pass.
+	// Rebuilt every frame, so it's nodes live in the frame arena
+	FrameUnorderedSet<Gameplay::Material*> _prepassedMaterials;
+	uint64_t _prepassArenaFrame;
+
+	/// <summary>
+	/// Draws the depth of all opaque objects with color writes disabled, filling in _prepassedMaterials
+	/// </summary>
+	/// <param name="viewProj">The camera's view projection matrix</param>
+	/// <param name="useStaticBatches">True if batched static objects should be drawn through their batches, like the main pass</param>
+	void _RenderDepthPrepass(const glm::mat4& viewProj, bool useStaticBatches);
 };
\ No newline at end of file
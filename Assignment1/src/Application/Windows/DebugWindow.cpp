@@ -2,6 +2,12 @@
 #include "Application/Application.h"
 #include "Application/ApplicationLayer.h"
 #include "Application/Layers/RenderLayer.h"
+#include "Application/Layers/PostProcessingLayer.h"
+#include "Utils/ImGuiHelper.h"
+#include "Graphics/GeometryArena.h"
+#include "Graphics/IGraphicsResource.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/FrameArena.h"
 
 DebugWindow::DebugWindow() :
 	IEditorWindow()
@@ -9,7 +15,7 @@ DebugWindow::DebugWindow() :
 	Name = "Debug";
 	SplitDirection = ImGuiDir_::ImGuiDir_None;
 	SplitDepth = 0.5f;
-	Requirements = EditorWindowRequirements::Menubar;
+	Requirements = EditorWindowRequirements::Menubar | EditorWindowRequirements::Window;
 }
 
 DebugWindow::~DebugWindow() = default;
@@ -33,8 +39,176 @@ void DebugWindow::RenderMenuBar()
 		changed = true;
 		flags = (flags & ~*RenderFlags::EnableColorCorrection) | (temp ? RenderFlags::EnableColorCorrection : RenderFlags::None);
 	}
+	temp = *(flags & RenderFlags::EnableDepthPrepass);
+	if (ImGui::Checkbox("Depth Pre-pass", &temp)) {
+		changed = true;
+		flags = (flags & ~*RenderFlags::EnableDepthPrepass) | (temp ? RenderFlags::EnableDepthPrepass : RenderFlags::None);
+	}
+	temp = *(flags & RenderFlags::EnableMultiDraw);
+	if (ImGui::Checkbox("Multi-Draw", &temp)) {
+		changed = true;
+		flags = (flags & ~*RenderFlags::EnableMultiDraw) | (temp ? RenderFlags::EnableMultiDraw : RenderFlags::None);
+	}
+	temp = *(flags & RenderFlags::EnableGpuCulling);
+	if (ImGui::Checkbox("GPU Culling", &temp)) {
+		changed = true;
+		flags = (flags & ~*RenderFlags::EnableGpuCulling) | (temp ? RenderFlags::EnableGpuCulling : RenderFlags::None);
+	}
+	temp = *(flags & RenderFlags::EnableOcclusionCulling);
+	if (ImGui::Checkbox("Occlusion Culling", &temp)) {
+		changed = true;
+		flags = (flags & ~*RenderFlags::EnableOcclusionCulling) | (temp ? RenderFlags::EnableOcclusionCulling : RenderFlags::None);
+	}
+	temp = *(flags & RenderFlags::EnableStaticBatching);
+	if (ImGui::Checkbox("Static Batching", &temp)) {
+		changed = true;
+		flags = (flags & ~*RenderFlags::EnableStaticBatching) | (temp ? RenderFlags::EnableStaticBatching : RenderFlags::None);
+	}
 
 	if (changed) {
 		renderLayer->SetRenderFlags(flags);
 	}
 }
+
+void DebugWindow::Render()
+{
+	Application& app = Application::Get();
+	RenderLayer::Sptr renderLayer = app.GetLayer<RenderLayer>();
+
+	if (ImGui::CollapsingHeader("Multi-Draw")) {
+		if (!MultiDrawRenderer::IsSupported()) {
+			ImGui::TextDisabled("Not supported by this driver");
+		}
+		const MultiDrawRenderer::Stats& stats = renderLayer->GetMultiDrawRenderer()->GetStats();
+		ImGui::Text("Objects: %u", stats.Draws);
+		ImGui::Text("Batches: %u", stats.Batches);
+		for (const GeometryArena::Sptr& arena : GeometryArena::GetArenas()) {
+			ImGui::BulletText("Arena (stride %u): %u pages", arena->GetStride(), arena->GetNumPages());
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Static Batching")) {
+		const StaticBatcher::Sptr& batcher = renderLayer->GetStaticBatcher();
+		const StaticBatcher::Stats& stats = batcher->GetStats();
+		ImGui::Text("Objects:  %u", stats.Objects);
+		ImGui::Text("Batches:  %u", stats.Batches);
+		ImGui::Text("Vertices: %u", stats.Vertices);
+		ImGui::Text("Rebuilds: %u (last took %.2f ms)", stats.Rebuilds, stats.BuildMilliseconds);
+		ImGui::DragFloat("Cell Size##StaticBatching", &batcher->CellSize, 0.5f, 1.0f, 1000.0f);
+		ImGui::Checkbox("Unbatched While Editing", &batcher->PreserveEditorObjects);
+		if (ImGui::Button("Rebuild")) {
+			batcher->Clear();
+		}
+	}
+
+	PostProcessingLayer::Sptr postLayer = app.GetLayer<PostProcessingLayer>();
+	if (postLayer != nullptr && ImGui::CollapsingHeader("Post Processing")) {
+		const FramebufferPool::Stats& stats = postLayer->GetFramebufferPool()->GetStats();
+		ImGui::Text("Pooled targets: %u (%u in use)", stats.Targets, stats.InUse);
+		ImGui::Text("Targets created: %u", stats.Created);
+		for (const PostProcessingEffect::Sptr& effect : postLayer->GetEffects()) {
+			ImGui::PushID(effect.get());
+			ImGui::Checkbox(effect->Name.c_str(), &effect->Enabled);
+			if (effect->Enabled) {
+				ImGui::Indent();
+				LABEL_LEFT(ImGui::SliderFloat, "Resolution Scale", &effect->ResolutionScale, 0.25f, 1.0f);
+				effect->RenderImGui();
+				ImGui::Unindent();
+			}
+			ImGui::PopID();
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Shadows")) {
+		const ShadowRenderer::Stats& stats = renderLayer->GetShadowRenderer()->GetStats();
+		ImGui::Text("Views rendered:  %u", stats.ViewsRendered);
+		ImGui::Text("Static rebuilds: %u", stats.StaticViewsRendered);
+		ImGui::Text("Views cached:    %u", stats.ViewsCached);
+		ImGui::Text("Draw calls:      %u", stats.DrawCalls);
+		for (size_t ix = 0; ix < stats.DrawsPerView.size(); ix++) {
+			if (stats.DrawsPerView[ix] > 0) {
+				ImGui::BulletText("View %zu: %u draws", ix, stats.DrawsPerView[ix]);
+			}
+		}
+		if (ImGui::Button("Invalidate Cache")) {
+			renderLayer->GetShadowRenderer()->InvalidateCache();
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Spatial Index")) {
+		const Gameplay::SpatialIndex::Sptr& index = app.CurrentScene()->GetSpatialIndex();
+		Gameplay::SpatialIndex::Stats stats = index->GetStats();
+		ImGui::Text("Objects:   %u", stats.Items);
+		ImGui::Text("Cells:     %u", stats.Cells);
+		ImGui::Text("Oversized: %u", stats.Oversized);
+		float cellSize = stats.CellSize;
+		if (ImGui::DragFloat("Cell Size", &cellSize, 0.1f, 0.5f, 100.0f)) {
+			index->SetCellSize(cellSize);
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Physics Queries")) {
+		const Gameplay::Physics::PhysicsQueryService::Stats& stats = app.CurrentScene()->GetPhysicsQueries()->GetStats();
+		ImGui::Text("Queries: %u", stats.Queries);
+		ImGui::Text("Hits:    %u", stats.Hits);
+		ImGui::Text("Threads: %u", stats.Threads);
+		ImGui::Text("Time:    %.3f ms", stats.Milliseconds);
+	}
+
+	if (ImGui::CollapsingHeader("Memory")) {
+		if (!MemoryTracker::IsEnabled()) {
+			ImGui::TextDisabled("Allocation tracking was compiled out");
+		}
+
+		ImGui::Columns(6, "##MemoryTags");
+		ImGui::TextUnformatted("Tag");         ImGui::NextColumn();
+		ImGui::TextUnformatted("Current (KB)"); ImGui::NextColumn();
+		ImGui::TextUnformatted("Peak (KB)");   ImGui::NextColumn();
+		ImGui::TextUnformatted("Live");        ImGui::NextColumn();
+		ImGui::TextUnformatted("Frame");       ImGui::NextColumn();
+		ImGui::TextUnformatted("Budget (KB)"); ImGui::NextColumn();
+		ImGui::Separator();
+		for (size_t ix = 0; ix < MemoryTracker::TAG_COUNT; ix++) {
+			MemoryTag tag = static_cast<MemoryTag>(ix);
+			MemoryTracker::TagStats stats = MemoryTracker::GetStats(tag);
+			bool overBudget = stats.BudgetBytes > 0 && stats.CurrentBytes > stats.BudgetBytes;
+			if (overBudget) {
+				ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.3f, 0.3f, 1.0f));
+			}
+			ImGui::TextUnformatted((~tag).c_str());               ImGui::NextColumn();
+			ImGui::Text("%.1f", stats.CurrentBytes / 1024.0);    ImGui::NextColumn();
+			ImGui::Text("%.1f", stats.PeakBytes / 1024.0);       ImGui::NextColumn();
+			ImGui::Text("%lld", (long long)stats.LiveAllocations); ImGui::NextColumn();
+			ImGui::Text("%llu", (unsigned long long)stats.FrameAllocations); ImGui::NextColumn();
+			if (stats.BudgetBytes > 0) {
+				ImGui::Text("%.1f", stats.BudgetBytes / 1024.0);
+			} else {
+				ImGui::TextDisabled("-");
+			}
+			ImGui::NextColumn();
+			if (overBudget) {
+				ImGui::PopStyleColor();
+			}
+		}
+		ImGui::Columns(1);
+		if (ImGui::Button("Reset Peaks")) {
+			MemoryTracker::ResetPeaks();
+		}
+
+		ImGui::Separator();
+		FrameArena::Stats arena = FrameArena::GetStats();
+		ImGui::Text("Frame arena: %.1f / %.1f KB (peak %.1f KB)", arena.LastFrameBytes / 1024.0, arena.Capacity / 1024.0, arena.PeakBytes / 1024.0);
+		if (arena.Overflows > 0) {
+			ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.3f, 1.0f), "Arena overflows: %llu", (unsigned long long)arena.Overflows);
+		}
+
+		ImGui::Separator();
+		ImGui::TextUnformatted("Video memory (estimated)");
+		size_t totalVideo = 0;
+		for (const auto& [type, bytes] : IGraphicsResource::GetMemoryEstimates()) {
+			ImGui::BulletText("%s: %.2f MB", (~type).c_str(), bytes / (1024.0 * 1024.0));
+			totalVideo += bytes;
+		}
+		ImGui::Text("Total: %.2f MB", totalVideo / (1024.0 * 1024.0));
+	}
+}
@@ -13,6 +13,7 @@ public:
 	// Inherited from IEditorWindow
 
 	virtual void RenderMenuBar() override;
+	virtual void Render() override;
 
 protected:
 };
\ No newline at end of file
@@ -26,8 +26,10 @@ void HierarchyWindow::Render()
 		ImGui::EndPopup();
 	}
 	
-	for (const auto& object : app.CurrentScene()->_objects) {
-		_RenderObjectNode(object);
+	// Objects can be added from the context menus while we're iterating, so we go by index
+	Gameplay::Scene::Sptr& scene = app.CurrentScene();
+	for (size_t ix = 0; ix < scene->_objects.size(); ix++) {
+		_RenderObjectNode(scene->_objects[ix]);
 	}
 }
 
@@ -39,7 +41,7 @@ void HierarchyWindow::_RenderObjectNode(Gameplay::GameObject::Sptr object, int d
 	}
 
 	// If the parent exists and we're at depth 0, abort
-	if (object->GetParent() != nullptr && depth == 0) {
+	if (object->HasParent() && depth == 0) {
 		return;
 	}
 
@@ -55,7 +57,7 @@ void HierarchyWindow::_RenderObjectNode(Gameplay::GameObject::Sptr object, int d
 	if (selectedObject != nullptr && selectedObject == object) {
 		flags |= ImGuiTreeNodeFlags_Selected;
 	}
-	if (object->GetChildren().size() == 0) {
+	if (!object->HasChildren()) {
 		flags |= ImGuiTreeNodeFlags_Leaf;
 	}
 
@@ -105,13 +107,9 @@ void HierarchyWindow::_RenderObjectNode(Gameplay::GameObject::Sptr object, int d
 		ImGui::Text("Are you sure you want to delete this game object?");
 		if (ImGuiHelper::WarningButton("Yes")) {
 			// Remove ourselves from the scene
+			// Remove ourselves from the scene, the scene will unlink us from our parent
 			object->GetScene()->RemoveGameObject(object);
 
-			// If the parent is not null, let it know we just killed it's child
-			if (object->GetParent() != nullptr) {
-				object->GetParent()->_PurgeDeletedChildren();
-			}
-
 			// Restore imgui state so we can early bail
 			ImGui::CloseCurrentPopup();
 			ImGui::EndPopup();
@@ -131,8 +129,8 @@ void HierarchyWindow::_RenderObjectNode(Gameplay::GameObject::Sptr object, int d
 
 	// If the node is expanded, render the child nodes
 	if (isOpen) {
-		for (const auto& child : object->GetChildren()) {
-			_RenderObjectNode(child, depth + 1);
+		for (GameObject* child = object->GetFirstChild(); child != nullptr; child = child->GetNextSibling()) {
+			_RenderObjectNode(child->SelfRef(), depth + 1);
 		}
 
 		// We also need the tree pop so that we finish the tree node
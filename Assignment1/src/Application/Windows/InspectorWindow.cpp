@@ -31,7 +31,7 @@ void InspectorWindow::Render()
 		memcpy(nameBuff, selection->Name.c_str(), selection->Name.size());
 		nameBuff[selection->Name.size()] = '\0';
 		if (ImGui::InputText("##name", nameBuff, 256)) {
-			selection->Name = nameBuff;
+			selection->SetName(nameBuff);
 		}
 
 		ImGui::Separator();
@@ -0,0 +1,265 @@
+#include "ProfilerWindow.h"
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <GLM/glm.hpp>
+#include "Utils/ImGuiHelper.h"
+#include "Utils/Windows/FileDialogs.h"
+
+ProfilerWindow::ProfilerWindow() :
+	IEditorWindow(),
+	_selectedFrame(-1),
+	_pixelsPerMs(40.0f)
+{
+	Name = "Profiler";
+	ParentName = "Debug";
+	SplitDirection = ImGuiDir_::ImGuiDir_Down;
+	SplitDepth = 0.5f;
+	Requirements = EditorWindowRequirements::Menubar | EditorWindowRequirements::Window;
+}
+
+ProfilerWindow::~ProfilerWindow() = default;
+
+void ProfilerWindow::RenderMenuBar()
+{
+	bool enabled = Profiler::IsEnabled();
+	if (ImGui::Checkbox("Enabled", &enabled)) {
+		Profiler::SetEnabled(enabled);
+	}
+	bool paused = Profiler::IsPaused();
+	if (ImGui::Checkbox("Paused", &paused)) {
+		Profiler::SetPaused(paused);
+	}
+	if (ImGui::MenuItem("Export Chrome Trace...")) {
+		std::optional<std::string> path = FileDialogs::SaveFile("Chrome Trace\0*.json\0\0");
+		if (path.has_value()) {
+			Profiler::ExportChromeTrace(path.value());
+		}
+	}
+}
+
+void ProfilerWindow::Render()
+{
+	const std::deque<Profiler::FrameCapture>& frames = Profiler::GetFrames();
+	if (frames.empty()) {
+		ImGui::TextDisabled("No frames captured");
+		return;
+	}
+
+	const Profiler::FrameCapture* selected = nullptr;
+	if (_selectedFrame >= 0) {
+		auto it = std::find_if(frames.begin(), frames.end(), [&](const Profiler::FrameCapture& frame) {
+			return frame.Index == (uint64_t)_selectedFrame;
+		});
+		if (it != frames.end()) {
+			selected = &(*it);
+		} else {
+			_selectedFrame = -1;
+		}
+	}
+	// When following, show the newest frame that has it's GPU timings, so the GPU row isn't always empty
+	if (selected == nullptr) {
+		for (auto it = frames.rbegin(); it != frames.rend() && selected == nullptr; it++) {
+			if (it->GpuResolved) {
+				selected = &(*it);
+			}
+		}
+		if (selected == nullptr) {
+			selected = &frames.back();
+		}
+	}
+
+	_RenderFrameGraph(selected);
+
+	ImGui::Text("Frame %llu: %.2f ms", (unsigned long long)selected->Index, (selected->EndNs - selected->StartNs) / 1000000.0);
+	if (_selectedFrame >= 0) {
+		ImGui::SameLine();
+		if (ImGui::Button("Follow Latest")) {
+			_selectedFrame = -1;
+		}
+	}
+	if (Profiler::GetDroppedEvents() > 0) {
+		ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "%llu events dropped (thread buffers full)", (unsigned long long)Profiler::GetDroppedEvents());
+	}
+	LABEL_LEFT(ImGui::DragFloat, "Zoom (px/ms)", &_pixelsPerMs, 1.0f, 5.0f, 2000.0f);
+
+	_RenderTimeline(*selected);
+
+	if (ImGui::CollapsingHeader("Zone Totals")) {
+		_RenderZoneTotals(*selected);
+	}
+}
+
+void ProfilerWindow::_RenderFrameGraph(const Profiler::FrameCapture*& selected)
+{
+	const std::deque<Profiler::FrameCapture>& frames = Profiler::GetFrames();
+
+	const float height = 60.0f;
+	float width = glm::max(ImGui::GetContentRegionAvail().x, 1.0f);
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImGui::InvisibleButton("##FrameGraph", ImVec2(width, height));
+	bool hovered = ImGui::IsItemHovered();
+	bool clicked = ImGui::IsItemClicked();
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(25, 25, 25, 255));
+
+	// Scale to fit the slowest frame, but never less than 30fps so a smooth capture doesn't look spiky
+	double maxMs = 1000.0 / 30.0;
+	for (const Profiler::FrameCapture& frame : frames) {
+		maxMs = glm::max(maxMs, (frame.EndNs - frame.StartNs) / 1000000.0);
+	}
+
+	float barWidth = width / Profiler::HISTORY_SIZE;
+	for (size_t ix = 0; ix < frames.size(); ix++) {
+		const Profiler::FrameCapture& frame = frames[ix];
+		double ms = (frame.EndNs - frame.StartNs) / 1000000.0;
+		float barHeight = static_cast<float>(ms / maxMs) * height;
+		float x = origin.x + ix * barWidth;
+
+		ImU32 color = ms < 1000.0 / 60.0 ? IM_COL32(80, 180, 80, 255) : ms < 1000.0 / 30.0 ? IM_COL32(220, 180, 60, 255) : IM_COL32(220, 70, 60, 255);
+		if (&frame == selected) {
+			color = IM_COL32(255, 255, 255, 255);
+		}
+		drawList->AddRectFilled(ImVec2(x, origin.y + height - barHeight), ImVec2(x + glm::max(barWidth - 1.0f, 1.0f), origin.y + height), color);
+	}
+
+	// Marker for the 60fps budget
+	float budgetY = origin.y + height - static_cast<float>((1000.0 / 60.0) / maxMs) * height;
+	drawList->AddLine(ImVec2(origin.x, budgetY), ImVec2(origin.x + width, budgetY), IM_COL32(255, 255, 255, 80));
+
+	if (hovered) {
+		size_t index = static_cast<size_t>((ImGui::GetIO().MousePos.x - origin.x) / barWidth);
+		if (index < frames.size()) {
+			const Profiler::FrameCapture& frame = frames[index];
+			ImGui::SetTooltip("Frame %llu\n%.2f ms", (unsigned long long)frame.Index, (frame.EndNs - frame.StartNs) / 1000000.0);
+			if (clicked) {
+				_selectedFrame = static_cast<int64_t>(frame.Index);
+				selected = &frame;
+			}
+		}
+	}
+}
+
+void ProfilerWindow::_RenderTimeline(const Profiler::FrameCapture& frame)
+{
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+
+	// One lane per thread, plus one for the GPU. Each lane has a title row then a row per depth
+	std::map<uint32_t, uint32_t> laneDepths;
+	for (const Profiler::Event& event : frame.CpuEvents) {
+		laneDepths[event.ThreadId] = glm::max(laneDepths[event.ThreadId], event.Depth + 1);
+	}
+	int64_t rangeEnd = frame.EndNs;
+	for (const Profiler::Event& event : frame.GpuEvents) {
+		laneDepths[Profiler::GPU_THREAD_ID] = glm::max(laneDepths[Profiler::GPU_THREAD_ID], event.Depth + 1);
+		// GPU work usually finishes after the CPU has moved on to the next frame
+		rangeEnd = std::max(rangeEnd, event.EndNs);
+	}
+
+	float totalHeight = 0.0f;
+	for (const auto& [thread, depth] : laneDepths) {
+		totalHeight += (depth + 1) * rowHeight;
+	}
+
+	auto toX = [&](float originX, int64_t time) {
+		return originX + static_cast<float>((time - frame.StartNs) / 1000000.0) * _pixelsPerMs;
+	};
+
+	float contentWidth = static_cast<float>((rangeEnd - frame.StartNs) / 1000000.0) * _pixelsPerMs;
+	ImGui::BeginChild("##Timeline", ImVec2(0.0f, totalHeight + ImGui::GetStyle().ScrollbarSize + 8.0f), true, ImGuiWindowFlags_HorizontalScrollbar);
+
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImGui::Dummy(ImVec2(contentWidth, totalHeight));
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	bool windowHovered = ImGui::IsWindowHovered();
+
+	// The frame boundary, anything past it is GPU work that was still running
+	float frameEndX = toX(origin.x, frame.EndNs);
+	drawList->AddLine(ImVec2(frameEndX, origin.y), ImVec2(frameEndX, origin.y + totalHeight), IM_COL32(255, 255, 255, 80));
+
+	float laneY = origin.y;
+	for (const auto& [thread, depth] : laneDepths) {
+		drawList->AddText(ImVec2(ImGui::GetWindowPos().x + 4.0f, laneY), IM_COL32(200, 200, 200, 255), Profiler::GetThreadName(thread).c_str());
+
+		const std::vector<Profiler::Event>& events = thread == Profiler::GPU_THREAD_ID ? frame.GpuEvents : frame.CpuEvents;
+		for (const Profiler::Event& event : events) {
+			if (event.ThreadId != thread) {
+				continue;
+			}
+
+			float x0 = toX(origin.x, event.StartNs);
+			float x1 = glm::max(toX(origin.x, event.EndNs), x0 + 1.0f);
+			float y0 = laneY + (event.Depth + 1) * rowHeight;
+			float y1 = y0 + rowHeight - 1.0f;
+
+			// Color by name, so the same zone is easy to follow between the CPU and GPU rows
+			float hue = (std::hash<std::string>()(event.Name) % 360) / 360.0f;
+			drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), ImColor::HSV(hue, 0.5f, 0.65f));
+
+			if (x1 - x0 > 8.0f) {
+				drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+				drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(255, 255, 255, 255), event.Name);
+				drawList->PopClipRect();
+			}
+
+			if (windowHovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) {
+				ImGui::SetTooltip("%s\n%.3f ms", event.Name, (event.EndNs - event.StartNs) / 1000000.0);
+			}
+		}
+
+		laneY += (depth + 1) * rowHeight;
+	}
+
+	ImGui::EndChild();
+}
+
+void ProfilerWindow::_RenderZoneTotals(const Profiler::FrameCapture& frame)
+{
+	// Total CPU and GPU time spent in each zone name, and the draw calls and allocations made inside it
+	struct ZoneTotal {
+		double   CpuMs = 0.0;
+		double   GpuMs = 0.0;
+		uint32_t DrawCalls = 0;
+		uint32_t Allocations = 0;
+	};
+	std::map<std::string, ZoneTotal> totals;
+	for (const Profiler::Event& event : frame.CpuEvents) {
+		totals[event.Name].CpuMs += (event.EndNs - event.StartNs) / 1000000.0;
+		totals[event.Name].DrawCalls += event.DrawCalls;
+		totals[event.Name].Allocations += event.Allocations;
+	}
+	for (const Profiler::Event& event : frame.GpuEvents) {
+		totals[event.Name].GpuMs += (event.EndNs - event.StartNs) / 1000000.0;
+	}
+
+	std::vector<std::pair<std::string, ZoneTotal>> sorted(totals.begin(), totals.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return glm::max(a.second.CpuMs, a.second.GpuMs) > glm::max(b.second.CpuMs, b.second.GpuMs);
+	});
+
+	ImGui::Text("Draw calls: %u", frame.DrawCalls);
+	ImGui::Text("Allocations: %u", frame.Allocations);
+	ImGui::Columns(5, "##ZoneTotals");
+	ImGui::TextUnformatted("Zone");    ImGui::NextColumn();
+	ImGui::TextUnformatted("CPU (ms)"); ImGui::NextColumn();
+	ImGui::TextUnformatted("GPU (ms)"); ImGui::NextColumn();
+	ImGui::TextUnformatted("Draws");    ImGui::NextColumn();
+	ImGui::TextUnformatted("Allocs");   ImGui::NextColumn();
+	ImGui::Separator();
+	for (const auto& [name, total] : sorted) {
+		ImGui::TextUnformatted(name.c_str()); ImGui::NextColumn();
+		ImGui::Text("%.3f", total.CpuMs);      ImGui::NextColumn();
+		if (total.GpuMs > 0.0) {
+			ImGui::Text("%.3f", total.GpuMs);
+		} else {
+			ImGui::TextDisabled("-");
+		}
+		ImGui::NextColumn();
+		ImGui::Text("%u", total.DrawCalls);    ImGui::NextColumn();
+		ImGui::Text("%u", total.Allocations);  ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
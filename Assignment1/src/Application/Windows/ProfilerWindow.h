@@ -0,0 +1,37 @@
+#pragma once
+#include "Application/IEditorWindow.h"
+#include "Utils/Profiler.h"
+
+/**
+ * Shows the profiler's frame history, and a timeline of the CPU and GPU zones in a selected frame
+ */
+class ProfilerWindow final : public IEditorWindow {
+public:
+	MAKE_PTRS(ProfilerWindow);
+	ProfilerWindow();
+	virtual ~ProfilerWindow();
+
+	// Inherited from IEditorWindow
+
+	virtual void RenderMenuBar() override;
+	virtual void Render() override;
+
+protected:
+	// The index of the frame we're inspecting, or -1 to follow the most recent complete frame
+	int64_t _selectedFrame;
+	// Horizontal zoom of the timeline, in pixels per millisecond
+	float   _pixelsPerMs;
+
+	/// <summary>
+	/// Draws a bar per frame in the history, clicking a bar selects that frame
+	/// </summary>
+	void _RenderFrameGraph(const Profiler::FrameCapture*& selected);
+	/// <summary>
+	/// Draws the zones of the given frame, with a row per thread plus one for the GPU
+	/// </summary>
+	void _RenderTimeline(const Profiler::FrameCapture& frame);
+	/// <summary>
+	/// Draws the total time spent in each zone name of the given frame
+	/// </summary>
+	void _RenderZoneTotals(const Profiler::FrameCapture& frame);
+};
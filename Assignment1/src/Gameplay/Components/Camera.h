@@ -63,6 +63,12 @@ namespace Gameplay {
 		/// Gets the vertical scale of this camera when in projection mode (ie. how many units appear vertically within the window)
 		/// </summary>
 		float GetOrthoVerticalScale() const { return _orthoVerticalScale; }
+		/// <summary>
+		/// Gets the distance to the near and far clipping planes, in world units
+		/// </summary>
+		float GetNearPlane() const { return _nearPlane; }
+		float GetFarPlane() const { return _farPlane; }
+
 		/// <summary>
 		/// Gets whether this camera is in orthographic mode
 		/// </summary>
@@ -8,13 +8,19 @@ GuiPanel::GuiPanel() :
 	_borderRadius(-1),
 	_color(glm::vec4(1.0f)),
 	_texture(nullptr),
-	_transform(nullptr)
+	_transform(nullptr),
+	_retainedHandle(GuiBatcher::InvalidElement),
+	_lastSize(glm::vec2(0.0f)),
+	_isDirty(true)
 { }
 
-GuiPanel::~GuiPanel() = default;
+GuiPanel::~GuiPanel() {
+	GuiBatcher::ReleaseElement(_retainedHandle);
+}
 
 void GuiPanel::SetColor(const glm::vec4& color) {
 	_color = color;
+	_isDirty = true;
 }
 
 const glm::vec4& GuiPanel::GetColor() const {
@@ -27,6 +33,7 @@ int GuiPanel::GetBorderRadius() const {
 
 void GuiPanel::SetBorderRadius(int value) {
 	_borderRadius = value;
+	_isDirty = true;
 }
 
 Texture2D::Sptr GuiPanel::GetTexture() const {
@@ -35,6 +42,7 @@ Texture2D::Sptr GuiPanel::GetTexture() const {
 
 void GuiPanel::SetTexture(const Texture2D::Sptr& value) {
 	_texture = value;
+	_isDirty = true;
 }
 
 void GuiPanel::Awake() {
@@ -47,9 +55,23 @@ void GuiPanel::Awake() {
 
 void GuiPanel::StartGUI() {
 	Texture2D::Sptr tex = _texture != nullptr ? _texture : GuiBatcher::GetDefaultTexture();
+	glm::vec2 size = _transform->GetSize();
+
+	// In retained mode, we only need to re-build our geometry if something has changed
+	if (GuiBatcher::GetRetainedMode()) {
+		bool dirty = _isDirty || size != _lastSize;
+		if (!GuiBatcher::BeginElement(_retainedHandle, tex, false, dirty)) {
+			return;
+		}
+	}
 
-	GuiBatcher::PushRect(glm::vec2(0,0), _transform->GetSize(), _color, tex, _borderRadius < 0 ? GuiBatcher::GetDefaultBorderRadius() : _borderRadius);
+	GuiBatcher::PushRect(glm::vec2(0,0), size, _color, tex, _borderRadius < 0 ? GuiBatcher::GetDefaultBorderRadius() : _borderRadius);
 
+	if (GuiBatcher::GetRetainedMode()) {
+		GuiBatcher::EndElement(_retainedHandle);
+		_lastSize = size;
+		_isDirty = false;
+	}
 }
 
 void GuiPanel::FinishGUI() {
@@ -57,8 +79,8 @@ void GuiPanel::FinishGUI() {
 
 void GuiPanel::RenderImGui()
 {
-	LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
-	LABEL_LEFT(ImGui::DragInt,    "Radius", &_borderRadius, 1, 0, 128);
+	_isDirty |= LABEL_LEFT(ImGui::ColorEdit4, "Color ", &_color.x);
+	_isDirty |= LABEL_LEFT(ImGui::DragInt,    "Radius", &_borderRadius, 1, 0, 128);
 }
 
 nlohmann::json GuiPanel::ToJson() const {
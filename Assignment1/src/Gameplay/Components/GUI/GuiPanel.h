@@ -3,6 +3,7 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Components/GUI/RectTransform.h"
 #include "Graphics/Textures/Texture2D.h"
+#include "Graphics/GuiBatcher.h"
 
 /// <summary>
 /// Draws a textured background for UI components
@@ -59,4 +60,9 @@ protected:
 	glm::vec4       _color;
 
 	RectTransform::Sptr _transform;
+
+	// Retained mode state, tracks whether we need to re-tessellate
+	GuiBatcher::ElementHandle _retainedHandle;
+	glm::vec2                 _lastSize;
+	bool                      _isDirty;
 };
\ No newline at end of file
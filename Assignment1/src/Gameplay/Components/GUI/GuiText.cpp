@@ -14,13 +14,19 @@ GuiText::GuiText() :
 	_color(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)),
 	_font(nullptr),
 	_textSize(glm::vec2(0.0f)),
-	_textScale(1.0f)
+	_textScale(1.0f),
+	_retainedHandle(GuiBatcher::InvalidElement),
+	_lastSize(glm::vec2(0.0f)),
+	_isDirty(true)
 { }
 
-GuiText::~GuiText() = default;
+GuiText::~GuiText() {
+	GuiBatcher::ReleaseElement(_retainedHandle);
+}
 
 void GuiText::SetColor(const glm::vec4& color) {
 	_color = color;
+	_isDirty = true;
 }
 
 const glm::vec4& GuiText::GetColor() const {
@@ -41,7 +47,8 @@ const std::wstring& GuiText::GetTextUnicode() const {
 
 void GuiText::SetTextUnicode(const std::wstring& value) {
 	_text = value;
-	
+	_isDirty = true;
+
 	if (_font != nullptr) {
 		_textSize = _font->MeausureString(_text, _textScale);
 	}
@@ -53,6 +60,10 @@ const float GuiText::GetTextScale() const {
 
 void GuiText::SetTextScale(float value) {
 	_textScale = value;
+	_isDirty = true;
+	if (_font != nullptr) {
+		_textSize = _font->MeausureString(_text, _textScale);
+	}
 }
 
 const Font::Sptr& GuiText::GetFont() const {
@@ -61,6 +72,7 @@ const Font::Sptr& GuiText::GetFont() const {
 
 void GuiText::SetFont(const Font::Sptr& font) {
 	_font = font;
+	_isDirty = true;
 	if (_font != nullptr) {
 		_textSize = _font->MeausureString(_text, _textScale);
 	}
@@ -77,9 +89,25 @@ void GuiText::Awake() {
 void GuiText::RenderGUI()
 {
 	if (_font != nullptr && !_text.empty()) {
-		glm::vec2 position = _transform->GetSize() / 2.0f;
+		glm::vec2 size = _transform->GetSize();
+
+		// In retained mode, we only need to re-build our glyphs if something has changed
+		if (GuiBatcher::GetRetainedMode()) {
+			bool dirty = _isDirty || size != _lastSize;
+			if (!GuiBatcher::BeginElement(_retainedHandle, _font, dirty)) {
+				return;
+			}
+		}
+
+		glm::vec2 position = size / 2.0f;
 		position -= _textSize / 2.0f;
 		GuiBatcher::RenderText(_text, _font, position, _color, _textScale);
+
+		if (GuiBatcher::GetRetainedMode()) {
+			GuiBatcher::EndElement(_retainedHandle);
+			_lastSize = size;
+			_isDirty = false;
+		}
 	}
 }
 
@@ -91,12 +119,14 @@ void GuiText::RenderImGui()
 
 	if (LABEL_LEFT(ImGui::InputTextMultiline, "Text", buffer, 4096)) {
 		_text = StringConvert.from_bytes(buffer);
+		_isDirty = true;
 		if (_font != nullptr) {
 			_textSize = _font->MeausureString(_text, _textScale);
 		}
 	}
-	LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x);
+	_isDirty |= LABEL_LEFT(ImGui::ColorEdit4, "Color", &_color.x);
 	if (LABEL_LEFT(ImGui::DragFloat, "Scale", &_textScale, 0.01f)) {
+		_isDirty = true;
 		if (_font != nullptr) {
 			_textSize = _font->MeausureString(_text, _textScale);
 		}
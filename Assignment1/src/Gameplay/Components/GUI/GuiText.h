@@ -2,6 +2,7 @@
 #include "Gameplay/Components/IComponent.h"
 #include "Gameplay/Components/GUI/RectTransform.h"
 #include "Graphics/Font.h"
+#include "Graphics/GuiBatcher.h"
 
 /// <summary>
 /// Renders text for UI components
@@ -82,4 +83,9 @@ protected:
 	float           _textScale;
 
 	RectTransform::Sptr _transform;
+
+	// Retained mode state, tracks whether we need to re-tessellate
+	GuiBatcher::ElementHandle _retainedHandle;
+	glm::vec2                 _lastSize;
+	bool                      _isDirty;
 };
\ No newline at end of file
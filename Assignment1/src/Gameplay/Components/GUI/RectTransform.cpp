@@ -53,10 +53,12 @@ glm::vec2 RectTransform::GetSize() const {
 }
 void RectTransform::SetSize(const glm::vec2& value) {
 	_halfSize = value * 2.0f;
+	_transformDirty = true;
 }
 
 void RectTransform::SetRotationDeg(float value) {
 	_rotation = glm::radians(value);
+	_transformDirty = true;
 }
 
 float RectTransform::GetRotationDeg() const {
@@ -3,6 +3,7 @@
 #include "Application/Timing.h"
 #include "Application/Application.h"
 #include "Utils/ImGuiHelper.h"
+#include "Utils/Profiler.h"
 
 ParticleSystem::ParticleSystem() :
 	IComponent(),
@@ -109,6 +110,7 @@ void ParticleSystem::Update()
 	else {
 		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
 	}
+	Profiler::CountDrawCalls();
 
 	// End of transform feedback
 	glEndTransformFeedback();
@@ -165,6 +167,7 @@ void ParticleSystem::Render()
 
 		// Draw our particles using whatever data we have in transform feedback buffer
 		glDrawTransformFeedback(GL_POINTS, _feedbackBuffers[_currentVertexBuffer]);
+		Profiler::CountDrawCalls();
 
 		// Clean up after ourselves
 		glDisableVertexAttribArray(1);
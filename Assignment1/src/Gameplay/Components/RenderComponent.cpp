@@ -1,4 +1,5 @@
 #include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/GameObject.h"
 
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/ImGuiHelper.h"
@@ -18,6 +19,10 @@ RenderComponent::RenderComponent() :
 
 void RenderComponent::SetMesh(const Gameplay::MeshResource::Sptr& mesh) {
 	_mesh = mesh;
+	// Our object's bounds come from the mesh, so the scene's spatial index needs to know
+	if (GetGameObject() != nullptr) {
+		GetGameObject()->MarkBoundsDirty();
+	}
 }
 
 const Gameplay::MeshResource::Sptr& RenderComponent::GetMeshResource() const {
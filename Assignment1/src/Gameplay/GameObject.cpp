@@ -29,8 +29,13 @@ namespace Gameplay {
 		_worldTransform(MAT4_IDENTITY),
 		_inverseWorldTransform(MAT4_IDENTITY),
 		_isWorldTransformDirty(true),
-		_parent(WeakRef()),
-		_children(std::vector<WeakRef>())
+		_parent(nullptr),
+		_firstChild(nullptr),
+		_lastChild(nullptr),
+		_prevSibling(nullptr),
+		_nextSibling(nullptr),
+		_handle(GameObjectHandle()),
+		_isSpatialDirty(false)
 	{ }
 
 	void GameObject::_RecalcLocalTransform() const
@@ -40,13 +45,12 @@ namespace Gameplay {
 			_inverseLocalTransform = glm::inverse(_localTransform);
 			_isLocalTransformDirty = false;
 			_isWorldTransformDirty = true;
+			// Catches edits that set the dirty flag directly instead of going through the setters
+			_MarkSpatialDirty();
 
 			// Dirty all the child objects world transforms
-			for (const auto& childPtr : _children) {
-				GameObject::Sptr childSptr = childPtr;
-				if (childSptr != nullptr) {
-					childSptr->_isWorldTransformDirty = true;
-				}
+			for (GameObject* child = _firstChild; child != nullptr; child = child->_nextSibling) {
+				child->_isWorldTransformDirty = true;
 			}
 		}
 	}
@@ -57,11 +61,9 @@ namespace Gameplay {
 
 		// If our world transform has been marked as dirty, we need to recalculate it!
 		if (_isWorldTransformDirty) {
-			GameObject::Sptr parent = _parent;
-
 			// If out parent exists, we apply our local transformation relative to the parent's world transformation
-			if (parent != nullptr) {
-				_worldTransform = parent->GetTransform() * _localTransform;
+			if (_parent != nullptr) {
+				_worldTransform = _parent->GetTransform() * _localTransform;
 				_inverseWorldTransform = glm::inverse(_worldTransform);
 			}
 
@@ -71,14 +73,54 @@ namespace Gameplay {
 				_inverseWorldTransform = _inverseLocalTransform;
 			}
 			_isWorldTransformDirty = false;
+
+			if (IsStatic && _scene != nullptr) {
+				_scene->MarkStaticGeometryDirty();
+			}
+		}
+	}
+
+	void GameObject::_UnlinkFromParent() {
+		if (_parent == nullptr) {
+			return;
+		}
+
+		if (_prevSibling != nullptr) {
+			_prevSibling->_nextSibling = _nextSibling;
+		} else {
+			_parent->_firstChild = _nextSibling;
+		}
+		if (_nextSibling != nullptr) {
+			_nextSibling->_prevSibling = _prevSibling;
+		} else {
+			_parent->_lastChild = _prevSibling;
+		}
+
+		_parent = nullptr;
+		_prevSibling = nullptr;
+		_nextSibling = nullptr;
+		// Our parent's transform no longer applies to us
+		_isWorldTransformDirty = true;
+		_MarkSpatialDirty();
+	}
+
+	void GameObject::_MarkSpatialDirty() const {
+		// Only the thread that sets the flag queues us, so we're in the queue at most once
+		if (_scene != nullptr && !_handle.IsNull() && !_isSpatialDirty.exchange(true, std::memory_order_acq_rel)) {
+			std::lock_guard<std::mutex> lock(_scene->_spatialDirtyMutex);
+			_scene->_spatialDirty.push_back(_handle);
 		}
 	}
 
-	void GameObject::_PurgeDeletedChildren() {
-		auto it = std::remove_if(_children.begin(), _children.end(), [](WeakRef child) { 
-			return child == nullptr; 
-		});
-		_children.erase(it, _children.end());
+	void GameObject::SetName(const std::string& name) {
+		if (name == Name) {
+			return;
+		}
+		std::string oldName = Name;
+		Name = name;
+		if (_scene != nullptr) {
+			_scene->_OnObjectRenamed(this, oldName);
+		}
 	}
 
 	void GameObject::LookAt(const glm::vec3& point) {
@@ -114,6 +156,7 @@ namespace Gameplay {
 	void GameObject::SetPostion(const glm::vec3& position) {
 		_position = position;
 		_isLocalTransformDirty = true;
+		_MarkSpatialDirty();
 	}
 
 	const glm::vec3& GameObject::GetPosition() const {
@@ -123,6 +166,7 @@ namespace Gameplay {
 	void GameObject::SetRotation(const glm::quat& value) {
 		_rotation = value;
 		_isLocalTransformDirty = true;
+		_MarkSpatialDirty();
 	}
 
 	const glm::quat& GameObject::GetRotation() const {
@@ -132,6 +176,7 @@ namespace Gameplay {
 	void GameObject::SetRotation(const glm::vec3& eulerAngles) {
 		_rotation = glm::quat(glm::radians(eulerAngles));
 		_isLocalTransformDirty = true;
+		_MarkSpatialDirty();
 	}
 
 	glm::vec3 GameObject::GetRotationEuler() const {
@@ -141,6 +186,7 @@ namespace Gameplay {
 	void GameObject::SetScale(const glm::vec3& value) {
 		_scale = value;
 		_isLocalTransformDirty = true;
+		_MarkSpatialDirty();
 	}
 
 	const glm::vec3& GameObject::GetScale() const {
@@ -169,12 +215,6 @@ namespace Gameplay {
 	}
 
 	void GameObject::RenderGUI() {
-		// Prune children
-		auto it = std::remove_if(_children.begin(), _children.end(), [](const WeakRef& child) { return !child.IsAlive(); });
-		if (it != _children.end()) {
-			_children.erase(it);
-		}
-
 		for (auto& component : _components) {
 			if (component->IsEnabled) {
 				component->StartGUI();
@@ -185,7 +225,7 @@ namespace Gameplay {
 				component->RenderGUI();
 			}
 		}
-		for (auto& child : _children) {
+		for (GameObject* child = _firstChild; child != nullptr; child = child->_nextSibling) {
 			child->RenderGUI();
 		}
 		for (auto& component : _components) {
@@ -214,7 +254,6 @@ namespace Gameplay {
 
 		_RecalcLocalTransform();
 		_RecalcWorldTransform();
-		_PurgeDeletedChildren();
 	}
 
 	bool GameObject::Has(const std::type_index& type) {
@@ -261,46 +300,51 @@ namespace Gameplay {
 	}
 
 	void GameObject::AddChild(const GameObject::Sptr& child) {
-		// If the object already has a parent, remove it from the other object
-		if (child->_parent != nullptr) {
-			child->_parent->RemoveChild(child);
+		if (child == nullptr || child.get() == this) {
+			return;
 		}
 
-		// Make sure the object isn't already a child of this object
-		auto it = std::find_if(_children.begin(), _children.end(), [child](GameObject::WeakRef wPtr) { return wPtr == child;});
-
 		// As long as the child is not already a child of this gameobject, add it
-		if (it == _children.end()) {
-			// Add child, set parent, and mark it's world transform as dirty, since the parent's transform now 
-			// applies to the child
-			_children.push_back(child);
-			child->_parent = _selfRef.lock();
-			child->_isWorldTransformDirty = true;
-		} else {
+		if (child->_parent == this) {
 			LOG_WARN("Attempting to add same child twice, ignoring: {}", child->Name);
+			return;
 		}
-	}
 
-	bool GameObject::RemoveChild(const GameObject::Sptr& child) {
-		// Find the child in our list of children if it exists
-		auto it = std::find_if(_children.begin(), _children.end(), [child](GameObject::WeakRef wPtr) { return wPtr == child; });
-		
-		if (it != _children.end()) { 
-			// Clear the object's parent and remove from our list of children
-			child->_parent.Reset();
-			_children.erase(it);
-			return true;
+		// Parenting one of our ancestors to us would make a loop
+		for (GameObject* ancestor = _parent; ancestor != nullptr; ancestor = ancestor->_parent) {
+			if (ancestor == child.get()) {
+				LOG_WARN("Cannot make {} a child of it's descendant {}, ignoring", child->Name, Name);
+				return;
+			}
+		}
+
+		// If the object already has a parent, remove it from the other object
+		child->_UnlinkFromParent();
+
+		// Append to the end of our children, and mark it's world transform as dirty, since the parent's
+		// transform now applies to the child
+		child->_parent = this;
+		child->_prevSibling = _lastChild;
+		if (_lastChild != nullptr) {
+			_lastChild->_nextSibling = child.get();
 		} else {
-			return false;
+			_firstChild = child.get();
 		}
+		_lastChild = child.get();
+		child->_isWorldTransformDirty = true;
+		child->_MarkSpatialDirty();
 	}
 
-	const std::vector<GameObject::WeakRef>& GameObject::GetChildren() const {
-		return _children;
+	bool GameObject::RemoveChild(const GameObject::Sptr& child) {
+		if (child == nullptr || child->_parent != this) {
+			return false;
+		}
+		child->_UnlinkFromParent();
+		return true;
 	}
 
 	GameObject::Sptr GameObject::GetParent() const {
-		return _parent;
+		return _parent != nullptr ? _parent->SelfRef() : nullptr;
 	}
 
 	void GameObject::DrawImGui(bool invokedFromScene) {
@@ -320,7 +364,7 @@ namespace Gameplay {
 			memcpy(nameBuff, Name.c_str(), Name.size());
 			nameBuff[Name.size()] = '\0';
 			if (ImGui::InputText("", nameBuff, 256)) {
-				Name = nameBuff;
+				SetName(nameBuff);
 			}
 			ImGui::SameLine();
 			if (ImGuiHelper::WarningButton("Delete")) {
@@ -378,6 +422,10 @@ namespace Gameplay {
 			// Draw the scale
 			_isLocalTransformDirty |= LABEL_LEFT(ImGui::DragFloat3, "Scale   ", &_scale.x, 0.01f, 0.0f);
 
+			if (ImGui::Checkbox("Static", &IsStatic)) {
+				_scene->MarkStaticGeometryDirty();
+			}
+
 			ImGui::Separator();
 			ImGui::TextUnformatted("Components");
 			ImGui::Separator();
@@ -426,8 +474,7 @@ namespace Gameplay {
 			ImGui::TextUnformatted("Children");
 			ImGui::Separator();
 
-			_PurgeDeletedChildren();
-			for (auto& child : _children) {
+			for (GameObject* child = _firstChild; child != nullptr; child = child->_nextSibling) {
 				child->DrawImGui(false);
 			}
 
@@ -454,11 +501,11 @@ namespace Gameplay {
 		// Load in basic info
 		result->Name = data["name"];
 		result->_guid = Guid(data["guid"]);
-		result->_parent = WeakRef(Guid(data.contains("parent") ? data["parent"] : "null"), nullptr);
 		result->_position = (data["position"]);
 		result->_rotation = (data["rotation"]);
 		result->_scale    = (data["scale"]);
 		result->HideInHierarchy = JsonGet(data, "hide_in_inspector", false);
+		result->IsStatic = JsonGet(data, "is_static", false);
 		result->_isLocalTransformDirty = true;
 		result->_isWorldTransformDirty = true;
 
@@ -481,15 +528,15 @@ namespace Gameplay {
 	}
 
 	nlohmann::json GameObject::ToJson() const {
-		GameObject::Sptr parent = _parent;
 		nlohmann::json result = {
 			{ "name", Name },
 			{ "guid", _guid.str() },
 			{ "position", _position },
 			{ "rotation", _rotation },
 			{ "scale",    _scale },
-			{ "parent",   parent == nullptr ? "null" : parent->_guid.str() },
-			{ "hide_in_inspector", HideInHierarchy }
+			{ "parent",   _parent == nullptr ? "null" : _parent->_guid.str() },
+			{ "hide_in_inspector", HideInHierarchy },
+			{ "is_static", IsStatic }
 		};
 		result["components"] = nlohmann::json();
 		for (auto& component : _components) {
@@ -497,11 +544,8 @@ namespace Gameplay {
 			IComponent::SaveBaseJson(component, result["components"][component->ComponentTypeName()]);
 		}
 		result["children"] = std::vector<nlohmann::json>();
-		for (auto& child : _children) {
-			GameObject::Sptr childPtr = child;
-			if (childPtr != nullptr) {
-				result["children"].push_back(childPtr->ToJson());
-			}
+		for (GameObject* child = _firstChild; child != nullptr; child = child->_nextSibling) {
+			result["children"].push_back(child->ToJson());
 		}
 		return result;
 	}
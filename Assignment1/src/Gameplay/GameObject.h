@@ -1,5 +1,8 @@
 #pragma once
 #include <string>
+#include <cstdint>
+#include <functional>
+#include <atomic>
 
 // Utils
 #include "Utils/GUID.hpp"
@@ -25,6 +28,23 @@ namespace Gameplay {
 		class RigidBody;
 	}
 
+	/// <summary>
+	/// A generational handle to a GameObject in a scene's object pool. Once the object is deleted the
+	/// slot's generation is bumped, so old handles go stale instead of pointing at whatever re-uses the slot
+	/// </summary>
+	struct GameObjectHandle {
+		uint32_t Index      = UINT32_MAX;
+		uint32_t Generation = 0;
+
+		/// <summary>
+		/// Returns true if this handle was never assigned to an object
+		/// </summary>
+		bool IsNull() const { return Index == UINT32_MAX; }
+
+		bool operator ==(const GameObjectHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+		bool operator !=(const GameObjectHandle& other) const { return !(*this == other); }
+	};
+
 	/// <summary>
 	/// Represents an object in our scene with a transformation and a collection
 	/// of components. Components provide gameobject's with behaviours
@@ -133,12 +153,34 @@ namespace Gameplay {
 			void Reset();
 		};
 
-		// Human readable name for the object
+		// Human readable name for the object, use SetName to rename an object that is already in a scene. Writing
+		// to this directly still works, but the next Scene::FindObjectByName for the new name has to search every object
 		std::string             Name;
 
 		// Hack to hide instances from the hierarchy (like when adding lots of instances)
 		bool HideInHierarchy = false;
 
+		// Static objects are expected to never move, which lets systems like shadows cache work done for them.
+		// If a static object does move, the scene is notified so the caches can be rebuilt
+		bool IsStatic = false;
+
+		/// <summary>
+		/// Renames this object, keeping the scene's name lookup up to date
+		/// </summary>
+		/// <param name="name">The new name for the object</param>
+		void SetName(const std::string& name);
+
+		/// <summary>
+		/// Lets the scene know this object's bounds have changed, ex when it's mesh is swapped. Changes to
+		/// the transform are picked up on their own
+		/// </summary>
+		void MarkBoundsDirty() { _MarkSpatialDirty(); }
+
+		/// <summary>
+		/// Gets this object's handle in it's scene's object pool, or a null handle if it is not in a scene
+		/// </summary>
+		GameObjectHandle GetHandle() const { return _handle; }
+
 		/// <summary>
 		/// Rotates this object to look at the given point in world coordinates
 		/// </summary>
@@ -310,11 +352,39 @@ namespace Gameplay {
 
 		std::shared_ptr<IComponent> Add(const std::type_index& type);
 
+		/// <summary>
+		/// Makes the given object a child of this one, removing it from it's old parent. Children are
+		/// kept in the order they were added
+		/// </summary>
+		/// <param name="child">The object to add as a child</param>
 		void AddChild(const GameObject::Sptr& child);
+		/// <summary>
+		/// Removes the given object from this object's children, making it a root object
+		/// </summary>
+		/// <param name="child">The child to remove</param>
+		/// <returns>True if the object was a child of this object</returns>
 		bool RemoveChild(const GameObject::Sptr& child);
-		const std::vector<WeakRef>& GetChildren() const;
 
+		/// <summary>
+		/// Gets this object's parent, or nullptr if it is a root object
+		/// </summary>
 		GameObject::Sptr GetParent() const;
+		/// <summary>
+		/// Returns true if this object has a parent, without having to take a reference to it
+		/// </summary>
+		bool HasParent() const { return _parent != nullptr; }
+		/// <summary>
+		/// Returns true if this object has at least one child
+		/// </summary>
+		bool HasChildren() const { return _firstChild != nullptr; }
+		/// <summary>
+		/// Gets the first child of this object, use GetNextSibling to walk the rest of them
+		/// </summary>
+		GameObject* GetFirstChild() const { return _firstChild; }
+		/// <summary>
+		/// Gets the next child of this object's parent, or nullptr if this is the last one
+		/// </summary>
+		GameObject* GetNextSibling() const { return _nextSibling; }
 
 		/// <summary>
 		/// Draws the ImGui window for this game object and all nested components
@@ -353,9 +423,19 @@ namespace Gameplay {
 		mutable glm::mat4 _inverseWorldTransform;
 		mutable bool _isWorldTransformDirty;
 
-		// For the hierarchy
-		WeakRef _parent;
-		std::vector<WeakRef> _children;
+		// For the hierarchy, an intrusive list of children that the scene keeps valid. Objects are unlinked
+		// from their parent and children when they are removed from the scene
+		GameObject* _parent;
+		GameObject* _firstChild;
+		GameObject* _lastChild;
+		GameObject* _prevSibling;
+		GameObject* _nextSibling;
+
+		// Our slot in the scene's object pool
+		GameObjectHandle _handle;
+		// True while we are queued for an update in the scene's spatial index. Transforms are recalculated in
+		// const getters that can run on worker threads, so this is set atomically
+		mutable std::atomic<bool> _isSpatialDirty;
 
 		// The components that this game object has attached to it
 		std::vector<IComponent::Sptr> _components;
@@ -375,7 +455,24 @@ namespace Gameplay {
 		void _RecalcLocalTransform() const;
 		void _RecalcWorldTransform() const;
 
-		void _PurgeDeletedChildren();
+		/// <summary>
+		/// Removes this object from it's parent's list of children, if it has a parent
+		/// </summary>
+		void _UnlinkFromParent();
+		/// <summary>
+		/// Queues this object to have it's bounds updated in the scene's spatial index, our children
+		/// are updated along with us. Safe to call from any thread
+		/// </summary>
+		void _MarkSpatialDirty() const;
 	};
 
+}
+
+namespace std {
+	template <>
+	struct hash<Gameplay::GameObjectHandle> {
+		std::size_t operator()(const Gameplay::GameObjectHandle& handle) const {
+			return std::hash<uint64_t>{}((static_cast<uint64_t>(handle.Generation) << 32) | handle.Index);
+		}
+	};
 }
\ No newline at end of file
@@ -19,6 +19,16 @@ namespace Gameplay {
 		/// The approximate range of our light in world units (meters)
 		/// </summary>
 		float Range = 4.0f;
+		/// <summary>
+		/// Static lights are only uploaded to the GPU when the scene is set up, or when
+		/// explicitly re-sent with Scene::SetShaderLight. Changes to dynamic lights are
+		/// picked up automatically each frame
+		/// </summary>
+		bool IsStatic = false;
+		/// <summary>
+		/// True if this light should render shadow maps, see ShadowRenderer
+		/// </summary>
+		bool CastShadows = false;
 
 		/// <summary>
 		/// Loads a light from a JSON blob
@@ -28,6 +38,8 @@ namespace Gameplay {
 			result.Position = data["position"];
 			result.Color = data["color"];
 			result.Range = data["range"].get<float>();
+			result.IsStatic = JsonGet(data, "static", false);
+			result.CastShadows = JsonGet(data, "cast_shadows", false);
 			return result;
 		}
 
@@ -39,6 +51,8 @@ namespace Gameplay {
 				{ "position", Position },
 				{ "color", Color },
 				{ "range", Range },
+				{ "static", IsStatic },
+				{ "cast_shadows", CastShadows },
 			};
 		}
 
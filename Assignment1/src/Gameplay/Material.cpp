@@ -1,4 +1,5 @@
 #include "Gameplay/Material.h"
+#include <algorithm>
 #include "Utils/ResourceManager/ResourceManager.h"
 #include "Utils/JsonGlmHelpers.h"
 #include "Graphics/Textures/TextureCube.h"
@@ -8,31 +9,126 @@
 #include "Graphics/Textures/Texture1D.h"
 #include "Graphics/Textures/Texture3D.h"
 
+// The initial size of the material arena in bytes, it will double as needed
+#define MATERIAL_ARENA_INITIAL_SIZE (16 * 1024)
+
+// Copies a single element into a std140 block, matrix columns and bools need to be re-strided
+static void PackStd140(uint8_t* dest, const uint8_t* source, ShaderDataType type, int matrixStride) {
+	ShaderDataTypecode typeCode = GetShaderDataTypeCode(type);
+	uint32_t rows = (uint32_t)type & ShaderDataType_Size1Mask;
+	switch (typeCode) {
+		case ShaderDataTypecode::Matrix:
+		case ShaderDataTypecode::MatrixD:
+		{
+			uint32_t columns = ((uint32_t)type & ShaderDataType_Size2Mask) >> 3;
+			uint32_t columnSize = rows * (typeCode == ShaderDataTypecode::Matrix ? sizeof(float) : sizeof(double));
+			for (uint32_t col = 0; col < columns; col++) {
+				memcpy(dest + col * matrixStride, source + col * columnSize, columnSize);
+			}
+		}
+			break;
+		case ShaderDataTypecode::Bool:
+			// GLSL bools are 4 bytes wide
+			for (uint32_t ix = 0; ix < rows; ix++) {
+				reinterpret_cast<uint32_t*>(dest)[ix] = source[ix] ? 1 : 0;
+			}
+			break;
+		default:
+			memcpy(dest, source, ShaderDataTypeSize(type));
+			break;
+	}
+}
+
+// Gets the sampler type to save a texture parameter as, so that loading it looks up the right kind of texture
+static ShaderDataType GetSamplerType(const ITexture::Sptr& texture) {
+	if (std::dynamic_pointer_cast<Texture2D>(texture) != nullptr) {
+		return ShaderDataType::Tex2D;
+	} else if (std::dynamic_pointer_cast<TextureCube>(texture) != nullptr) {
+		return ShaderDataType::TexCube;
+	} else if (std::dynamic_pointer_cast<Texture1D>(texture) != nullptr) {
+		return ShaderDataType::Tex1D;
+	} else if (std::dynamic_pointer_cast<Texture3D>(texture) != nullptr) {
+		return ShaderDataType::Tex3D;
+	}
+	return ShaderDataType::None;
+}
+
 namespace Gameplay {
 	Material::Material(const ShaderProgram::Sptr& shader) :
 		IResource(),
 		_shader(shader),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		_uniforms(std::unordered_map<std::string, UniformData>()),
+		_blockOffset(0),
+		_blockSize(0),
+		_isBlockDirty(true),
+		_isLayoutDirty(true),
+		_isShaderPending(false),
+		_hasShaderFailed(false),
+		_variant(nullptr),
+		_variantVersion(0),
+		_prepassMode(DepthPrepassMode::Auto),
+		_autoPrepassMode(DepthPrepassMode::Disabled),
+		_prepassVariant("DEPTH_PREPASS"),
+		_multiDrawVariant("MULTI_DRAW")
 	{
-		_PopulateUniforms();
+		_ResolveAutoPrepassMode();
+		// If the variant is still compiling we can't introspect it yet, parameters get deferred until it's ready
+		_SelectVariant();
 	}
 
 	Material::Material() :
 		IResource(),
 		_shader(nullptr),
-		_uniforms(std::unordered_map<std::string, UniformData>())
+		_uniforms(std::unordered_map<std::string, UniformData>()),
+		_blockOffset(0),
+		_blockSize(0),
+		_isBlockDirty(true),
+		_isLayoutDirty(true),
+		_isShaderPending(false),
+		_hasShaderFailed(false),
+		_variant(nullptr),
+		_variantVersion(0),
+		_prepassMode(DepthPrepassMode::Auto),
+		_autoPrepassMode(DepthPrepassMode::Disabled),
+		_prepassVariant("DEPTH_PREPASS"),
+		_multiDrawVariant("MULTI_DRAW")
 	{ }
 
+	Material::~Material() {
+		if (_blockSize > 0) {
+			__FreeArena(_blockOffset, _blockSize);
+		}
+	}
+
 	void Material::Set(const std::string& name, ShaderDataType type, const void* value, size_t arraySize)
 	{
-		// Try and find the matching uniform
+		// We don't know the uniform layout until the shader is linked, so hold on to a copy of the value
+		if (_isShaderPending) {
+			DeferredParameter param;
+			param.Name = name;
+			param.Type = type;
+			param.ArraySize = arraySize;
+			if (type == ShaderDataType::None) {
+				param.Texture = *reinterpret_cast<const ITexture::Sptr*>(value);
+			} else {
+				const uint8_t* bytes = static_cast<const uint8_t*>(value);
+				param.Data.assign(bytes, bytes + ShaderDataTypeSize(type) * arraySize);
+			}
+			_deferredParameters.push_back(std::move(param));
+			return;
+		}
+
+		// Try and find the matching uniform, a new one may need a texture slot or be a loose uniform, so the layout gets rebuilt
+		size_t uniformCount = _uniforms.size();
 		UniformData& uniform = _GetUniform(name);
+		_isLayoutDirty |= _uniforms.size() != uniformCount;
 
 		// We have a uniform, let's see if we can update it
 		if (uniform.Location != -2) {
 			// If it's a texture, we update TextureAsset so it adds to the ref count
 			if (GetShaderDataTypeCode(uniform.Type) == ShaderDataTypecode::Texture && type == ShaderDataType::None) {
 				uniform.TextureAsset = *reinterpret_cast<const ITexture::Sptr*>(value);
+				_isLayoutDirty = true;
 			}
 			// Check for type mismatch
 			else if (uniform.Type != type && uniform.Type != ShaderDataType::None) {
@@ -48,6 +144,7 @@ namespace Gameplay {
 				else {
 					memcpy(uniform.Value, value, ShaderDataTypeSize(type));
 				}
+				_isBlockDirty |= uniform.BlockOffset >= 0;
 			}
 		}
 		// We couldn't find that uniform, log a warning
@@ -60,41 +157,367 @@ namespace Gameplay {
 		return _shader;
 	}
 
-	void Material::Apply() {
-		if (_shader != nullptr) {
-			// Skip the reserved # of texture slots
-			int textureSlot = 0;
-			
-			// Iterate over the uniforms map
-			for (auto&[name, data] : _uniforms) {
-				// The typecode is basically the underlying type of the uniform
-				// ex: float, matrix, texture, etc...
-				ShaderDataTypecode typeCode = GetShaderDataTypeCode(data.Type);
-
-				// If the uniform is a texture, we try and bind it, then move to the next slot
-				if (typeCode == ShaderDataTypecode::Texture) {
-					if (textureSlot >= MAX_TEXTURE_SLOTS) {
-						LOG_WARN("Ignoring material binding, exceeds allowed number of textures");
-					}
-					else {
-						ITexture::Sptr texture = data.TextureAsset;
-						if (texture != nullptr) {
-							texture->Bind(textureSlot);
-						}
-						else {
-							ITexture::Unbind(textureSlot);
-						}
-						// Send the slot to the shader
-						_shader->SetUniform(data.Location, data.Type, &textureSlot);
-						textureSlot++;
-					}
+	const ShaderProgram::Sptr& Material::GetActiveShader() const {
+		return _variant;
+	}
+
+	void Material::SetDefine(const std::string& name, const std::string& value) {
+		_defines[name] = value;
+		_SelectVariant();
+	}
+
+	void Material::RemoveDefine(const std::string& name) {
+		if (_defines.erase(name) > 0) {
+			_SelectVariant();
+		}
+	}
+
+	const ShaderDefines& Material::GetDefines() const {
+		return _defines;
+	}
+
+	void Material::SetPrepassMode(DepthPrepassMode mode) {
+		_prepassMode = mode;
+	}
+
+	DepthPrepassMode Material::GetPrepassMode() const {
+		return _prepassMode == DepthPrepassMode::Auto ? _autoPrepassMode : _prepassMode;
+	}
+
+	void Material::_ResolveAutoPrepassMode() {
+		if (_shader == nullptr) {
+			_autoPrepassMode = DepthPrepassMode::Disabled;
+			return;
+		}
+
+		// Shaders that know about the pre-pass can strip themselves down for it
+		std::string vertex = _shader->GetStageSource(ShaderPartType::Vertex);
+		std::string fragment = _shader->GetStageSource(ShaderPartType::Fragment);
+		auto checksPrepass = [](const std::string& source) {
+			return
+				source.find("#ifdef DEPTH_PREPASS") != std::string::npos ||
+				source.find("#ifndef DEPTH_PREPASS") != std::string::npos ||
+				source.find("defined(DEPTH_PREPASS)") != std::string::npos;
+		};
+		if (checksPrepass(vertex) || checksPrepass(fragment)) {
+			_autoPrepassMode = DepthPrepassMode::Variant;
+			return;
+		}
+
+		// The shared shader only gives the same depth if vertices aren't moved around and no fragments are cut out.
+		// Anything else would cost a full shading pass to pre-pass, so it's left to the main pass
+		std::string vertexPath = _shader->GetStagePath(ShaderPartType::Vertex);
+		static const std::string basicVertex = "vertex_shaders/basic.glsl";
+		bool isBasicVertex = vertexPath.size() >= basicVertex.size() &&
+			vertexPath.compare(vertexPath.size() - basicVertex.size(), basicVertex.size(), basicVertex) == 0;
+		bool discards = fragment.find("discard") != std::string::npos;
+		_autoPrepassMode = isBasicVertex && !discards ? DepthPrepassMode::Shared : DepthPrepassMode::Disabled;
+	}
+
+	const ShaderProgram::Sptr& Material::GetPrepassShader() {
+		return _GetPassShader(_prepassVariant);
+	}
+
+	const ShaderProgram::Sptr& Material::GetMultiDrawShader() {
+		return _GetPassShader(_multiDrawVariant);
+	}
+
+	const ShaderProgram::Sptr& Material::_GetPassShader(PassVariant& pass) {
+		if (pass.Program == nullptr && _shader != nullptr) {
+			ShaderDefines defines = _defines;
+			defines[pass.Define] = "";
+			pass.Program = _shader->GetVariant(defines);
+			pass.IsLayoutDirty = true;
+		}
+		return pass.Program;
+	}
+
+	bool Material::IsReady() {
+		// The global defines changed (ex: a render flag was toggled), so we may need a different variant
+		if (_shader != nullptr && _variantVersion != ShaderProgram::GetGlobalDefinesVersion()) {
+			_SelectVariant();
+		}
+		if (_isShaderPending && _variant->IsReady()) {
+			// A shader that failed to link keeps us on the fallback, and our parameters stay deferred in case it's
+			// linked again later
+			if (_variant->IsLinked()) {
+				_OnShaderReady();
+			} else if (!_hasShaderFailed) {
+				LOG_ERROR("Shader \"{}\" failed to link, material \"{}\" will be drawn with the fallback shader", _variant->GetDebugName(), Name);
+				_hasShaderFailed = true;
+			}
+		}
+		return !_isShaderPending;
+	}
+
+	void Material::_SelectVariant() {
+		_variantVersion = ShaderProgram::GetGlobalDefinesVersion();
+		ShaderProgram::Sptr variant = _shader != nullptr ? _shader->GetVariant(_defines) : nullptr;
+		if (variant == _variant) {
+			return;
+		}
+
+		// Our values are carried over the same way as parameters set before the shader was ready,
+		// if we're still waiting on the old variant they're already stored that way
+		if (_variant != nullptr && !_isShaderPending) {
+			for (auto& [name, data] : _uniforms) {
+				if (data.Location < 0) {
+					continue;
 				}
-				// The uniform is a plain ol' value type, send it in
-				else {
-					_shader->SetUniform(data.Location, data.Type, data.ArraySize > 1 ? data.ArrayBlock : data.Value, data.ArraySize);
+				DeferredParameter param;
+				param.Name = name;
+				param.ArraySize = data.ArraySize;
+				if (data.IsTextureResource()) {
+					param.Type = ShaderDataType::None;
+					param.Texture = data.TextureAsset;
+				} else {
+					param.Type = data.Type;
+					const uint8_t* bytes = data.ArraySize > 1 ? static_cast<const uint8_t*>(data.ArrayBlock) : data.Value;
+					param.Data.assign(bytes, bytes + ShaderDataTypeSize(data.Type) * data.ArraySize);
 				}
+				_deferredParameters.push_back(std::move(param));
 			}
 		}
+
+		_variant = variant;
+		_prepassVariant.Program = nullptr;
+		_multiDrawVariant.Program = nullptr;
+		_uniforms.clear();
+		_looseUniforms.clear();
+		_textureHandles.clear();
+		_isLayoutDirty = true;
+		_hasShaderFailed = false;
+
+		if (_variant == nullptr) {
+			_isShaderPending = false;
+		} else if (_variant->IsLinked()) {
+			_OnShaderReady();
+		} else {
+			// Still compiling, or failed to link, either way IsReady will sort it out
+			_isShaderPending = true;
+		}
+	}
+
+	const ShaderProgram::Sptr& Material::GetFallbackShader() {
+		if (__fallbackShader == nullptr) {
+			// Flat grey with a fixed light, just enough to see the shape of the object
+			__fallbackShader = ShaderProgram::Create();
+			__fallbackShader->SetDebugName("Material Fallback");
+			__fallbackShader->LoadShaderPartFromFile("shaders/vertex_shaders/basic.glsl", ShaderPartType::Vertex);
+			__fallbackShader->LoadShaderPart(R"LIT(#version 440
+					layout(location = 2) in vec3 inNormal;
+
+					layout(location = 0) out vec4 frag_color;
+
+					void main() {
+						float light = max(dot(normalize(inNormal), normalize(vec3(0.3, 0.5, 1.0))), 0.0);
+						frag_color = vec4(vec3(0.6) * (0.3 + 0.7 * light), 1.0);
+					}
+				)LIT", ShaderPartType::Fragment);
+			__fallbackShader->Link();
+		}
+		return __fallbackShader;
+	}
+
+	void Material::_OnShaderReady() {
+		_isShaderPending = false;
+		_hasShaderFailed = false;
+		_PopulateUniforms();
+		_AllocateBlock();
+
+		// Parameters from JSON come first, since anything set in code happened after loading
+		if (!_deferredJson.is_null()) {
+			_LoadParameters(_deferredJson);
+			_deferredJson = nullptr;
+		}
+		for (DeferredParameter& param : _deferredParameters) {
+			if (param.Type == ShaderDataType::None) {
+				Set(param.Name, param.Type, &param.Texture, param.ArraySize);
+			} else {
+				Set(param.Name, param.Type, param.Data.data(), param.ArraySize);
+			}
+		}
+		_deferredParameters.clear();
+	}
+
+	void Material::Apply() {
+		if (_ApplyShared()) {
+			// Shaders that do not declare the material block still get their values one at a time
+			for (UniformData* data : _looseUniforms) {
+				_variant->SetUniform(data->Location, data->Type, data->ArraySize > 1 ? data->ArrayBlock : data->Value, data->ArraySize);
+			}
+		}
+	}
+
+	bool Material::_ApplyShared() {
+		if (_variant == nullptr || !IsReady()) {
+			return false;
+		}
+
+		if (_isLayoutDirty) {
+			_RebuildLayout();
+		}
+
+		// Our parameters only get uploaded when they change, after that it's just a range bind
+		if (_blockSize > 0) {
+			if (_isBlockDirty) {
+				_PackBlock();
+				__arenaBuffer->UpdateSubData(_blockData.data(), _blockOffset, _blockSize);
+				_isBlockDirty = false;
+			}
+			__arenaBuffer->BindRange(MATERIAL_UBO_BINDING, _blockOffset, _blockSize);
+		}
+
+		// Slots were assigned up front, so all textures go in one call (0 handles unbind)
+		if (!_textureHandles.empty()) {
+			glBindTextures(0, (GLsizei)_textureHandles.size(), _textureHandles.data());
+		}
+		return true;
+	}
+
+	void Material::ApplyPrepass() {
+		_ApplyPass(_prepassVariant);
+	}
+
+	void Material::ApplyMultiDraw() {
+		_ApplyPass(_multiDrawVariant);
+	}
+
+	void Material::_ApplyPass(PassVariant& pass) {
+		// The block and textures are shared with the main pass, but our loose uniforms only go to the pass program
+		if (!_ApplyShared()) {
+			return;
+		}
+
+		if (pass.IsLayoutDirty) {
+			// Uniforms the variant doesn't use will have been compiled out, those get a location of -1
+			ShaderProgram::UniformInfo info;
+			pass.LooseLocations.clear();
+			for (UniformData* data : _looseUniforms) {
+				pass.LooseLocations.push_back(pass.Program->FindUniform(data->Name, &info) ? info.Location : -1);
+			}
+			for (auto& [name, data] : _uniforms) {
+				if (data.IsTextureResource() && data.BindingSlot >= 0 && pass.Program->FindUniform(name, &info)) {
+					pass.Program->SetUniform(info.Location, data.Type, &data.BindingSlot);
+				}
+			}
+			pass.IsLayoutDirty = false;
+		}
+
+		for (size_t ix = 0; ix < _looseUniforms.size(); ix++) {
+			UniformData* data = _looseUniforms[ix];
+			if (pass.LooseLocations[ix] >= 0) {
+				pass.Program->SetUniform(pass.LooseLocations[ix], data->Type, data->ArraySize > 1 ? data->ArrayBlock : data->Value, data->ArraySize);
+			}
+		}
+	}
+
+	void Material::_RebuildLayout() {
+		std::vector<UniformData*> textures;
+		_looseUniforms.clear();
+		for (auto& [name, data] : _uniforms) {
+			if (data.Location < 0) {
+				continue;
+			}
+			if (data.IsTextureResource()) {
+				textures.push_back(&data);
+			} else if (data.BlockOffset < 0) {
+				_looseUniforms.push_back(&data);
+			}
+		}
+
+		// Slots are assigned in location order, so every material using the shader agrees on them
+		std::sort(textures.begin(), textures.end(), [](const UniformData* a, const UniformData* b) {
+			return a->Location < b->Location;
+		});
+		if (textures.size() > MAX_TEXTURE_SLOTS) {
+			LOG_WARN("Ignoring material bindings in \"{}\", exceeds allowed number of textures", Name);
+			textures.resize(MAX_TEXTURE_SLOTS);
+		}
+
+		_textureHandles.resize(textures.size());
+		for (int slot = 0; slot < (int)textures.size(); slot++) {
+			UniformData* data = textures[slot];
+			data->BindingSlot = slot;
+			_variant->SetUniform(data->Location, data->Type, &slot);
+			_textureHandles[slot] = data->TextureAsset != nullptr ? data->TextureAsset->GetHandle() : 0;
+		}
+
+		_isLayoutDirty = false;
+		_prepassVariant.IsLayoutDirty = true;
+		_multiDrawVariant.IsLayoutDirty = true;
+	}
+
+	void Material::_PackBlock() {
+		for (auto& [name, data] : _uniforms) {
+			if (data.BlockOffset < 0) {
+				continue;
+			}
+			const uint8_t* source = data.ArraySize > 1 ? (const uint8_t*)data.ArrayBlock : data.Value;
+			uint32_t elementSize = ShaderDataTypeSize(data.Type);
+			for (size_t ix = 0; ix < data.ArraySize; ix++) {
+				PackStd140(_blockData.data() + data.BlockOffset + ix * data.ArrayStride, source + ix * elementSize, data.Type, data.MatrixStride);
+			}
+		}
+	}
+
+	void Material::_AllocateBlock() {
+		if (_blockSize > 0) {
+			__FreeArena(_blockOffset, _blockSize);
+			_blockSize = 0;
+		}
+
+		const ShaderProgram::UniformBlockInfo* block = _variant != nullptr ? _variant->FindUniformBlock(MATERIAL_BLOCK_NAME) : nullptr;
+		if (block != nullptr && block->SizeInBytes > 0) {
+			_blockSize = block->SizeInBytes;
+			_blockOffset = __AllocateArena(_blockSize);
+			_blockData.assign(_blockSize, 0);
+			_isBlockDirty = true;
+		}
+	}
+
+	uint32_t Material::__GetArenaSize(uint32_t size) {
+		if (__arenaAlignment == 0) {
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &__arenaAlignment);
+		}
+		// Round up so every block starts on a valid offset for glBindBufferRange
+		return (size + __arenaAlignment - 1) / __arenaAlignment * __arenaAlignment;
+	}
+
+	uint32_t Material::__AllocateArena(uint32_t size) {
+		size = __GetArenaSize(size);
+
+		// Materials sharing a shader have the same block size, so we can recycle by size
+		std::vector<uint32_t>& freeList = __arenaFreeList[size];
+		if (!freeList.empty()) {
+			uint32_t offset = freeList.back();
+			freeList.pop_back();
+			return offset;
+		}
+
+		uint32_t offset = __arenaCursor;
+		__arenaCursor += size;
+
+		// Grow the arena, copying the existing blocks over on the GPU
+		uint32_t capacity = __arenaBuffer != nullptr ? __arenaBuffer->GetTotalSize() : 0;
+		if (__arenaCursor > capacity) {
+			uint32_t newCapacity = capacity > 0 ? capacity : MATERIAL_ARENA_INITIAL_SIZE;
+			while (newCapacity < __arenaCursor) {
+				newCapacity *= 2;
+			}
+			AbstractUniformBuffer::Sptr arena = std::make_shared<AbstractUniformBuffer>(newCapacity);
+			arena->SetDebugName("Material Arena");
+			if (__arenaBuffer != nullptr) {
+				glCopyNamedBufferSubData(__arenaBuffer->GetHandle(), arena->GetHandle(), 0, 0, offset);
+			}
+			__arenaBuffer = arena;
+		}
+
+		return offset;
+	}
+
+	void Material::__FreeArena(uint32_t offset, uint32_t size) {
+		__arenaFreeList[__GetArenaSize(size)].push_back(offset);
 	}
 
 	void Material::RenderImGui() {
@@ -105,11 +528,27 @@ namespace Gameplay {
 		ImGuiHelper::ResourceDragSource(this, Name);
 
 		if (open) {
-			ImGui::Text("Shader: %s", _shader != nullptr ? _shader->GetDebugName().c_str() : "null");
+			ImGui::Text("Shader: %s", _variant != nullptr ? _variant->GetDebugName().c_str() : "null");
+			if (_hasShaderFailed) {
+				ImGui::TextDisabled("Shader failed to link, using the fallback");
+			} else if (_isShaderPending) {
+				ImGui::TextDisabled("Waiting on shader to compile...");
+			}
+			if (ImGui::BeginCombo("Depth Pre-pass", (~_prepassMode).c_str())) {
+				for (DepthPrepassMode mode : { DepthPrepassMode::Auto, DepthPrepassMode::Shared, DepthPrepassMode::Variant, DepthPrepassMode::Disabled }) {
+					if (ImGui::Selectable((~mode).c_str(), mode == _prepassMode)) {
+						_prepassMode = mode;
+					}
+				}
+				ImGui::EndCombo();
+			}
 			// Draw all of our valid uniforms
 			for (auto&[key, value] : _uniforms) {
 				if (value.Location != -2 && value.Location != -1) {
-					value.RenderImGui();
+					if (value.RenderImGui()) {
+						_isBlockDirty = true;
+						_isLayoutDirty = true;
+					}
 				}
 			}
 
@@ -132,20 +571,33 @@ namespace Gameplay {
 		result->OverrideGUID(Guid(data["guid"]));
 		result->Name = data["name"].get<std::string>();
 		result->_shader = ResourceManager::Get<ShaderProgram>(Guid(data["shader"]));
-		result->_PopulateUniforms();
+		if (data.contains("defines") && data["defines"].is_object()) {
+			for (auto& [key, value] : data["defines"].items()) {
+				result->_defines[key] = value.get<std::string>();
+			}
+		}
+
+		result->_prepassMode = JsonParseEnum(DepthPrepassMode, data, "prepass", DepthPrepassMode::Auto);
+		result->_ResolveAutoPrepassMode();
 
 		// material specific parameters'
-		if (data.contains("parameters") && data["parameters"].is_object()) {
+		// These can't be parsed until the variant is introspected, so they get applied once it's ready
+		result->_deferredJson = data.contains("parameters") ? data["parameters"] : nlohmann::json();
+		result->_SelectVariant();
+		return result;
+	}
+
+	void Material::_LoadParameters(const nlohmann::json& parameters) {
+		if (parameters.is_object()) {
 			// Iterate over all objects
-			for (auto& [key, value] : data["parameters"].items()) {
+			for (auto& [key, value] : parameters.items()) {
 				// Try loading a uniform from the blob, if successful, store it
-				Material::UniformData uniform = Material::UniformData::FromJson(value, key, result->_shader);
+				Material::UniformData uniform = Material::UniformData::FromJson(value, key, _variant);
 				if (uniform.Location != -2) {
-					result->_uniforms[key] = uniform;
+					_uniforms[key] = uniform;
 				}
 			}
 		}
-		return result;
 	}
 
 	nlohmann::json Material::ToJson() const { 
@@ -153,14 +605,57 @@ namespace Gameplay {
 			{ "guid", GetGUID().str() },
 			{ "name", Name },
 			{ "shader", _shader ? _shader->GetGUID().str() : "null" },
-			{ "parameters", nlohmann::json() }
+			{ "prepass", ~_prepassMode },
+			{ "parameters", _ParametersToJson() }
 		};
 
+		if (!_defines.empty()) {
+			result["defines"] = _defines;
+		}
+
+		return result;
+	}
+
+	nlohmann::json Material::_ParametersToJson() const {
+		// Until the shader is ready our parameters are still in the form they were given to us, so we save them
+		// as they are rather than waiting on the compile
+		if (_isShaderPending) {
+			return _DeferredParametersToJson();
+		}
+
+		nlohmann::json result = nlohmann::json();
+
 		// Store all the uniforms
 		for (auto& [key, value] : _uniforms) {
 			if (value.Location != -1) {
-				result["parameters"][key] = value.ToJson();
+				result[key] = value.ToJson();
+			}
+		}
+
+		return result;
+	}
+
+	nlohmann::json Material::_DeferredParametersToJson() const {
+		// Parameters from JSON come first, anything set in code since then replaces them
+		nlohmann::json result = _deferredJson.is_object() ? _deferredJson : nlohmann::json();
+
+		for (const DeferredParameter& param : _deferredParameters) {
+			UniformData data;
+			data.Name = param.Name;
+			data.ArraySize = 1;
+			if (param.Type == ShaderDataType::None) {
+				// Textures don't know their sampler type until the shader is introspected, so we work it out from the texture
+				data.Type = GetSamplerType(param.Texture);
+				if (data.Type == ShaderDataType::None) {
+					continue;
+				}
+				data.TextureAsset = param.Texture;
+			} else {
+				// Like our other uniforms, only the first element of an array is saved
+				data.Type = param.Type;
+				memcpy(data.Value, param.Data.data(), ShaderDataTypeSize(param.Type));
 			}
+			result[param.Name] = data.ToJson();
 		}
 
 		return result;
@@ -171,13 +666,13 @@ namespace Gameplay {
 		UniformData& data = _uniforms[name];
 		if (data.Location == -2) {
 			ShaderProgram::UniformInfo uniform;
-			if (_shader->FindUniform(name, &uniform)) {
+			if (_variant->FindUniform(name, &uniform) || _FindBlockUniform(_variant, name, &uniform)) {
 				// Ignoring our reserved textures
 				if (GetShaderDataTypeCode(uniform.Type) == ShaderDataTypecode::Texture && uniform.Binding >= MAX_TEXTURE_SLOTS) {
 					data.Location = -1;
 				}
 				else {
-					data = UniformData(name, _shader);
+					data = UniformData(name, _variant);
 				}
 			} else {
 				data.Location = -1;
@@ -188,10 +683,32 @@ namespace Gameplay {
 
 	void Material::_PopulateUniforms()
 	{
-		const auto& uniforms = _shader->GetUniforms();
+		const auto& uniforms = _variant->GetUniforms();
 		for (const auto& [key, value] : uniforms) {
 			_uniforms[key] = _GetUniform(key);
 		}
+		const ShaderProgram::UniformBlockInfo* block = _variant->FindUniformBlock(MATERIAL_BLOCK_NAME);
+		if (block != nullptr) {
+			for (const auto& uniform : block->SubUniforms) {
+				_uniforms[uniform.Name] = _GetUniform(uniform.Name);
+			}
+		}
+		_isLayoutDirty = true;
+	}
+
+	bool Material::_FindBlockUniform(const ShaderProgram::Sptr& shader, const std::string& name, ShaderProgram::UniformInfo* out) {
+		const ShaderProgram::UniformBlockInfo* block = shader != nullptr ? shader->FindUniformBlock(MATERIAL_BLOCK_NAME) : nullptr;
+		if (block != nullptr) {
+			for (const auto& uniform : block->SubUniforms) {
+				if (uniform.Name == name) {
+					if (out != nullptr) {
+						*out = uniform;
+					}
+					return true;
+				}
+			}
+		}
+		return false;
 	}
 
 	bool Material::UniformData::RenderImGui() {
@@ -304,6 +821,7 @@ namespace Gameplay {
 							ImGui::Image((ImTextureID)tex->GetHandle(), ImVec2(ImGui::GetTextLineHeight() * 2, ImGui::GetTextLineHeight() * 2));
 							if (ImGuiHelper::ResourceDragTarget<Texture2D>(tex)) {
 								TextureAsset = tex;
+								modified = true;
 							}
 						}
 					}
@@ -403,12 +921,20 @@ namespace Gameplay {
 	{
 		// We extract the uniform info from the shader to populate our info
 		ShaderProgram::UniformInfo uniform;
-		if (shader != nullptr && shader->FindUniform(uniformName, &uniform)) {
+		bool isLoose = shader != nullptr && shader->FindUniform(uniformName, &uniform);
+		if (isLoose || Material::_FindBlockUniform(shader, uniformName, &uniform)) {
 			Name = uniformName;
 			Location = uniform.Location;
 			Type = uniform.Type;
 			ArraySize = uniform.ArraySize;
 			BindingSlot = uniform.Binding;
+
+			// Block members have no location, instead it holds their offset within the block
+			if (!isLoose) {
+				BlockOffset = uniform.Location;
+				ArrayStride = uniform.ArrayStride;
+				MatrixStride = uniform.MatrixStride;
+			}
 			
 			// Allocate memory for array if the uniform is an array
 			if (ArraySize > 1) {
@@ -424,6 +950,10 @@ namespace Gameplay {
 		Location = other.Location;
 		ArraySize = other.ArraySize;
 		Type = other.Type;
+		BindingSlot = other.BindingSlot;
+		BlockOffset = other.BlockOffset;
+		ArrayStride = other.ArrayStride;
+		MatrixStride = other.MatrixStride;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
 			TextureAsset = other.TextureAsset;
@@ -444,6 +974,10 @@ namespace Gameplay {
 		Location  = other.Location;
 		ArraySize = other.ArraySize;
 		Type      = other.Type;
+		BindingSlot  = other.BindingSlot;
+		BlockOffset  = other.BlockOffset;
+		ArrayStride  = other.ArrayStride;
+		MatrixStride = other.MatrixStride;
 
 		if (GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture) {
 			TextureAsset = other.TextureAsset;
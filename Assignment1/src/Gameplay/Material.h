@@ -2,6 +2,24 @@
 #include <memory>
 #include "Graphics/ShaderProgram.h"
 #include "Graphics/Textures/ITexture.h"
+#include "Graphics/Buffers/UniformBuffer.h"
+
+/// <summary>
+/// How a material takes part in RenderLayer's depth pre-pass
+/// </summary>
+ENUM(DepthPrepassMode, int,
+	// Drawn with the shared position-only shader, only valid for shaders whose vertex
+	// stage matches basic.glsl (u_ModelViewProjection * inPosition)
+	Shared   = 0,
+	// Drawn with the material's own shader compiled with DEPTH_PREPASS defined, for alpha
+	// tested materials and vertex shaders that move vertices around (ex: foliage)
+	Variant  = 1,
+	// Not drawn in the pre-pass, the main pass will test and write depth as usual
+	Disabled = 2,
+	// Picked from the shader's sources: Variant if it checks for DEPTH_PREPASS, Shared if it uses
+	// basic.glsl and never discards, otherwise Disabled
+	Auto     = 3
+);
 
 namespace Gameplay {
 	/// <summary>
@@ -15,9 +33,16 @@ namespace Gameplay {
 
 		/// <summary>
 		/// We'll sometimes want to reserve some texture slots for shared textures, such
-		/// as the environment map. We'll specify a number of reserved slots here
+		/// as the environment map (15) and shadow atlas (13), with 14 kept spare. We'll specify a number of reserved slots here
+		/// </summary>
+		static const int MAX_TEXTURE_SLOTS = 13;
+		/// <summary>
+		/// The uniform buffer slot that material parameter blocks are bound to, and the name of the
+		/// block that shaders declare to receive them. Non-texture uniforms inside this block are packed
+		/// by the material into a shared arena, and bound with a single range bind
 		/// </summary>
-		static const int MAX_TEXTURE_SLOTS = 14;
+		static const int MATERIAL_UBO_BINDING = 3;
+		inline static const std::string MATERIAL_BLOCK_NAME = "b_MaterialUniforms";
 
 		/// <summary>
 		/// A human readable name for the material
@@ -33,6 +58,7 @@ namespace Gameplay {
 		/// </summary>
 		/// <param name="shader">The shader for the material</param>
 		Material(const ShaderProgram::Sptr& shader);
+		virtual ~Material();
 
 		/// <summary>
 		/// Sets a material parameter with the given name and type
@@ -60,11 +86,70 @@ namespace Gameplay {
 		/// </summary>
 		const ShaderProgram::Sptr& GetShader() const;
 
+		/// <summary>
+		/// Gets the shader variant that this material draws with, selected from the shader using
+		/// the material's defines and the global defines
+		/// </summary>
+		const ShaderProgram::Sptr& GetActiveShader() const;
+
+		/// <summary>
+		/// Sets a define for this material's shader variant, materials sharing a shader and
+		/// defines will share a variant. Uniform values are carried over to the new variant
+		/// </summary>
+		/// <param name="name">The name of the define</param>
+		/// <param name="value">The value of the define, or empty for a bare #define</param>
+		void SetDefine(const std::string& name, const std::string& value = "");
+		void RemoveDefine(const std::string& name);
+		const ShaderDefines& GetDefines() const;
+
+		/// <summary>
+		/// Sets how this material is drawn in the depth pre-pass, see DepthPrepassMode
+		/// </summary>
+		void SetPrepassMode(DepthPrepassMode mode);
+		/// <summary>
+		/// Gets how this material is drawn in the depth pre-pass, never returns Auto
+		/// </summary>
+		DepthPrepassMode GetPrepassMode() const;
+		/// <summary>
+		/// Gets the DEPTH_PREPASS variant of our shader, used when our prepass mode is Variant.
+		/// The variant is created the first time this is called, and may still be compiling
+		/// </summary>
+		const ShaderProgram::Sptr& GetPrepassShader();
+		/// <summary>
+		/// Gets the MULTI_DRAW variant of our shader, which reads it's per-draw transforms from the
+		/// draw data buffer using gl_DrawID instead of the instance UBO (see MultiDrawRenderer).
+		/// The variant is created the first time this is called, and may still be compiling
+		/// </summary>
+		const ShaderProgram::Sptr& GetMultiDrawShader();
+
+		/// <summary>
+		/// Returns true if the material's shader has finished compiling, polling it if needed.
+		/// Parameters set while the shader was pending are applied once it is ready. If the shader
+		/// failed to link this stays false, so the material keeps drawing with the fallback shader
+		/// </summary>
+		bool IsReady();
+
+		/// <summary>
+		/// Gets a cheap, untextured shader that can be drawn with in place of materials
+		/// whose shaders are still compiling
+		/// </summary>
+		static const ShaderProgram::Sptr& GetFallbackShader();
+
 		/// <summary>
 		/// Handles applying this material's state to the OpenGL pipeline
-		/// Will bind the shader, update material uniforms, and bind textures
+		/// Will upload the parameter block if it has changed, then bind it and the textures
 		/// </summary>
 		virtual void Apply();
+		/// <summary>
+		/// Applies this material's state for drawing with our prepass variant, the variant
+		/// must be bound and ready. Uniforms outside of the parameter block are set by name
+		/// </summary>
+		void ApplyPrepass();
+		/// <summary>
+		/// Applies this material's state for drawing with our multi-draw variant, the variant
+		/// must be bound and ready
+		/// </summary>
+		void ApplyMultiDraw();
 
 		/// <summary>
 		/// Renders some UI controls for manipulating a material at runtime
@@ -108,6 +193,10 @@ namespace Gameplay {
 			// The size of the array, in elements
 			size_t         ArraySize;
 			int            BindingSlot;
+			// Offset and strides within the material block, or -1 if this is a loose uniform
+			int            BlockOffset = -1;
+			int            ArrayStride = 0;
+			int            MatrixStride = 0;
 
 			// The type of uniform
 			ShaderDataType Type = ShaderDataType::None;
@@ -165,17 +254,112 @@ namespace Gameplay {
 				return GetShaderDataTypeCode(Type) == ShaderDataTypecode::Texture;
 			}
 		};
+
+		/// <summary>
+		/// Stores a parameter that was set before the shader finished compiling
+		/// </summary>
+		struct DeferredParameter {
+			std::string          Name;
+			ShaderDataType       Type;
+			std::vector<uint8_t> Data;
+			ITexture::Sptr       Texture;
+			size_t               ArraySize;
+		};
+
+		/// <summary>
+		/// Finds a uniform within the shader's material block
+		/// </summary>
+		static bool _FindBlockUniform(const ShaderProgram::Sptr& shader, const std::string& name, ShaderProgram::UniformInfo* out);
 	
 		/// <summary>
 		/// The shader that the material is using
 		/// </summary>
 		ShaderProgram::Sptr    _shader;
 		/// <summary>
+		/// The variant of the shader that we draw with and introspect, and the global defines version it was selected for
+		/// </summary>
+		ShaderProgram::Sptr    _variant;
+		uint32_t               _variantVersion;
+		ShaderDefines          _defines;
+
+		// A variant of our shader with one extra define, used by a specific render pass
+		struct PassVariant {
+			std::string         Define;
+			ShaderProgram::Sptr Program;
+			// Locations of our loose uniforms within the variant, parallel to _looseUniforms
+			std::vector<int>    LooseLocations;
+			bool                IsLayoutDirty;
+
+			PassVariant(const std::string& define) : Define(define), Program(nullptr), IsLayoutDirty(true) { }
+		};
+
+		DepthPrepassMode       _prepassMode;
+		// What Auto resolves to for our shader, worked out when the shader is set
+		DepthPrepassMode       _autoPrepassMode;
+		PassVariant            _prepassVariant;
+		PassVariant            _multiDrawVariant;
+
+		/// <summary>
+		/// Works out which pre-pass mode is safe for our shader, see DepthPrepassMode::Auto
+		/// </summary>
+		void _ResolveAutoPrepassMode();
+		/// <summary>
 		/// The uniforms that the material will be modifying
 		/// </summary>
 		std::unordered_map<std::string, UniformData> _uniforms;
 
+		// CPU side copy of our std140 parameter block, and where it lives in the arena
+		std::vector<uint8_t>   _blockData;
+		uint32_t               _blockOffset;
+		uint32_t               _blockSize;
+		bool                   _isBlockDirty;
+
+		// Precomputed texture handles for glBindTextures, and uniforms not in the block
+		std::vector<GLuint>    _textureHandles;
+		std::vector<UniformData*> _looseUniforms;
+		bool                   _isLayoutDirty;
+
+		// Parameters waiting on the shader to finish compiling, from Set and from JSON. If the shader fails to link
+		// they keep waiting, and we stay on the fallback shader
+		bool                   _isShaderPending;
+		bool                   _hasShaderFailed;
+		std::vector<DeferredParameter> _deferredParameters;
+		nlohmann::json         _deferredJson;
+
 		UniformData& _GetUniform(const std::string& name);
 		void _PopulateUniforms();
+		void _AllocateBlock();
+		void _RebuildLayout();
+		void _PackBlock();
+		void _LoadParameters(const nlohmann::json& parameters);
+		const ShaderProgram::Sptr& _GetPassShader(PassVariant& pass);
+		void _ApplyPass(PassVariant& pass);
+		/// <summary>
+		/// Brings our layout up to date and binds the parameter block and textures, which every pass shares.
+		/// Returns false if the shader isn't ready yet
+		/// </summary>
+		bool _ApplyShared();
+		nlohmann::json _ParametersToJson() const;
+		nlohmann::json _DeferredParametersToJson() const;
+		/// <summary>
+		/// Picks the shader variant for our defines, and moves our parameters over to it if it changed
+		/// </summary>
+		void _SelectVariant();
+		/// <summary>
+		/// Builds the uniform layout once our shader is linked, and applies any deferred parameters
+		/// </summary>
+		void _OnShaderReady();
+
+		inline static ShaderProgram::Sptr __fallbackShader = nullptr;
+
+		// The arena that all material blocks are sub-allocated from
+		inline static AbstractUniformBuffer::Sptr __arenaBuffer = nullptr;
+		inline static std::unordered_map<uint32_t, std::vector<uint32_t>> __arenaFreeList;
+		inline static uint32_t __arenaCursor = 0;
+		inline static int __arenaAlignment = 0;
+
+		static uint32_t __GetArenaSize(uint32_t size);
+		static uint32_t __AllocateArena(uint32_t size);
+		static void __FreeArena(uint32_t offset, uint32_t size);
 	};
 }
\ No newline at end of file
@@ -112,18 +112,21 @@ namespace Gameplay::Physics {
 				};
 
 				// Allocate some space to read data from OpenGL and read our buffer data back into CPU memory
-				uint8_t* vertexStore = reinterpret_cast<uint8_t*>(malloc(vertexBuff->GetTotalSize()));
-				glGetNamedBufferSubData(vertexBuff->GetHandle(), 0, vertexBuff->GetTotalSize(), vertexStore);
+				// Meshes in the geometry arena share their buffers, so we only read back the mesh's own range
+				size_t vertexBytes = (size_t)vao->GetVertexCount() * posAttrib.Stride;
+				uint8_t* vertexStore = reinterpret_cast<uint8_t*>(malloc(vertexBytes));
+				glGetNamedBufferSubData(vertexBuff->GetHandle(), (GLintptr)vao->GetBaseVertex() * posAttrib.Stride, vertexBytes, vertexStore);
 				_triMesh->preallocateVertices(vao->GetVertexCount());
 
 				// If our data is indexed, we use the index buffer to add our triangles
 				if (indexBuff != nullptr) {
 					// Allocate and read space for the indices
-					uint8_t* indexStore = reinterpret_cast<uint8_t*>(malloc(indexBuff->GetTotalSize()));
-					glGetNamedBufferSubData(indexBuff->GetHandle(), 0, indexBuff->GetTotalSize(), indexStore);
+					size_t indexSize = GetIndexTypeSize(indexBuff->GetElementType());
+					uint8_t* indexStore = reinterpret_cast<uint8_t*>(malloc(vao->GetIndexCount() * indexSize));
+					glGetNamedBufferSubData(indexBuff->GetHandle(), (GLintptr)vao->GetFirstIndex() * indexSize, vao->GetIndexCount() * indexSize, indexStore);
 
 					// Iterate over index triangles
-					for (size_t ix = 0; ix < indexBuff->GetElementCount(); ix+=3) {
+					for (size_t ix = 0; ix < vao->GetIndexCount(); ix+=3) {
 						// Extract index from the raw data
 						int i1 = getBufferIndex(indexBuff, indexStore, static_cast<int>(ix));
 						int i2 = getBufferIndex(indexBuff, indexStore, static_cast<int>(ix + 1));
@@ -145,7 +148,7 @@ namespace Gameplay::Physics {
 				// We only have vertex data, create triangles sequentially
 				else {
 					// Iterate over triangles, and add each to the mesh
-					for (size_t ix = 0; ix < vertexBuff->GetElementCount(); ix+=3) {
+					for (size_t ix = 0; ix + 2 < vao->GetVertexCount(); ix+=3) {
 						glm::vec3 p1 = *reinterpret_cast<glm::vec3*>(vertexStore + ((ix + 0) * posAttrib.Stride) + posAttrib.Offset);
 						glm::vec3 p2 = *reinterpret_cast<glm::vec3*>(vertexStore + ((ix + 1) * posAttrib.Stride) + posAttrib.Offset);
 						glm::vec3 p3 = *reinterpret_cast<glm::vec3*>(vertexStore + ((ix + 2) * posAttrib.Stride) + posAttrib.Offset);
@@ -0,0 +1,488 @@
+#include "Gameplay/Physics/PhysicsQueries.h"
+#include <algorithm>
+#include <chrono>
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <BulletCollision/NarrowPhaseCollision/btPointCollector.h>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+
+#include "Utils/GlmBulletConversions.h"
+
+namespace Gameplay::Physics {
+	// Scratch space for walking the broadphase trees, so queries don't allocate once they've warmed up
+	static thread_local btAlignedObjectArray<const btDbvtNode*>  tl_stack;
+	static thread_local btAlignedObjectArray<btCollisionObject*> tl_candidates;
+
+	static btVector3 ToBtVec(const glm::vec3& value) {
+		return btVector3(value.x, value.y, value.z);
+	}
+
+	static bool IsOverlap(PhysicsQueryType type) {
+		return type == PhysicsQueryType::SphereOverlap || type == PhysicsQueryType::BoxOverlap;
+	}
+
+	// RigidBody and TriggerVolume store their object's handle in the user indices
+	static GameObjectHandle GetObjectHandle(const btCollisionObject* object) {
+		GameObjectHandle result;
+		result.Index = static_cast<uint32_t>(object->getUserIndex());
+		result.Generation = static_cast<uint32_t>(object->getUserIndex2());
+		return result;
+	}
+
+	static bool PassesFilter(const PhysicsQuery& query, const btCollisionObject* object) {
+		if (!query.IncludeTriggers && object->getInternalType() == btCollisionObject::CO_GHOST_OBJECT) {
+			return false;
+		}
+		const btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+		if (proxy == nullptr || (proxy->m_collisionFilterGroup & query.CollisionMask) == 0) {
+			return false;
+		}
+		return query.Owner.IsNull() || GetObjectHandle(object) != query.Owner;
+	}
+
+	// Collects the collision objects of any leaves the traversal reaches
+	struct CandidateCollector : public btDbvt::ICollide {
+		void Process(const btDbvtNode* leaf) override {
+			const btDbvtProxy* proxy = static_cast<const btDbvtProxy*>(leaf->data);
+			tl_candidates.push_back(static_cast<btCollisionObject*>(proxy->m_clientObject));
+		}
+	};
+
+	// Finds leaves whose bounds overlap a box. btDbvt::collideTV would allocate a new stack every call
+	static void CollectInAabb(const btDbvt& tree, const btDbvtVolume& volume) {
+		if (tree.m_root == nullptr) {
+			return;
+		}
+		tl_stack.resize(0);
+		tl_stack.push_back(tree.m_root);
+		while (tl_stack.size() > 0) {
+			const btDbvtNode* node = tl_stack[tl_stack.size() - 1];
+			tl_stack.pop_back();
+			if (Intersect(node->volume, volume)) {
+				if (node->isinternal()) {
+					tl_stack.push_back(node->childs[0]);
+					tl_stack.push_back(node->childs[1]);
+				} else {
+					const btDbvtProxy* proxy = static_cast<const btDbvtProxy*>(node->data);
+					tl_candidates.push_back(static_cast<btCollisionObject*>(proxy->m_clientObject));
+				}
+			}
+		}
+	}
+
+	// Finds leaves along a ray, with their bounds grown by the given box for sweeps. This mirrors
+	// btDbvtBroadphase::rayTest, but with our own stack so it can run on several threads at once
+	static void CollectAlongRay(btDbvtBroadphase* broadphase, const btVector3& from, const btVector3& to, const btVector3& aabbMin, const btVector3& aabbMax) {
+		btVector3 direction = (to - from).normalized();
+		btVector3 inverse(
+			direction.x() == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction.x(),
+			direction.y() == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction.y(),
+			direction.z() == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction.z()
+		);
+		unsigned int signs[3] = { inverse.x() < 0.0, inverse.y() < 0.0, inverse.z() < 0.0 };
+		btScalar lambdaMax = direction.dot(to - from);
+
+		CandidateCollector collector;
+		for (int set = 0; set < 2; set++) {
+			const btDbvt& tree = broadphase->m_sets[set];
+			if (tree.m_root != nullptr) {
+				tree.rayTestInternal(tree.m_root, from, to, inverse, signs, lambdaMax, aabbMin, aabbMax, tl_stack, collector);
+			}
+		}
+	}
+
+	// Tests a convex shape against any shape, descending into compounds
+	static bool TestOverlap(const btConvexShape* shape, const btTransform& transform, const btVector3& aabbMin, const btVector3& aabbMax,
+		const btCollisionShape* other, const btTransform& otherTransform, btVector3& point, btVector3& normal)
+	{
+		if (other->isCompound()) {
+			const btCompoundShape* compound = static_cast<const btCompoundShape*>(other);
+			for (int ix = 0; ix < compound->getNumChildShapes(); ix++) {
+				btTransform childTransform = otherTransform * compound->getChildTransform(ix);
+				if (TestOverlap(shape, transform, aabbMin, aabbMax, compound->getChildShape(ix), childTransform, point, normal)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		btVector3 otherMin, otherMax;
+		other->getAabb(otherTransform, otherMin, otherMax);
+		if (!TestAabbAgainstAabb2(aabbMin, aabbMax, otherMin, otherMax)) {
+			return false;
+		}
+
+		if (other->isConvex()) {
+			btVoronoiSimplexSolver simplex;
+			btGjkEpaPenetrationDepthSolver penetration;
+			btGjkPairDetector detector(shape, static_cast<const btConvexShape*>(other), &simplex, &penetration);
+			btGjkPairDetector::ClosestPointInput input;
+			input.m_transformA = transform;
+			input.m_transformB = otherTransform;
+			btPointCollector output;
+			detector.getClosestPoints(input, output, nullptr);
+			if (output.m_hasResult && output.m_distance <= btScalar(0.0)) {
+				point = output.m_pointInWorld;
+				normal = output.m_normalOnBInWorld;
+				return true;
+			}
+			return false;
+		}
+
+		// Planes are infinite, so we check the deepest point of our shape against them
+		if (other->getShapeType() == STATIC_PLANE_PROXYTYPE) {
+			const btStaticPlaneShape* plane = static_cast<const btStaticPlaneShape*>(other);
+			btVector3 planeNormal = otherTransform.getBasis() * plane->getPlaneNormal();
+			btScalar planeConstant = plane->getPlaneConstant() + planeNormal.dot(otherTransform.getOrigin());
+			btVector3 deepest = transform(shape->localGetSupportingVertex(-planeNormal * transform.getBasis()));
+			btScalar distance = planeNormal.dot(deepest) - planeConstant;
+			if (distance <= btScalar(0.0)) {
+				point = deepest - planeNormal * distance;
+				normal = planeNormal;
+				return true;
+			}
+			return false;
+		}
+
+		// Anything else (triangle meshes) is only checked against it's bounds
+		point = (otherMin + otherMax) * btScalar(0.5);
+		normal = (transform.getOrigin() - point).safeNormalize();
+		return true;
+	}
+
+	PhysicsQuery PhysicsQuery::Raycast(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, int mask) {
+		PhysicsQuery result;
+		result.Type = PhysicsQueryType::Raycast;
+		result.Owner = owner;
+		result.From = from;
+		result.To = to;
+		result.Extents = glm::vec3(0.0f);
+		result.Rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+		result.CollisionMask = mask;
+		result.MaxHits = 1;
+		result.IncludeTriggers = false;
+		return result;
+	}
+
+	PhysicsQuery PhysicsQuery::SphereSweep(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, float radius, int mask) {
+		PhysicsQuery result = Raycast(owner, from, to, mask);
+		result.Type = PhysicsQueryType::SphereSweep;
+		result.Extents = glm::vec3(radius);
+		return result;
+	}
+
+	PhysicsQuery PhysicsQuery::BoxSweep(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, const glm::vec3& halfExtents, const glm::quat& rotation, int mask) {
+		PhysicsQuery result = Raycast(owner, from, to, mask);
+		result.Type = PhysicsQueryType::BoxSweep;
+		result.Extents = halfExtents;
+		result.Rotation = rotation;
+		return result;
+	}
+
+	PhysicsQuery PhysicsQuery::SphereOverlap(GameObjectHandle owner, const glm::vec3& center, float radius, int mask, uint8_t maxHits) {
+		PhysicsQuery result = Raycast(owner, center, center, mask);
+		result.Type = PhysicsQueryType::SphereOverlap;
+		result.Extents = glm::vec3(radius);
+		result.MaxHits = maxHits;
+		return result;
+	}
+
+	PhysicsQuery PhysicsQuery::BoxOverlap(GameObjectHandle owner, const glm::vec3& center, const glm::vec3& halfExtents, const glm::quat& rotation, int mask, uint8_t maxHits) {
+		PhysicsQuery result = Raycast(owner, center, center, mask);
+		result.Type = PhysicsQueryType::BoxOverlap;
+		result.Extents = halfExtents;
+		result.Rotation = rotation;
+		result.MaxHits = maxHits;
+		return result;
+	}
+
+	uint32_t PhysicsQueryService::DefaultWorkerCount() {
+		uint32_t cores = std::thread::hardware_concurrency();
+		return cores <= 2 ? 1 : std::min(cores - 2, 6u);
+	}
+
+	PhysicsQueryService::PhysicsQueryService(uint32_t workerCount) :
+		_submitMutex(),
+		_pending(),
+		_executing(),
+		_slotOffsets(),
+		_slots(),
+		_hitCounts(),
+		_broadphase(nullptr),
+		_results(),
+		_hits(),
+		_stats({ 0, 0, 0, 0.0f }),
+		_workers(),
+		_workMutex(),
+		_workReady(),
+		_workDone(),
+		_batchId(0),
+		_finishedWorkers(0),
+		_shutdown(false),
+		_cursor(0),
+		_queryCount(0)
+	{
+		for (uint32_t ix = 0; ix < workerCount; ix++) {
+			_workers.emplace_back(&PhysicsQueryService::_WorkerLoop, this);
+		}
+	}
+
+	PhysicsQueryService::~PhysicsQueryService() {
+		{
+			std::lock_guard<std::mutex> lock(_workMutex);
+			_shutdown = true;
+		}
+		_workReady.notify_all();
+		for (std::thread& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	uint32_t PhysicsQueryService::Submit(const PhysicsQuery& query) {
+		return Submit(&query, 1);
+	}
+
+	uint32_t PhysicsQueryService::Submit(const PhysicsQuery* queries, size_t count) {
+		std::lock_guard<std::mutex> lock(_submitMutex);
+		uint32_t ticket = static_cast<uint32_t>(_pending.size());
+		_pending.insert(_pending.end(), queries, queries + count);
+		return ticket;
+	}
+
+	bool PhysicsQueryService::HasPending() {
+		std::lock_guard<std::mutex> lock(_submitMutex);
+		return !_pending.empty();
+	}
+
+	void PhysicsQueryService::Execute(btDbvtBroadphase* broadphase) {
+		auto start = std::chrono::high_resolution_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(_submitMutex);
+			_executing.swap(_pending);
+			_pending.clear();
+		}
+		uint32_t count = static_cast<uint32_t>(_executing.size());
+
+		// Give every query it's own slots to write hits into, so threads never share anything
+		_slotOffsets.resize(count);
+		uint32_t totalSlots = 0;
+		for (uint32_t ix = 0; ix < count; ix++) {
+			_slotOffsets[ix] = totalSlots;
+			totalSlots += IsOverlap(_executing[ix].Type) ? std::max<uint32_t>(_executing[ix].MaxHits, 1) : 1;
+		}
+		_slots.resize(totalSlots);
+		_hitCounts.assign(count, 0);
+		_broadphase = broadphase;
+
+		uint32_t threads = 1;
+		if (count > 0 && broadphase != nullptr) {
+			if (count >= MIN_PARALLEL_QUERIES && !_workers.empty()) {
+				threads += static_cast<uint32_t>(_workers.size());
+
+				// Every worker finished the last batch before it returned, so nothing else is reading these yet.
+				// The workers pick them up under the mutex along with the new batch ID
+				uint64_t batch = _batchId + 1;
+				_queryCount.store(count, std::memory_order_relaxed);
+				_cursor.store((batch & 0xFFFFFFFF) << 32, std::memory_order_relaxed);
+				{
+					std::lock_guard<std::mutex> lock(_workMutex);
+					_batchId = batch;
+					_finishedWorkers = 0;
+				}
+				_workReady.notify_all();
+
+				// Pitch in while the workers wake up, then wait for all of them to be done with the batch. Waiting
+				// on the queries alone isn't enough, a worker that woke up late could still be about to claim a
+				// chunk when the next batch is published
+				_RunChunks(batch);
+				std::unique_lock<std::mutex> lock(_workMutex);
+				_workDone.wait(lock, [&]() { return _finishedWorkers == _workers.size(); });
+			} else {
+				for (uint32_t ix = 0; ix < count; ix++) {
+					_RunQuery(ix);
+				}
+			}
+		}
+
+		// Publish the results grouped by owner, with their hits packed together
+		_results.resize(count);
+		for (uint32_t ix = 0; ix < count; ix++) {
+			_results[ix] = { _executing[ix].Owner, ix, 0, _hitCounts[ix] };
+		}
+		std::stable_sort(_results.begin(), _results.end(), [](const PhysicsQueryResult& a, const PhysicsQueryResult& b) {
+			return a.Owner.Index != b.Owner.Index ? a.Owner.Index < b.Owner.Index : a.Owner.Generation < b.Owner.Generation;
+		});
+		_hits.clear();
+		for (PhysicsQueryResult& result : _results) {
+			result.FirstHit = static_cast<uint32_t>(_hits.size());
+			const PhysicsQueryHit* slots = _slots.data() + _slotOffsets[result.Ticket];
+			_hits.insert(_hits.end(), slots, slots + result.HitCount);
+		}
+		_executing.clear();
+
+		_stats.Queries = count;
+		_stats.Hits = static_cast<uint32_t>(_hits.size());
+		_stats.Threads = threads;
+		_stats.Milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	PhysicsQueryService::ResultRange PhysicsQueryService::GetResults(GameObjectHandle owner) const {
+		auto first = std::lower_bound(_results.begin(), _results.end(), owner, [](const PhysicsQueryResult& result, const GameObjectHandle& handle) {
+			return result.Owner.Index != handle.Index ? result.Owner.Index < handle.Index : result.Owner.Generation < handle.Generation;
+		});
+		auto last = std::upper_bound(first, _results.end(), owner, [](const GameObjectHandle& handle, const PhysicsQueryResult& result) {
+			return handle.Index != result.Owner.Index ? handle.Index < result.Owner.Index : handle.Generation < result.Owner.Generation;
+		});
+		const PhysicsQueryResult* data = _results.data();
+		return { data + (first - _results.begin()), data + (last - _results.begin()) };
+	}
+
+	const PhysicsQueryHit* PhysicsQueryService::GetHits(const PhysicsQueryResult& result) const {
+		return result.HitCount > 0 ? &_hits[result.FirstHit] : nullptr;
+	}
+
+	void PhysicsQueryService::_WorkerLoop() {
+		uint64_t seen = 0;
+		while (true) {
+			uint64_t batch;
+			{
+				std::unique_lock<std::mutex> lock(_workMutex);
+				_workReady.wait(lock, [&]() { return _shutdown || _batchId != seen; });
+				if (_shutdown) {
+					return;
+				}
+				batch = seen = _batchId;
+			}
+			_RunChunks(batch);
+
+			{
+				std::lock_guard<std::mutex> lock(_workMutex);
+				_finishedWorkers++;
+			}
+			_workDone.notify_one();
+		}
+	}
+
+	void PhysicsQueryService::_RunChunks(uint64_t batch) {
+		// Execute keeps batches from overlapping, but the cursor still holds the batch in it's top half so a
+		// worker can never claim queries from a different batch than the one it was woken for
+		uint64_t tag = (batch & 0xFFFFFFFF) << 32;
+		uint64_t cursor = _cursor.load(std::memory_order_acquire);
+		while ((cursor & 0xFFFFFFFF00000000ull) == tag) {
+			uint32_t first = static_cast<uint32_t>(cursor);
+			uint32_t count = _queryCount.load(std::memory_order_relaxed);
+			if (first >= count) {
+				return;
+			}
+			if (_cursor.compare_exchange_weak(cursor, cursor + QUERIES_PER_CHUNK, std::memory_order_acq_rel)) {
+				uint32_t last = std::min(first + QUERIES_PER_CHUNK, count);
+				for (uint32_t ix = first; ix < last; ix++) {
+					_RunQuery(ix);
+				}
+				cursor = _cursor.load(std::memory_order_acquire);
+			}
+		}
+	}
+
+	void PhysicsQueryService::_RunQuery(uint32_t index) {
+		const PhysicsQuery& query = _executing[index];
+		PhysicsQueryHit* slots = _slots.data() + _slotOffsets[index];
+		uint32_t& hitCount = _hitCounts[index];
+
+		btVector3 from = ToBtVec(query.From);
+		btVector3 to = ToBtVec(query.To);
+		btQuaternion rotation = ToBt(query.Rotation);
+
+		btSphereShape sphere(query.Extents.x);
+		btBoxShape box(ToBtVec(query.Extents));
+		bool isSphere = query.Type == PhysicsQueryType::SphereSweep || query.Type == PhysicsQueryType::SphereOverlap;
+		const btConvexShape* shape = isSphere ? static_cast<const btConvexShape*>(&sphere) : static_cast<const btConvexShape*>(&box);
+
+		tl_candidates.resize(0);
+
+		switch (query.Type) {
+			case PhysicsQueryType::Raycast:
+			{
+				if ((to - from).length2() < SIMD_EPSILON) {
+					return;
+				}
+				CollectAlongRay(_broadphase, from, to, btVector3(0, 0, 0), btVector3(0, 0, 0));
+
+				btTransform fromTransform(btQuaternion::getIdentity(), from);
+				btTransform toTransform(btQuaternion::getIdentity(), to);
+				btCollisionWorld::ClosestRayResultCallback callback(from, to);
+				for (int ix = 0; ix < tl_candidates.size(); ix++) {
+					btCollisionObject* object = tl_candidates[ix];
+					if (PassesFilter(query, object)) {
+						btCollisionWorld::rayTestSingle(fromTransform, toTransform, object, object->getCollisionShape(), object->getWorldTransform(), callback);
+					}
+				}
+				if (callback.hasHit()) {
+					slots[0].Object = GetObjectHandle(callback.m_collisionObject);
+					slots[0].Point = ToGlm(callback.m_hitPointWorld);
+					slots[0].Normal = ToGlm(callback.m_hitNormalWorld.normalized());
+					slots[0].Fraction = callback.m_closestHitFraction;
+					hitCount = 1;
+				}
+				break;
+			}
+			case PhysicsQueryType::SphereSweep:
+			case PhysicsQueryType::BoxSweep:
+			{
+				if ((to - from).length2() < SIMD_EPSILON) {
+					return;
+				}
+				btTransform fromTransform(rotation, from);
+				btTransform toTransform(rotation, to);
+				btVector3 shapeMin, shapeMax;
+				shape->getAabb(btTransform(rotation, btVector3(0, 0, 0)), shapeMin, shapeMax);
+				CollectAlongRay(_broadphase, from, to, shapeMin, shapeMax);
+
+				btCollisionWorld::ClosestConvexResultCallback callback(from, to);
+				for (int ix = 0; ix < tl_candidates.size(); ix++) {
+					btCollisionObject* object = tl_candidates[ix];
+					if (PassesFilter(query, object)) {
+						btCollisionWorld::objectQuerySingle(shape, fromTransform, toTransform, object, object->getCollisionShape(), object->getWorldTransform(), callback, btScalar(0.0));
+					}
+				}
+				if (callback.hasHit()) {
+					slots[0].Object = GetObjectHandle(callback.m_hitCollisionObject);
+					slots[0].Point = ToGlm(callback.m_hitPointWorld);
+					slots[0].Normal = ToGlm(callback.m_hitNormalWorld.normalized());
+					slots[0].Fraction = callback.m_closestHitFraction;
+					hitCount = 1;
+				}
+				break;
+			}
+			case PhysicsQueryType::SphereOverlap:
+			case PhysicsQueryType::BoxOverlap:
+			{
+				btTransform transform(rotation, from);
+				btVector3 aabbMin, aabbMax;
+				shape->getAabb(transform, aabbMin, aabbMax);
+				btDbvtVolume volume = btDbvtVolume::FromMM(aabbMin, aabbMax);
+				CollectInAabb(_broadphase->m_sets[0], volume);
+				CollectInAabb(_broadphase->m_sets[1], volume);
+
+				uint32_t maxHits = std::max<uint32_t>(query.MaxHits, 1);
+				for (int ix = 0; ix < tl_candidates.size() && hitCount < maxHits; ix++) {
+					btCollisionObject* object = tl_candidates[ix];
+					btVector3 point, normal;
+					if (PassesFilter(query, object) && TestOverlap(shape, transform, aabbMin, aabbMax, object->getCollisionShape(), object->getWorldTransform(), point, normal)) {
+						PhysicsQueryHit& hit = slots[hitCount++];
+						hit.Object = GetObjectHandle(object);
+						hit.Point = ToGlm(point);
+						hit.Normal = ToGlm(normal);
+						hit.Fraction = 0.0f;
+					}
+				}
+				break;
+			}
+			default:
+				break;
+		}
+	}
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <EnumToString.h>
+#include <GLM/glm.hpp>
+#include <GLM/gtc/quaternion.hpp>
+
+#include "Utils/Macros.h"
+#include "Gameplay/GameObject.h"
+
+class btDbvtBroadphase;
+
+ENUM(PhysicsQueryType, uint8_t,
+	// Finds the first object along a line
+	Raycast       = 0,
+	// Finds the first object a sphere would touch moving along a line
+	SphereSweep   = 1,
+	// Finds the first object a box would touch moving along a line
+	BoxSweep      = 2,
+	// Finds all objects touching a sphere
+	SphereOverlap = 3,
+	// Finds all objects touching a box
+	BoxOverlap    = 4
+);
+
+namespace Gameplay::Physics {
+	/// <summary>
+	/// Describes a single query against the physics world, use the static helpers to make one
+	/// </summary>
+	struct PhysicsQuery {
+		PhysicsQueryType Type;
+		// The object that made the query, results are grouped by this
+		GameObjectHandle Owner;
+		// The start and end of rays and sweeps, overlaps are centered on From
+		glm::vec3        From;
+		glm::vec3        To;
+		// The radius of spheres, or the half size of boxes
+		glm::vec3        Extents;
+		// The orientation of boxes
+		glm::quat        Rotation;
+		// Only objects in at least one of these collision groups are reported
+		int              CollisionMask;
+		// The most objects an overlap will report
+		uint8_t          MaxHits;
+		// True to report trigger volumes as well as rigid bodies
+		bool             IncludeTriggers;
+
+		static PhysicsQuery Raycast(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, int mask = -1);
+		static PhysicsQuery SphereSweep(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, float radius, int mask = -1);
+		static PhysicsQuery BoxSweep(GameObjectHandle owner, const glm::vec3& from, const glm::vec3& to, const glm::vec3& halfExtents, const glm::quat& rotation, int mask = -1);
+		static PhysicsQuery SphereOverlap(GameObjectHandle owner, const glm::vec3& center, float radius, int mask = -1, uint8_t maxHits = 8);
+		static PhysicsQuery BoxOverlap(GameObjectHandle owner, const glm::vec3& center, const glm::vec3& halfExtents, const glm::quat& rotation, int mask = -1, uint8_t maxHits = 8);
+	};
+
+	/// <summary>
+	/// An object found by a query
+	/// </summary>
+	struct PhysicsQueryHit {
+		GameObjectHandle Object;
+		// The contact point and surface normal in world space
+		glm::vec3        Point;
+		glm::vec3        Normal;
+		// How far along the ray or sweep the hit was, from 0 to 1. Always 0 for overlaps
+		float            Fraction;
+	};
+
+	/// <summary>
+	/// The outcome of a single query, it's hits are stored together in the service's hit list
+	/// </summary>
+	struct PhysicsQueryResult {
+		GameObjectHandle Owner;
+		// The value Submit returned for the query
+		uint32_t         Ticket;
+		uint32_t         FirstHit;
+		uint32_t         HitCount;
+	};
+
+	/// <summary>
+	/// Runs batches of raycasts, sweeps and overlap tests against the physics world on a small pool of
+	/// worker threads. Queries submitted during a frame are run together once the world has been stepped
+	/// (see Scene::DoPhysics), and their results stay available until the next batch runs
+	///
+	/// Queries walk the broadphase trees directly and use Bullet's single object tests, which only read
+	/// from the world, so they don't go through btCollisionWorld's shared ray test stack
+	/// </summary>
+	class PhysicsQueryService {
+	public:
+		MAKE_PTRS(PhysicsQueryService);
+		NO_COPY(PhysicsQueryService);
+		NO_MOVE(PhysicsQueryService);
+
+		// Batches smaller than this run on the calling thread, since waking workers costs more
+		static const uint32_t MIN_PARALLEL_QUERIES = 64;
+		// The number of queries a thread claims at a time
+		static const uint32_t QUERIES_PER_CHUNK = 16;
+
+		/// <summary>
+		/// A range of results for a single owner, usable in range based for loops
+		/// </summary>
+		struct ResultRange {
+			const PhysicsQueryResult* Begin;
+			const PhysicsQueryResult* End;
+			const PhysicsQueryResult* begin() const { return Begin; }
+			const PhysicsQueryResult* end() const { return End; }
+			size_t size() const { return End - Begin; }
+		};
+
+		/// <summary>
+		/// Describes the last batch that was run
+		/// </summary>
+		struct Stats {
+			uint32_t Queries;
+			uint32_t Hits;
+			uint32_t Threads;
+			float    Milliseconds;
+		};
+
+		static inline Sptr Create(uint32_t workerCount = DefaultWorkerCount()) {
+			return std::make_shared<PhysicsQueryService>(workerCount);
+		}
+
+		/// <summary>
+		/// Gets the number of workers to use when none is given, leaves a core for the main thread
+		/// </summary>
+		static uint32_t DefaultWorkerCount();
+
+		PhysicsQueryService(uint32_t workerCount);
+		~PhysicsQueryService();
+
+		/// <summary>
+		/// Queues a query to run with the next batch, safe to call from any thread
+		/// </summary>
+		/// <returns>A ticket that identifies the query's result</returns>
+		uint32_t Submit(const PhysicsQuery& query);
+		/// <summary>
+		/// Queues several queries at once, the tickets are consecutive
+		/// </summary>
+		/// <returns>The ticket of the first query</returns>
+		uint32_t Submit(const PhysicsQuery* queries, size_t count);
+		/// <summary>
+		/// True if any queries are waiting for the next batch
+		/// </summary>
+		bool HasPending();
+
+		/// <summary>
+		/// Runs all queued queries against the given broadphase and publishes their results, blocking until
+		/// they are done. Called by the scene after each physics step
+		/// </summary>
+		void Execute(btDbvtBroadphase* broadphase);
+
+		/// <summary>
+		/// Gets the results of the last batch, sorted by owner and then by ticket
+		/// </summary>
+		const std::vector<PhysicsQueryResult>& GetResults() const { return _results; }
+		/// <summary>
+		/// Gets the results of the last batch for a single object, in the order they were submitted
+		/// </summary>
+		ResultRange GetResults(GameObjectHandle owner) const;
+		/// <summary>
+		/// Gets the first hit of a result, or nullptr if it has none
+		/// </summary>
+		const PhysicsQueryHit* GetHits(const PhysicsQueryResult& result) const;
+		/// <summary>
+		/// Gets every hit from the last batch, results index into this list
+		/// </summary>
+		const std::vector<PhysicsQueryHit>& GetAllHits() const { return _hits; }
+
+		const Stats& GetStats() const { return _stats; }
+
+	protected:
+		// Queries waiting for the next batch
+		std::mutex                       _submitMutex;
+		std::vector<PhysicsQuery>        _pending;
+
+		// The batch being run, each query writes into it's own range of hit slots
+		std::vector<PhysicsQuery>        _executing;
+		std::vector<uint32_t>            _slotOffsets;
+		std::vector<PhysicsQueryHit>     _slots;
+		std::vector<uint32_t>            _hitCounts;
+		btDbvtBroadphase*                _broadphase;
+
+		// The published results of the last batch
+		std::vector<PhysicsQueryResult>  _results;
+		std::vector<PhysicsQueryHit>     _hits;
+		Stats                            _stats;
+
+		// The worker pool, workers wake when the batch ID changes and claim chunks of queries until none are left.
+		// Execute waits for every worker to finish a batch before returning, so no worker is ever still running
+		// when the next batch is set up
+		std::vector<std::thread>         _workers;
+		std::mutex                       _workMutex;
+		std::condition_variable          _workReady;
+		std::condition_variable          _workDone;
+		uint64_t                         _batchId;
+		// The number of workers that have finished the current batch, guarded by _workMutex
+		uint32_t                         _finishedWorkers;
+		bool                             _shutdown;
+		// The low half is the next query to claim, the high half is the batch it belongs to
+		std::atomic<uint64_t>            _cursor;
+		std::atomic<uint32_t>            _queryCount;
+
+		void _WorkerLoop();
+		void _RunChunks(uint64_t batch);
+		void _RunQuery(uint32_t index);
+	};
+}
@@ -218,6 +218,9 @@ namespace Gameplay::Physics {
 		_body = new btRigidBody(_mass, _motionState, _shape, _inertia);
 		// Add a pointer to our own weak reference to allow getting this component as a shared_ptr later
 		_body->setUserPointer(&SelfRef());
+		// Store the object's handle as well, so physics queries can report it without touching the component
+		_body->setUserIndex(static_cast<int>(context->GetHandle().Index));
+		_body->setUserIndex2(static_cast<int>(context->GetHandle().Generation));
 
 		_scene->GetPhysicsWorld()->addRigidBody(_body);
 
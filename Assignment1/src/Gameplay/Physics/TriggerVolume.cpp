@@ -3,6 +3,7 @@
 #include <BulletCollision/CollisionDispatch/btGhostObject.h>
 
 #include "Utils/GlmBulletConversions.h"
+#include "Utils/FrameArena.h"
 
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Scene.h"
@@ -37,8 +38,8 @@ namespace Gameplay::Physics {
 	}
 
 	void TriggerVolume::PhysicsPostStep(float dt) {
-		// This will store all the objects inside the trigger this frame
-		std::vector<std::weak_ptr<RigidBody>> thisFrameCollision;
+		// This will store all the objects inside the trigger this frame, it's gone by the end of the step so it can live in the frame arena
+		FrameVector<std::weak_ptr<RigidBody>> thisFrameCollision;
 
 		// Get all our collisions from from the world
 		_scene->GetPhysicsWorld()->getDispatcher()->dispatchAllCollisionPairs(_ghost->getOverlappingPairCache(), _scene->GetPhysicsWorld()->getDispatchInfo(), _scene->GetPhysicsWorld()->getDispatcher());
@@ -131,8 +132,8 @@ namespace Gameplay::Physics {
 			}
 		}
 
-		// Load the contents of the current collision items into the cache
-		_currentCollisions.swap(thisFrameCollision);
+		// Load the contents of the current collision items into the cache, re-using it's storage
+		_currentCollisions.assign(thisFrameCollision.begin(), thisFrameCollision.end());
 	}
 
 	void TriggerVolume::Awake() {
@@ -157,6 +158,8 @@ namespace Gameplay::Physics {
 		_ghost = new btPairCachingGhostObject();
 		_ghost->setCollisionShape(_shape);
 		_ghost->setUserPointer(&SelfRef());
+		_ghost->setUserIndex(static_cast<int>(context->GetHandle().Index));
+		_ghost->setUserIndex2(static_cast<int>(context->GetHandle().Generation));
 		_ghost->setCollisionFlags(_ghost->getCollisionFlags() | btCollisionObject::CF_NO_CONTACT_RESPONSE);
 
 		// Get the transform and send it to the ghost
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <locale>
 #include <codecvt>
+#include <cstring>
 
 #include "Utils/FileHelpers.h"
 #include "Utils/GlmBulletConversions.h"
@@ -11,16 +12,30 @@
 #include "Gameplay/Physics/TriggerVolume.h"
 #include "Gameplay/MeshResource.h"
 #include "Gameplay/Material.h"
+#include "Gameplay/Components/RenderComponent.h"
 
 #include "Graphics/DebugDraw.h"
 #include "Graphics/Textures/TextureCube.h"
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/GeometryArena.h"
 #include "Application/Application.h"
+#include "Utils/Profiler.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/FrameArena.h"
 
 namespace Gameplay {
 	Scene::Scene() :
 		_objects(std::vector<GameObject::Sptr>()),
-		_deletionQueue(std::vector<std::weak_ptr<GameObject>>()),
+		_objectSlots(std::vector<uint32_t>()),
+		_slots(std::vector<ObjectSlot>()),
+		_freeSlots(std::vector<uint32_t>()),
+		_guidLookup(std::unordered_map<Guid, uint32_t>()),
+		_nameLookup(std::unordered_multimap<std::string, uint32_t>()),
+		_deletionQueue(std::vector<GameObjectHandle>()),
+		_spatialIndex(SpatialIndex::Create()),
+		_spatialDirtyMutex(),
+		_spatialDirty(std::vector<GameObjectHandle>()),
+		_spatialFlushing(std::vector<GameObjectHandle>()),
 		Lights(std::vector<Light>()),
 		IsPlaying(false),
 		MainCamera(nullptr),
@@ -31,13 +46,22 @@ namespace Gameplay {
 		_skyboxMesh(nullptr),
 		_skyboxTexture(nullptr),
 		_skyboxRotation(glm::mat3(1.0f)),
-		_gravity(glm::vec3(0.0f, 0.0f, -9.81f))
+		_gravity(glm::vec3(0.0f, 0.0f, -9.81f)),
+		_numGpuLights(0),
+		_staticGeometryVersion(0)
 	{
 		_lightingUbo = std::make_shared<UniformBuffer<LightingUboStruct>>();
 		_lightingUbo->GetData().AmbientCol = glm::vec3(0.1f);
+		_lightingUbo->GetData().SunDirection = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+		_lightingUbo->GetData().SunColor = glm::vec4(0.0f);
 		_lightingUbo->Update();
 		_lightingUbo->Bind(LIGHT_UBO_BINDING_SLOT);
 
+		// Start with a single empty light so the buffer is never zero sized
+		_lightData.resize(1, { glm::vec4(0.0f), glm::vec4(0.0f) });
+		_lightBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+		_lightBuffer->LoadData(_lightData.data(), sizeof(LightData), 1);
+
 		GameObject::Sptr mainCam = CreateGameObject("Main Camera");		
 		MainCamera = mainCam->Add<Camera>();
 
@@ -51,7 +75,7 @@ namespace Gameplay {
 		_skyboxShader = nullptr;
 		_skyboxMesh = nullptr;
 		_skyboxTexture = nullptr;
-		_objects.clear();
+		_ClearObjects();
 		Lights.clear();
 		_CleanupPhysics();
 	}
@@ -104,26 +128,62 @@ namespace Gameplay {
 		result->Name = name;
 		result->_scene = this;
 		result->_selfRef = result;
-		_objects.push_back(result);
+		_AddObject(result);
 		return result;
 	}
 
 	void Scene::RemoveGameObject(const GameObject::Sptr& object) {
-		_deletionQueue.push_back(object);
+		if (object == nullptr || object->_scene != this) {
+			return;
+		}
+		RemoveGameObject(object->_handle);
+	}
+
+	void Scene::RemoveGameObject(GameObjectHandle handle) {
+		if (!IsHandleValid(handle)) {
+			return;
+		}
+		if (_objects[_slots[handle.Index].DenseIndex]->IsStatic) {
+			MarkStaticGeometryDirty();
+		}
+		_deletionQueue.push_back(handle);
 	}
 
 	GameObject::Sptr Scene::FindObjectByName(const std::string name) const {
-		auto it = std::find_if(_objects.begin(), _objects.end(), [&](const GameObject::Sptr& obj) {
-			return obj->Name == name;
-		});
-		return it == _objects.end() ? nullptr : *it;
+		// Names can change without going through SetName, so double check the match and drop entries that are out of date
+		auto range = _nameLookup.equal_range(name);
+		for (auto it = range.first; it != range.second;) {
+			const GameObject::Sptr& obj = _objects[_slots[it->second].DenseIndex];
+			if (obj->Name == name) {
+				return obj;
+			}
+			it = _nameLookup.erase(it);
+		}
+
+		// The object may have been renamed by writing to Name directly, so fall back to searching every object,
+		// and add it to the lookup so the next search is fast again
+		for (size_t ix = 0; ix < _objects.size(); ix++) {
+			if (_objects[ix]->Name == name) {
+				_nameLookup.emplace(name, _objectSlots[ix]);
+				return _objects[ix];
+			}
+		}
+		return nullptr;
 	}
 
 	GameObject::Sptr Scene::FindObjectByGUID(Guid id) const {
-		auto it = std::find_if(_objects.begin(), _objects.end(), [&](const GameObject::Sptr& obj) {
-			return obj->_guid == id;
-		});
-		return it == _objects.end() ? nullptr : *it;
+		auto it = _guidLookup.find(id);
+		return it == _guidLookup.end() ? nullptr : _objects[_slots[it->second].DenseIndex];
+	}
+
+	GameObject::Sptr Scene::GetObjectByHandle(GameObjectHandle handle) const {
+		return IsHandleValid(handle) ? _objects[_slots[handle.Index].DenseIndex] : nullptr;
+	}
+
+	bool Scene::IsHandleValid(GameObjectHandle handle) const {
+		return handle.Index < _slots.size() &&
+			_slots[handle.Index].Generation == handle.Generation &&
+			_slots[handle.Index].DenseIndex != UINT32_MAX;
 	}
 
 	void Scene::SetAmbientLight(const glm::vec3& value) {
@@ -135,6 +195,25 @@ namespace Gameplay {
 		return _lightingUbo->GetData().AmbientCol;
 	}
 
+	void Scene::SetSunDirection(const glm::vec3& value) {
+		float length = glm::length(value);
+		_lightingUbo->GetData().SunDirection = glm::vec4(length > 0.0f ? value / length : glm::vec3(0.0f, 0.0f, -1.0f), 0.0f);
+		_lightingUbo->Update();
+	}
+
+	glm::vec3 Scene::GetSunDirection() const {
+		return glm::vec3(_lightingUbo->GetData().SunDirection);
+	}
+
+	void Scene::SetSunColor(const glm::vec3& value) {
+		_lightingUbo->GetData().SunColor = glm::vec4(value, 0.0f);
+		_lightingUbo->Update();
+	}
+
+	glm::vec3 Scene::GetSunColor() const {
+		return glm::vec3(_lightingUbo->GetData().SunColor);
+	}
+
 	void Scene::Awake() {
 		// Not a huge fan of this, but we need to get window size to notify our camera
 		// of the current screen size
@@ -151,9 +230,9 @@ namespace Gameplay {
 			_skyboxMesh->GenerateMesh();
 		}
 
-		// Call awake on all gameobjects
-		for (auto& obj : _objects) {
-			obj->Awake();
+		// Call awake on all gameobjects, by index since awake may spawn more objects
+		for (size_t ix = 0; ix < _objects.size(); ix++) {
+			_objects[ix]->Awake();
 		}
 		// Set up our lighting 
 		SetupShaderAndLights();
@@ -162,6 +241,9 @@ namespace Gameplay {
 	}
 
 	void Scene::DoPhysics(float dt) {
+		PROFILE_SCOPE("Physics");
+		MEMORY_SCOPE(Physics);
+
 		_components.Each<Gameplay::Physics::RigidBody>([=](const std::shared_ptr<Gameplay::Physics::RigidBody>& body) {
 			body->PhysicsPreStep(dt);
 		});
@@ -180,6 +262,15 @@ namespace Gameplay {
 				body->PhysicsPostStep(dt);
 			});
 		}
+
+		// Bodies have moved their objects, so make sure queries see where they ended up
+		_FlushSpatialIndex();
+
+		// The broadphase bounds are only refreshed when stepping, so catch up on anything moved in the editor
+		if (!IsPlaying && _physicsQueries->HasPending()) {
+			_physicsWorld->updateAabbs();
+		}
+		_physicsQueries->Execute(static_cast<btDbvtBroadphase*>(_broadphaseInterface));
 	}
 
 	void Scene::DrawPhysicsDebug() {
@@ -191,41 +282,87 @@ namespace Gameplay {
 
 	void Scene::Update(float dt) {
 		_FlushDeleteQueue();
+		_FlushSpatialIndex();
 		if (IsPlaying) {
-			for (auto& obj : _objects) {
-				obj->Update(dt);
+			// Objects spawned during the update are added to the end and updated this frame, removals
+			// are queued so nothing moves under us
+			for (size_t ix = 0; ix < _objects.size(); ix++) {
+				_objects[ix]->Update(dt);
 			}
 		}
 		_FlushDeleteQueue();
 	}
 
 	void Scene::PreRender() {
+		FlushLightUpdates();
+
 		_lightingUbo->Bind(LIGHT_UBO_BINDING);
+		_lightBuffer->Bind(LIGHT_SSBO_BINDING);
 	}
 
 	void Scene::RenderGUI()
 	{
 		for (auto& obj : _objects) {
 			// Parents handle rendering for children, so ignore parented objects
-			if (obj->GetParent() == nullptr) {
+			if (!obj->HasParent()) {
 				obj->RenderGUI();
 			}
 		}
 	}
 
-	void Scene::SetShaderLight(int index, bool update /*= true*/) {
-		if (index >= 0 && index < Lights.size() && index < MAX_LIGHTS) {
-			// Get a reference to the light UBO data so we can update it
-			LightingUboStruct& data = _lightingUbo->GetData();
-			Light& light = Lights[index];
+	float Scene::CalcLightRadius(const Light& light) {
+		// Shaders use 1 / (1 + k * d^2) for attenuation, which never reaches zero. We cut the light
+		// off where it would drop below 1/256 of it's brightest channel, so the light grid can
+		// cull it by radius without a visible edge
+		float attenuation = 1.0f / (1.0f + light.Range);
+		float brightest = glm::max(light.Color.r, glm::max(light.Color.g, light.Color.b));
+		return glm::sqrt(glm::max(256.0f * brightest - 1.0f, 0.0f) / attenuation);
+	}
+
+	Scene::LightData Scene::_PackLight(const Light& light) {
+		LightData result;
+		result.PositionRadius = glm::vec4(light.Position, CalcLightRadius(light));
+		result.ColorAttenuation = glm::vec4(light.Color, 1.0f / (1.0f + light.Range));
+		return result;
+	}
+
+	void Scene::SetShaderLight(int index) {
+		if (index >= 0 && index < Lights.size() && index < _lightData.size()) {
+			_lightData[index] = _PackLight(Lights[index]);
+			_lightDirtyBits[index] = true;
+		}
+	}
+
+	void Scene::FlushLightUpdates() {
+		// If lights were added or removed, the buffer needs to be resized so everything goes up at once
+		if (Lights.size() != _numGpuLights) {
+			SetupShaderAndLights();
+			return;
+		}
 
-			// Copy to the ubo data
-			data.Lights[index].Position = light.Position;
-			data.Lights[index].Color = light.Color;
-			data.Lights[index].Attenuation = 1.0f / (1.0f + light.Range);
+		// Gameplay code edits Lights directly, so we compare dynamic lights against what we last sent
+		for (int ix = 0; ix < Lights.size(); ix++) {
+			if (!Lights[ix].IsStatic) {
+				LightData packed = _PackLight(Lights[ix]);
+				if (memcmp(&packed, &_lightData[ix], sizeof(LightData)) != 0) {
+					_lightData[ix] = packed;
+					_lightDirtyBits[ix] = true;
+				}
+			}
+		}
 
-			// If requested, send the new data to the UBO
-			if (update)	_lightingUbo->Update();
+		// Coalesce everything that changed into a single ranged upload
+		int first = -1;
+		int last = -1;
+		for (int ix = 0; ix < _lightDirtyBits.size(); ix++) {
+			if (_lightDirtyBits[ix]) {
+				if (first == -1) first = ix;
+				last = ix;
+				_lightDirtyBits[ix] = false;
+			}
+		}
+		if (first != -1) {
+			_lightBuffer->UpdateSubData(&_lightData[first], first * sizeof(LightData), (last - first + 1) * sizeof(LightData));
 		}
 	}
 
@@ -236,13 +373,22 @@ namespace Gameplay {
 		data.AmbientCol = glm::vec3(0.1f);
 		data.NumLights = static_cast<float>(Lights.size());
 
-		// Iterate over all lights that are enabled and configure them
+		// The buffer always needs at least one element, even if we have no lights
+		_lightData.resize(glm::max(Lights.size(), (size_t)1), { glm::vec4(0.0f), glm::vec4(0.0f) });
 		for (int ix = 0; ix < Lights.size(); ix++) {
-			SetShaderLight(ix, false);
+			_lightData[ix] = _PackLight(Lights[ix]);
 		}
+		// Everything goes up in one go below, so nothing is left dirty
+		_lightDirtyBits.assign(_lightData.size(), false);
+		_numGpuLights = static_cast<uint32_t>(Lights.size());
 
 		// Send updated data to OpenGL
 		_lightingUbo->Update();
+		_lightBuffer->UpdateData(_lightData.data(), sizeof(LightData), (uint32_t)_lightData.size(), true);
+	}
+
+	uint32_t Scene::GetNumGpuLights() const {
+		return _numGpuLights;
 	}
 
 	btDynamicsWorld* Scene::GetPhysicsWorld() const {
@@ -254,12 +400,15 @@ namespace Gameplay {
 
 		Scene::Sptr result = std::make_shared<Scene>();
 		result->MainCamera = nullptr;
-		result->_objects.clear();
+		result->_ClearObjects();
 		result->DefaultMaterial = ResourceManager::Get<Material>(Guid(data["default_material"]));
 
 		if (data.contains("ambient")) {
 			result->SetAmbientLight((data["ambient"]));
 		}
+		result->SetSunDirection(JsonGet(data, "sun_direction", glm::vec3(0.0f, 0.0f, -1.0f)));
+		result->SetSunColor(JsonGet(data, "sun_color", glm::vec3(0.0f)));
+		result->_spatialIndex->SetCellSize(JsonGet(data, "spatial_cell_size", SpatialIndex::DEFAULT_CELL_SIZE));
 
 		if (data.contains("skybox") && data["skybox"].is_object()) {
 			nlohmann::json& blob = data["skybox"].get<nlohmann::json>();
@@ -274,15 +423,20 @@ namespace Gameplay {
 		for (auto& object : data["objects"]) {
 			GameObject::Sptr obj = GameObject::FromJson(result.get(), object);
 			obj->_scene = result.get();
-			obj->_parent.SceneContext = result.get();
 			obj->_selfRef = obj;
-			result->_objects.push_back(obj);
+			result->_AddObject(obj);
 		}
 
-		// Re-build the parent hierarchy 
-		for (const auto& object : result->_objects) {
-			if (object->GetParent() != nullptr) {
-				object->GetParent()->AddChild(object);
+		// Re-build the parent hierarchy now that every object can be looked up, in file order so children
+		// keep their order
+		for (auto& object : data["objects"]) {
+			std::string parentGuid = JsonGet<std::string>(object, "parent", "null");
+			if (parentGuid != "null") {
+				GameObject::Sptr parent = result->FindObjectByGUID(Guid(parentGuid));
+				GameObject::Sptr child = result->FindObjectByGUID(Guid(object["guid"]));
+				if (parent != nullptr && child != nullptr) {
+					parent->AddChild(child);
+				}
 			}
 		}
 
@@ -305,6 +459,9 @@ namespace Gameplay {
 		blob["default_material"] = DefaultMaterial ? DefaultMaterial->GetGUID().str() : "null";
 
 		blob["ambient"] = GetAmbientLight();
+		blob["sun_direction"] = GetSunDirection();
+		blob["sun_color"] = GetSunColor();
+		blob["spatial_cell_size"] = _spatialIndex->GetCellSize();
 
 		blob["skybox"] = nlohmann::json();
 		blob["skybox"]["mesh"] = _skyboxMesh ? _skyboxMesh->GetGUID().str() : "null";
@@ -343,6 +500,7 @@ namespace Gameplay {
 
 	Scene::Sptr Scene::Load(const std::string& path)
 	{
+		MEMORY_SCOPE(Scene);
 		LOG_INFO("Loading scene from \"{}\"", path);
 		std::string content = FileHelpers::ReadFile(path);
 		nlohmann::json blob = nlohmann::json::parse(content);
@@ -377,9 +535,12 @@ namespace Gameplay {
 		_bulletDebugDraw = new BulletDebugDraw();
 		_physicsWorld->setDebugDrawer(_bulletDebugDraw);
 		_bulletDebugDraw->setDebugMode(btIDebugDraw::DBG_NoDebug);
+		_physicsQueries = Physics::PhysicsQueryService::Create();
 	}
 
 	void Scene::_CleanupPhysics() {
+		// Stops the query workers before the world they read from goes away
+		_physicsQueries = nullptr;
 		delete _physicsWorld;
 		delete _constraintSolver;
 		delete _broadphaseInterface;
@@ -390,14 +551,204 @@ namespace Gameplay {
 
 
 	void Scene::_FlushDeleteQueue() {
-		for (auto& weakPtr : _deletionQueue) {
-			if (weakPtr.expired()) continue;
-			auto& it = std::find(_objects.begin(), _objects.end(), weakPtr.lock());
-			if (it != _objects.end()) {
-				_objects.erase(it);
+		// Handles that were queued twice are already stale by the second time, so they are skipped
+		for (GameObjectHandle handle : _deletionQueue) {
+			_RemoveObject(handle);
+		}
+		_deletionQueue.clear();
+	}
+
+	// Removes a slot's entry from the name lookup. Names can be changed directly instead of through SetName, so if
+	// the entry isn't under the expected name we have to hunt for it
+	static void EraseNameEntry(std::unordered_multimap<std::string, uint32_t>& lookup, const std::string& name, uint32_t slotIx) {
+		auto range = lookup.equal_range(name);
+		for (auto it = range.first; it != range.second; it++) {
+			if (it->second == slotIx) {
+				lookup.erase(it);
+				return;
+			}
+		}
+		for (auto it = lookup.begin(); it != lookup.end(); it++) {
+			if (it->second == slotIx) {
+				lookup.erase(it);
+				return;
 			}
 		}
+	}
+
+	void Scene::_AddObject(const GameObject::Sptr& object) {
+		uint32_t slotIx;
+		if (!_freeSlots.empty()) {
+			slotIx = _freeSlots.back();
+			_freeSlots.pop_back();
+		} else {
+			slotIx = static_cast<uint32_t>(_slots.size());
+			_slots.push_back({ 0, UINT32_MAX });
+		}
+
+		ObjectSlot& slot = _slots[slotIx];
+		slot.DenseIndex = static_cast<uint32_t>(_objects.size());
+		_objects.push_back(object);
+		_objectSlots.push_back(slotIx);
+
+		object->_handle = { slotIx, slot.Generation };
+		_guidLookup[object->_guid] = slotIx;
+		_nameLookup.emplace(object->Name, slotIx);
+		object->_MarkSpatialDirty();
+	}
+
+	bool Scene::_RemoveObject(GameObjectHandle handle) {
+		if (!IsHandleValid(handle)) {
+			return false;
+		}
+
+		ObjectSlot& slot = _slots[handle.Index];
+		uint32_t denseIx = slot.DenseIndex;
+		GameObject::Sptr object = _objects[denseIx];
+
+		// Orphan our children and leave our parent, so nothing points at us once we're gone
+		while (object->_firstChild != nullptr) {
+			object->_firstChild->_UnlinkFromParent();
+		}
+		object->_UnlinkFromParent();
+
+		auto guidIt = _guidLookup.find(object->_guid);
+		if (guidIt != _guidLookup.end() && guidIt->second == handle.Index) {
+			_guidLookup.erase(guidIt);
+		}
+
+		EraseNameEntry(_nameLookup, object->Name, handle.Index);
+
+		// Swap the last object into our place
+		uint32_t lastIx = static_cast<uint32_t>(_objects.size() - 1);
+		if (denseIx != lastIx) {
+			_objects[denseIx] = std::move(_objects[lastIx]);
+			_objectSlots[denseIx] = _objectSlots[lastIx];
+			_slots[_objectSlots[denseIx]].DenseIndex = denseIx;
+		}
+		_objects.pop_back();
+		_objectSlots.pop_back();
+		_spatialIndex->Remove(handle);
+
+		slot.Generation++;
+		slot.DenseIndex = UINT32_MAX;
+		_freeSlots.push_back(handle.Index);
+
+		object->_handle = GameObjectHandle();
+		return true;
+	}
+
+	void Scene::_ClearObjects() {
+		// Other systems may still hold references, so make sure none of them point into the hierarchy
+		for (const GameObject::Sptr& object : _objects) {
+			object->_parent = nullptr;
+			object->_firstChild = nullptr;
+			object->_lastChild = nullptr;
+			object->_prevSibling = nullptr;
+			object->_nextSibling = nullptr;
+			object->_handle = GameObjectHandle();
+		}
+		_objects.clear();
+		_objectSlots.clear();
+		_slots.clear();
+		_freeSlots.clear();
+		_guidLookup.clear();
+		_nameLookup.clear();
 		_deletionQueue.clear();
+		_spatialIndex->Clear();
+		std::lock_guard<std::mutex> lock(_spatialDirtyMutex);
+		_spatialDirty.clear();
+	}
+
+	// Gets the world space bounding sphere of an object, using it's mesh if it has one
+	static SpatialIndex::Item CalcSpatialItem(GameObject* object) {
+		const glm::mat4& transform = object->GetTransform();
+
+		SpatialIndex::Item result;
+		result.Handle = object->GetHandle();
+		result.Center = glm::vec3(transform[3]);
+		result.Radius = 0.0f;
+
+		RenderComponent::Sptr renderer = object->Get<RenderComponent>();
+		VertexArrayObject::Sptr mesh = renderer != nullptr ? renderer->GetMesh() : nullptr;
+		if (mesh != nullptr && mesh->GetArenaAllocation() != nullptr) {
+			const glm::vec4& sphere = mesh->GetArenaAllocation()->BoundingSphere;
+			float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+			result.Center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+			result.Radius = sphere.w * scale;
+		}
+		return result;
+	}
+
+	// Adds the bounds of an object and all it's children to the list, since moving a parent moves the children too
+	static void GatherSpatialItems(GameObject* object, FrameVector<SpatialIndex::Item>& items) {
+		items.push_back(CalcSpatialItem(object));
+		for (GameObject* child = object->GetFirstChild(); child != nullptr; child = child->GetNextSibling()) {
+			GatherSpatialItems(child, items);
+		}
+	}
+
+	void Scene::_FlushSpatialIndex() {
+		{
+			std::lock_guard<std::mutex> lock(_spatialDirtyMutex);
+			if (_spatialDirty.empty()) {
+				return;
+			}
+		}
+		PROFILE_SCOPE("Spatial Index");
+
+		// Other threads may queue objects while we work, so we take the queue under the lock. Calculating transforms
+		// can also queue objects that had their dirty flag set directly, so we keep taking until it's empty
+		FrameVector<SpatialIndex::Item> items;
+		FrameVector<GameObject*> roots;
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(_spatialDirtyMutex);
+				if (_spatialDirty.empty()) {
+					break;
+				}
+				_spatialFlushing.swap(_spatialDirty);
+			}
+
+			// Objects whose parents are also dirty get picked up along with their parent
+			roots.clear();
+			for (GameObjectHandle handle : _spatialFlushing) {
+				if (!IsHandleValid(handle)) {
+					continue;
+				}
+				GameObject* object = _objects[_slots[handle.Index].DenseIndex].get();
+				bool hasDirtyAncestor = false;
+				for (GameObject* parent = object->_parent; parent != nullptr; parent = parent->_parent) {
+					hasDirtyAncestor |= parent->_isSpatialDirty.load(std::memory_order_acquire);
+				}
+				if (!hasDirtyAncestor) {
+					roots.push_back(object);
+				}
+			}
+
+			// Clear the flags before reading any bounds, so a change made while we gather queues the object again
+			for (GameObjectHandle handle : _spatialFlushing) {
+				if (IsHandleValid(handle)) {
+					_objects[_slots[handle.Index].DenseIndex]->_isSpatialDirty.store(false, std::memory_order_release);
+				}
+			}
+			_spatialFlushing.clear();
+
+			for (GameObject* object : roots) {
+				GatherSpatialItems(object, items);
+			}
+		}
+
+		_spatialIndex->Update(items.data(), items.size());
+	}
+
+	void Scene::_OnObjectRenamed(GameObject* object, const std::string& oldName) {
+		uint32_t slotIx = object->_handle.Index;
+		if (!IsHandleValid(object->_handle)) {
+			return;
+		}
+		EraseNameEntry(_nameLookup, oldName, slotIx);
+		_nameLookup.emplace(object->Name, slotIx);
 	}
 
 	void Scene::DrawAllGameObjectGUIs()
@@ -417,7 +768,10 @@ namespace Gameplay {
 
 	void Scene::DrawSkybox()
 	{
-		if (_skyboxShader != nullptr &&
+		// The skybox uses color correction, so it needs the variant for the current global defines
+		ShaderProgram::Sptr skyboxShader = _skyboxShader != nullptr ? _skyboxShader->GetVariant() : nullptr;
+		if (skyboxShader != nullptr &&
+			skyboxShader->IsReady() &&
 			_skyboxMesh != nullptr &&
 			_skyboxMesh->Mesh != nullptr &&
 			_skyboxTexture != nullptr &&
@@ -427,9 +781,9 @@ namespace Gameplay {
 			glDisable(GL_CULL_FACE);
 			glDepthFunc(GL_LEQUAL); 
 
-			_skyboxShader->Bind();
-			_skyboxShader->SetUniformMatrix("u_ClippedView", MainCamera->GetProjection() * glm::mat4(glm::mat3(MainCamera->GetView())));
-			_skyboxShader->SetUniformMatrix("u_EnvironmentRotation", _skyboxRotation);
+			skyboxShader->Bind();
+			skyboxShader->SetUniformMatrix("u_ClippedView", MainCamera->GetProjection() * glm::mat4(glm::mat3(MainCamera->GetView())));
+			skyboxShader->SetUniformMatrix("u_EnvironmentRotation", _skyboxRotation);
 			_skyboxTexture->Bind(0);
 			_skyboxMesh->Mesh->Draw();
 
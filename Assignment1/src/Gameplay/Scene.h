@@ -1,14 +1,19 @@
 #pragma once
+#include <unordered_map>
+#include <mutex>
 #include <btBulletDynamicsCommon.h>
 #include "BulletCollision/CollisionDispatch/btGhostObject.h"
 
 #include "Gameplay/Components/Camera.h"
 #include "Gameplay/GameObject.h"
 #include "Gameplay/Light.h"
+#include "Gameplay/SpatialIndex.h"
+#include "Gameplay/Physics/PhysicsQueries.h"
 
 #include "Physics/BulletDebugDraw.h"
 
 #include "Graphics/Buffers/UniformBuffer.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
 #include "Graphics/Textures/Texture3D.h"
 
 struct GLFWwindow;
@@ -38,8 +43,9 @@ namespace Gameplay {
 	public:
 		typedef std::shared_ptr<Scene> Sptr;
 
-		static const int MAX_LIGHTS = 8;
 		static const int LIGHT_UBO_BINDING = 2;
+		// The light list is stored in an SSBO so we can have as many lights as we like
+		static const int LIGHT_SSBO_BINDING = 4;
 
 		// Stores all the lights in our scene
 		std::vector<Light>         Lights;
@@ -85,26 +91,40 @@ namespace Gameplay {
 		GameObject::Sptr CreateGameObject(const std::string& name);
 
 		/// <summary>
-		/// Queues a game object for deletion at the call of the next Update function
+		/// Queues a game object for deletion at the call of the next Update function. Any children
+		/// of the object are kept, and become root objects
 		/// </summary>
-		/// <param name="object">The gameobject to delete</param>
+		/// <param name="object">The gameobject to delete, does nothing if it is null or not in this scene</param>
 		void RemoveGameObject(const GameObject::Sptr& object);
+		/// <summary>
+		/// Queues the game object with the given handle for deletion at the call of the next Update function
+		/// </summary>
+		/// <param name="handle">The handle of the gameobject to delete, stale handles are ignored</param>
+		void RemoveGameObject(GameObjectHandle handle);
 
 		/// <summary>
-		/// Searches all objects in the scene and returns the first
-		/// one who's name matches the one given, or nullptr if no object
-		/// is found
+		/// Returns an object in the scene who's name matches the one given,
+		/// or nullptr if no object is found
 		/// </summary>
 		/// <param name="name">The name of the object to find</param>
 		GameObject::Sptr FindObjectByName(const std::string name) const;
 		/// <summary>
-		/// Searches all render objects in the scene and returns the first
-		/// one who's guid matches the one given, or nullptr if no object
-		/// is found
+		/// Returns the object in the scene who's guid matches the one given,
+		/// or nullptr if no object is found
 		/// </summary>
 		/// <param name="id">The guid of the object to find</param>
 		GameObject::Sptr FindObjectByGUID(Guid id) const;
 
+		/// <summary>
+		/// Gets the object that the given handle refers to, or nullptr if the handle is stale
+		/// </summary>
+		/// <param name="handle">The handle to resolve</param>
+		GameObject::Sptr GetObjectByHandle(GameObjectHandle handle) const;
+		/// <summary>
+		/// Returns true if the given handle refers to an object that is still in this scene
+		/// </summary>
+		bool IsHandleValid(GameObjectHandle handle) const;
+
 		/// <summary>
 		/// Sets the ambient light color for this scene
 		/// </summary>
@@ -115,6 +135,45 @@ namespace Gameplay {
 		/// </summary>
 		const glm::vec3& GetAmbientLight() const;
 
+		/// <summary>
+		/// Sets the direction that the scene's directional light (the sun) is shining in
+		/// </summary>
+		/// <param name="value">The direction in world space, does not need to be normalized</param>
+		void SetSunDirection(const glm::vec3& value);
+		/// <summary>
+		/// Gets the normalized direction that the sun is shining in
+		/// </summary>
+		glm::vec3 GetSunDirection() const;
+		/// <summary>
+		/// Sets the color of the sun, black disables the sun entirely
+		/// </summary>
+		void SetSunColor(const glm::vec3& value);
+		glm::vec3 GetSunColor() const;
+
+		/// <summary>
+		/// Gets a counter that increases whenever static geometry in the scene is moved, added or
+		/// removed. Systems that cache data built from static objects (ex: shadow maps) can compare
+		/// against this to know when to rebuild
+		/// </summary>
+		uint32_t GetStaticGeometryVersion() const { return _staticGeometryVersion; }
+		/// <summary>
+		/// Notifies the scene that some static geometry has changed
+		/// </summary>
+		void MarkStaticGeometryDirty() { _staticGeometryVersion++; }
+
+		/// <summary>
+		/// Gets the index of object bounds in this scene, for proximity, ray and nearest neighbour queries.
+		/// Objects are re-indexed when their transforms change, at the start of Update and after physics,
+		/// and the queries can be made from any thread
+		/// </summary>
+		const SpatialIndex::Sptr& GetSpatialIndex() const { return _spatialIndex; }
+
+		/// <summary>
+		/// Gets the service for raycasts, sweeps and overlap tests against the physics world. Queries can be
+		/// submitted from any thread, and are run together at the end of DoPhysics
+		/// </summary>
+		const Physics::PhysicsQueryService::Sptr& GetPhysicsQueries() const { return _physicsQueries; }
+
 		/// <summary>
 		/// Gets the file path that this scene was saved to or loaded from
 		/// </summary>
@@ -159,17 +218,28 @@ namespace Gameplay {
 		void RenderGUI();
 
 		/// <summary>
-		/// Handles setting the shader uniforms for our light structure in our array of lights
+		/// Copies the light at the given index into our light buffer data and marks it as dirty,
+		/// it will be sent to the GPU with the next FlushLightUpdates. Use this to re-send static lights
 		/// </summary>
-		/// <param name="shader">The pointer to the shader</param>
-		/// <param name="uniformName">The name of the uniform (ex: u_Lights)</param>
 		/// <param name="index">The index of the light to set</param>
-		/// <param name="light">The light data to copy over</param>
-		void SetShaderLight(int index, bool update = true);
+		void SetShaderLight(int index);
+		/// <summary>
+		/// Picks up any changes to dynamic lights, and sends all dirty lights to the GPU in
+		/// a single ranged upload. Called once per frame from PreRender
+		/// </summary>
+		void FlushLightUpdates();
 		/// <summary>
 		/// Creates the shader and sets up all the lights
 		/// </summary>
 		void SetupShaderAndLights();
+		/// <summary>
+		/// Gets the number of lights that have been uploaded to the light buffer
+		/// </summary>
+		uint32_t GetNumGpuLights() const;
+		/// <summary>
+		/// Gets the distance past which the given light no longer has any visible effect
+		/// </summary>
+		static float CalcLightRadius(const Light& light);
 
 		/// <summary>
 		/// Draws ImGui stuff for all gameobjects in the scene
@@ -230,6 +300,8 @@ namespace Gameplay {
 		btConstraintSolver*       _constraintSolver;
 		// this is what allows us to get our pairs from the trigger volumes
 		btGhostPairCallback*      _ghostCallback;
+		// Runs batched queries against the broadphase after each step
+		Physics::PhysicsQueryService::Sptr _physicsQueries;
 
 		BulletDebugDraw* _bulletDebugDraw;
 
@@ -239,9 +311,38 @@ namespace Gameplay {
 		// Our physics scene's global gravity, default matches earth's gravity (m/s^2)
 		glm::vec3 _gravity;
 
-		// Stores all the objects in our scene
+		/// <summary>
+		/// An entry in the handle table, maps a GameObjectHandle's index to the object's position in _objects
+		/// </summary>
+		struct ObjectSlot {
+			// Bumped whenever the slot's object is removed, so old handles stop matching
+			uint32_t Generation;
+			// The object's index in _objects, or UINT32_MAX if the slot is free
+			uint32_t DenseIndex;
+		};
+
+		// Stores all the objects in our scene, tightly packed. Removing an object moves the last one into
+		// it's place, so the order is not stable
 		std::vector<GameObject::Sptr>  _objects;
-		std::vector<std::weak_ptr<GameObject>>  _deletionQueue;
+		// The slot index of each object in _objects
+		std::vector<uint32_t>          _objectSlots;
+		// The handle table, and a list of slots that can be re-used
+		std::vector<ObjectSlot>        _slots;
+		std::vector<uint32_t>          _freeSlots;
+		// Lookups from GUIDs and names to slot indices. The name lookup is repaired by FindObjectByName when
+		// it finds an object that was renamed without SetName, hence mutable
+		std::unordered_map<Guid, uint32_t>             _guidLookup;
+		mutable std::unordered_multimap<std::string, uint32_t> _nameLookup;
+		// Objects waiting to be removed at the next flush
+		std::vector<GameObjectHandle>  _deletionQueue;
+
+		// Bounds of all our objects, and the objects that have moved since it was last updated. Objects can be
+		// queued from any thread (see GameObject::_MarkSpatialDirty), but the index is only updated on the main thread
+		SpatialIndex::Sptr             _spatialIndex;
+		std::mutex                     _spatialDirtyMutex;
+		std::vector<GameObjectHandle>  _spatialDirty;
+		// The queue being flushed, kept around so it's memory is re-used
+		std::vector<GameObjectHandle>  _spatialFlushing;
 
 		// Info for rendering our skybox will be stored in the scene itself
 		std::shared_ptr<ShaderProgram>       _skyboxShader;
@@ -260,29 +361,42 @@ namespace Gameplay {
 		/// thing for packing structures to sizeof(vec4)
 		/// </summary>
 		struct LightingUboStruct {
-			struct Light {
-				// This lets us continue to access Position as a vec3, but also allocates space for the
-				// pack at the end (since objects are vec4 aligned)
-				union {
-					glm::vec3 Position;
-					glm::vec4 Position4;
-				};
-				// Since these are tightly packed, will match the vec4 in light
-				glm::vec3 Color;
-				float     Attenuation;
-			};
-
 			// Since these are tightly packed, will match the vec4 in the UBO
 			glm::vec3 AmbientCol;
 			float     NumLights;
+			// Direction in xyz
+			glm::vec4 SunDirection;
+			// Color in rgb, alpha is unused
+			glm::vec4 SunColor;
 
-			Light     Lights[MAX_LIGHTS];
 			// NOTE: our shaders expect a mat3, but due to the STD140 layout, each column of the
 			// vec3 needs to be padded to the size of a vec4, hence the use of a mat4 here
 			glm::mat4 EnvironmentRotation;
 		};
 		UniformBuffer<LightingUboStruct>::Sptr _lightingUbo;
 
+		/// <summary>
+		/// Matches the Light struct in light_clusters.glsl, using the std430 layout
+		/// </summary>
+		struct LightData {
+			// Position in xyz, the radius past which the light has no effect in w
+			glm::vec4 PositionRadius;
+			// Color in rgb, attenuation in w
+			glm::vec4 ColorAttenuation;
+		};
+		std::vector<LightData>     _lightData;
+		// One bit per light, set when it's data has changed since the last upload
+		std::vector<bool>          _lightDirtyBits;
+		// The number of lights the buffer was last sized for
+		uint32_t                   _numGpuLights;
+		uint32_t                   _staticGeometryVersion;
+		ShaderStorageBuffer::Sptr  _lightBuffer;
+
+		/// <summary>
+		/// Converts a light into the layout our shaders expect
+		/// </summary>
+		static LightData _PackLight(const Light& light);
+
 		bool                       _isAwake;
 
 		/// <summary>
@@ -295,5 +409,27 @@ namespace Gameplay {
 		void _CleanupPhysics();
 
 		void _FlushDeleteQueue();
+
+		/// <summary>
+		/// Adds an object to the pool and the lookups, and assigns it's handle
+		/// </summary>
+		void _AddObject(const GameObject::Sptr& object);
+		/// <summary>
+		/// Removes an object from the pool and the lookups, unlinking it from the hierarchy
+		/// </summary>
+		/// <returns>True if the handle was valid</returns>
+		bool _RemoveObject(GameObjectHandle handle);
+		/// <summary>
+		/// Removes all objects from the scene at once
+		/// </summary>
+		void _ClearObjects();
+		/// <summary>
+		/// Called by GameObject::SetName to keep the name lookup up to date
+		/// </summary>
+		void _OnObjectRenamed(GameObject* object, const std::string& oldName);
+		/// <summary>
+		/// Sends the bounds of every object that has moved to the spatial index
+		/// </summary>
+		void _FlushSpatialIndex();
 	};
 }
\ No newline at end of file
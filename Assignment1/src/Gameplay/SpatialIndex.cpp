@@ -0,0 +1,486 @@
+#include "Gameplay/SpatialIndex.h"
+#include <algorithm>
+#include <climits>
+
+namespace Gameplay {
+	const float SpatialIndex::DEFAULT_CELL_SIZE = 4.0f;
+
+	// Cells are packed into 21 bits per axis, so coordinates are clamped to this range
+	static const int CELL_LIMIT = (1 << 20) - 1;
+	static const uint32_t NO_ENTRY = UINT32_MAX;
+
+	// Finds where a ray enters a sphere, 0 if it starts inside. The direction must be normalized
+	static bool RaySphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius, float& t) {
+		glm::vec3 m = origin - center;
+		float b = glm::dot(m, dir);
+		float c = glm::dot(m, m) - radius * radius;
+		// Starting outside and pointing away
+		if (c > 0.0f && b > 0.0f) {
+			return false;
+		}
+		float discriminant = b * b - c;
+		if (discriminant < 0.0f) {
+			return false;
+		}
+		t = glm::max(-b - glm::sqrt(discriminant), 0.0f);
+		return true;
+	}
+
+	// Clips a ray against a box, returning the distances where it enters and leaves
+	static bool RayAABB(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& min, const glm::vec3& max, float& tEnter, float& tExit) {
+		tEnter = -FLT_MAX;
+		tExit = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			if (glm::abs(dir[axis]) < 1e-8f) {
+				if (origin[axis] < min[axis] || origin[axis] > max[axis]) {
+					return false;
+				}
+			} else {
+				float t1 = (min[axis] - origin[axis]) / dir[axis];
+				float t2 = (max[axis] - origin[axis]) / dir[axis];
+				tEnter = glm::max(tEnter, glm::min(t1, t2));
+				tExit = glm::min(tExit, glm::max(t1, t2));
+			}
+		}
+		return tEnter <= tExit;
+	}
+
+	SpatialIndex::SpatialIndex(float cellSize) :
+		_mutex(),
+		_cellSize(glm::max(cellSize, 0.01f)),
+		_invCellSize(1.0f / glm::max(cellSize, 0.01f)),
+		_entries(),
+		_entryLookup(),
+		_cells(),
+		_oversized(),
+		_minCell(glm::ivec3(INT_MAX)),
+		_maxCell(glm::ivec3(INT_MIN))
+	{ }
+
+	void SpatialIndex::Update(const Item* items, size_t count) {
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+
+		for (size_t ix = 0; ix < count; ix++) {
+			const Item& item = items[ix];
+			if (item.Handle.IsNull()) {
+				continue;
+			}
+
+			if (item.Handle.Index >= _entryLookup.size()) {
+				_entryLookup.resize(item.Handle.Index + 1, NO_ENTRY);
+			}
+
+			uint32_t entryIx = _entryLookup[item.Handle.Index];
+			if (entryIx != NO_ENTRY) {
+				Entry& entry = _entries[entryIx];
+				// A different object in the same slot, the old one must be gone
+				if (entry.Data.Handle != item.Handle) {
+					_Remove(entry.Data.Handle);
+					entryIx = NO_ENTRY;
+				}
+				// Most moves stay in the same cell, so we can skip re-binning
+				else {
+					bool isOversized = item.Radius > _cellSize * 0.5f;
+					if (isOversized == entry.IsOversized && (isOversized || _PackCell(_GetCell(item.Center)) == entry.CellKey)) {
+						entry.Data = item;
+					} else {
+						_Unlink(entryIx);
+						entry.Data = item;
+						_Insert(entryIx);
+					}
+					continue;
+				}
+			}
+
+			Entry entry;
+			entry.Data = item;
+			entry.CellKey = 0;
+			entry.CellSlot = 0;
+			entry.IsOversized = false;
+			entryIx = static_cast<uint32_t>(_entries.size());
+			_entries.push_back(entry);
+			_entryLookup[item.Handle.Index] = entryIx;
+			_Insert(entryIx);
+		}
+	}
+
+	void SpatialIndex::Remove(GameObjectHandle handle) {
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		_Remove(handle);
+	}
+
+	void SpatialIndex::Clear() {
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		_entries.clear();
+		_entryLookup.clear();
+		_cells.clear();
+		_oversized.clear();
+		_minCell = glm::ivec3(INT_MAX);
+		_maxCell = glm::ivec3(INT_MIN);
+	}
+
+	void SpatialIndex::SetCellSize(float value) {
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		value = glm::max(value, 0.01f);
+		if (value == _cellSize) {
+			return;
+		}
+
+		_cellSize = value;
+		_invCellSize = 1.0f / value;
+		_cells.clear();
+		_oversized.clear();
+		_minCell = glm::ivec3(INT_MAX);
+		_maxCell = glm::ivec3(INT_MIN);
+		for (uint32_t ix = 0; ix < _entries.size(); ix++) {
+			_Insert(ix);
+		}
+	}
+
+	float SpatialIndex::GetCellSize() const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		return _cellSize;
+	}
+
+	size_t SpatialIndex::QueryRadius(const glm::vec3& center, float radius, std::vector<Item>& results, GameObjectHandle ignore) const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		size_t startSize = results.size();
+
+		auto test = [&](uint32_t entryIx) {
+			const Item& item = _entries[entryIx].Data;
+			float range = radius + item.Radius;
+			glm::vec3 delta = item.Center - center;
+			if (item.Handle != ignore && glm::dot(delta, delta) <= range * range) {
+				results.push_back(item);
+			}
+		};
+
+		for (uint32_t entryIx : _oversized) {
+			test(entryIx);
+		}
+		// Objects can hang half a cell out of the cell they're in
+		glm::vec3 extents = glm::vec3(radius + _cellSize * 0.5f);
+		_EachInRange(_GetCell(center - extents), _GetCell(center + extents), test);
+
+		return results.size() - startSize;
+	}
+
+	size_t SpatialIndex::QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<Item>& results) const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		size_t startSize = results.size();
+
+		auto test = [&](uint32_t entryIx) {
+			const Item& item = _entries[entryIx].Data;
+			glm::vec3 delta = glm::clamp(item.Center, min, max) - item.Center;
+			if (glm::dot(delta, delta) <= item.Radius * item.Radius) {
+				results.push_back(item);
+			}
+		};
+
+		for (uint32_t entryIx : _oversized) {
+			test(entryIx);
+		}
+		glm::vec3 margin = glm::vec3(_cellSize * 0.5f);
+		_EachInRange(_GetCell(min - margin), _GetCell(max + margin), test);
+
+		return results.size() - startSize;
+	}
+
+	bool SpatialIndex::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit, GameObjectHandle ignore) const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+
+		float length = glm::length(direction);
+		if (length <= 0.0f || _entries.empty()) {
+			return false;
+		}
+		glm::vec3 dir = direction / length;
+
+		float best = maxDistance;
+		bool found = false;
+		auto test = [&](uint32_t entryIx) {
+			const Item& item = _entries[entryIx].Data;
+			float t;
+			if (item.Handle != ignore && RaySphere(origin, dir, item.Center, item.Radius, t) && t <= best) {
+				best = t;
+				hit.Handle = item.Handle;
+				hit.Distance = t;
+				hit.Point = origin + dir * t;
+				found = true;
+			}
+		};
+
+		for (uint32_t entryIx : _oversized) {
+			test(entryIx);
+		}
+		if (_minCell.x > _maxCell.x) {
+			return found;
+		}
+
+		// Clip the ray to the cells that have ever held something, plus one for the loose bounds
+		glm::ivec3 minCell = _minCell - 1;
+		glm::ivec3 maxCell = _maxCell + 1;
+		float tEnter, tExit;
+		if (!RayAABB(origin, dir, glm::vec3(minCell) * _cellSize, glm::vec3(maxCell + 1) * _cellSize, tEnter, tExit)) {
+			return found;
+		}
+		tEnter = glm::max(tEnter, 0.0f);
+		tExit = glm::min(tExit, best);
+		if (tEnter > tExit) {
+			return found;
+		}
+
+		// Walk the cells along the ray with a 3D DDA. Anything the ray hits is centered in a cell next to one
+		// the ray passes through, so we test each cell's neighbours as well
+		glm::vec3 start = origin + dir * tEnter;
+		glm::ivec3 cell = glm::clamp(_GetCell(start), minCell, maxCell);
+		glm::ivec3 step;
+		glm::vec3 tMax, tDelta;
+		for (int axis = 0; axis < 3; axis++) {
+			if (dir[axis] > 0.0f) {
+				step[axis] = 1;
+				tMax[axis] = tEnter + ((cell[axis] + 1) * _cellSize - start[axis]) / dir[axis];
+				tDelta[axis] = _cellSize / dir[axis];
+			} else if (dir[axis] < 0.0f) {
+				step[axis] = -1;
+				tMax[axis] = tEnter + (cell[axis] * _cellSize - start[axis]) / dir[axis];
+				tDelta[axis] = -_cellSize / dir[axis];
+			} else {
+				step[axis] = 0;
+				tMax[axis] = FLT_MAX;
+				tDelta[axis] = FLT_MAX;
+			}
+		}
+
+		_EachInRange(cell - 1, cell + 1, test);
+		while (true) {
+			int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+			// Any hit in a cell we have yet to enter is further than the one we have
+			if (tMax[axis] > tExit || tMax[axis] > best) {
+				break;
+			}
+			cell[axis] += step[axis];
+			tMax[axis] += tDelta[axis];
+
+			// Everything but the slab of neighbours on the far side was covered by the last cell
+			glm::ivec3 low = cell - 1;
+			glm::ivec3 high = cell + 1;
+			low[axis] = high[axis] = cell[axis] + step[axis];
+			_EachInRange(low, high, test);
+		}
+
+		return found;
+	}
+
+	size_t SpatialIndex::QueryNearest(const glm::vec3& point, size_t count, std::vector<Item>& results, float maxDistance, GameObjectHandle ignore) const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		if (count == 0 || _entries.empty()) {
+			return 0;
+		}
+
+		// A max heap of the best candidates so far, by distance to the edge of their bounds
+		std::vector<std::pair<float, uint32_t>> heap;
+		heap.reserve(std::min(count, _entries.size()));
+		auto consider = [&](uint32_t entryIx) {
+			const Item& item = _entries[entryIx].Data;
+			if (item.Handle == ignore) {
+				return;
+			}
+			float distance = glm::max(glm::length(item.Center - point) - item.Radius, 0.0f);
+			if (distance > maxDistance) {
+				return;
+			}
+			if (heap.size() < count) {
+				heap.emplace_back(distance, entryIx);
+				std::push_heap(heap.begin(), heap.end());
+			} else if (distance < heap.front().first) {
+				std::pop_heap(heap.begin(), heap.end());
+				heap.back() = { distance, entryIx };
+				std::push_heap(heap.begin(), heap.end());
+			}
+		};
+
+		for (uint32_t entryIx : _oversized) {
+			consider(entryIx);
+		}
+
+		// Search outwards in shells of cells, until the next shell can't hold anything closer than what we have
+		if (_minCell.x <= _maxCell.x) {
+			glm::ivec3 center = _GetCell(point);
+			glm::ivec3 reach = glm::max(glm::abs(center - _minCell), glm::abs(_maxCell - center));
+			int maxShell = glm::max(reach.x, glm::max(reach.y, reach.z));
+
+			for (int shell = 0; shell <= maxShell; shell++) {
+				float shellDistance = glm::max((shell - 1.5f) * _cellSize, 0.0f);
+				if (shellDistance > maxDistance || (heap.size() == count && shellDistance > heap.front().first)) {
+					break;
+				}
+
+				// Once a shell has more cells than are occupied, it's cheaper to check the rest directly
+				size_t side = 2 * static_cast<size_t>(shell) + 1;
+				if (side * side * 6 > _cells.size()) {
+					for (const auto& [key, list] : _cells) {
+						glm::ivec3 offset = glm::abs(_UnpackCell(key) - center);
+						if (glm::max(offset.x, glm::max(offset.y, offset.z)) >= shell) {
+							for (uint32_t entryIx : list) {
+								consider(entryIx);
+							}
+						}
+					}
+					break;
+				}
+
+				if (shell == 0) {
+					_EachInRange(center, center, consider);
+					continue;
+				}
+				for (int z = -shell; z <= shell; z++) {
+					// The top and bottom of the shell are full squares, everything between is just the outline
+					if (z == -shell || z == shell) {
+						_EachInRange(center + glm::ivec3(-shell, -shell, z), center + glm::ivec3(shell, shell, z), consider);
+					} else {
+						_EachInRange(center + glm::ivec3(-shell, -shell, z), center + glm::ivec3(shell, -shell, z), consider);
+						_EachInRange(center + glm::ivec3(-shell, shell, z), center + glm::ivec3(shell, shell, z), consider);
+						_EachInRange(center + glm::ivec3(-shell, 1 - shell, z), center + glm::ivec3(-shell, shell - 1, z), consider);
+						_EachInRange(center + glm::ivec3(shell, 1 - shell, z), center + glm::ivec3(shell, shell - 1, z), consider);
+					}
+				}
+			}
+		}
+
+		std::sort_heap(heap.begin(), heap.end());
+		for (const auto& [distance, entryIx] : heap) {
+			results.push_back(_entries[entryIx].Data);
+		}
+		return heap.size();
+	}
+
+	SpatialIndex::Stats SpatialIndex::GetStats() const {
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		Stats result;
+		result.Items = static_cast<uint32_t>(_entries.size());
+		result.Cells = static_cast<uint32_t>(_cells.size());
+		result.Oversized = static_cast<uint32_t>(_oversized.size());
+		result.CellSize = _cellSize;
+		return result;
+	}
+
+	glm::ivec3 SpatialIndex::_GetCell(const glm::vec3& point) const {
+		glm::vec3 cell = glm::floor(point * _invCellSize);
+		return glm::ivec3(glm::clamp(cell, glm::vec3(-CELL_LIMIT), glm::vec3(CELL_LIMIT)));
+	}
+
+	uint64_t SpatialIndex::_PackCell(const glm::ivec3& cell) {
+		const uint64_t mask = (1ull << 21) - 1;
+		return
+			((static_cast<uint64_t>(cell.x + CELL_LIMIT) & mask) << 42) |
+			((static_cast<uint64_t>(cell.y + CELL_LIMIT) & mask) << 21) |
+			((static_cast<uint64_t>(cell.z + CELL_LIMIT) & mask));
+	}
+
+	glm::ivec3 SpatialIndex::_UnpackCell(uint64_t key) {
+		const uint64_t mask = (1ull << 21) - 1;
+		return glm::ivec3(
+			static_cast<int>((key >> 42) & mask) - CELL_LIMIT,
+			static_cast<int>((key >> 21) & mask) - CELL_LIMIT,
+			static_cast<int>(key & mask) - CELL_LIMIT
+		);
+	}
+
+	void SpatialIndex::_Insert(uint32_t entryIx) {
+		Entry& entry = _entries[entryIx];
+		entry.IsOversized = entry.Data.Radius > _cellSize * 0.5f;
+		if (entry.IsOversized) {
+			entry.CellKey = 0;
+			entry.CellSlot = static_cast<uint32_t>(_oversized.size());
+			_oversized.push_back(entryIx);
+		} else {
+			glm::ivec3 cell = _GetCell(entry.Data.Center);
+			entry.CellKey = _PackCell(cell);
+			std::vector<uint32_t>& list = _cells[entry.CellKey];
+			entry.CellSlot = static_cast<uint32_t>(list.size());
+			list.push_back(entryIx);
+			_minCell = glm::min(_minCell, cell);
+			_maxCell = glm::max(_maxCell, cell);
+		}
+	}
+
+	void SpatialIndex::_Unlink(uint32_t entryIx) {
+		const Entry& entry = _entries[entryIx];
+		auto cellIt = entry.IsOversized ? _cells.end() : _cells.find(entry.CellKey);
+		std::vector<uint32_t>& list = entry.IsOversized ? _oversized : cellIt->second;
+
+		// Swap the last entry in the cell into our place
+		uint32_t lastIx = list.back();
+		list[entry.CellSlot] = lastIx;
+		_entries[lastIx].CellSlot = entry.CellSlot;
+		list.pop_back();
+
+		if (!entry.IsOversized && list.empty()) {
+			_cells.erase(cellIt);
+		}
+	}
+
+	void SpatialIndex::_Remove(GameObjectHandle handle) {
+		if (handle.Index >= _entryLookup.size()) {
+			return;
+		}
+		uint32_t entryIx = _entryLookup[handle.Index];
+		if (entryIx == NO_ENTRY || _entries[entryIx].Data.Handle != handle) {
+			return;
+		}
+
+		_Unlink(entryIx);
+		_entryLookup[handle.Index] = NO_ENTRY;
+
+		// Swap the last entry into our place, and point it's cell at the new position
+		uint32_t lastIx = static_cast<uint32_t>(_entries.size() - 1);
+		if (entryIx != lastIx) {
+			_entries[entryIx] = _entries[lastIx];
+			_entryLookup[_entries[entryIx].Data.Handle.Index] = entryIx;
+			_SetSlot(_entries[entryIx], entryIx);
+		}
+		_entries.pop_back();
+	}
+
+	void SpatialIndex::_SetSlot(const Entry& entry, uint32_t entryIx) {
+		if (entry.IsOversized) {
+			_oversized[entry.CellSlot] = entryIx;
+		} else {
+			_cells.find(entry.CellKey)->second[entry.CellSlot] = entryIx;
+		}
+	}
+
+	template <typename Callback>
+	void SpatialIndex::_EachInRange(const glm::ivec3& min, const glm::ivec3& max, Callback callback) const {
+		if (_cells.empty() || min.x > max.x || min.y > max.y || min.z > max.z) {
+			return;
+		}
+
+		// Big ranges are mostly empty cells, so past a point it's cheaper to walk the occupied ones
+		uint64_t volume = static_cast<uint64_t>(max.x - min.x + 1) * static_cast<uint64_t>(max.y - min.y + 1) * static_cast<uint64_t>(max.z - min.z + 1);
+		if (volume > _cells.size()) {
+			for (const auto& [key, list] : _cells) {
+				glm::ivec3 cell = _UnpackCell(key);
+				if (glm::all(glm::greaterThanEqual(cell, min)) && glm::all(glm::lessThanEqual(cell, max))) {
+					for (uint32_t entryIx : list) {
+						callback(entryIx);
+					}
+				}
+			}
+			return;
+		}
+
+		for (int z = min.z; z <= max.z; z++) {
+			for (int y = min.y; y <= max.y; y++) {
+				for (int x = min.x; x <= max.x; x++) {
+					auto it = _cells.find(_PackCell(glm::ivec3(x, y, z)));
+					if (it != _cells.end()) {
+						for (uint32_t entryIx : it->second) {
+							callback(entryIx);
+						}
+					}
+				}
+			}
+		}
+	}
+}
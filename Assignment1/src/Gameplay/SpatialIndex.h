@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <cfloat>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Gameplay/GameObject.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// A loose uniform grid of bounding spheres, keyed by GameObjectHandle. Each object lives in the one
+	/// cell that contains it's center, and may spill up to half a cell past it, so queries only ever
+	/// need to look one cell further out than their bounds. Objects too large for that are kept in a
+	/// separate list that every query checks
+	///
+	/// The scene keeps this up to date from transform changes (see Scene::GetSpatialIndex), so it is only
+	/// modified on the main thread. Queries take a shared lock and are safe to call from any thread, they
+	/// see the objects as they were at the last flush
+	/// </summary>
+	class SpatialIndex {
+	public:
+		MAKE_PTRS(SpatialIndex);
+		NO_COPY(SpatialIndex);
+		NO_MOVE(SpatialIndex);
+
+		static const float DEFAULT_CELL_SIZE;
+
+		/// <summary>
+		/// An object in the index, or the result of a query
+		/// </summary>
+		struct Item {
+			GameObjectHandle Handle;
+			// The bounding sphere of the object in world space
+			glm::vec3        Center;
+			float            Radius;
+		};
+
+		/// <summary>
+		/// The result of a raycast
+		/// </summary>
+		struct RayHit {
+			GameObjectHandle Handle;
+			// The distance along the ray to where it entered the object's bounds
+			float            Distance;
+			glm::vec3        Point;
+		};
+
+		/// <summary>
+		/// Describes the current contents of the index
+		/// </summary>
+		struct Stats {
+			uint32_t Items;
+			uint32_t Cells;
+			uint32_t Oversized;
+			float    CellSize;
+		};
+
+		static inline Sptr Create(float cellSize = DEFAULT_CELL_SIZE) {
+			return std::make_shared<SpatialIndex>(cellSize);
+		}
+
+		SpatialIndex(float cellSize = DEFAULT_CELL_SIZE);
+		~SpatialIndex() = default;
+
+		/// <summary>
+		/// Inserts or moves the given objects, taking the lock once for the whole batch
+		/// </summary>
+		/// <param name="items">The new bounds of the objects</param>
+		/// <param name="count">The number of items</param>
+		void Update(const Item* items, size_t count);
+		/// <summary>
+		/// Removes an object from the index, does nothing if it was never added
+		/// </summary>
+		void Remove(GameObjectHandle handle);
+		/// <summary>
+		/// Removes everything from the index
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Changes the size of the grid cells, re-binning every object. Cells should be about twice the
+		/// size of a typical object
+		/// </summary>
+		void SetCellSize(float value);
+		float GetCellSize() const;
+
+		/// <summary>
+		/// Finds all objects whose bounds overlap the given sphere
+		/// </summary>
+		/// <param name="center">The center of the sphere in world space</param>
+		/// <param name="radius">The radius of the sphere</param>
+		/// <param name="results">The objects found are appended to this list</param>
+		/// <param name="ignore">An object to leave out of the results, usually the one doing the query</param>
+		/// <returns>The number of objects found</returns>
+		size_t QueryRadius(const glm::vec3& center, float radius, std::vector<Item>& results, GameObjectHandle ignore = GameObjectHandle()) const;
+		/// <summary>
+		/// Finds all objects whose bounds overlap the given axis aligned box
+		/// </summary>
+		/// <param name="min">The minimum corner of the box in world space</param>
+		/// <param name="max">The maximum corner of the box in world space</param>
+		/// <param name="results">The objects found are appended to this list</param>
+		/// <returns>The number of objects found</returns>
+		size_t QueryAABB(const glm::vec3& min, const glm::vec3& max, std::vector<Item>& results) const;
+		/// <summary>
+		/// Finds the first object whose bounds are hit by the given ray
+		/// </summary>
+		/// <param name="origin">The start of the ray in world space</param>
+		/// <param name="direction">The direction of the ray, does not need to be normalized</param>
+		/// <param name="maxDistance">The length of the ray</param>
+		/// <param name="hit">Filled in with the closest hit, if there was one</param>
+		/// <param name="ignore">An object the ray should pass through</param>
+		/// <returns>True if an object was hit</returns>
+		bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit, GameObjectHandle ignore = GameObjectHandle()) const;
+		/// <summary>
+		/// Finds the objects whose bounds are closest to the given point, closest first
+		/// </summary>
+		/// <param name="point">The point to search around, in world space</param>
+		/// <param name="count">The maximum number of objects to find</param>
+		/// <param name="results">The objects found are appended to this list</param>
+		/// <param name="maxDistance">Objects further than this are ignored</param>
+		/// <param name="ignore">An object to leave out of the results, usually the one doing the query</param>
+		/// <returns>The number of objects found</returns>
+		size_t QueryNearest(const glm::vec3& point, size_t count, std::vector<Item>& results, float maxDistance = FLT_MAX, GameObjectHandle ignore = GameObjectHandle()) const;
+
+		/// <summary>
+		/// Gets a snapshot of the index's contents
+		/// </summary>
+		Stats GetStats() const;
+
+	protected:
+		// An item, and where it is stored in the cell lists so it can be removed in constant time
+		struct Entry {
+			Item     Data;
+			uint64_t CellKey;
+			uint32_t CellSlot;
+			bool     IsOversized;
+		};
+
+		mutable std::shared_mutex _mutex;
+
+		float     _cellSize;
+		float     _invCellSize;
+
+		// All items, tightly packed
+		std::vector<Entry>    _entries;
+		// Maps GameObjectHandle indices to positions in _entries
+		std::vector<uint32_t> _entryLookup;
+		// The entries in each occupied cell
+		std::unordered_map<uint64_t, std::vector<uint32_t>> _cells;
+		// Entries too big to fit the loose bounds of a cell
+		std::vector<uint32_t> _oversized;
+		// The range of cells that have ever held an item, used to bound ray and nearest queries
+		glm::ivec3 _minCell;
+		glm::ivec3 _maxCell;
+
+		glm::ivec3 _GetCell(const glm::vec3& point) const;
+		static uint64_t _PackCell(const glm::ivec3& cell);
+		static glm::ivec3 _UnpackCell(uint64_t key);
+
+		void _Insert(uint32_t entryIx);
+		void _Unlink(uint32_t entryIx);
+		void _Remove(GameObjectHandle handle);
+		void _SetSlot(const Entry& entry, uint32_t entryIx);
+
+		// Calls the callback with the index of every entry in the given range of cells, oversized entries are not included
+		template <typename Callback>
+		void _EachInRange(const glm::ivec3& min, const glm::ivec3& max, Callback callback) const;
+	};
+}
@@ -0,0 +1,204 @@
+#include "Gameplay/StressSceneGenerator.h"
+#include <random>
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/constants.hpp>
+#include "Logging.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Font.h"
+#include "Graphics/Textures/Texture2D.h"
+#include "Graphics/Textures/TextureCube.h"
+#include "Utils/GlmDefines.h"
+#include "Utils/JsonGlmHelpers.h"
+#include "Utils/MeshFactory.h"
+#include "Utils/ResourceManager/ResourceManager.h"
+#include "Gameplay/Material.h"
+#include "Gameplay/MeshResource.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Gameplay/Components/ParticleSystem.h"
+#include "Gameplay/Components/GUI/RectTransform.h"
+#include "Gameplay/Components/GUI/GuiText.h"
+#include "Gameplay/Physics/RigidBody.h"
+#include "Gameplay/Physics/TriggerVolume.h"
+#include "Gameplay/Physics/Colliders/BoxCollider.h"
+#include "Gameplay/Physics/Colliders/SphereCollider.h"
+
+namespace Gameplay {
+	StressSceneGenerator::Settings StressSceneGenerator::Settings::FromJson(const nlohmann::json& blob) {
+		Settings result;
+		result.ObjectCount    = JsonGet(blob, "objects", result.ObjectCount);
+		result.HierarchyDepth = glm::max(JsonGet(blob, "hierarchy_depth", result.HierarchyDepth), 1u);
+		result.MaterialCount  = glm::max(JsonGet(blob, "materials", result.MaterialCount), 1u);
+		result.LightCount     = JsonGet(blob, "lights", result.LightCount);
+		result.Seed           = JsonGet(blob, "seed", result.Seed);
+		result.WorldSize      = JsonGet(blob, "world_size", result.WorldSize);
+		result.RigidBodyRatio = JsonGet(blob, "rigid_body_ratio", result.RigidBodyRatio);
+		result.TriggerRatio   = JsonGet(blob, "trigger_ratio", result.TriggerRatio);
+		result.ParticleRatio  = JsonGet(blob, "particle_ratio", result.ParticleRatio);
+		result.StaticRatio    = JsonGet(blob, "static_ratio", result.StaticRatio);
+		result.GuiTextRatio   = JsonGet(blob, "gui_text_ratio", result.GuiTextRatio);
+		return result;
+	}
+
+	nlohmann::json StressSceneGenerator::Settings::ToJson() const {
+		return {
+			{ "objects", ObjectCount },
+			{ "hierarchy_depth", HierarchyDepth },
+			{ "materials", MaterialCount },
+			{ "lights", LightCount },
+			{ "seed", Seed },
+			{ "world_size", WorldSize },
+			{ "rigid_body_ratio", RigidBodyRatio },
+			{ "trigger_ratio", TriggerRatio },
+			{ "particle_ratio", ParticleRatio },
+			{ "static_ratio", StaticRatio },
+			{ "gui_text_ratio", GuiTextRatio }
+		};
+	}
+
+	Scene::Sptr StressSceneGenerator::Generate(const Settings& settings) {
+		using namespace Physics;
+
+		LOG_INFO("Generating stress scene with {} objects (depth {}, {} materials, {} lights, seed {})",
+			settings.ObjectCount, settings.HierarchyDepth, settings.MaterialCount, settings.LightCount, settings.Seed);
+
+		std::mt19937 rng(settings.Seed);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		auto range = [&](float low, float high) { return low + (high - low) * unit(rng); };
+
+		ShaderProgram::BeginCompileBatch();
+		ShaderProgram::Sptr basicShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+			{ ShaderPartType::Vertex, "shaders/vertex_shaders/basic.glsl" },
+			{ ShaderPartType::Fragment, "shaders/fragment_shaders/frag_blinn_phong_textured.glsl" }
+		});
+		basicShader->SetDebugName("Blinn-phong");
+		ShaderProgram::Sptr skyboxShader = ResourceManager::CreateAsset<ShaderProgram>(std::unordered_map<ShaderPartType, std::string>{
+			{ ShaderPartType::Vertex, "shaders/vertex_shaders/skybox_vert.glsl" },
+			{ ShaderPartType::Fragment, "shaders/fragment_shaders/skybox_frag.glsl" }
+		});
+		ShaderProgram::EndCompileBatch();
+
+		Scene::Sptr scene = std::make_shared<Scene>();
+		scene->SetSkyboxTexture(ResourceManager::CreateAsset<TextureCube>("cubemaps/ocean/ocean.jpg"));
+		scene->SetSkyboxShader(skyboxShader);
+		scene->SetSkyboxRotation(glm::rotate(MAT4_IDENTITY, glm::half_pi<float>(), glm::vec3(1.0f, 0.0f, 0.0f)));
+		scene->SetSunDirection(glm::vec3(-0.4f, 0.3f, -1.0f));
+		scene->SetSunColor(glm::vec3(0.4f));
+
+		// Each material gets it's own instance even if it shares a texture, so the renderer has to treat them as
+		// different state like it would for authored content
+		const char* textures[] = { "textures/grassTex.png", "textures/leaf1.png", "textures/leaf2.png", "textures/logUV.png", "textures/flagUv.png" };
+		std::vector<Material::Sptr> materials;
+		materials.reserve(settings.MaterialCount);
+		for (uint32_t ix = 0; ix < settings.MaterialCount; ix++) {
+			Material::Sptr material = ResourceManager::CreateAsset<Material>(basicShader);
+			material->Name = "Stress " + std::to_string(ix);
+			material->Set("s_Diffuse", ResourceManager::CreateAsset<Texture2D>(textures[ix % (sizeof(textures) / sizeof(textures[0]))]));
+			material->Set("u_Material.Shininess", range(0.1f, 1.0f));
+			materials.push_back(material);
+		}
+
+		MeshResource::Sptr cubeMesh = ResourceManager::CreateAsset<MeshResource>();
+		cubeMesh->AddParam(MeshBuilderParam::CreateCube(ZERO, ONE));
+		cubeMesh->GenerateMesh();
+		MeshResource::Sptr sphereMesh = ResourceManager::CreateAsset<MeshResource>();
+		sphereMesh->AddParam(MeshBuilderParam::CreateIcoSphere(ZERO, 0.5f, 2));
+		sphereMesh->GenerateMesh();
+
+		const float halfSize = settings.WorldSize / 2.0f;
+
+		scene->Lights.resize(settings.LightCount);
+		for (Light& light : scene->Lights) {
+			light.Position = glm::vec3(range(-halfSize, halfSize), range(-halfSize, halfSize), range(1.0f, 8.0f));
+			light.Color = glm::vec3(range(0.2f, 1.0f), range(0.2f, 1.0f), range(0.2f, 1.0f));
+			light.Range = range(5.0f, 20.0f);
+			light.IsStatic = true;
+		}
+
+		// Looking across the whole area, so most objects are in the frustum
+		GameObject::Sptr camera = scene->MainCamera->GetGameObject()->SelfRef();
+		camera->SetPostion(glm::vec3(-halfSize, -halfSize, halfSize * 0.5f));
+		camera->SetRotation(glm::vec3(65.0f, 0.0f, -45.0f));
+
+		GameObject::Sptr ground = scene->CreateGameObject("Ground");
+		{
+			ground->IsStatic = true;
+			MeshResource::Sptr groundMesh = ResourceManager::CreateAsset<MeshResource>();
+			groundMesh->AddParam(MeshBuilderParam::CreatePlane(ZERO, UNIT_Z, UNIT_X, glm::vec2(settings.WorldSize), glm::vec2(settings.WorldSize / 5.0f)));
+			groundMesh->GenerateMesh();
+			RenderComponent::Sptr renderer = ground->Add<RenderComponent>();
+			renderer->SetMesh(groundMesh);
+			renderer->SetMaterial(materials[0]);
+			RigidBody::Sptr physics = ground->Add<RigidBody>(/*static by default*/);
+			physics->AddCollider(BoxCollider::Create(glm::vec3(halfSize, halfSize, 1.0f)))->SetPosition({ 0, 0, -1 });
+		}
+
+		// Objects are made in chains of HierarchyDepth, where only the root gets physics or particles so bodies
+		// aren't fighting their parent's transform
+		GameObject::Sptr parent = nullptr;
+		bool chainIsStatic = false;
+		for (uint32_t ix = 0; ix < settings.ObjectCount; ix++) {
+			bool isRoot = (ix % settings.HierarchyDepth) == 0;
+			bool isSphere = unit(rng) < 0.5f;
+
+			GameObject::Sptr object = scene->CreateGameObject("Stress " + std::to_string(ix));
+			object->SetRotation(glm::vec3(0.0f, 0.0f, range(0.0f, 360.0f)));
+
+			RenderComponent::Sptr renderer = object->Add<RenderComponent>();
+			renderer->SetMesh(isSphere ? sphereMesh : cubeMesh);
+			renderer->SetMaterial(materials[static_cast<size_t>(unit(rng) * materials.size()) % materials.size()]);
+
+			if (isRoot) {
+				glm::vec3 position = glm::vec3(range(-halfSize, halfSize), range(-halfSize, halfSize), range(0.5f, 10.0f));
+				object->SetPostion(position);
+
+				float roll = unit(rng);
+				chainIsStatic = false;
+				if (roll < settings.RigidBodyRatio) {
+					RigidBody::Sptr physics = object->Add<RigidBody>(RigidBodyType::Dynamic);
+					if (isSphere) {
+						physics->AddCollider(SphereCollider::Create(0.5f));
+					} else {
+						physics->AddCollider(BoxCollider::Create(glm::vec3(0.5f)));
+					}
+				} else if ((roll -= settings.RigidBodyRatio) < settings.TriggerRatio) {
+					TriggerVolume::Sptr volume = object->Add<TriggerVolume>();
+					volume->AddCollider(BoxCollider::Create(glm::vec3(1.5f)));
+				} else if ((roll -= settings.TriggerRatio) < settings.ParticleRatio) {
+					// Emitters are in world space
+					ParticleSystem::Sptr particles = object->Add<ParticleSystem>();
+					particles->AddEmitter(position, glm::vec3(0.0f, 0.0f, 2.0f), range(5.0f, 20.0f), glm::vec4(range(0.5f, 1.0f), range(0.5f, 1.0f), range(0.5f, 1.0f), 1.0f));
+				} else {
+					chainIsStatic = unit(rng) < settings.StaticRatio;
+				}
+			} else {
+				object->SetPostion(glm::vec3(0.0f, 0.0f, 1.25f));
+				parent->AddChild(object);
+			}
+			object->IsStatic = chainIsStatic;
+
+			parent = object;
+		}
+
+		uint32_t textCount = static_cast<uint32_t>(settings.ObjectCount * settings.GuiTextRatio);
+		if (textCount > 0) {
+			Font::Sptr font = ResourceManager::CreateAsset<Font>("fonts/Roboto-Medium.ttf", 16.0f);
+			font->Bake();
+
+			const int columns = 40;
+			for (uint32_t ix = 0; ix < textCount; ix++) {
+				GameObject::Sptr label = scene->CreateGameObject("Stress Label " + std::to_string(ix));
+
+				RectTransform::Sptr transform = label->Add<RectTransform>();
+				transform->SetMin({ (ix % columns) * 32.0f, (ix / columns) * 14.0f });
+				transform->SetMax({ (ix % columns) * 32.0f + 30.0f, (ix / columns) * 14.0f + 12.0f });
+
+				GuiText::Sptr text = label->Add<GuiText>();
+				text->SetFont(font);
+				text->SetTextScale(0.5f);
+				text->SetText(std::to_string(ix));
+			}
+		}
+
+		return scene;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <json.hpp>
+#include "Gameplay/Scene.h"
+
+namespace Gameplay {
+	/// <summary>
+	/// Builds large, randomized scenes for benchmarking how systems scale with object count. The same
+	/// settings and seed always produce the same scene, so runs can be compared between builds
+	/// </summary>
+	class StressSceneGenerator {
+	public:
+		StressSceneGenerator() = delete;
+
+		/// <summary>
+		/// Controls the size and makeup of a generated scene
+		/// </summary>
+		struct Settings {
+			/// <summary>
+			/// The number of world objects to create, not counting GUI elements, lights or the ground
+			/// </summary>
+			uint32_t ObjectCount = 1000;
+			/// <summary>
+			/// The length of each parent/child chain, 1 for a flat scene
+			/// </summary>
+			uint32_t HierarchyDepth = 1;
+			/// <summary>
+			/// The number of unique materials that objects are spread across
+			/// </summary>
+			uint32_t MaterialCount = 8;
+			/// <summary>
+			/// The number of point lights scattered through the world
+			/// </summary>
+			uint32_t LightCount = 8;
+			/// <summary>
+			/// Seed for the random number generator
+			/// </summary>
+			uint32_t Seed = 1;
+			/// <summary>
+			/// The width and depth of the area objects are placed in, in meters
+			/// </summary>
+			float WorldSize = 200.0f;
+
+			// The chance that the root of a chain gets each of these components, at most one per root
+
+			float RigidBodyRatio = 0.1f;
+			float TriggerRatio = 0.02f;
+			float ParticleRatio = 0.001f;
+
+			/// <summary>
+			/// The chance that a chain with no physics or particles is marked as static
+			/// </summary>
+			float StaticRatio = 0.5f;
+			/// <summary>
+			/// The number of GUI text elements to create, as a fraction of the object count
+			/// </summary>
+			float GuiTextRatio = 0.001f;
+
+			/// <summary>
+			/// Loads settings from a JSON blob, any missing keys keep their default value
+			/// </summary>
+			static Settings FromJson(const nlohmann::json& blob);
+			/// <summary>
+			/// Converts these settings into their JSON representation
+			/// </summary>
+			nlohmann::json ToJson() const;
+		};
+
+		/// <summary>
+		/// Generates a new scene, creating all of it's resources through the ResourceManager so that
+		/// they can be written out with ResourceManager::SaveManifest. Requires a GL context
+		/// </summary>
+		/// <param name="settings">The settings to generate the scene with</param>
+		/// <returns>The new scene, which has not been awoken</returns>
+		static Scene::Sptr Generate(const Settings& settings);
+	};
+}
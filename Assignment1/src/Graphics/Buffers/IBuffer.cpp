@@ -5,7 +5,8 @@ IBuffer::IBuffer(BufferType type, BufferUsage usage) :
 	IGraphicsResource(),
 	_elementCount(0),
 	_elementSize(0),
-	_size(0)
+	_size(0),
+	_isImmutable(false)
 {
 	_type = type;
 	_usage = usage;
@@ -16,6 +17,10 @@ GlResourceType IBuffer::GetResourceClass() const {
 	return GlResourceType::Buffer;
 }
 
+size_t IBuffer::GetMemoryEstimate() const {
+	return _size;
+}
+
 IBuffer::~IBuffer() {
 	if (_rendererId != 0) {
 		glDeleteBuffers(1, &_rendererId);
@@ -24,6 +29,7 @@ IBuffer::~IBuffer() {
 }
 
 void IBuffer::LoadData(const void* data, uint32_t elementSize, uint32_t elementCount) {
+	LOG_ASSERT(!_isImmutable, "Cannot reload data into a buffer with immutable storage!");
 	// Note, this is part of the bindless state access stuff added in 4.5
 	glNamedBufferData(_rendererId, (GLsizeiptr)elementSize * elementCount, data, (GLenum)_usage);
 
@@ -35,7 +41,7 @@ void IBuffer::LoadData(const void* data, uint32_t elementSize, uint32_t elementC
 void IBuffer::UpdateData(const void* data, uint32_t elementSize, uint32_t elementCount, bool allowResize /*= true*/)
 {
 	if (elementSize * elementCount > _size) {
-		if (allowResize) {
+		if (allowResize && !_isImmutable) {
 			glNamedBufferData(_rendererId, (GLsizeiptr)elementSize * elementCount, data, (GLenum)_usage);
 
 			LOG_INFO("Expanding buffer from {} bytes to {} bytes", _size, elementCount * elementSize);
@@ -59,6 +65,29 @@ void IBuffer::UpdateData(const void* data, uint32_t elementSize, uint32_t elemen
 	}
 }
 
+void IBuffer::AllocateStorage(const void* data, uint32_t elementSize, uint32_t elementCount, BufferMapMode access) {
+	LOG_ASSERT(!_isImmutable, "Buffer storage has already been allocated!");
+
+	// Only the access bits are valid for storage, dynamic storage lets UpdateSubData keep working
+	GLbitfield flags = *access & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+	glNamedBufferStorage(_rendererId, (GLsizeiptr)elementSize * elementCount, data, flags | GL_DYNAMIC_STORAGE_BIT);
+
+	_elementCount = elementCount;
+	_elementSize = elementSize;
+	_size = elementCount * elementSize;
+	_isImmutable = true;
+}
+
+void IBuffer::UpdateSubData(const void* data, uint32_t offsetBytes, uint32_t sizeBytes) {
+	LOG_ASSERT(offsetBytes + sizeBytes <= _size, "Attempting to write beyond the end of the buffer!");
+	glNamedBufferSubData(_rendererId, (GLintptr)offsetBytes, (GLsizeiptr)sizeBytes, data);
+}
+
+void IBuffer::ReadSubData(void* data, uint32_t offsetBytes, uint32_t sizeBytes) const {
+	LOG_ASSERT(offsetBytes + sizeBytes <= _size, "Attempting to read beyond the end of the buffer!");
+	glGetNamedBufferSubData(_rendererId, (GLintptr)offsetBytes, (GLsizeiptr)sizeBytes, data);
+}
+
 void* IBuffer::Map(BufferMapMode mode) {
 	return glMapNamedBufferRange(_rendererId, 0, _size, *mode);
 }
@@ -76,6 +105,11 @@ void IBuffer::Bind(uint32_t slot) const
 	glBindBufferBase((GLenum)_type, slot, _rendererId);
 }
 
+void IBuffer::BindRange(uint32_t slot, uint32_t offsetBytes, uint32_t sizeBytes) const
+{
+	glBindBufferRange((GLenum)_type, slot, _rendererId, (GLintptr)offsetBytes, (GLsizeiptr)sizeBytes);
+}
+
 void IBuffer::UnBind(BufferType type) {
 	glBindBuffer((GLenum)type, 0);
 }
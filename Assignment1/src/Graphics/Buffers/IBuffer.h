@@ -12,6 +12,7 @@
 /// </summary>
 /// <see>https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glMapBufferRange.xhtml</see>
 ENUM_FLAGS(BufferMapMode, uint32_t,
+	None             = 0,
 	Read             = GL_MAP_READ_BIT,
 	Write            = GL_MAP_WRITE_BIT,
 	Persistent       = GL_MAP_PERSISTENT_BIT,
@@ -52,6 +53,39 @@ public:
 	/// <param name="allowResize">True if resizing the buffer is allowed, otherwise an assertion is thrown for oversized writes</param>
 	virtual void UpdateData(const void* data, uint32_t elementSize, uint32_t elementCount, bool allowResize = true);
 
+	/// <summary>
+	/// Updates a sub-range of the data within the buffer, without resizing it. Use this
+	/// when only a small part of a large buffer has changed
+	/// </summary>
+	/// <param name="data">The data to copy into the range</param>
+	/// <param name="offsetBytes">The offset from the start of the buffer to write to, in bytes</param>
+	/// <param name="sizeBytes">The number of bytes to write</param>
+	virtual void UpdateSubData(const void* data, uint32_t offsetBytes, uint32_t sizeBytes);
+	/// <summary>
+	/// Copies a sub-range of the buffer back to the CPU. This waits for any pending GPU work on the
+	/// buffer, so keep it to load time
+	/// </summary>
+	/// <param name="data">The memory to copy the range into</param>
+	/// <param name="offsetBytes">The offset from the start of the buffer to read from, in bytes</param>
+	/// <param name="sizeBytes">The number of bytes to read</param>
+	void ReadSubData(void* data, uint32_t offsetBytes, uint32_t sizeBytes) const;
+
+	/// <summary>
+	/// Allocates immutable storage for this buffer using glNamedBufferStorage. Unlike LoadData, the
+	/// buffer may be mapped persistently while the GPU is reading from it, but can no longer be resized
+	/// or reloaded afterwards
+	/// </summary>
+	/// <see>https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glBufferStorage.xhtml</see>
+	/// <param name="data">The initial data for the buffer, or nullptr to leave it uninitialized</param>
+	/// <param name="elementSize">The size of a single element, in bytes</param>
+	/// <param name="elementCount">The number of elements to allocate</param>
+	/// <param name="access">The mapping access the storage must support (Read, Write, Persistent and Coherent are honored)</param>
+	void AllocateStorage(const void* data, uint32_t elementSize, uint32_t elementCount, BufferMapMode access);
+	/// <summary>
+	/// Returns true if this buffer's storage was allocated with AllocateStorage, and cannot be resized
+	/// </summary>
+	bool IsImmutable() const { return _isImmutable; }
+
 	/// <summary>
 	/// Loads an array of data into this buffer, using the bindless method glNamedBufferData
 	/// </summary>
@@ -107,6 +141,13 @@ public:
 	/// <param name="slot">The buffer slot to bind to, for the vast majority of cases this should be 0</param>
 	virtual void Bind(uint32_t slot) const;
 	/// <summary>
+	/// Binds a sub-range of this buffer to an indexed slot, so many small blocks can share one buffer
+	/// </summary>
+	/// <param name="slot">The buffer slot to bind to</param>
+	/// <param name="offsetBytes">The offset of the range, must respect the binding's offset alignment</param>
+	/// <param name="sizeBytes">The size of the range in bytes</param>
+	void BindRange(uint32_t slot, uint32_t offsetBytes, uint32_t sizeBytes) const;
+	/// <summary>
 	/// Unbinds the buffer bound to the slot given by type
 	/// </summary>
 	/// <param name="type">The type or slot of buffer to unbind (ex: GL_ARRAY_BUFFER, GL_ARRAY_ELEMENT_BUFFER)</param>
@@ -120,6 +161,7 @@ public:
 
 	// Inherited from IGraphicsResource
 	virtual GlResourceType GetResourceClass() const override;
+	virtual size_t GetMemoryEstimate() const override;
 
 protected:
 	/// <summary>
@@ -134,4 +176,5 @@ protected:
 	uint32_t _size; // The size of the buffer in bytes
 	BufferUsage _usage; // The buffer usage mode (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
 	BufferType _type; // The buffer type (ex GL_ARRAY_BUFFER, GL_ARRAY_ELEMENT_BUFFER)
+	bool _isImmutable; // True if the storage was allocated via glNamedBufferStorage
 };
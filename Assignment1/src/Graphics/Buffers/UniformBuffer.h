@@ -44,7 +44,6 @@ public :
 protected:
 	// Will contain the backing data store for the buffer
 	uint8_t* _rawData;
-	uint32_t _size;
 };
 
 /// <summary>
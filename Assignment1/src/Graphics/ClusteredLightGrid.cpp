@@ -0,0 +1,118 @@
+#include "Graphics/ClusteredLightGrid.h"
+
+ClusteredLightGrid::ClusteredLightGrid() :
+	_boundsShader(nullptr),
+	_cullShader(nullptr),
+	_clusterBounds(nullptr),
+	_lightGrid(nullptr),
+	_lightIndices(nullptr),
+	_lightCounter(nullptr),
+	_params(nullptr),
+	_boundsProjection(glm::mat4(1.0f)),
+	_boundsScreenSize(glm::ivec2(0)),
+	_isBoundsDirty(true)
+{
+	_boundsShader = ShaderProgram::Create();
+	_boundsShader->LoadShaderPartFromFile("shaders/compute_shaders/cluster_bounds.glsl", ShaderPartType::Compute);
+	_boundsShader->Link();
+
+	_cullShader = ShaderProgram::Create();
+	_cullShader->LoadShaderPartFromFile("shaders/compute_shaders/cluster_cull.glsl", ShaderPartType::Compute);
+	_cullShader->Link();
+
+	// The grid is a fixed size, so all our storage can be allocated up front
+	_clusterBounds = ShaderStorageBuffer::Create(BufferUsage::DynamicCopy);
+	_clusterBounds->LoadData(nullptr, sizeof(glm::vec4) * 2, NUM_CLUSTERS);
+
+	_lightGrid = ShaderStorageBuffer::Create(BufferUsage::DynamicCopy);
+	_lightGrid->LoadData(nullptr, sizeof(glm::uvec2), NUM_CLUSTERS);
+
+	_lightIndices = ShaderStorageBuffer::Create(BufferUsage::DynamicCopy);
+	_lightIndices->LoadData(nullptr, sizeof(uint32_t), NUM_CLUSTERS * MAX_LIGHTS_PER_CLUSTER);
+
+	_lightCounter = ShaderStorageBuffer::Create(BufferUsage::DynamicCopy);
+	_lightCounter->LoadData(nullptr, sizeof(uint32_t), 1);
+
+	// Start with every cluster empty, so nothing reads garbage before the first cull pass has run
+	uint32_t zero = 0;
+	glClearNamedBufferData(_lightGrid->GetHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glClearNamedBufferData(_lightIndices->GetHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	_params = std::make_shared<UniformBuffer<ClusterParams>>(BufferUsage::DynamicDraw);
+}
+
+ClusteredLightGrid::~ClusteredLightGrid() = default;
+
+void ClusteredLightGrid::Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& nearFar, bool isOrtho, const glm::ivec2& screenSize, uint32_t numLights) {
+	if (screenSize.x * screenSize.y == 0 || !_boundsShader->IsLinked() || !_cullShader->IsLinked()) {
+		return;
+	}
+
+	// The cluster bounds only depend on the projection, so we can skip rebuilding them most frames
+	if (_isBoundsDirty || projection != _boundsProjection || screenSize != _boundsScreenSize) {
+		_boundsProjection = projection;
+		_boundsScreenSize = screenSize;
+		_isBoundsDirty = false;
+
+		glm::mat4  inverseProjection = glm::inverse(projection);
+		glm::ivec3 gridSize = glm::ivec3(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z);
+		glm::vec2  screen = glm::vec2(screenSize);
+		// GLSL bools are set as ints
+		int        ortho = isOrtho ? 1 : 0;
+
+		_boundsShader->Bind();
+		_boundsShader->SetUniformMatrix(0, &inverseProjection);
+		_boundsShader->SetUniform(1, &gridSize);
+		_boundsShader->SetUniform(2, &screen);
+		_boundsShader->SetUniform(3, &nearFar);
+		_boundsShader->SetUniform(4, &ortho);
+		_clusterBounds->Bind(CLUSTER_BOUNDS_BINDING);
+		glDispatchCompute((NUM_CLUSTERS + 63) / 64, 1, 1);
+
+		// Fragments find their slice from the log of their view depth, this needs to match
+		// the exponential split in cluster_bounds.glsl
+		float logRatio = glm::log(nearFar.y / nearFar.x);
+		ClusterParams& params = _params->GetData();
+		params.GridSize = glm::uvec4(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z, NUM_CLUSTERS);
+		params.ScaleBias = glm::vec4(
+			GRID_SIZE_X / screen.x,
+			GRID_SIZE_Y / screen.y,
+			GRID_SIZE_Z / logRatio,
+			-(GRID_SIZE_Z * glm::log(nearFar.x)) / logRatio
+		);
+		_params->Update();
+
+		// The cull pass reads the bounds we just wrote
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	// Reset the shared index counter, the cull pass hands out ranges of the index list from it
+	uint32_t zero = 0;
+	glClearNamedBufferData(_lightCounter->GetHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	int lightCount = static_cast<int>(numLights);
+	int clusterCount = static_cast<int>(NUM_CLUSTERS);
+
+	_cullShader->Bind();
+	_cullShader->SetUniformMatrix(0, &view);
+	_cullShader->SetUniform(1, &lightCount);
+	_cullShader->SetUniform(2, &clusterCount);
+	_lightGrid->Bind(LIGHT_GRID_BINDING);
+	_lightIndices->Bind(LIGHT_INDEX_BINDING);
+	_clusterBounds->Bind(CLUSTER_BOUNDS_BINDING);
+	_lightCounter->Bind(LIGHT_COUNTER_BINDING);
+	glDispatchCompute((NUM_CLUSTERS + 127) / 128, 1, 1);
+
+	// Make sure the grid is written before any fragment shaders read from it
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ClusteredLightGrid::Bind() const {
+	// The grid is never filled in if the cull pass failed to compile, so we leave it unbound
+	if (!_cullShader->IsLinked()) {
+		return;
+	}
+	_params->Bind(PARAMS_UBO_BINDING);
+	_lightGrid->Bind(LIGHT_GRID_BINDING);
+	_lightIndices->Bind(LIGHT_INDEX_BINDING);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+#include "Graphics/Buffers/UniformBuffer.h"
+
+/// <summary>
+/// Builds a clustered forward+ light grid on the GPU. The view frustum is split into tiles
+/// on screen and exponential slices in depth, and a compute pass bins the scene's lights
+/// into the clusters they touch. Fragment shaders (see multiple_point_lights.glsl) then
+/// only loop over the lights in their own cluster, so per-fragment cost stays roughly
+/// constant as the number of lights in the scene grows
+/// </summary>
+class ClusteredLightGrid {
+public:
+	MAKE_PTRS(ClusteredLightGrid);
+
+	static inline Sptr Create() {
+		return std::make_shared<ClusteredLightGrid>();
+	}
+
+	// The number of clusters along each axis of the grid
+	static const uint32_t GRID_SIZE_X = 16;
+	static const uint32_t GRID_SIZE_Y = 9;
+	static const uint32_t GRID_SIZE_Z = 24;
+	static const uint32_t NUM_CLUSTERS = GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z;
+	// Must match MAX_LIGHTS_PER_CLUSTER in light_clusters.glsl
+	static const uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+	// Binding slots, must match multiple_point_lights.glsl and the cluster compute shaders
+	static const int PARAMS_UBO_BINDING = 4;
+	static const int LIGHT_GRID_BINDING = 5;
+	static const int LIGHT_INDEX_BINDING = 6;
+	static const int CLUSTER_BOUNDS_BINDING = 7;
+	static const int LIGHT_COUNTER_BINDING = 9;
+
+	ClusteredLightGrid();
+	~ClusteredLightGrid();
+
+	/// <summary>
+	/// Rebuilds the cluster bounds if the projection or screen size changed, then bins the
+	/// lights currently bound to the light buffer slot into the grid
+	/// </summary>
+	/// <param name="view">The camera's view matrix</param>
+	/// <param name="projection">The camera's projection matrix</param>
+	/// <param name="nearFar">The distances to the camera's near and far planes</param>
+	/// <param name="isOrtho">True if the projection is orthographic</param>
+	/// <param name="screenSize">The size of the framebuffer being rendered to, in pixels</param>
+	/// <param name="numLights">The number of lights in the light buffer</param>
+	void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& nearFar, bool isOrtho, const glm::ivec2& screenSize, uint32_t numLights);
+
+	/// <summary>
+	/// Binds the grid and it's parameters for use by fragment shaders, does nothing if the cull shader
+	/// failed to link
+	/// </summary>
+	void Bind() const;
+
+protected:
+	// Matches b_ClusterParams in multiple_point_lights.glsl
+	struct ClusterParams {
+		glm::uvec4 GridSize;
+		glm::vec4  ScaleBias;
+	};
+
+	ShaderProgram::Sptr _boundsShader;
+	ShaderProgram::Sptr _cullShader;
+
+	ShaderStorageBuffer::Sptr _clusterBounds;
+	ShaderStorageBuffer::Sptr _lightGrid;
+	ShaderStorageBuffer::Sptr _lightIndices;
+	ShaderStorageBuffer::Sptr _lightCounter;
+	UniformBuffer<ClusterParams>::Sptr _params;
+
+	// The inputs the cluster bounds were last built with
+	glm::mat4  _boundsProjection;
+	glm::ivec2 _boundsScreenSize;
+	bool       _isBoundsDirty;
+};
@@ -1,26 +1,136 @@
 #include "Graphics/DebugDraw.h"
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/constants.hpp>
+#include "Utils/Profiler.h"
+
+// Number of segments in each of the 3 circles making up the unit sphere
+#define SPHERE_CIRCLE_SEGMENTS 32
+
+// Attributes for the per-instance data, the mat4 takes 4 consecutive slots
+static const std::vector<BufferAttribute> PRIMITIVE_INSTANCE_DECL = {
+	BufferAttribute(2, 4, AttributeType::Float, sizeof(glm::mat4) + sizeof(glm::vec4), 0, AttribUsage::User0),
+	BufferAttribute(3, 4, AttributeType::Float, sizeof(glm::mat4) + sizeof(glm::vec4), 4 * sizeof(float), AttribUsage::User0),
+	BufferAttribute(4, 4, AttributeType::Float, sizeof(glm::mat4) + sizeof(glm::vec4), 8 * sizeof(float), AttribUsage::User0),
+	BufferAttribute(5, 4, AttributeType::Float, sizeof(glm::mat4) + sizeof(glm::vec4), 12 * sizeof(float), AttribUsage::User0),
+	BufferAttribute(6, 4, AttributeType::Float, sizeof(glm::mat4) + sizeof(glm::vec4), 16 * sizeof(float), AttribUsage::Color),
+};
+
+// The unit meshes only need positions
+static const std::vector<BufferAttribute> PRIMITIVE_MESH_DECL = {
+	BufferAttribute(0, 3, AttributeType::Float, sizeof(glm::vec3), 0, AttribUsage::Position)
+};
+
+void DebugDrawer::StreamBuffer::Init(uint32_t stride, uint32_t segmentCapacity) {
+	Stride = stride;
+	SegmentCapacity = segmentCapacity;
+
+	// Storage is immutable so that it can stay mapped while the GPU reads from it
+	BufferMapMode access = BufferMapMode::Write | BufferMapMode::Persistent | BufferMapMode::Coherent;
+	Buffer = VertexBuffer::Create(BufferUsage::DynamicDraw);
+	Buffer->AllocateStorage(nullptr, stride, segmentCapacity * STREAM_SEGMENTS, access);
+	Mapped = reinterpret_cast<uint8_t*>(Buffer->Map(access));
+	LOG_ASSERT(Mapped != nullptr, "Failed to persistently map debug draw buffer!");
+}
+
+void DebugDrawer::StreamBuffer::Release() {
+	for (GLsync& fence : Fences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (Mapped != nullptr) {
+		Buffer->Unmap();
+		Mapped = nullptr;
+	}
+	Buffer = nullptr;
+}
+
+void DebugDrawer::StreamBuffer::NextSegment() {
+	// All draws that read from this segment have been submitted, so fence it off
+	Fences[Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	Segment = (Segment + 1) % STREAM_SEGMENTS;
+
+	// We only stall if the GPU is still reading draws submitted a full ring ago
+	if (Fences[Segment] != nullptr) {
+		while (glClientWaitSync(Fences[Segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(Fences[Segment]);
+		Fences[Segment] = nullptr;
+	}
+
+	Cursor = Segment * SegmentCapacity;
+	DrawStart = Cursor;
+}
 
 DebugDrawer::DebugDrawer() :
-	_colorStack(std::stack<glm::vec3>()),
-	_transformStack(std::stack<glm::mat4>()),
+	_colorStack(),
+	_transformStack(),
 	_viewProjection(glm::mat4(1.0f)),
-	_lineOffset(0),
-	_triangleOffset(0)
+	_isWorldIdentity(true)
 {
-	_linesVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_linesVBO->LoadData<VertexPosCol>(nullptr, LINE_BATCH_SIZE * 2);
+	_lines.Init(sizeof(VertexPosCol), LINE_BATCH_SIZE * 2);
 	_linesVAO = VertexArrayObject::Create();
-	_linesVAO->AddVertexBuffer(_linesVBO, VertexPosCol::V_DECL);
+	_linesVAO->AddVertexBuffer(_lines.Buffer, VertexPosCol::V_DECL);
 
-	_trisVBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
-	_trisVBO->LoadData<VertexPosCol>(nullptr, TRI_BATCH_SIZE * 3);
+	_tris.Init(sizeof(VertexPosCol), TRI_BATCH_SIZE * 3);
 	_trisVAO = VertexArrayObject::Create();
-	_trisVAO->AddVertexBuffer(_trisVBO, VertexPosCol::V_DECL);
+	_trisVAO->AddVertexBuffer(_tris.Buffer, VertexPosCol::V_DECL);
+
+	// Unit cube from -1 to 1 as a line list, frustums reuse this with an inverse view projection
+	std::vector<glm::vec3> cube;
+	cube.reserve(24);
+	for (int axis = 0; axis < 3; axis++) {
+		for (int ix = 0; ix < 4; ix++) {
+			glm::vec3 corner(0.0f);
+			corner[(axis + 1) % 3] = (ix & 1) ? 1.0f : -1.0f;
+			corner[(axis + 2) % 3] = (ix & 2) ? 1.0f : -1.0f;
+			corner[axis] = -1.0f;
+			cube.push_back(corner);
+			corner[axis] = 1.0f;
+			cube.push_back(corner);
+		}
+	}
+
+	VertexBuffer::Sptr cubeMesh = VertexBuffer::Create(BufferUsage::StaticDraw);
+	cubeMesh->AllocateStorage(cube.data(), sizeof(glm::vec3), (uint32_t)cube.size(), BufferMapMode::None);
+	_boxes.Init(sizeof(PrimitiveInstance), PRIMITIVE_BATCH_SIZE);
+	_boxVAO = VertexArrayObject::Create();
+	_boxVAO->AddVertexBuffer(cubeMesh, PRIMITIVE_MESH_DECL);
+	_boxVAO->AddVertexBuffer(_boxes.Buffer, PRIMITIVE_INSTANCE_DECL, true);
+
+	// Unit sphere made of 3 great circles, one around each axis
+	std::vector<glm::vec3> sphere;
+	sphere.reserve(3 * SPHERE_CIRCLE_SEGMENTS * 2);
+	for (int axis = 0; axis < 3; axis++) {
+		for (int ix = 0; ix < SPHERE_CIRCLE_SEGMENTS; ix++) {
+			for (int end = 0; end < 2; end++) {
+				float angle = (ix + end) * glm::two_pi<float>() / SPHERE_CIRCLE_SEGMENTS;
+				glm::vec3 point(0.0f);
+				point[(axis + 1) % 3] = glm::cos(angle);
+				point[(axis + 2) % 3] = glm::sin(angle);
+				sphere.push_back(point);
+			}
+		}
+	}
+
+	VertexBuffer::Sptr sphereMesh = VertexBuffer::Create(BufferUsage::StaticDraw);
+	sphereMesh->AllocateStorage(sphere.data(), sizeof(glm::vec3), (uint32_t)sphere.size(), BufferMapMode::None);
+	_spheres.Init(sizeof(PrimitiveInstance), PRIMITIVE_BATCH_SIZE);
+	_sphereVAO = VertexArrayObject::Create();
+	_sphereVAO->AddVertexBuffer(sphereMesh, PRIMITIVE_MESH_DECL);
+	_sphereVAO->AddVertexBuffer(_spheres.Buffer, PRIMITIVE_INSTANCE_DECL, true);
 
 	_colorStack.push(glm::vec3(1.0f));
 	_transformStack.push(glm::mat4(1.0f));
 }
 
+DebugDrawer::~DebugDrawer() {
+	_lines.Release();
+	_tris.Release();
+	_boxes.Release();
+	_spheres.Release();
+}
+
 void DebugDrawer::PushColor(const glm::vec3& color) {
 	_colorStack.push(color);
 }
@@ -33,15 +143,29 @@ glm::vec3 DebugDrawer::PopColor() {
 }
 
 void DebugDrawer::PushWorldMatrix(const glm::mat4& value) {
-	FlushAll();
 	_transformStack.push(value);
+	_UpdateWorldMatrix();
 }
 
 void DebugDrawer::PopWorldMatrix() {
 	LOG_ASSERT(_transformStack.size() > 1, "Attempting to pop more transforms than you are pushing! Check your code!");
-	FlushAll();
 	_transformStack.pop();
+	_UpdateWorldMatrix();
+}
 
+void DebugDrawer::_UpdateWorldMatrix() {
+	// Lets us skip the per-vertex transform for the common case
+	_isWorldIdentity = _transformStack.top() == glm::mat4(1.0f);
+}
+
+void* DebugDrawer::_Reserve(StreamBuffer& stream, uint32_t count, void(DebugDrawer::* flush)()) {
+	if (stream.Cursor + count > (stream.Segment + 1) * stream.SegmentCapacity) {
+		(this->*flush)();
+		stream.NextSegment();
+	}
+	void* result = stream.Mapped + (size_t)stream.Cursor * stream.Stride;
+	stream.Cursor += count;
+	return result;
 }
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2) {
@@ -54,33 +178,30 @@ void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::
 
 void DebugDrawer::DrawLine(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& color1, const glm::vec3& color2)
 {
-	_lineBuffer[_lineOffset + 0].Color = glm::vec4(color1, 1.0f);
-	_lineBuffer[_lineOffset + 0].Position = p1;
-	_lineBuffer[_lineOffset + 1].Color = glm::vec4(color2, 1.0f);
-	_lineBuffer[_lineOffset + 1].Position = p2;
-
-	_lineOffset += 2;
-	if (_lineOffset >= LINE_BATCH_SIZE) {
-		FlushLines();
+	VertexPosCol* verts = reinterpret_cast<VertexPosCol*>(_Reserve(_lines, 2, &DebugDrawer::FlushLines));
+	if (_isWorldIdentity) {
+		verts[0].Position = p1;
+		verts[1].Position = p2;
+	} else {
+		const glm::mat4& world = _transformStack.top();
+		verts[0].Position = glm::vec3(world * glm::vec4(p1, 1.0f));
+		verts[1].Position = glm::vec3(world * glm::vec4(p2, 1.0f));
 	}
+	verts[0].Color = glm::vec4(color1, 1.0f);
+	verts[1].Color = glm::vec4(color2, 1.0f);
 }
 
 void DebugDrawer::FlushLines()
 {
-	if (_lineOffset > 0) {
+	uint32_t count = _lines.Pending();
+	if (count > 0) {
 		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_linesVBO->LoadData<VertexPosCol>(_lineBuffer, LINE_BATCH_SIZE * 2);
+		__Shader->SetUniformMatrix(0, &_viewProjection);
 		_linesVAO->Bind();
-		_linesVAO->Draw(DrawMode::LineList);
-		_linesVAO->Unbind();
-		_lineOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
+		glDrawArrays(GL_LINES, _lines.DrawStart, count);
+		Profiler::CountDrawCalls();
+		VertexArrayObject::Unbind();
+		_lines.DrawStart = _lines.Cursor;
 	}
 }
 
@@ -95,35 +216,87 @@ void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::v
 
 void DebugDrawer::DrawTri(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3)
 {
-	_triBuffer[_triangleOffset + 0].Color = glm::vec4(c1, 1.0f);
-	_triBuffer[_triangleOffset + 0].Position = p1;
-	_triBuffer[_triangleOffset + 1].Color = glm::vec4(c2, 1.0f);
-	_triBuffer[_triangleOffset + 1].Position = p2;
-	_triBuffer[_triangleOffset + 2].Color = glm::vec4(c3, 1.0f);
-	_triBuffer[_triangleOffset + 2].Position = p3;
-
-	_triangleOffset += 3;
-	if (_triangleOffset >= TRI_BATCH_SIZE) {
-		FlushTris();
+	VertexPosCol* verts = reinterpret_cast<VertexPosCol*>(_Reserve(_tris, 3, &DebugDrawer::FlushTris));
+	if (_isWorldIdentity) {
+		verts[0].Position = p1;
+		verts[1].Position = p2;
+		verts[2].Position = p3;
+	} else {
+		const glm::mat4& world = _transformStack.top();
+		verts[0].Position = glm::vec3(world * glm::vec4(p1, 1.0f));
+		verts[1].Position = glm::vec3(world * glm::vec4(p2, 1.0f));
+		verts[2].Position = glm::vec3(world * glm::vec4(p3, 1.0f));
 	}
+	verts[0].Color = glm::vec4(c1, 1.0f);
+	verts[1].Color = glm::vec4(c2, 1.0f);
+	verts[2].Color = glm::vec4(c3, 1.0f);
 }
 
 void DebugDrawer::FlushTris()
 {
-	if (_triangleOffset > 0) {
+	uint32_t count = _tris.Pending();
+	if (count > 0) {
 		__Shader->Bind();
-		__Shader->SetUniformMatrix("u_MVP", _viewProjection * _transformStack.top());
-		int restorePoint = 0;
-		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &restorePoint);
-		VertexArrayObject::Unbind();
-		_trisVBO->LoadData<VertexPosCol>(_triBuffer, TRI_BATCH_SIZE * 3);
+		__Shader->SetUniformMatrix(0, &_viewProjection);
 		_trisVAO->Bind();
-		_trisVAO->Draw(DrawMode::LineList);
-		_trisVAO->Unbind();
-		_triangleOffset = 0;
-		if (restorePoint != 0) {
-			glBindVertexArray(restorePoint);
-		}
+		glDrawArrays(GL_TRIANGLES, _tris.DrawStart, count);
+		Profiler::CountDrawCalls();
+		VertexArrayObject::Unbind();
+		_tris.DrawStart = _tris.Cursor;
+	}
+}
+
+void DebugDrawer::DrawBox(const glm::vec3& center, const glm::vec3& halfExtents) {
+	DrawBox(center, halfExtents, _colorStack.top());
+}
+
+void DebugDrawer::DrawBox(const glm::vec3& center, const glm::vec3& halfExtents, const glm::vec3& color) {
+	DrawBox(glm::scale(glm::translate(glm::mat4(1.0f), center), halfExtents), color);
+}
+
+void DebugDrawer::DrawBox(const glm::mat4& transform, const glm::vec3& color) {
+	_PushPrimitive(_boxes, transform, color, &DebugDrawer::FlushPrimitives);
+}
+
+void DebugDrawer::DrawSphere(const glm::vec3& center, float radius) {
+	DrawSphere(center, radius, _colorStack.top());
+}
+
+void DebugDrawer::DrawSphere(const glm::vec3& center, float radius, const glm::vec3& color) {
+	glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(radius));
+	_PushPrimitive(_spheres, transform, color, &DebugDrawer::FlushPrimitives);
+}
+
+void DebugDrawer::DrawFrustum(const glm::mat4& viewProjection, const glm::vec3& color) {
+	// The NDC cube mapped back through the inverse view projection, the shader handles the divide by w
+	_PushPrimitive(_boxes, glm::inverse(viewProjection), color, &DebugDrawer::FlushPrimitives);
+}
+
+void DebugDrawer::_PushPrimitive(StreamBuffer& stream, const glm::mat4& transform, const glm::vec3& color, void(DebugDrawer::* flush)()) {
+	PrimitiveInstance* instance = reinterpret_cast<PrimitiveInstance*>(_Reserve(stream, 1, flush));
+	instance->Transform = _isWorldIdentity ? transform : _transformStack.top() * transform;
+	instance->Color = glm::vec4(color, 1.0f);
+}
+
+void DebugDrawer::_DrawPrimitives(StreamBuffer& stream, const VertexArrayObject::Sptr& vao) {
+	uint32_t count = stream.Pending();
+	if (count > 0) {
+		// Base instance offsets the instanced attributes to the start of the pending range
+		vao->Bind();
+		glDrawArraysInstancedBaseInstance(GL_LINES, 0, vao->GetVertexCount(), count, stream.DrawStart);
+		Profiler::CountDrawCalls();
+		stream.DrawStart = stream.Cursor;
+	}
+}
+
+void DebugDrawer::FlushPrimitives()
+{
+	if (_boxes.Pending() > 0 || _spheres.Pending() > 0) {
+		__InstancedShader->Bind();
+		__InstancedShader->SetUniformMatrix(0, &_viewProjection);
+		_DrawPrimitives(_boxes, _boxVAO);
+		_DrawPrimitives(_spheres, _sphereVAO);
+		VertexArrayObject::Unbind();
 	}
 }
 
@@ -131,6 +304,7 @@ void DebugDrawer::FlushAll()
 {
 	FlushLines();
 	FlushTris();
+	FlushPrimitives();
 }
 
 void DebugDrawer::SetViewProjection(const glm::mat4& viewProjection)
@@ -155,6 +329,22 @@ DebugDrawer& DebugDrawer::Get() {
 					outColor = inColor;
 				}
 			)LIT";
+		const char* vs_instanced_source = R"LIT(#version 450
+				layout (location = 0) in vec3 inPosition;
+				layout (location = 2) in mat4 inTransform;
+				layout (location = 6) in vec4 inColor;
+
+				layout (location = 0) out vec4 outColor;
+
+				layout (location = 0) uniform mat4 u_ViewProjection;
+
+				void main() {
+					// Divide by w so that inverse projections (frustums) land in world space
+					vec4 world = inTransform * vec4(inPosition, 1.0);
+					gl_Position = u_ViewProjection * vec4(world.xyz / world.w, 1.0);
+					outColor = inColor;
+				}
+			)LIT";
 		const char* fs_source = R"LIT(#version 450
 				layout (location=0) in  vec4 inColor;
 				layout (location=0) out vec4 outColor;
@@ -168,6 +358,11 @@ DebugDrawer& DebugDrawer::Get() {
 		__Shader->LoadShaderPart(vs_source, ShaderPartType::Vertex);
 		__Shader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
 		__Shader->Link();
+
+		__InstancedShader = ShaderProgram::Create();
+		__InstancedShader->LoadShaderPart(vs_instanced_source, ShaderPartType::Vertex);
+		__InstancedShader->LoadShaderPart(fs_source, ShaderPartType::Fragment);
+		__InstancedShader->Link();
 	}
 	return *__Instance;
 }
@@ -178,5 +373,6 @@ void DebugDrawer::Uninitialize()
 		delete __Instance;
 		__Instance = nullptr;
 		__Shader = nullptr;
+		__InstancedShader = nullptr;
 	}
-}
\ No newline at end of file
+}
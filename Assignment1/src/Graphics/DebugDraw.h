@@ -1,6 +1,7 @@
 #pragma once
 #include <GLM/glm.hpp>
 #include <stack>
+#include <vector>
 #include "Graphics/VertexTypes.h"
 #include "Graphics/ShaderProgram.h"
 
@@ -9,12 +10,20 @@
 /// 
 /// Includes a stack for transformations and color, to ease implementation of complex
 /// debuggers
+/// 
+/// Vertices are written straight into persistently mapped buffers that are split into
+/// fenced segments, so only the range that was actually used gets drawn and changing the
+/// transform no longer forces a flush. Boxes, spheres and frustums are expanded from unit
+/// meshes on the GPU via instancing
 /// </summary>
 class DebugDrawer
 {
 public:
 	inline static const size_t LINE_BATCH_SIZE = 8192;
 	inline static const size_t TRI_BATCH_SIZE = 4096;
+	inline static const size_t PRIMITIVE_BATCH_SIZE = 1024;
+	// The number of fenced segments each streaming buffer is split into
+	inline static const size_t STREAM_SEGMENTS = 3;
 
 	// Delete copy and mode
 
@@ -23,7 +32,7 @@ public:
 	DebugDrawer& operator =(const DebugDrawer& other) = delete;
 	DebugDrawer& operator =(DebugDrawer&& other) = delete;
 
-	virtual ~DebugDrawer() = default;
+	virtual ~DebugDrawer();
 
 	/// <summary>
 	/// Gets the singleton instance of the debug drawer
@@ -47,12 +56,13 @@ public:
 	glm::vec3 PopColor();
 
 	/// <summary>
-	/// Pushes a new transform to the stack, replacing the existing value and flushing all lines and tris
+	/// Pushes a new transform to the stack, replacing the existing value. Elements are transformed
+	/// as they are added, so this does not flush
 	/// </summary>
 	/// <param name="world">The new world transform to use for drawing</param>
 	void PushWorldMatrix(const glm::mat4& world);
 	/// <summary>
-	/// Pops a transform from the stack, replacing the existing value and flushing all lines and tris
+	/// Pops a transform from the stack, replacing the existing value
 	/// </summary>
 	void PopWorldMatrix();
 
@@ -116,7 +126,50 @@ public:
 	void FlushTris();
 
 	/// <summary>
-	/// Flushes any remaining triangles and lines, drawing them to the screen and resetting their counters
+	/// Draws a wireframe box using the current debug color
+	/// </summary>
+	/// <param name="center">The center of the box</param>
+	/// <param name="halfExtents">The distance from the center to each face of the box</param>
+	void DrawBox(const glm::vec3& center, const glm::vec3& halfExtents);
+	/// <summary>
+	/// Draws a wireframe box with a given color
+	/// </summary>
+	/// <param name="center">The center of the box</param>
+	/// <param name="halfExtents">The distance from the center to each face of the box</param>
+	/// <param name="color">Color for the box</param>
+	void DrawBox(const glm::vec3& center, const glm::vec3& halfExtents, const glm::vec3& color);
+	/// <summary>
+	/// Draws a wireframe box by transforming the unit cube (-1 to 1 on each axis)
+	/// </summary>
+	/// <param name="transform">The transform to apply to the unit cube</param>
+	/// <param name="color">Color for the box</param>
+	void DrawBox(const glm::mat4& transform, const glm::vec3& color);
+	/// <summary>
+	/// Draws a wireframe sphere using the current debug color
+	/// </summary>
+	/// <param name="center">The center of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	void DrawSphere(const glm::vec3& center, float radius);
+	/// <summary>
+	/// Draws a wireframe sphere with a given color
+	/// </summary>
+	/// <param name="center">The center of the sphere</param>
+	/// <param name="radius">The radius of the sphere</param>
+	/// <param name="color">Color for the sphere</param>
+	void DrawSphere(const glm::vec3& center, float radius, const glm::vec3& color);
+	/// <summary>
+	/// Draws the outline of a camera frustum
+	/// </summary>
+	/// <param name="viewProjection">The view projection matrix of the camera to visualize</param>
+	/// <param name="color">Color for the frustum</param>
+	void DrawFrustum(const glm::mat4& viewProjection, const glm::vec3& color = glm::vec3(1.0f));
+	/// <summary>
+	/// Flushes all boxes, spheres and frustums to the screen
+	/// </summary>
+	void FlushPrimitives();
+
+	/// <summary>
+	/// Flushes any remaining triangles, lines and primitives, drawing them to the screen and resetting their counters
 	/// </summary>
 	void FlushAll();
 
@@ -128,21 +181,58 @@ public:
 protected:
 	DebugDrawer();
 
-	std::stack<glm::vec3> _colorStack;
-	std::stack<glm::mat4> _transformStack;
+	/// <summary>
+	/// Per-instance data for the instanced primitives, the transform maps the unit mesh into world space
+	/// </summary>
+	struct PrimitiveInstance {
+		glm::mat4 Transform;
+		glm::vec4 Color;
+	};
+
+	/// <summary>
+	/// A persistently mapped vertex buffer, split into segments that are fenced once the GPU
+	/// has been handed all of their draws. Elements between DrawStart and Cursor are pending
+	/// </summary>
+	struct StreamBuffer {
+		VertexBuffer::Sptr Buffer;
+		uint8_t*  Mapped = nullptr;
+		uint32_t  Stride = 0;
+		uint32_t  SegmentCapacity = 0;
+		uint32_t  Segment = 0;
+		uint32_t  Cursor = 0;
+		uint32_t  DrawStart = 0;
+		GLsync    Fences[STREAM_SEGMENTS] = { };
+
+		void Init(uint32_t stride, uint32_t segmentCapacity);
+		void Release();
+		void NextSegment();
+		uint32_t Pending() const { return Cursor - DrawStart; }
+	};
+
+	// Reserves space for count elements in the stream, flushing and moving to the next segment if needed
+	void* _Reserve(StreamBuffer& stream, uint32_t count, void(DebugDrawer::*flush)());
+	void _PushPrimitive(StreamBuffer& stream, const glm::mat4& transform, const glm::vec3& color, void(DebugDrawer::*flush)());
+	void _DrawPrimitives(StreamBuffer& stream, const VertexArrayObject::Sptr& vao);
+	void _UpdateWorldMatrix();
+
+	// Backed by vectors so pushing and popping every frame re-uses the same storage, rather than
+	// allocating deque blocks
+	std::stack<glm::vec3, std::vector<glm::vec3>> _colorStack;
+	std::stack<glm::mat4, std::vector<glm::mat4>> _transformStack;
 	glm::mat4    _viewProjection;
-	glm::mat4    _worldMatrix;
+	bool         _isWorldIdentity;
 
-	size_t       _lineOffset;
-	VertexPosCol _lineBuffer[LINE_BATCH_SIZE * 2];
-	size_t       _triangleOffset;
-	VertexPosCol _triBuffer[TRI_BATCH_SIZE * 3];
+	StreamBuffer _lines;
+	StreamBuffer _tris;
+	StreamBuffer _boxes;
+	StreamBuffer _spheres;
 
-	VertexBuffer::Sptr _linesVBO;
 	VertexArrayObject::Sptr _linesVAO;
-	VertexBuffer::Sptr _trisVBO;
 	VertexArrayObject::Sptr _trisVAO;
+	VertexArrayObject::Sptr _boxVAO;
+	VertexArrayObject::Sptr _sphereVAO;
 
 	inline static DebugDrawer* __Instance = nullptr;
 	inline static ShaderProgram::Sptr __Shader = nullptr;
+	inline static ShaderProgram::Sptr __InstancedShader = nullptr;
 };
\ No newline at end of file
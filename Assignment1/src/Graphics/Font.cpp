@@ -1,16 +1,27 @@
 #include "Graphics/Font.h"
 #include "Utils/FileHelpers.h"
+#include "Utils/StringUtils.h"
 #include "Utils/JsonGlmHelpers.h"
 #include <set>
-#include <codecvt>
-#include <locale>
 #include <cstdint>
 #include <stb_rect_pack.h>
+#include <chrono>
 #include "Utils/JsonGlmHelpers.h"
 
 #define OVERSAMPLE_X 1
 #define OVERSAMPLE_Y 1
 #define PADDING 1
+// Kerning is tabled for pairs of codepoints up to this value (end of Latin Extended-B)
+#define KERNING_TABLE_MAX_CODEPOINT 0x024Fu
+// The default size of glyph cache atlases, in pixels
+#define GLYPH_CACHE_DEFAULT_SIZE 1024
+// Number of pixels of distance field around each SDF glyph, and the scaling from
+// pixels to distance values (so the field reaches 0 at the edge of the padding)
+#define SDF_PADDING 4
+#define SDF_ON_EDGE_VALUE 128
+#define SDF_PIXEL_DIST_SCALE (128.0f / SDF_PADDING)
+
+uint64_t Font::__frameIndex = 0;
 
 Font::Font() : Font("", 0.0f) { }
 
@@ -27,8 +38,21 @@ Font::Font(const std::string& fontPath, float size) :
 	_pixelHeightScale(0.0f),
 	_fontInfo(stbtt_fontinfo()),
 	_defaultGlyph(GlyphInfo()),
-	_atlasWidth(256),
-	_atlasHeight(256)
+	_atlasWidth(0),
+	_atlasHeight(0),
+	_kerningTable(),
+	_kerningTableMax(0),
+	_isKerningLazy(false),
+	_mode(FontAtlasMode::Bitmap),
+	_isDynamic(false),
+	_atlasVersion(0),
+	_stats(Stats()),
+	_cells(),
+	_freeCells(),
+	_cellScratch(),
+	_cellSize(glm::uvec2(0)),
+	_cellsPerRow(0),
+	_hasWarnedFull(false)
 {
 	// For the box character
 	_glyphRanges.push_back({ 0xE000u, 0xE000u });
@@ -79,29 +103,96 @@ void Font::Load(const std::string& fontPath, float size /*= 16.0f*/)
 }
 
 void Font::AddGlyphRange(uint32_t min, uint32_t max) {
-	LOG_ASSERT(_atlas == nullptr, "Cannot add glyphs after the font has been baked!");
+	LOG_ASSERT(_atlas == nullptr || _isDynamic, "Cannot add glyphs after the font has been baked!");
 	_glyphRanges.push_back({ min, max });
+
+	// Dynamic fonts can warm the cache with the new range immediately
+	if (_atlas != nullptr && _isDynamic) {
+		for (uint32_t ix = min; ix <= max; ix++) {
+			if (_glyphMap.find(ix) == _glyphMap.end()) {
+				__RasterizeGlyph(ix);
+			}
+		}
+	}
+}
+
+void Font::SetAtlasMode(FontAtlasMode mode) {
+	LOG_ASSERT(_atlas == nullptr, "Cannot change atlas mode after the font has been baked!");
+	_mode = mode;
+}
+
+FontAtlasMode Font::GetAtlasMode() const {
+	return _mode;
+}
+
+void Font::SetDynamic(bool value) {
+	LOG_ASSERT(_atlas == nullptr, "Cannot enable the glyph cache after the font has been baked!");
+	_isDynamic = value;
+}
+
+bool Font::IsDynamic() const {
+	return _isDynamic;
+}
+
+void Font::SetAtlasSize(uint32_t width, uint32_t height) {
+	LOG_ASSERT(_atlas == nullptr, "Cannot resize the atlas after the font has been baked!");
+	_atlasWidth = width;
+	_atlasHeight = height;
+}
+
+void Font::AdvanceFrame() {
+	__frameIndex++;
 }
 
 void Font::Bake() {
 	LOG_ASSERT(_atlas == nullptr, "Bake has already been called!");
 	LOG_ASSERT(_fontInfo.data != nullptr, "Have not loaded a font asset!");
 
-	uint8_t* rawFontData = reinterpret_cast<uint8_t*>(_fontData.data());
+	auto start = std::chrono::high_resolution_clock::now();
 
 	// Collect all codepoint ranges into a set, so we have a list of unique codepoints
 	std::set<int> codePoints;
-	uint32_t numCodepoints = 0;
 	for (const auto& range : _glyphRanges) {
 		for (uint32_t ix = range.x; ix <= range.y; ix++) {
 			// skip if the font doesn't have that glyph
 			if (!stbtt_FindGlyphIndex(&_fontInfo, ix)) {
 				continue;
 			}
-			numCodepoints += codePoints.emplace(ix).second ? 1 : 0;
+			codePoints.emplace(ix);
 		}
 	}
 
+	// SDF and dynamic fonts rasterize glyphs into fixed size cells, otherwise we pack
+	// all glyphs tightly into a single atlas up front
+	if (_mode == FontAtlasMode::Sdf || _isDynamic) {
+		__BakeGlyphCache(codePoints);
+	} else {
+		__BakePacked(codePoints);
+	}
+
+	__BuildKerningTable();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	_stats.BakeTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+	_stats.AtlasBytes = (size_t)_atlasWidth * _atlasHeight; // Atlases are single channel 8 bit
+	_stats.GlyphCount = static_cast<uint32_t>(_glyphMap.size());
+
+	LOG_INFO("Baked font \"{}\" ({}{}): {} glyphs, {}x{} atlas ({} KB) in {:.2f}ms",
+		_fontPath, ~_mode, _isDynamic ? ", dynamic" : "", _stats.GlyphCount,
+		_atlasWidth, _atlasHeight, _stats.AtlasBytes / 1024, _stats.BakeTimeMs);
+}
+
+void Font::__BakePacked(const std::set<int>& codePoints)
+{
+	uint8_t* rawFontData = reinterpret_cast<uint8_t*>(_fontData.data());
+	uint32_t numCodepoints = static_cast<uint32_t>(codePoints.size());
+
+	// The packed atlas defaults to 256x256 if a size has not been set
+	if (_atlasWidth == 0 || _atlasHeight == 0) {
+		_atlasWidth = 256;
+		_atlasHeight = 256;
+	}
+
 	// Allocate our glyph data for the number of unicode character's we're supporting
 	_glyphs = new stbtt_packedchar[numCodepoints];
 	memset(_glyphs, 0, sizeof(stbtt_packedchar) * numCodepoints);
@@ -198,16 +289,245 @@ void Font::Bake() {
 		if (codepoint == 0xE000u)
 			_defaultGlyph = _glyphMap[codepoint];
 	}
+
+}
+
+void Font::__BakeGlyphCache(const std::set<int>& codePoints)
+{
+	// The cache defaults to 1024x1024 if a size has not been set
+	if (_atlasWidth == 0 || _atlasHeight == 0) {
+		_atlasWidth = GLYPH_CACHE_DEFAULT_SIZE;
+		_atlasHeight = GLYPH_CACHE_DEFAULT_SIZE;
+	}
+
+	// Create a texture to store the atlas, we never generate mips since glyphs can change
+	Texture2DDescription desc;
+	desc.Width = _atlasWidth;
+	desc.Height = _atlasHeight;
+	desc.Format = InternalFormat::R8;
+	desc.GenerateMipMaps = false;
+	desc.MinificationFilter = MinFilter::Linear;
+	desc.MagnificationFilter = MagFilter::Linear;
+	desc.HorizontalWrap = WrapMode::ClampToEdge;
+	desc.VerticalWrap = WrapMode::ClampToEdge;
+	_atlas = std::make_shared<Texture2D>(desc);
+	_atlas->Clear(glm::vec4(0.0f));
+
+	// Every cell is large enough for the largest glyph in the font, SDF glyphs are padded on
+	// all sides. We also leave a pixel of padding on one side so glyphs don't bleed when filtered
+	int x0, y0, x1, y1;
+	stbtt_GetFontBoundingBox(&_fontInfo, &x0, &y0, &x1, &y1);
+	uint32_t sdfPadding = _mode == FontAtlasMode::Sdf ? SDF_PADDING * 2 : 0;
+	_cellSize.x = (uint32_t)glm::ceil((x1 - x0) * _pixelHeightScale) + sdfPadding + PADDING + 1;
+	_cellSize.y = (uint32_t)glm::ceil((y1 - y0) * _pixelHeightScale) + sdfPadding + PADDING + 1;
+	// Keep rows 4 byte aligned, since that's the default unpack alignment
+	_cellSize.x = (_cellSize.x + 3) & ~3u;
+
+	_cellsPerRow = _atlasWidth / _cellSize.x;
+	uint32_t rows = _atlasHeight / _cellSize.y;
+	_cells.clear();
+	_cells.resize(_cellsPerRow * rows);
+	_freeCells.clear();
+	for (int32_t ix = static_cast<int32_t>(_cells.size()) - 1; ix >= 0; ix--) {
+		_freeCells.push_back(ix);
+	}
+	_cellScratch.resize(_cellSize.x * (size_t)_cellSize.y);
+	_stats.CacheCapacity = static_cast<uint32_t>(_cells.size());
+	_hasWarnedFull = false;
+
+	_glyphMap.clear();
+
+	// The default glyph is pinned, since missing codepoints will reference it's cell
+	if (stbtt_FindGlyphIndex(&_fontInfo, 0xE000u)) {
+		const GlyphInfo* glyph = __RasterizeGlyph(0xE000u);
+		if (glyph != nullptr) {
+			_cells[glyph->Cell].IsPinned = true;
+			_defaultGlyph = *glyph;
+		}
+	}
+
+	// Warm the cache with the requested ranges, if there's not enough room we'll warn and skip the rest
+	for (uint32_t codepoint : codePoints) {
+		if (_glyphMap.find(codepoint) == _glyphMap.end() && __RasterizeGlyph(codepoint) == nullptr) {
+			break;
+		}
+	}
+}
+
+int32_t Font::__AllocateCell()
+{
+	if (_freeCells.size() > 0) {
+		int32_t result = _freeCells.back();
+		_freeCells.pop_back();
+		return result;
+	}
+
+	// Find the least recently used cell
+	int32_t  oldest = -1;
+	uint64_t oldestFrame = UINT64_MAX;
+	for (int32_t ix = 0; ix < static_cast<int32_t>(_cells.size()); ix++) {
+		if (!_cells[ix].IsPinned && _cells[ix].LastFrame < oldestFrame) {
+			oldest = ix;
+			oldestFrame = _cells[ix].LastFrame;
+		}
+	}
+
+	// If every glyph has been used this frame, evicting one would corrupt text that has already been drawn
+	if (oldest < 0 || oldestFrame == __frameIndex) {
+		if (!_hasWarnedFull) {
+			LOG_WARN("Glyph cache for font \"{}\" is full ({} glyphs), consider increasing the atlas size", _fontPath, _cells.size());
+			_hasWarnedFull = true;
+		}
+		return -1;
+	}
+	return oldest;
+}
+
+const GlyphInfo* Font::__RasterizeGlyph(uint32_t codePoint)
+{
+	// If the font doesn't have the glyph we hand back the default glyph, but don't cache it, since
+	// a copy in the glyph map would go stale once the default glyph or the font's glyph source changes
+	int glyphIndex = stbtt_FindGlyphIndex(&_fontInfo, codePoint);
+	if (glyphIndex == 0) {
+		return &_defaultGlyph;
+	}
+
+	int32_t cellIndex = __AllocateCell();
+	if (cellIndex < 0) {
+		return nullptr;
+	}
+
+	// Evict the previous glyph from the cell, this invalidates any cached UVs
+	CacheCell& cell = _cells[cellIndex];
+	if (cell.InUse) {
+		_glyphMap.erase(cell.Codepoint);
+		_atlasVersion++;
+		_stats.CacheEvictions++;
+	}
+	cell.Codepoint = codePoint;
+	cell.LastFrame = __frameIndex;
+	cell.InUse = true;
+	_stats.CacheMisses++;
+
+	// Rasterize the glyph, SDF glyphs are padded so the distance field has room to fall off
+	int width, height, xOff, yOff;
+	uint8_t* bitmap = nullptr;
+	if (_mode == FontAtlasMode::Sdf) {
+		bitmap = stbtt_GetGlyphSDF(&_fontInfo, _pixelHeightScale, glyphIndex, SDF_PADDING, SDF_ON_EDGE_VALUE, SDF_PIXEL_DIST_SCALE, &width, &height, &xOff, &yOff);
+	} else {
+		bitmap = stbtt_GetGlyphBitmap(&_fontInfo, _pixelHeightScale, _pixelHeightScale, glyphIndex, &width, &height, &xOff, &yOff);
+	}
+	if (bitmap == nullptr) {
+		// Whitespace has no bitmap
+		width = height = xOff = yOff = 0;
+	}
+	int stride = width;
+	width  = glm::min(width,  (int)_cellSize.x - PADDING);
+	height = glm::min(height, (int)_cellSize.y - PADDING);
+
+	// Copy into a cleared cell sized buffer, so nothing is left behind from the evicted glyph
+	memset(_cellScratch.data(), 0, _cellScratch.size());
+	for (int iy = 0; iy < height; iy++) {
+		memcpy(&_cellScratch[iy * _cellSize.x], &bitmap[iy * stride], width);
+	}
+	if (bitmap != nullptr) {
+		if (_mode == FontAtlasMode::Sdf) {
+			stbtt_FreeSDF(bitmap, nullptr);
+		} else {
+			stbtt_FreeBitmap(bitmap, nullptr);
+		}
+	}
+
+	glm::uvec2 origin = glm::uvec2(cellIndex % _cellsPerRow, cellIndex / _cellsPerRow) * _cellSize;
+	_atlas->LoadData(_cellSize.x, _cellSize.y, PixelFormat::Red, PixelType::UByte, _cellScratch.data(), origin.x, origin.y);
+
+	int advance, leftBearing;
+	stbtt_GetGlyphHMetrics(&_fontInfo, glyphIndex, &advance, &leftBearing);
+
+	// Build the glyph info to match the layout from __CreateGlyph
+	float xmin = (float)xOff;
+	float xmax = (float)(xOff + width);
+	float ymin = (float)(yOff + height);
+	float ymax = (float)yOff;
+	glm::vec2 uvMin = glm::vec2(origin) / glm::vec2(_atlasWidth, _atlasHeight);
+	glm::vec2 uvMax = glm::vec2(origin + glm::uvec2(width, height)) / glm::vec2(_atlasWidth, _atlasHeight);
+
+	GlyphInfo& info = _glyphMap[codePoint];
+	info = GlyphInfo();
+	info.OffsetX      = advance * _pixelHeightScale;
+	info.OffsetY      = 0.0f;
+	info.Positions[0] = { xmax, ymin };
+	info.Positions[1] = { xmax, ymax };
+	info.Positions[2] = { xmin, ymax };
+	info.Positions[3] = { xmin, ymin };
+	info.UVs[0]       = { uvMax.x, uvMax.y };
+	info.UVs[1]       = { uvMax.x, uvMin.y };
+	info.UVs[2]       = { uvMin.x, uvMin.y };
+	info.UVs[3]       = { uvMin.x, uvMax.y };
+	info.IsPacked     = true;
+	info.Cell         = cellIndex;
+
+	return &info;
+}
+
+void Font::__BuildKerningTable()
+{
+	_kerningTable.clear();
+	_kerningTableMax = KERNING_TABLE_MAX_CODEPOINT;
+
+	// stb can only list the legacy kern table, fonts that kern with GPOS (or not at all) get
+	// their pairs looked up and cached the first time GetKerning sees them
+	int length = _fontInfo.gpos == 0 ? stbtt_GetKerningTableLength(&_fontInfo) : 0;
+	_isKerningLazy = length == 0;
+	if (_isKerningLazy) {
+		return;
+	}
+
+	// The kern table is keyed by glyph, so map glyphs back to the codepoints that use them
+	std::unordered_multimap<int, uint32_t> codepointsByGlyph;
+	for (uint32_t codepoint = 0; codepoint <= _kerningTableMax; codepoint++) {
+		int glyph = stbtt_FindGlyphIndex(&_fontInfo, codepoint);
+		if (glyph != 0) {
+			codepointsByGlyph.emplace(glyph, codepoint);
+		}
+	}
+
+	// Only store pairs with kerning, a missing entry means no kerning
+	std::vector<stbtt_kerningentry> entries(length);
+	length = stbtt_GetKerningTable(&_fontInfo, entries.data(), length);
+	for (int ix = 0; ix < length; ix++) {
+		const stbtt_kerningentry& entry = entries[ix];
+		if (entry.advance == 0) {
+			continue;
+		}
+		auto lefts  = codepointsByGlyph.equal_range(entry.glyph1);
+		auto rights = codepointsByGlyph.equal_range(entry.glyph2);
+		for (auto left = lefts.first; left != lefts.second; left++) {
+			for (auto right = rights.first; right != rights.second; right++) {
+				_kerningTable[((uint64_t)left->second << 32) | right->second] = entry.advance * _pixelHeightScale;
+			}
+		}
+	}
 }
 
 const Texture2D::Sptr& Font::GetAtlas() {
 	return _atlas;
 }
 
-GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const {
-	// Try and get glyph info from the codepoint, otherwise grab the default glyph
-	auto it = _glyphMap.find(codePoint);		
-	GlyphInfo result = it == _glyphMap.end() ? _defaultGlyph : it->second;
+GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) {
+	// Try and get glyph info from the codepoint, dynamic fonts will rasterize missing glyphs,
+	// otherwise grab the default glyph
+	const GlyphInfo* glyph = &_defaultGlyph;
+	auto it = _glyphMap.find(codePoint);
+	if (it != _glyphMap.end()) {
+		glyph = &it->second;
+		TouchCell(glyph->Cell);
+	} else if (_isDynamic && _atlas != nullptr) {
+		const GlyphInfo* rasterized = __RasterizeGlyph(codePoint);
+		glyph = rasterized != nullptr ? rasterized : &_defaultGlyph;
+	}
+
+	GlyphInfo result = *glyph;
 
 	result.OffsetX += offsetX;
 	result.OffsetY += offsetY;
@@ -216,6 +536,21 @@ GlyphInfo Font::GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const
 }
 
 float Font::GetKerning(int char1, int char2) const {
+	// Most text will hit the table, which is either built during Bake or filled in as pairs are seen
+	if ((uint32_t)char1 <= _kerningTableMax && (uint32_t)char2 <= _kerningTableMax) {
+		uint64_t key = ((uint64_t)(uint32_t)char1 << 32) | (uint32_t)char2;
+		auto it = _kerningTable.find(key);
+		if (it != _kerningTable.end()) {
+			return it->second;
+		}
+		if (!_isKerningLazy) {
+			return 0.0f;
+		}
+		// Lazy tables also store pairs with no kerning, so each pair only queries the font once
+		float result = stbtt_GetCodepointKernAdvance(&_fontInfo, char1, char2) * _pixelHeightScale;
+		_kerningTable[key] = result;
+		return result;
+	}
 	return stbtt_GetCodepointKernAdvance(&_fontInfo, char1, char2) * _pixelHeightScale;
 }
 
@@ -223,13 +558,9 @@ float Font::GetLineHeight() const {
 	return (_ascent - _descent + _lineGap) * _pixelHeightScale;
 }
 
-glm::vec2 Font::MeausureString(const std::string& text, const float scale /*= 1.0f*/) {
-	// We can convert an ASCII string to unicode!
-	std::wstring unicode = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(text);
-	return MeausureString(unicode, scale);
-}
-
-glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1.0f*/) {
+// Measures a sequence of codepoints, next is called to get each codepoint and returns false at the end of the text
+template <typename NextFn>
+static glm::vec2 MeasureCodepoints(Font& font, NextFn next, const float scale) {
 	// Will cache the current glyph
 	GlyphInfo glyph;
 
@@ -240,25 +571,26 @@ glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1
 	float totalHeight = 0.0f;
 
 	// Iterate over all characters, ascii and unicode overlap in the 0-255 range!
-	for (size_t i = 0; i < text.size(); i++) {
-		glyph = GetGlyph(text[i], xOff, yOff);
+	uint32_t codepoint;
+	while (next(codepoint)) {
+		glyph = font.GetGlyph(codepoint, xOff, yOff);
 		xOff = glyph.OffsetX;
 		yOff = glyph.OffsetY;
 
 		lineHeight = glm::max(lineHeight, -glyph.Positions[1].y);
 		maxWidth = glm::max(maxWidth, xOff);
 
-		if (text[i] == '\n')
+		if (codepoint == '\n')
 		{
-			yOff += GetLineHeight();
+			yOff += font.GetLineHeight();
 			totalHeight += lineHeight;
 			lineHeight = 0.0f;
 			xOff = 0;
-		} else if (text[i] == '\r') {
+		} else if (codepoint == '\r') {
 			xOff = 0;
-		} else if (text[i] == '\t') {
+		} else if (codepoint == '\t') {
 			float xOffTemp{ 0 }, yOffTemp{ 0 };
-			glyph = GetGlyph(' ', xOffTemp, yOffTemp);
+			glyph = font.GetGlyph(' ', xOffTemp, yOffTemp);
 			xOff += glyph.OffsetX * 4;
 		}
 	}
@@ -266,6 +598,30 @@ glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1
 	return glm::vec2(maxWidth, totalHeight) * scale;
 }
 
+glm::vec2 Font::MeausureString(const std::string& text, const float scale /*= 1.0f*/) {
+	// Decode the UTF-8 in place, rather than converting to a wide string
+	const char* it = text.data();
+	const char* end = text.data() + text.size();
+	return MeasureCodepoints(*this, [&](uint32_t& codepoint) {
+		if (it == end) {
+			return false;
+		}
+		codepoint = StringTools::DecodeUtf8(it, end);
+		return true;
+	}, scale);
+}
+
+glm::vec2 Font::MeausureString(const std::wstring& text, const float scale /*= 1.0f*/) {
+	size_t ix = 0;
+	return MeasureCodepoints(*this, [&](uint32_t& codepoint) {
+		if (ix == text.size()) {
+			return false;
+		}
+		codepoint = static_cast<uint32_t>(text[ix++]);
+		return true;
+	}, scale);
+}
+
 
 GlyphInfo Font::__CreateGlyph(uint32_t index)
 {
@@ -299,7 +655,10 @@ nlohmann::json Font::ToJson() const
 {
 	nlohmann::json blob = {
 		{ "filename", _fontPath },
-		{ "font_size", _fontSize }
+		{ "font_size", _fontSize },
+		{ "mode", ~_mode },
+		{ "dynamic", _isDynamic },
+		{ "atlas_size", glm::uvec2(_atlasWidth, _atlasHeight) }
 	};
 
 	nlohmann::json ranges = std::vector<nlohmann::json>();
@@ -317,6 +676,10 @@ Font::Sptr Font::FromJson(const nlohmann::json& data) {
 	std::string path = JsonGet<std::string>(data, "filename", "");
 	float size = JsonGet(data, "font_size", 16.0f);
 	result->Load(path, size);
+	result->SetAtlasMode(JsonParseEnum(FontAtlasMode, data, "mode", FontAtlasMode::Bitmap));
+	result->SetDynamic(JsonGet(data, "dynamic", false));
+	glm::uvec2 atlasSize = JsonGet(data, "atlas_size", glm::uvec2(0));
+	result->SetAtlasSize(atlasSize.x, atlasSize.y);
 		
 	// Iterate over the ranges and add them to the font
 	if (data.contains("ranges") && data["ranges"].is_array()) {
@@ -4,12 +4,27 @@
 #include "Graphics/Textures/Texture2D.h"
 
 #include <stb_truetype.h>
+#include <EnumToString.h>
+#include <unordered_map>
+#include <set>
+
+	/// <summary>
+	/// Determines how glyphs are stored in a font's atlas
+	/// </summary>
+	ENUM(FontAtlasMode, int,
+		// Glyphs are rasterized at the font size, and will blur when scaled up
+		Bitmap = 0,
+		// Glyphs are stored as signed distance fields, and stay crisp at any scale
+		Sdf    = 1
+	)
 
 	struct GlyphInfo {
 		glm::vec2 Positions[4];
 		glm::vec2 UVs[4];
 		float OffsetX, OffsetY;
 		bool IsPacked;
+		// The glyph cache cell that stores this glyph, or -1 if the glyph was packed by Bake
+		int32_t Cell = -1;
 	};
 
 	/// <summary>
@@ -34,10 +49,88 @@
 		/// <param name="size">The size to render to font in the font atlas</param>
 		void Load(const std::string& fontPath, float size = 16.0f);
 
+		/// <summary>
+		/// Stores statistics about the font's atlas, used to compare atlas modes
+		/// </summary>
+		struct Stats {
+			// The time taken to bake the font, in milliseconds
+			float    BakeTimeMs = 0.0f;
+			// The amount of GPU memory used by the atlas, in bytes
+			size_t   AtlasBytes = 0;
+			// The number of glyphs currently in the atlas
+			uint32_t GlyphCount = 0;
+			// The maximum number of glyphs the glyph cache can hold at once, 0 if the font is not cached
+			uint32_t CacheCapacity = 0;
+			// The number of glyphs that have been rasterized into the glyph cache
+			uint32_t CacheMisses = 0;
+			// The number of glyphs that have been evicted from the glyph cache
+			uint32_t CacheEvictions = 0;
+		};
+
+		/// <summary>
+		/// Sets how glyphs are stored in the atlas, must be called before Bake
+		/// 
+		/// SDF atlases can be rendered at any text scale without blurring, so a single
+		/// font can be used for all sizes. The font size determines the resolution of the
+		/// distance field, 32-48 gives good results
+		/// </summary>
+		void SetAtlasMode(FontAtlasMode mode);
+		/// <summary>
+		/// Gets how glyphs are stored in the atlas
+		/// </summary>
+		FontAtlasMode GetAtlasMode() const;
+		/// <summary>
+		/// Returns true if the font's atlas stores signed distance fields
+		/// </summary>
+		bool IsSdf() const { return _mode == FontAtlasMode::Sdf; }
+
+		/// <summary>
+		/// Enables the dynamic glyph cache, must be called before Bake. Dynamic fonts
+		/// rasterize missing codepoints into the atlas when they are first used, and will
+		/// evict the least recently used glyphs when the atlas is full, so the atlas size
+		/// stays fixed regardless of how many codepoints are used (ex: CJK text)
+		/// </summary>
+		void SetDynamic(bool value);
+		/// <summary>
+		/// Returns true if the font rasterizes glyphs on demand
+		/// </summary>
+		bool IsDynamic() const;
+
+		/// <summary>
+		/// Sets the size of the atlas texture in pixels, must be called before Bake. If
+		/// not set, bitmap fonts will use a 256x256 atlas and cached fonts (SDF or dynamic)
+		/// will use a 1024x1024 atlas
+		/// </summary>
+		void SetAtlasSize(uint32_t width, uint32_t height);
+
+		/// <summary>
+		/// Gets a counter that is incremented whenever glyphs are evicted from the atlas. If
+		/// this changes, any geometry using glyph UVs from this font must be rebuilt
+		/// </summary>
+		uint32_t GetAtlasVersion() const { return _atlasVersion; }
+		/// <summary>
+		/// Marks a glyph cache cell as used this frame, so that it is not evicted. This
+		/// is done by GetGlyph, and only needs to be called when glyph info is cached
+		/// </summary>
+		/// <param name="cell">The cell from GlyphInfo::Cell</param>
+		void TouchCell(int32_t cell) { if (cell >= 0) { _cells[cell].LastFrame = __frameIndex; } }
+
+		/// <summary>
+		/// Gets statistics about this font's atlas
+		/// </summary>
+		const Stats& GetStats() const { return _stats; }
+
+		/// <summary>
+		/// Advances the frame counter used by the glyph caches. Glyphs used in the current
+		/// frame will never be evicted, should be called once per frame
+		/// </summary>
+		static void AdvanceFrame();
+
 		/// <summary>
 		/// Adds a range of unicode characters to enable in this font.
 		/// Since we are rendering to a texture, we need to know all of the characters
-		/// that we will want to render ahead of time
+		/// that we will want to render ahead of time. Dynamic fonts may add ranges
+		/// after they have been baked, in which case the glyphs will be rasterized immediately
 		/// </summary>
 		/// <param name="min">The minimum unicode character (inclusive)</param>
 		/// <param name="max">The maximum unicode character (inclusive)</param>
@@ -55,14 +148,17 @@
 
 		/// <summary>
 		/// Extracts information about a glyph with the given codepoint, positioning
-		/// it at the offset provided
+		/// it at the offset provided. For dynamic fonts, this will rasterize the glyph
+		/// if it is not already in the atlas
 		/// </summary>
 		/// <param name="codePoint">The unicode codepoint to attempt to lookup</param>
 		/// <param name="offsetX">The x position of the glyph</param>
 		/// <param name="offsetY">The y position of the glyph</param>
-		GlyphInfo GetGlyph(uint32_t codePoint, float offsetX, float offsetY) const;
+		GlyphInfo GetGlyph(uint32_t codePoint, float offsetX, float offsetY);
 		/// <summary>
-		/// Gets the kerning (horizontal space) between 2 unicode characters
+		/// Gets the kerning (horizontal space) between 2 unicode characters. Pairs within
+		/// the kerning table are a table lookup (fonts without a kern table fill it as pairs
+		/// are first seen), other pairs will query the font directly
 		/// </summary>
 		/// <param name="char1">The left character</param>
 		/// <param name="char2">The right character</param>
@@ -113,5 +209,41 @@
 		stbtt_packedchar* _glyphs;
 		stbtt_fontinfo    _fontInfo;
 
+		FontAtlasMode     _mode;
+		bool              _isDynamic;
+		uint32_t          _atlasVersion;
+		Stats             _stats;
+
+		// A single fixed size slot in the glyph cache's atlas
+		struct CacheCell {
+			uint32_t Codepoint = 0;
+			uint64_t LastFrame = 0;
+			bool     InUse     = false;
+			bool     IsPinned  = false;
+		};
+
+		// Glyph cache state, used by SDF and dynamic fonts
+		std::vector<CacheCell> _cells;
+		std::vector<int32_t>   _freeCells;
+		std::vector<uint8_t>   _cellScratch;
+		glm::uvec2             _cellSize;
+		uint32_t               _cellsPerRow;
+		bool                   _hasWarnedFull;
+
+		// Stores kerning between pairs of codepoints, keyed by (left << 32 | right). Built from the
+		// font's kern table during Bake (non-zero pairs only), or filled in by GetKerning when lazy
+		mutable std::unordered_map<uint64_t, float> _kerningTable;
+		// Codepoints above this are not in the kerning table
+		uint32_t          _kerningTableMax;
+		// True if the font has no kern table we can list, and pairs are cached as they're seen
+		bool              _isKerningLazy;
+
+		static uint64_t __frameIndex;
+
 		GlyphInfo __CreateGlyph(uint32_t index);
+		void __BuildKerningTable();
+		void __BakePacked(const std::set<int>& codePoints);
+		void __BakeGlyphCache(const std::set<int>& codePoints);
+		int32_t __AllocateCell();
+		const GlyphInfo* __RasterizeGlyph(uint32_t codePoint);
 	};
\ No newline at end of file
@@ -41,6 +41,12 @@ Framebuffer::Framebuffer(const FramebufferDescriptor& description) :
 	for (const auto& kvp : _description.RenderTargets) {
 		_AddAttachment(kvp.first, kvp.second);
 	}
+
+	// Depth-only framebuffers (ex: shadow maps) have nothing to draw or read color from
+	if (_drawBuffers.empty()) {
+		glNamedFramebufferDrawBuffer(_rendererId, GL_NONE);
+		glNamedFramebufferReadBuffer(_rendererId, GL_NONE);
+	}
 }
 
 Framebuffer::~Framebuffer() {
@@ -60,6 +66,10 @@ glm::ivec2 Framebuffer::GetSize() const {
 	return glm::ivec2(_description.Width, _description.Height);
 }
 
+const FramebufferDescriptor& Framebuffer::GetDescription() const {
+	return _description;
+}
+
 Texture2D::Sptr Framebuffer::GetTextureAttachment(RenderTargetAttachment attachment, bool multisampled) const {
 	// If we are multisampled, and requested a non-multisampled texture, grab from the unsampled framebuffer
 	if (_description.SampleCount > 1 && !multisampled) {
@@ -70,6 +70,10 @@ public:
 	 * Gets the dimensions of the framebuffer and its attachments in pixels
 	 */
 	glm::ivec2 GetSize() const;
+	/**
+	 * Gets the descriptor that this framebuffer was created from
+	 */
+	const FramebufferDescriptor& GetDescription() const;
 
 	/**
 	 * Gets the texture attached to the given render target attachment, or nullptr
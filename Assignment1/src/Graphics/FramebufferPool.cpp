@@ -0,0 +1,97 @@
+#include "Graphics/FramebufferPool.h"
+#include <algorithm>
+
+FramebufferPool::FramebufferPool() :
+	MaxIdleFrames(3),
+	_targets(std::unordered_map<Key, std::vector<Entry>, KeyHasher>()),
+	_frame(0),
+	_stats(Stats())
+{ }
+
+FramebufferPool::~FramebufferPool() = default;
+
+Framebuffer::Sptr FramebufferPool::Acquire(const glm::ivec2& size, RenderTargetType format) {
+	Key key = { std::max(size.x, 1), std::max(size.y, 1), format };
+	std::vector<Entry>& entries = _targets[key];
+
+	for (Entry& entry : entries) {
+		if (!entry.InUse) {
+			entry.InUse = true;
+			entry.LastUsedFrame = _frame;
+			_stats.InUse++;
+			return entry.Target;
+		}
+	}
+
+	FramebufferDescriptor descriptor;
+	descriptor.Width = key.Width;
+	descriptor.Height = key.Height;
+	descriptor.SampleCount = 1;
+	descriptor.RenderTargets[RenderTargetAttachment::Color0] = { true, format };
+
+	Entry entry;
+	entry.Target = std::make_shared<Framebuffer>(descriptor);
+	entry.Target->SetDebugName("Pooled " + (~format) + " " + std::to_string(key.Width) + "x" + std::to_string(key.Height));
+	entry.InUse = true;
+	entry.LastUsedFrame = _frame;
+	entries.push_back(entry);
+
+	_stats.Targets++;
+	_stats.InUse++;
+	_stats.Created++;
+	return entry.Target;
+}
+
+void FramebufferPool::Release(const Framebuffer::Sptr& target) {
+	if (target == nullptr) {
+		return;
+	}
+
+	// Pooled targets only have a Color0 attachment, so that's all we need to find it's bucket
+	Key key = { (int)target->GetWidth(), (int)target->GetHeight(), target->GetDescription().RenderTargets.at(RenderTargetAttachment::Color0).Format };
+	auto it = _targets.find(key);
+	if (it == _targets.end()) {
+		return;
+	}
+
+	for (Entry& entry : it->second) {
+		if (entry.Target == target && entry.InUse) {
+			entry.InUse = false;
+			entry.LastUsedFrame = _frame;
+			_stats.InUse--;
+			return;
+		}
+	}
+}
+
+void FramebufferPool::EndFrame() {
+	_frame++;
+
+	// Old sizes stop being requested after a resize, so they'll age out here
+	for (auto it = _targets.begin(); it != _targets.end();) {
+		std::vector<Entry>& entries = it->second;
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+			return !entry.InUse && _frame - entry.LastUsedFrame > MaxIdleFrames;
+		}), entries.end());
+
+		it = entries.empty() ? _targets.erase(it) : std::next(it);
+	}
+
+	_stats.Targets = 0;
+	for (const auto& [key, entries] : _targets) {
+		_stats.Targets += static_cast<uint32_t>(entries.size());
+	}
+}
+
+void FramebufferPool::Clear() {
+	for (auto it = _targets.begin(); it != _targets.end();) {
+		std::vector<Entry>& entries = it->second;
+		entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) {
+			return !entry.InUse;
+		}), entries.end());
+
+		it = entries.empty() ? _targets.erase(it) : std::next(it);
+	}
+
+	_stats.Targets = _stats.InUse;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Framebuffer.h"
+
+/// <summary>
+/// Hands out single color attachment framebuffers for transient work (ex: post processing passes),
+/// keyed by size and format. Targets that are released go back into the pool and are reused by the
+/// next request with a matching key, so a chain of passes only allocates on the first frame or after
+/// a resize. Targets that have not been used for a few frames are destroyed
+/// </summary>
+class FramebufferPool {
+public:
+	MAKE_PTRS(FramebufferPool);
+
+	static inline Sptr Create() {
+		return std::make_shared<FramebufferPool>();
+	}
+
+	/// <summary>
+	/// Statistics about the targets owned by the pool
+	/// </summary>
+	struct Stats {
+		// The number of targets that currently exist
+		uint32_t Targets;
+		// The number of targets that have been acquired and not released
+		uint32_t InUse;
+		// The total number of targets that have ever been created, should stay flat while nothing resizes
+		uint32_t Created;
+	};
+
+	/// <summary>
+	/// The number of frames a target can go unused before it is destroyed
+	/// </summary>
+	uint32_t MaxIdleFrames;
+
+	FramebufferPool();
+	~FramebufferPool();
+
+	/// <summary>
+	/// Gets a target with the given size and color format, creating one if none are free
+	/// </summary>
+	/// <param name="size">The size of the target in pixels, clamped to at least 1x1</param>
+	/// <param name="format">The format of the target's Color0 attachment</param>
+	Framebuffer::Sptr Acquire(const glm::ivec2& size, RenderTargetType format);
+
+	/// <summary>
+	/// Returns a target to the pool so it can be handed out again. Targets that were not
+	/// acquired from this pool are ignored
+	/// </summary>
+	void Release(const Framebuffer::Sptr& target);
+
+	/// <summary>
+	/// Advances the pool's frame counter, and destroys any free targets that have been idle for too long
+	/// </summary>
+	void EndFrame();
+
+	/// <summary>
+	/// Destroys all free targets
+	/// </summary>
+	void Clear();
+
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	struct Key {
+		int              Width;
+		int              Height;
+		RenderTargetType Format;
+
+		bool operator ==(const Key& other) const {
+			return Width == other.Width && Height == other.Height && Format == other.Format;
+		}
+	};
+
+	struct KeyHasher {
+		size_t operator()(const Key& key) const {
+			return std::hash<uint64_t>()(((uint64_t)key.Width << 48) ^ ((uint64_t)key.Height << 32) ^ (uint64_t)key.Format);
+		}
+	};
+
+	struct Entry {
+		Framebuffer::Sptr Target;
+		bool              InUse;
+		uint64_t          LastUsedFrame;
+	};
+
+	std::unordered_map<Key, std::vector<Entry>, KeyHasher> _targets;
+	uint64_t _frame;
+	Stats    _stats;
+};
@@ -0,0 +1,194 @@
+#include "Graphics/GeometryArena.h"
+#include <algorithm>
+#include "Logging.h"
+
+std::vector<GeometryArena::Sptr> GeometryArena::__arenas;
+
+GeometryAllocation::~GeometryAllocation() {
+	if (Arena != nullptr) {
+		Arena->_Free(*this);
+	}
+}
+
+bool GeometryArena::FreeList::Allocate(uint32_t size, uint32_t& outOffset) {
+	for (auto it = Ranges.begin(); it != Ranges.end(); it++) {
+		if (it->second >= size) {
+			outOffset = it->first;
+			it->first += size;
+			it->second -= size;
+			if (it->second == 0) {
+				Ranges.erase(it);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void GeometryArena::FreeList::Free(uint32_t offset, uint32_t size) {
+	// Find where the range belongs, then merge it with it's neighbours if they touch
+	auto it = std::lower_bound(Ranges.begin(), Ranges.end(), std::make_pair(offset, 0u));
+	it = Ranges.insert(it, std::make_pair(offset, size));
+	if (it + 1 != Ranges.end() && it->first + it->second == (it + 1)->first) {
+		it->second += (it + 1)->second;
+		Ranges.erase(it + 1);
+	}
+	if (it != Ranges.begin() && (it - 1)->first + (it - 1)->second == it->first) {
+		(it - 1)->second += it->second;
+		Ranges.erase(it);
+	}
+}
+
+GeometryArena::Sptr GeometryArena::Get(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t stride) {
+	auto it = std::find_if(__arenas.begin(), __arenas.end(), [&](const Sptr& arena) {
+		if (arena->_stride != stride || arena->_vDecl.size() != vDecl.size()) {
+			return false;
+		}
+		for (size_t ix = 0; ix < vDecl.size(); ix++) {
+			const BufferAttribute& a = arena->_vDecl[ix];
+			const BufferAttribute& b = vDecl[ix];
+			if (a.Slot != b.Slot || a.Size != b.Size || a.Type != b.Type || a.Normalized != b.Normalized || a.Offset != b.Offset) {
+				return false;
+			}
+		}
+		return true;
+	});
+	if (it != __arenas.end()) {
+		return *it;
+	}
+
+	Sptr result = std::make_shared<GeometryArena>(vDecl, stride);
+	__arenas.push_back(result);
+	return result;
+}
+
+GeometryArena::GeometryArena(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t stride) :
+	_vDecl(vDecl),
+	_stride(stride),
+	_pages(std::vector<Page>())
+{ }
+
+GeometryArena::~GeometryArena() = default;
+
+VertexArrayObject::Sptr GeometryArena::Upload(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+	if (vertexCount == 0) {
+		LOG_WARN("Attempting to upload an empty mesh to the geometry arena");
+		return nullptr;
+	}
+	if (indices == nullptr) {
+		indexCount = 0;
+	}
+
+	GeometryAllocation::Sptr allocation = std::make_shared<GeometryAllocation>();
+	allocation->VertexCount = vertexCount;
+	allocation->IndexCount = indexCount;
+	allocation->BoundingSphere = _CalcBoundingSphere(vertices, vertexCount);
+
+	// Find the first page with room for both our vertices and indices
+	bool found = false;
+	for (uint32_t ix = 0; ix < _pages.size() && !found; ix++) {
+		Page& page = _pages[ix];
+		uint32_t baseVertex, firstIndex = 0;
+		if (!page.FreeVertices.Allocate(vertexCount, baseVertex)) {
+			continue;
+		}
+		if (indexCount > 0 && !page.FreeIndices.Allocate(indexCount, firstIndex)) {
+			page.FreeVertices.Free(baseVertex, vertexCount);
+			continue;
+		}
+		allocation->Page = ix;
+		allocation->BaseVertex = baseVertex;
+		allocation->FirstIndex = firstIndex;
+		found = true;
+	}
+
+	if (!found) {
+		allocation->Page = _AddPage(std::max(vertexCount, VERTICES_PER_PAGE), std::max(indexCount, INDICES_PER_PAGE));
+		Page& page = _pages[allocation->Page];
+		page.FreeVertices.Allocate(vertexCount, allocation->BaseVertex);
+		if (indexCount > 0) {
+			page.FreeIndices.Allocate(indexCount, allocation->FirstIndex);
+		}
+	}
+
+	// Only set the arena once we own the ranges, so a failed upload doesn't free anything
+	allocation->Arena = shared_from_this();
+
+	Page& page = _pages[allocation->Page];
+	page.Vertices->UpdateSubData(vertices, allocation->BaseVertex * _stride, vertexCount * _stride);
+	if (indexCount > 0) {
+		page.Indices->UpdateSubData(indices, allocation->FirstIndex * sizeof(uint32_t), indexCount * sizeof(uint32_t));
+	}
+
+	// The mesh gets it's own VAO so it can still be drawn on it's own, it just points at a range of the page
+	VertexArrayObject::Sptr result = VertexArrayObject::Create();
+	if (indexCount > 0) {
+		result->SetIndexBuffer(page.Indices);
+	}
+	result->AddVertexBuffer(page.Vertices, _vDecl);
+	result->SetVDecl(_vDecl);
+	result->SetArenaAllocation(allocation);
+	return result;
+}
+
+uint32_t GeometryArena::_AddPage(uint32_t vertexCapacity, uint32_t indexCapacity) {
+	Page page;
+
+	// Pages never resize, so we can use immutable storage and let the driver place it wherever it likes
+	page.Vertices = VertexBuffer::Create(BufferUsage::StaticDraw);
+	page.Vertices->AllocateStorage(nullptr, _stride, vertexCapacity, BufferMapMode::None);
+	page.Indices = IndexBuffer::Create(BufferUsage::StaticDraw, IndexType::UInt);
+	page.Indices->AllocateStorage(nullptr, sizeof(uint32_t), indexCapacity, BufferMapMode::None);
+
+	page.Vao = VertexArrayObject::Create();
+	page.Vao->SetIndexBuffer(page.Indices);
+	page.Vao->AddVertexBuffer(page.Vertices, _vDecl);
+	page.Vao->SetVDecl(_vDecl);
+
+	page.FreeVertices.Ranges.push_back(std::make_pair(0u, vertexCapacity));
+	page.FreeIndices.Ranges.push_back(std::make_pair(0u, indexCapacity));
+
+	_pages.push_back(page);
+
+	uint32_t index = static_cast<uint32_t>(_pages.size() - 1);
+	page.Vao->SetDebugName("Geometry Arena Page " + std::to_string(index));
+	LOG_INFO("Added geometry arena page {} ({} vertices, {} indices, stride {})", index, vertexCapacity, indexCapacity, _stride);
+	return index;
+}
+
+void GeometryArena::_Free(const GeometryAllocation& allocation) {
+	Page& page = _pages[allocation.Page];
+	page.FreeVertices.Free(allocation.BaseVertex, allocation.VertexCount);
+	if (allocation.IndexCount > 0) {
+		page.FreeIndices.Free(allocation.FirstIndex, allocation.IndexCount);
+	}
+}
+
+glm::vec4 GeometryArena::_CalcBoundingSphere(const void* vertices, uint32_t vertexCount) const {
+	auto it = std::find_if(_vDecl.begin(), _vDecl.end(), [](const BufferAttribute& attrib) {
+		return attrib.Usage == AttribUsage::Position;
+	});
+	if (it == _vDecl.end() || it->Type != AttributeType::Float || it->Size < 3) {
+		return glm::vec4(0.0f);
+	}
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(vertices) + it->Offset;
+	auto getPosition = [&](uint32_t ix) {
+		return *reinterpret_cast<const glm::vec3*>(bytes + (size_t)ix * _stride);
+	};
+
+	// Center the sphere on the bounding box, then grow it to reach the furthest vertex
+	glm::vec3 min = getPosition(0), max = min;
+	for (uint32_t ix = 1; ix < vertexCount; ix++) {
+		glm::vec3 pos = getPosition(ix);
+		min = glm::min(min, pos);
+		max = glm::max(max, pos);
+	}
+	glm::vec3 center = (min + max) * 0.5f;
+	float radiusSq = 0.0f;
+	for (uint32_t ix = 0; ix < vertexCount; ix++) {
+		glm::vec3 delta = getPosition(ix) - center;
+		radiusSq = glm::max(radiusSq, glm::dot(delta, delta));
+	}
+	return glm::vec4(center, glm::sqrt(radiusSq));
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/VertexArrayObject.h"
+
+class GeometryArena;
+
+/// <summary>
+/// A range of vertices and indices that a mesh owns within one of a geometry arena's pages.
+/// The range is handed back to the arena when the allocation is destroyed
+/// </summary>
+struct GeometryAllocation {
+	MAKE_PTRS(GeometryAllocation);
+	NO_COPY(GeometryAllocation);
+	NO_MOVE(GeometryAllocation);
+
+	std::shared_ptr<GeometryArena> Arena;
+	uint32_t Page;
+	uint32_t BaseVertex;
+	uint32_t VertexCount;
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+	// A sphere around the mesh's vertices in model space, center in xyz and radius in w
+	glm::vec4 BoundingSphere;
+
+	GeometryAllocation() : Arena(nullptr), Page(0), BaseVertex(0), VertexCount(0), FirstIndex(0), IndexCount(0), BoundingSphere(glm::vec4(0.0f)) { }
+	~GeometryAllocation();
+};
+
+/// <summary>
+/// Stores the geometry for many meshes that share a vertex layout in a few large vertex and
+/// index buffers. Meshes baked through MeshBuilder and the OBJ loaders sub-allocate from here,
+/// so any meshes in the same page can be drawn with one bound VAO and a single multi-draw call.
+///
+/// Indices are always 32 bit and relative to the mesh's base vertex
+/// </summary>
+class GeometryArena : public std::enable_shared_from_this<GeometryArena> {
+public:
+	DEFINE_RESOURCE(GeometryArena);
+
+	// The default size of a page, meshes larger than this get a page of their own
+	static const uint32_t VERTICES_PER_PAGE = 1 << 18;
+	static const uint32_t INDICES_PER_PAGE = 1 << 20;
+
+	/// <summary>
+	/// Gets the arena for the given vertex layout, creating it if it does not exist yet
+	/// </summary>
+	/// <param name="vDecl">The vertex declaration that the arena's vertices follow</param>
+	/// <param name="stride">The size of a single vertex, in bytes</param>
+	static Sptr Get(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t stride);
+
+	/// <summary>
+	/// Gets the arena for the given vertex type, creating it if it does not exist yet
+	/// </summary>
+	template <typename VertType>
+	static Sptr Get() {
+		return Get(VertType::V_DECL, sizeof(VertType));
+	}
+
+	GeometryArena(const VertexArrayObject::VertexDeclaration& vDecl, uint32_t stride);
+	~GeometryArena();
+
+	/// <summary>
+	/// Copies the given mesh data into the arena, and returns a VAO that draws only that range.
+	/// The returned VAO shares the page's buffers, and frees it's range when destroyed
+	/// </summary>
+	/// <param name="vertices">The vertex data, must match this arena's vertex layout</param>
+	/// <param name="vertexCount">The number of vertices in the mesh</param>
+	/// <param name="indices">The mesh's indices, relative to the first vertex, or nullptr for non-indexed meshes</param>
+	/// <param name="indexCount">The number of indices in the mesh</param>
+	VertexArrayObject::Sptr Upload(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+	/// <summary>
+	/// Gets the VAO that covers an entire page, bind this to draw any mesh within the page
+	/// </summary>
+	const VertexArrayObject::Sptr& GetPageVao(uint32_t page) const { return _pages[page].Vao; }
+	uint32_t GetNumPages() const { return static_cast<uint32_t>(_pages.size()); }
+
+	const VertexArrayObject::VertexDeclaration& GetVDecl() const { return _vDecl; }
+	uint32_t GetStride() const { return _stride; }
+
+	/// <summary>
+	/// Gets all the arenas that have been created so far
+	/// </summary>
+	static const std::vector<Sptr>& GetArenas() { return __arenas; }
+
+protected:
+	friend struct GeometryAllocation;
+
+	// First fit allocator for ranges of elements within a page
+	struct FreeList {
+		// Sorted, non-adjacent (offset, size) pairs
+		std::vector<std::pair<uint32_t, uint32_t>> Ranges;
+
+		bool Allocate(uint32_t size, uint32_t& outOffset);
+		void Free(uint32_t offset, uint32_t size);
+	};
+
+	struct Page {
+		VertexBuffer::Sptr      Vertices;
+		IndexBuffer::Sptr       Indices;
+		VertexArrayObject::Sptr Vao;
+		FreeList                FreeVertices;
+		FreeList                FreeIndices;
+	};
+
+	VertexArrayObject::VertexDeclaration _vDecl;
+	uint32_t                             _stride;
+	std::vector<Page>                    _pages;
+
+	static std::vector<Sptr> __arenas;
+
+	/// <summary>
+	/// Adds a new page to the arena with at least the given capacity
+	/// </summary>
+	/// <returns>The index of the new page</returns>
+	uint32_t _AddPage(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+	void _Free(const GeometryAllocation& allocation);
+
+	/// <summary>
+	/// Calculates a bounding sphere around the positions in some vertex data laid out like our vertices
+	/// </summary>
+	glm::vec4 _CalcBoundingSphere(const void* vertices, uint32_t vertexCount) const;
+};
@@ -2,11 +2,16 @@
 #include <GLM/gtc/matrix_transform.hpp>
 #include <GLM/gtc/matrix_inverse.hpp>
 #include "Utils/ResourceManager/ResourceManager.h"
-#include <locale>
-#include <codecvt>
+#include "Utils/StringUtils.h"
+#include "Utils/Profiler.h"
+#include <string_view>
 
 
-std::unordered_map<Texture2D*, GuiBatcher::MeshData> GuiBatcher::_meshBuilders;
+std::unordered_map<uint64_t, GuiBatcher::TextLayout> GuiBatcher::__textLayouts;
+std::vector<uint32_t> GuiBatcher::__codepointScratch;
+
+GuiBatcher::MeshData GuiBatcher::__immediateMesh;
+FrameVector<GuiBatcher::DrawRun> GuiBatcher::__drawRuns;
 
 VertexArrayObject::Sptr GuiBatcher::__vao = nullptr;
 IndexBuffer::Sptr GuiBatcher::__ibo = nullptr;
@@ -17,47 +22,73 @@ int GuiBatcher::__defaultEdgeRadius = 0;
 VertexBuffer::Sptr GuiBatcher::__vbo = nullptr;
 ShaderProgram::Sptr GuiBatcher::__shader = nullptr;
 ShaderProgram::Sptr GuiBatcher::__fontShader = nullptr;
+ShaderProgram::Sptr GuiBatcher::__sdfFontShader = nullptr;
+ShaderProgram::Sptr GuiBatcher::__bindlessShader = nullptr;
+uint32_t GuiBatcher::__drawCalls = 0;
 glm::ivec2 GuiBatcher::__windowSize = {0, 0};
 glm::mat4 GuiBatcher::__projection = glm::mat4(1.0f);
 glm::mat3 GuiBatcher::__model = glm::mat3(1.0f);
 std::vector<glm::mat3> GuiBatcher::__modelTransformStack = std::vector<glm::mat3>();
 std::vector<GuiBatcher::IRect> GuiBatcher::__scissorRects = std::vector<GuiBatcher::IRect>();
 
-void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
-	// Create vertices and transform positions
-	VertexPosColTex verts[4];
-	verts[0].Position = __model * glm::vec3(min.x, min.y, 1.0f);
-	verts[1].Position = __model * glm::vec3(min.x, max.y, 1.0f);
-	verts[2].Position = __model * glm::vec3(max.x, max.y, 1.0f);
-	verts[3].Position = __model * glm::vec3(max.x, min.y, 1.0f);
-		
-	// Grab mesh info for the texture batch
-	MeshData& mesh = _meshBuilders[tex.get()];
-	// We can use the vertex count for depth, so that things drawn later have a bit of spacing
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
+bool GuiBatcher::__atlasEnabled = true;
+TextureAtlas::Sptr GuiBatcher::__atlas = nullptr;
+
+bool GuiBatcher::__bindlessEnabled = true;
+std::unordered_map<Texture2D*, uint32_t> GuiBatcher::__bindlessSlotMap;
+std::vector<std::weak_ptr<Texture2D>> GuiBatcher::__bindlessTextures;
+std::vector<uint32_t> GuiBatcher::__freeBindlessSlots;
+std::vector<GuiBatcher::BindlessSlot> GuiBatcher::__bindlessTable;
+bool GuiBatcher::__bindlessTableDirty = false;
+ShaderStorageBuffer::Sptr GuiBatcher::__bindlessBuffer = nullptr;
+
+bool GuiBatcher::__retainedMode = true;
+uint64_t GuiBatcher::__frameIndex = 0;
+std::unordered_map<Texture2D*, GuiBatcher::RetainedBatch> GuiBatcher::__retainedBatches;
+GuiBatcher::RetainedBatch GuiBatcher::__bindlessBatch;
+std::vector<GuiBatcher::RetainedElement> GuiBatcher::__retainedElements;
+std::vector<GuiBatcher::ElementHandle> GuiBatcher::__freeElements;
+GuiBatcher::MeshData GuiBatcher::__captureMesh;
+GuiBatcher::ElementHandle GuiBatcher::__captureElement = GuiBatcher::InvalidElement;
+uint64_t GuiBatcher::__arenaFrame = 0;
+glm::uvec2 GuiBatcher::__meshHighWater = glm::uvec2(0);
+
+// The minimum number of quads to allocate when a retained batch is created
+#define RETAINED_MIN_QUADS 256
+// The SSBO binding for the bindless texture table, must match the bindless shader
+#define GUI_TEXTURE_TABLE_BINDING 8
+// Text layouts that have not been used for this many frames will be evicted from the cache
+#define TEXT_LAYOUT_LIFETIME 120
 
-	// Copy in all color and set depth 
-	for (int ix = 0; ix < 4; ix++) {
-		verts[ix].Color = color;
-		verts[ix].Position.z = depth;
+void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, const glm::vec2 uvMin, const glm::vec2 uvMax) {
+	if (tex == nullptr) {
+		return;
 	}
 
-	// Copy over UV coords
-	verts[0].UV = glm::vec2(uvMin.x, uvMax.y);
-	verts[1].UV = glm::vec2(uvMin.x, uvMin.y);
-	verts[2].UV = glm::vec2(uvMax.x, uvMin.y);
-	verts[3].UV = glm::vec2(uvMax.x, uvMax.y);
+	// Find the texture we'll actually draw with (may be an atlas page), and remap our UVs into it
+	glm::vec2 uvOffset, uvScale;
+	const Texture2D::Sptr& resolved = __ResolveTexture(tex, ShadeMode::Sprite, uvOffset, uvScale);
 
-	// Add vertices and indices to range
-	uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 1);
-	mesh.Builder.AddIndexTri(ix + 0, ix + 3, ix + 2);
+	float slot;
+	MeshData& mesh = __GetMesh(resolved, ShadeMode::Sprite, slot);
+	__PushQuad(mesh, min, max, color, slot, uvOffset + uvMin * uvScale, uvOffset + uvMax * uvScale);
 }
 
 void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, const Texture2D::Sptr& tex, int edgeRadius)
 {
+	if (tex == nullptr) {
+		return;
+	}
+
+	// Resolve the texture once for all 9 slices
+	glm::vec2 uvOffset, uvScale;
+	const Texture2D::Sptr& resolved = __ResolveTexture(tex, ShadeMode::Sprite, uvOffset, uvScale);
+
+	float slot;
+	MeshData& mesh = __GetMesh(resolved, ShadeMode::Sprite, slot);
+
 	if (edgeRadius <= 0) {
-		PushRect(min, max, color, tex, { 0,0 }, { 1,1 });
+		__PushQuad(mesh, min, max, color, slot, uvOffset, uvOffset + uvScale);
 	} 
 	else {
 		glm::vec2 edgeOffset;
@@ -76,20 +107,25 @@ void GuiBatcher::PushRect(const glm::vec2& min, const glm::vec2& max, const glm:
 		float uMinYS = edgeOffset.y;
 		float uMaxYS = 1.0f - edgeOffset.y;
 
+		// Pushes a slice, remapping the UVs into the resolved texture
+		auto slice = [&](const glm::vec2& sMin, const glm::vec2& sMax, const glm::vec2& uMin, const glm::vec2& uMax) {
+			__PushQuad(mesh, sMin, sMax, color, slot, uvOffset + uMin * uvScale, uvOffset + uMax * uvScale);
+		};
+
 		// Left column
-		PushRect(glm::vec2(min.x, min.y),  glm::vec2(eMinXS, eMinYS), color, tex, glm::vec2(0.0f, uMaxYS),   glm::vec2(uMinXS, 1.0f));
-		PushRect(glm::vec2(min.x, eMinYS), glm::vec2(eMinXS, eMaxYS), color, tex, glm::vec2(0.0f, uMinYS), glm::vec2(uMinXS, uMaxYS));
-		PushRect(glm::vec2(min.x, eMaxYS), glm::vec2(eMinXS, max.y),  color, tex, glm::vec2(0.0f, 0.0f), glm::vec2(uMinXS, uMinYS));
+		slice(glm::vec2(min.x, min.y),  glm::vec2(eMinXS, eMinYS), glm::vec2(0.0f, uMaxYS), glm::vec2(uMinXS, 1.0f));
+		slice(glm::vec2(min.x, eMinYS), glm::vec2(eMinXS, eMaxYS), glm::vec2(0.0f, uMinYS), glm::vec2(uMinXS, uMaxYS));
+		slice(glm::vec2(min.x, eMaxYS), glm::vec2(eMinXS, max.y),  glm::vec2(0.0f, 0.0f),   glm::vec2(uMinXS, uMinYS));
 
 		// Center column
-		PushRect(glm::vec2(eMinXS, min.y),  glm::vec2(eMaxXS, eMinYS), color, tex, glm::vec2(uMinXS, uMaxYS),   glm::vec2(uMaxXS, 1.0f));
-		PushRect(glm::vec2(eMinXS, eMinYS), glm::vec2(eMaxXS, eMaxYS), color, tex, glm::vec2(uMinXS, uMinYS), glm::vec2(uMaxXS, uMaxYS));
-		PushRect(glm::vec2(eMinXS, eMaxYS), glm::vec2(eMaxXS, max.y), color, tex,  glm::vec2(uMinXS, 0.0f), glm::vec2(uMaxXS, uMinYS));
+		slice(glm::vec2(eMinXS, min.y),  glm::vec2(eMaxXS, eMinYS), glm::vec2(uMinXS, uMaxYS), glm::vec2(uMaxXS, 1.0f));
+		slice(glm::vec2(eMinXS, eMinYS), glm::vec2(eMaxXS, eMaxYS), glm::vec2(uMinXS, uMinYS), glm::vec2(uMaxXS, uMaxYS));
+		slice(glm::vec2(eMinXS, eMaxYS), glm::vec2(eMaxXS, max.y),  glm::vec2(uMinXS, 0.0f),   glm::vec2(uMaxXS, uMinYS));
 
 		// Right column
-		PushRect(glm::vec2(eMaxXS, min.y),  glm::vec2(max.x, eMinYS), color, tex, glm::vec2(uMaxXS, uMaxYS),   glm::vec2(1.0f, 1.0f));
-		PushRect(glm::vec2(eMaxXS, eMinYS), glm::vec2(max.x, eMaxYS), color, tex, glm::vec2(uMaxXS, uMinYS), glm::vec2(1.0f, uMaxYS));
-		PushRect(glm::vec2(eMaxXS, eMaxYS), glm::vec2(max.x, max.y),  color, tex, glm::vec2(uMaxXS, 0.0f), glm::vec2(1.0f, uMinYS));
+		slice(glm::vec2(eMaxXS, min.y),  glm::vec2(max.x, eMinYS), glm::vec2(uMaxXS, uMaxYS), glm::vec2(1.0f, 1.0f));
+		slice(glm::vec2(eMaxXS, eMinYS), glm::vec2(max.x, eMaxYS), glm::vec2(uMaxXS, uMinYS), glm::vec2(1.0f, uMaxYS));
+		slice(glm::vec2(eMaxXS, eMaxYS), glm::vec2(max.x, max.y),  glm::vec2(uMaxXS, 0.0f),   glm::vec2(1.0f, uMinYS));
 	}
 }
 
@@ -98,67 +134,104 @@ void GuiBatcher::SetProjection(const glm::mat4& projection) {
 }
 
 void GuiBatcher::RenderText(const std::wstring& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/) {
-	// How many characters we have
-	size_t length = text.size();
-
-	// Tracks the offset of the character
-	glm::vec2 offset = glm::vec2(0.0f);
-
-	// Transform the origin based off the model transform
-	glm::vec2 origin = position;
+	if (font == nullptr || text.empty()) {
+		return;
+	}
+	const TextLayout& layout = __GetTextLayout(text.data(), text.size() * sizeof(wchar_t), true, font, scale);
+	__RenderTextLayout(layout, font, position, color);
+}
 
-	// Gets the texture used to render the font
-	Texture2D::Sptr atlas = font->GetAtlas();
+void GuiBatcher::RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/)
+{
+	if (font == nullptr || text.empty()) {
+		return;
+	}
+	const TextLayout& layout = __GetTextLayout(text.data(), text.size(), false, font, scale);
+	__RenderTextLayout(layout, font, position, color);
+}
 
-	// Grab the mesh builder and make sure it's a texture batch
-	MeshData& mesh = _meshBuilders[atlas.get()];
-	mesh.IsFont = true;
+const GuiBatcher::TextLayout& GuiBatcher::__GetTextLayout(const void* bytes, size_t size, bool isWide, const Font::Sptr& font, float scale)
+{
+	// Combine the string hash with the font and scale to get our key
+	uint64_t key = std::hash<std::string_view>()(std::string_view(static_cast<const char*>(bytes), size));
+	auto combine = [&](uint64_t value) {
+		key ^= value + 0x9e3779b97f4a7c15ull + (key << 6) + (key >> 2);
+	};
+	combine(std::hash<const void*>()(font.get()));
+	combine(std::hash<float>()(scale));
+	combine(isWide ? 1 : 0);
+
+	// If we have a matching layout, we can use it as-is
+	TextLayout& layout = __textLayouts[key];
+	layout.LastFrame = __frameIndex;
+	if (layout.FontPtr == font.get() && !layout.FontRef.expired() && layout.Scale == scale && layout.IsWide == isWide &&
+		layout.AtlasVersion == font->GetAtlasVersion() && layout.Source.size() == size && memcmp(layout.Source.data(), bytes, size) == 0) {
+		// Since we skip GetGlyph, we need to let the glyph cache know the glyphs are still in use
+		for (const GlyphQuad& quad : layout.Glyphs) {
+			font->TouchCell(quad.Cell);
+		}
+		return layout;
+	}
 
-	// Allocate some space for the vertices
-	VertexPosColTex verts[4];
-	verts[0].Color = color;
-	verts[1].Color = color;
-	verts[2].Color = color;
-	verts[3].Color = color;
+	// Otherwise this is a new string (or a hash collision), so we need to re-shape the text
+	layout.FontPtr = font.get();
+	layout.FontRef = font;
+	layout.Scale = scale;
+	layout.IsWide = isWide;
+	layout.AtlasVersion = font->GetAtlasVersion();
+	layout.Source.assign(static_cast<const char*>(bytes), size);
+	layout.Glyphs.clear();
+
+	// Decode the text into codepoints, wide strings map directly to codepoints
+	__codepointScratch.clear();
+	if (isWide) {
+		const wchar_t* text = static_cast<const wchar_t*>(bytes);
+		for (size_t ix = 0; ix < size / sizeof(wchar_t); ix++) {
+			__codepointScratch.push_back(static_cast<uint32_t>(text[ix]));
+		}
+	} else {
+		const char* it = static_cast<const char*>(bytes);
+		const char* end = it + size;
+		while (it != end) {
+			__codepointScratch.push_back(StringTools::DecodeUtf8(it, end));
+		}
+	}
 
-	float depth = mesh.Builder.GetVertexCount() / 1000.0f;
+	// Tracks the offset of the character
+	glm::vec2 offset = glm::vec2(0.0f);
 
 	// Iterate over all characters in string
-	for (int i = 0; i < length; i++) {
+	size_t length = __codepointScratch.size();
+	for (size_t i = 0; i < length; i++) {
+		uint32_t codepoint = __codepointScratch[i];
+
 		// Grab the glyph data for the character
-		GlyphInfo glyph = font->GetGlyph(text[i], offset.x, offset.y);
+		GlyphInfo glyph = font->GetGlyph(codepoint, offset.x, offset.y);
 
 		// A newline will advance to the next line and return to the start of the line
-		if (text[i] == '\n') {
-			offset.y  += font->GetLineHeight() * scale;
+		if (codepoint == '\n') {
+			offset.y += font->GetLineHeight();
 			offset.x = 0;
 		}
 		// A return character simply returns to the start of the line
-		else if (text[i] == '\r') {
+		else if (codepoint == '\r') {
 			offset.x = 0;
 		}
 		// A tab character is 4 spaces
-		else if (text[i] == '\t') {
+		else if (codepoint == '\t') {
 			float xOffTemp{ 0 }, yOffTemp{ 0 };
 			glyph = font->GetGlyph(' ', xOffTemp, yOffTemp);
 			offset.x += glyph.OffsetX * 4;
 		}
-		// All other characters get rendered
+		// All other characters get a quad
 		else {
-			verts[0].Position = __model * glm::vec3(origin + (offset + glyph.Positions[0]) * scale, 1.0f);
-			verts[1].Position = __model * glm::vec3(origin + (offset + glyph.Positions[1]) * scale, 1.0f);
-			verts[2].Position = __model * glm::vec3(origin + (offset + glyph.Positions[2]) * scale, 1.0f);
-			verts[3].Position = __model * glm::vec3(origin + (offset + glyph.Positions[3]) * scale, 1.0f);
-			verts[0].UV = glyph.UVs[0];
-			verts[1].UV = glyph.UVs[1];
-			verts[2].UV = glyph.UVs[2];
-			verts[3].UV = glyph.UVs[3];
-
-			verts[0].Position.z = verts[1].Position.z = verts[2].Position.z = verts[3].Position.z = depth;
-
-			uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 1, ix + 2);
-			mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 3);
+			GlyphQuad quad;
+			for (int ix = 0; ix < 4; ix++) {
+				quad.Positions[ix] = (offset + glyph.Positions[ix]) * scale;
+				quad.UVs[ix] = glyph.UVs[ix];
+			}
+			quad.Cell = glyph.Cell;
+			layout.Glyphs.push_back(quad);
 
 			// Advance the offset based on the size of the glyph
 			offset.x = glyph.OffsetX;
@@ -167,59 +240,162 @@ void GuiBatcher::RenderText(const std::wstring& text, const Font::Sptr& font, co
 			// If we have more characters, see if there's any kerning between the
 			// current and next character and add it to the x offset
 			if (i < length - 1) {
-				float kerning = font->GetKerning(text[i], text[i + 1]);
-				offset.x += kerning;
+				offset.x += font->GetKerning(codepoint, __codepointScratch[i + 1]);
 			}
 		}
-
 	}
 
+	return layout;
 }
 
-void GuiBatcher::RenderText(const std::string& text, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color, float scale /*= 1.0f*/)
+void GuiBatcher::__RenderTextLayout(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color)
 {
-	static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
-	RenderText(converter.from_bytes(text), font, position, color, scale);
+	// Gets the texture used to render the font
+	const Texture2D::Sptr& atlas = font->GetAtlas();
+	if (atlas == nullptr || layout.Glyphs.size() == 0) {
+		return;
+	}
+
+	// Grab the mesh builder for the font atlas, the slot is only used by the bindless path
+	float slot;
+	MeshData& mesh = __GetMesh(atlas, font->IsSdf() ? ShadeMode::SdfFont : ShadeMode::Font, slot);
+
+	// Allocate some space for the vertices
+	VertexPosColTex verts[4];
+	verts[0].Color = color;
+	verts[1].Color = color;
+	verts[2].Color = color;
+	verts[3].Color = color;
+
+	// Retained elements keep their glyphs' cells, so they can keep them alive while the geometry is re-used
+	std::vector<int32_t>* cells = __captureElement != InvalidElement ? &__retainedElements[__captureElement].GlyphCells : nullptr;
+
+	// The layout is cached relative to the origin, so we only need to transform the quads
+	for (const GlyphQuad& quad : layout.Glyphs) {
+		if (cells != nullptr && quad.Cell >= 0) {
+			cells->push_back(quad.Cell);
+		}
+
+		for (int ix = 0; ix < 4; ix++) {
+			verts[ix].Position = glm::vec3(glm::vec2(__model * glm::vec3(position + quad.Positions[ix], 1.0f)), slot);
+			verts[ix].UV = quad.UVs[ix];
+		}
+
+		uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
+		mesh.Builder.AddIndexTri(ix + 0, ix + 1, ix + 2);
+		mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 3);
+	}
 }
 
 void GuiBatcher::Flush()
 {
 	__StaticInit();
+	__RenewFrameData();
+
+	__meshHighWater = glm::max(__meshHighWater, glm::uvec2(__immediateMesh.Builder.GetVertexCount(), __immediateMesh.Builder.GetIndexCount()));
+
+	// The last run doesn't know where it ends until now
+	__CloseRun();
+
+	// All immediate geometry lives in one mesh, so we only need a single upload
+	uint32_t indexCount = static_cast<uint32_t>(__immediateMesh.Builder.GetIndexCount());
+	if (indexCount > 0) {
+		__vbo->UpdateData(__immediateMesh.Builder.GetVertexDataPtr(), sizeof(VertexPosColTex), __immediateMesh.Builder.GetVertexCount(), true);
+		__ibo->UpdateData(__immediateMesh.Builder.GetIndexDataPtr(), sizeof(uint32_t), indexCount, true);
+	}
 
-	// Iterate over each texture and it's mesh
-	for (auto&[key, value] : _meshBuilders) {
-		Texture2D* tex = key;
-		// If the texture exists and the mesh has data
-		if (tex != nullptr && value.Builder.GetIndexCount() > 0) {
-			// Update the VAO and it's buffers
-			__vao->Bind();
-			__vbo->UpdateData(value.Builder.GetVertexDataPtr(), sizeof(VertexPosColTex), value.Builder.GetVertexCount(), true);
-			__ibo->UpdateData(value.Builder.GetIndexDataPtr(), sizeof(uint32_t), value.Builder.GetIndexCount(), true);
-
-			// Bind texture, send uniforms to shader
-			tex->Bind(0);
-			ShaderProgram::Sptr shader = value.IsFont ? __fontShader : __shader;
+	// Retained batches only upload the ranges that changed, we do them all before drawing
+	for (const DrawRun& run : __drawRuns) {
+		if (run.Batch != nullptr) {
+			__UploadBatch(*run.Batch);
+		}
+	}
+
+	// Every texture is accessible through the texture table, so runs only need a new draw when the buffers change
+	if (__bindlessEnabled && __drawRuns.size() > 0) {
+		__BindBindlessTable();
+	}
+
+	// Draw each run in the order it was pushed, so that layering matches submission order
+	ShaderProgram* boundShader = nullptr;
+	VertexArrayObject* boundVao = nullptr;
+	for (const DrawRun& run : __drawRuns) {
+		if (run.Count == 0) {
+			continue;
+		}
+
+		// Retained batches use the same index pattern for every quad, so a range of quads is a range of indices
+		VertexArrayObject* vao = run.Batch != nullptr ? run.Batch->VAO.get() : __vao.get();
+		uint32_t offset = run.Batch != nullptr ? run.Offset * 6 : run.Offset;
+		uint32_t count  = run.Batch != nullptr ? run.Count * 6 : run.Count;
+
+		ShaderProgram* shader = __bindlessEnabled ? __bindlessShader.get() : __GetShader(run.Mode).get();
+		if (!__bindlessEnabled) {
+			run.Texture->Bind(0);
+		}
+		if (shader != boundShader) {
 			shader->Bind();
 			shader->SetUniformMatrix(0, &__projection, 1, false);
+			boundShader = shader;
+		}
+		if (vao != boundVao) {
+			vao->Bind();
+			boundVao = vao;
+		}
+
+		glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(offset * sizeof(uint32_t)));
+		__drawCalls++;
+		Profiler::CountDrawCalls();
+	}
+	if (boundVao != nullptr) {
+		VertexArrayObject::Unbind();
+	}
 
-			// Draw geometry
-			__vao->Draw();
+	// Clear mesh
+	__immediateMesh.Builder.Reset();
+	__drawRuns.clear();
+}
 
-			// Clear mesh
-			value.Builder.Reset();
+void GuiBatcher::__PushRun(const DrawRun& run) {
+	__CloseRun();
+	__drawRuns.push_back(run);
+}
+
+void GuiBatcher::__CloseRun() {
+	// Immediate runs keep growing until another run starts, so this is where we find out how many indices they have
+	if (__drawRuns.size() > 0 && __drawRuns.back().Batch == nullptr) {
+		DrawRun& run = __drawRuns.back();
+		run.Count = static_cast<uint32_t>(__immediateMesh.Builder.GetIndexCount()) - run.Offset;
+	}
+}
+
+void GuiBatcher::__SubmitRetained(const RetainedElement& element) {
+	if (element.QuadCapacity == 0) {
+		return;
+	}
+
+	// Elements that follow each other in the batch are drawn together, the unused quads at the end of a slice are degenerate
+	if (__drawRuns.size() > 0) {
+		DrawRun& last = __drawRuns.back();
+		if (last.Batch == element.Batch && last.Offset + last.Count == element.QuadOffset) {
+			last.Count += element.QuadCapacity;
+			return;
 		}
 	}
+	__PushRun({ element.Batch->Texture.get(), element.Batch->Mode, element.Batch, element.QuadOffset, element.QuadCapacity });
 }
 
 void GuiBatcher::PushModelTransform(const glm::mat3& transform) {
-	__modelTransformStack.push_back(transform);
+	// We store the previous transform instead of inverting on pop, so that the model matrix
+	// is restored exactly (otherwise rounding errors would dirty every retained element)
+	__modelTransformStack.push_back(__model);
 	__model = __model * transform;
 }
 
 void GuiBatcher::PopModelTransform()
 {
 	LOG_ASSERT(__modelTransformStack.size() > 0, "Transform push/pop mismatch");
-	__model = __model * glm::inverse(__modelTransformStack.back());
+	__model = __modelTransformStack.back();
 	__modelTransformStack.pop_back();
 }
 
@@ -231,6 +407,8 @@ void GuiBatcher::__StaticInit()
 {
 	static bool needsInit = true;
 	if (needsInit) {
+		needsInit = false;
+
 		__shader = ShaderProgram::Create();
 		__shader->LoadShaderPart(R"LIT(#version 460
 					layout(location = 0) in vec3 inPos;
@@ -245,7 +423,7 @@ void GuiBatcher::__StaticInit()
 					void main() {
 						outColor = inColor;
 						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
+						gl_Position = u_Projection * vec4(inPos.xy, 0, 1);
 					}
 				)LIT", ShaderPartType::Vertex);
 
@@ -278,7 +456,7 @@ void GuiBatcher::__StaticInit()
 					void main() {
 						outColor = inColor;
 						outUV = inUV;
-						gl_Position = u_Projection * vec4(inPos, 1);
+						gl_Position = u_Projection * vec4(inPos.xy, 0, 1);
 					}
 				)LIT", ShaderPartType::Vertex);
 
@@ -298,6 +476,107 @@ void GuiBatcher::__StaticInit()
 
 		__fontShader->Link();
 
+		// SDF fonts use the same vertex shader, but reconstruct the glyph edge from the
+		// distance field, using screen space derivatives to keep the edge ~1 pixel wide
+		__sdfFontShader = ShaderProgram::Create();
+		__sdfFontShader->LoadShaderPart(R"LIT(#version 460
+					layout(location = 0) in vec3 inPos;
+					layout(location = 1) in vec4 inColor;
+					layout(location = 3) in vec2 inUV;
+
+					layout(location = 0) out vec4 outColor;
+					layout(location = 1) out vec2 outUV;
+
+					layout(location = 0) uniform mat4 u_Projection;
+
+					void main() {
+						outColor = inColor;
+						outUV = inUV;
+						gl_Position = u_Projection * vec4(inPos.xy, 0, 1);
+					}
+				)LIT", ShaderPartType::Vertex);
+
+		__sdfFontShader->LoadShaderPart(R"LIT(#version 460
+					layout(location = 0) in vec4 inColor;
+					layout(location = 1) in vec2 inUV;
+
+					layout(location = 0) out vec4 outColor;
+
+					uniform layout(binding=0) sampler2D s_Texture;
+
+					void main() {
+						float dist = texture(s_Texture, inUV).r;
+						float width = max(fwidth(dist), 0.0001) * 0.75;
+						outColor = vec4(inColor.rgb, smoothstep(0.5 - width, 0.5 + width, dist));
+					}
+				)LIT" , ShaderPartType::Fragment);
+
+		__sdfFontShader->Link();
+
+		// The bindless shader handles both sprites and fonts, the Z component of the
+		// position stores the index into the texture table
+		if (IsBindlessSupported()) {
+			__bindlessShader = ShaderProgram::Create();
+			__bindlessShader->LoadShaderPart(R"LIT(#version 460
+					layout(location = 0) in vec3 inPos;
+					layout(location = 1) in vec4 inColor;
+					layout(location = 3) in vec2 inUV;
+
+					layout(location = 0) out vec4 outColor;
+					layout(location = 1) out vec2 outUV;
+					layout(location = 2) flat out uint outSlot;
+
+					layout(location = 0) uniform mat4 u_Projection;
+
+					void main() {
+						outColor = inColor;
+						outUV = inUV;
+						outSlot = uint(inPos.z);
+						gl_Position = u_Projection * vec4(inPos.xy, 0, 1);
+					}
+				)LIT", ShaderPartType::Vertex);
+
+			__bindlessShader->LoadShaderPart(R"LIT(#version 460
+					#extension GL_ARB_bindless_texture : require
+					layout(location = 0) in vec4 inColor;
+					layout(location = 1) in vec2 inUV;
+					layout(location = 2) flat in uint inSlot;
+
+					layout(location = 0) out vec4 outColor;
+
+					// Mode is 0 for sprites, 1 for bitmap fonts and 2 for SDF fonts
+					struct TextureSlot {
+						uvec2 Handle;
+						uint  Mode;
+						uint  Padding;
+					};
+
+					layout(std430, binding = 8) readonly buffer b_GuiTextures {
+						TextureSlot u_Slots[];
+					};
+
+					void main() {
+						TextureSlot slot = u_Slots[inSlot];
+						vec4 texel = texture(sampler2D(slot.Handle), inUV);
+						if (slot.Mode == 0) {
+							outColor = texel * inColor;
+						} else if (slot.Mode == 1) {
+							outColor = vec4(inColor.rgb, texel.r);
+						} else {
+							float width = max(fwidth(texel.r), 0.0001) * 0.75;
+							outColor = vec4(inColor.rgb, smoothstep(0.5 - width, 0.5 + width, texel.r));
+						}
+					}
+				)LIT", ShaderPartType::Fragment);
+
+			__bindlessShader->Link();
+
+			__bindlessBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+			__bindlessBuffer->SetDebugName("GUI Texture Table");
+		} else {
+			__bindlessEnabled = false;
+		}
+
 		__vbo = VertexBuffer::Create(BufferUsage::DynamicDraw);
 		__ibo = IndexBuffer::Create(BufferUsage::DynamicDraw, IndexType::UInt);
 
@@ -328,8 +607,6 @@ void GuiBatcher::__StaticInit()
 			}
 			__defaultUITexture->LoadData(16, 16, PixelFormat::RGBA, PixelType::UByte, data);
 		}
-
-		needsInit = false;
 	}
 }
 
@@ -353,29 +630,39 @@ void GuiBatcher::PushScissorRect(const glm::vec2& min, const glm::vec2& max) {
 	int width  = glm::max(maxWin.x, minWin.x) - glm::min(maxWin.x, minWin.x);
 	int height = glm::max(maxWin.y, minWin.y) - glm::min(maxWin.y, minWin.y);
 
-	// Draw current geo with the current scissor, then update it
+	// Draw current geo with the current scissor, then update it. Retained elements are part of the flush, so
+	// they're clipped the same as immediate geometry
 	Flush();
-	glScissor(minWin.x, maxWin.y, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(glm::min(minWin.x, maxWin.x), glm::min(minWin.y, maxWin.y), width, height);
 }
 
 void GuiBatcher::PopScissorRect() {
 	LOG_ASSERT(__scissorRects.size() > 0, "Scissor rect push/pop mismatch!");
 	__scissorRects.pop_back();
 
-	// Grab the last scissor rect, or just use window bounds if none left
-	IRect bounds = __scissorRects.size() > 0 ? __scissorRects.back() : IRect{ { 0, 0 }, { __windowSize.x, __windowSize.y } };
+	// Draw current geo with the current scissor, then update it
+	Flush();
+
+	// With no scissor rects left, nothing gets clipped
+	if (__scissorRects.size() == 0) {
+		glDisable(GL_SCISSOR_TEST);
+		return;
+	}
+
+	// Grab the last scissor rect
+	IRect bounds = __scissorRects.back();
 
 	// Calculate the actual size
 	int width  = glm::max(bounds.Min.x, bounds.Max.x) - glm::min(bounds.Min.x, bounds.Max.x);
 	int height = glm::max(bounds.Min.y, bounds.Max.y) - glm::min(bounds.Min.y, bounds.Max.y);
 
-	// Draw current geo with the current scissor, then update it
-	Flush();
 	glScissor(glm::min(bounds.Min.x, bounds.Max.x), glm::min(bounds.Min.y, bounds.Max.y), width, height);
 }
 
 void GuiBatcher::SetDefaultTexture(const Texture2D::Sptr& value) {
 	__defaultUITexture = value;
+	__InvalidateRetained();
 }
 
 const Texture2D::Sptr& GuiBatcher::GetDefaultTexture() {
@@ -384,8 +671,500 @@ const Texture2D::Sptr& GuiBatcher::GetDefaultTexture() {
 
 void GuiBatcher::SetDefaultBorderRadius(int value) {
 	__defaultEdgeRadius = value;
+	__InvalidateRetained();
 }
 
 int GuiBatcher::GetDefaultBorderRadius() {
 	return __defaultEdgeRadius;
 }
+
+
+void GuiBatcher::SetAtlasEnabled(bool value) {
+	if (__atlasEnabled != value) {
+		__atlasEnabled = value;
+		// Releasing the atlas will free the pages once no batches reference them
+		if (!value) {
+			__atlas = nullptr;
+		}
+		__InvalidateRetained();
+	}
+}
+
+bool GuiBatcher::GetAtlasEnabled() {
+	return __atlasEnabled;
+}
+
+void GuiBatcher::SetBindlessEnabled(bool value) {
+	value = value && IsBindlessSupported();
+	if (__bindlessEnabled != value) {
+		__bindlessEnabled = value;
+		__InvalidateRetained();
+	}
+}
+
+bool GuiBatcher::GetBindlessEnabled() {
+	return __bindlessEnabled && IsBindlessSupported();
+}
+
+bool GuiBatcher::IsBindlessSupported() {
+	#ifdef GL_ARB_bindless_texture
+	return GLAD_GL_ARB_bindless_texture != 0;
+	#else
+	return false;
+	#endif
+}
+
+uint32_t GuiBatcher::GetDrawCallCount() {
+	return __drawCalls;
+}
+
+void GuiBatcher::SetRetainedMode(bool value) {
+	if (__retainedMode != value) {
+		__retainedMode = value;
+		__InvalidateRetained();
+	}
+}
+
+bool GuiBatcher::GetRetainedMode() {
+	return __retainedMode;
+}
+
+void GuiBatcher::BeginFrame() {
+	__RenewFrameData();
+	__frameIndex++;
+	__drawCalls = 0;
+	Font::AdvanceFrame();
+
+	// Periodically evict any text layouts that are no longer being drawn
+	if (__frameIndex % TEXT_LAYOUT_LIFETIME == 0) {
+		for (auto it = __textLayouts.begin(); it != __textLayouts.end();) {
+			if (__frameIndex - it->second.LastFrame > TEXT_LAYOUT_LIFETIME || it->second.FontRef.expired()) {
+				it = __textLayouts.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+
+	// Release the atlas space and texture table slots of any textures that have been destroyed
+	if (__atlas != nullptr) {
+		__atlas->CollectGarbage();
+	}
+	__CollectBindlessSlots();
+}
+
+bool GuiBatcher::BeginElement(ElementHandle& handle, const Texture2D::Sptr& tex, bool isFont, bool contentDirty)
+{
+	return __BeginElement(handle, tex, isFont ? ShadeMode::Font : ShadeMode::Sprite, contentDirty);
+}
+
+bool GuiBatcher::BeginElement(ElementHandle& handle, const Font::Sptr& font, bool contentDirty)
+{
+	// Glyph UVs are baked into the element's geometry, so evictions from the font's glyph cache invalidate it
+	uint32_t version = font->GetAtlasVersion();
+	bool atlasChanged = handle != InvalidElement && __retainedElements[handle].AtlasVersion != version;
+
+	bool result = __BeginElement(handle, font->GetAtlas(), font->IsSdf() ? ShadeMode::SdfFont : ShadeMode::Font, contentDirty || atlasChanged);
+	RetainedElement& element = __retainedElements[handle];
+	element.AtlasVersion = version;
+	if (result) {
+		// The cells get collected again as the text is rendered
+		element.GlyphCells.clear();
+	} else {
+		// We skip RenderText when the geometry is kept, so we need to let the glyph cache know the glyphs are still on screen
+		for (int32_t cell : element.GlyphCells) {
+			font->TouchCell(cell);
+		}
+	}
+	return result;
+}
+
+bool GuiBatcher::__BeginElement(ElementHandle& handle, const Texture2D::Sptr& tex, ShadeMode mode, bool contentDirty)
+{
+	LOG_ASSERT(__captureElement == InvalidElement, "BeginElement called without matching EndElement!");
+	__StaticInit();
+	__RenewFrameData();
+
+	// Allocate a new element if required, re-using released handles where possible
+	if (handle == InvalidElement) {
+		if (__freeElements.size() > 0) {
+			handle = __freeElements.back();
+			__freeElements.pop_back();
+		} else {
+			handle = static_cast<ElementHandle>(__retainedElements.size());
+			__retainedElements.emplace_back();
+		}
+		__retainedElements[handle] = RetainedElement();
+		__retainedElements[handle].InUse = true;
+	}
+
+	RetainedElement& element = __retainedElements[handle];
+	element.LastFrame = __frameIndex;
+
+	// Determine which batch the element belongs to, this may be an atlas page or a bindless batch
+	glm::vec2 uvOffset, uvScale;
+	const Texture2D::Sptr& resolved = __ResolveTexture(tex, mode, uvOffset, uvScale);
+	RetainedBatch& batch = __GetBatch(resolved, mode);
+
+	// The submit cursor tracks the end of the last element submitted to the batch this frame
+	if (batch.SubmitFrame != __frameIndex) {
+		batch.SubmitFrame = __frameIndex;
+		batch.SubmitCursor = 0;
+	}
+
+	// If nothing has changed since the element was last tessellated, we can keep it's geometry
+	if (!contentDirty && !element.IsDirty && element.IsVisible && element.Texture == tex.get() && element.Batch == &batch && element.Model == __model) {
+		// If an element submitted before this one lives later in the batch, we need to move our
+		// geometry after it so that elements are still drawn in painter's order
+		if (element.QuadCapacity > 0 && element.QuadOffset < batch.SubmitCursor) {
+			uint32_t offset = __AllocateQuads(batch, element.QuadCapacity, batch.SubmitCursor);
+			memcpy(&batch.Vertices[offset * 4], &batch.Vertices[element.QuadOffset * 4], element.QuadCapacity * 4 * sizeof(VertexPosColTex));
+			__FreeQuads(batch, element.QuadOffset, element.QuadCapacity);
+			batch.DirtyMin = glm::min(batch.DirtyMin, offset);
+			batch.DirtyMax = glm::max(batch.DirtyMax, offset + element.QuadCapacity);
+			element.QuadOffset = offset;
+		}
+		batch.SubmitCursor = glm::max(batch.SubmitCursor, element.QuadOffset + element.QuadCapacity);
+		__SubmitRetained(element);
+		return false;
+	}
+
+	// If the texture has changed, the geometry may need to move to a different batch
+	if (element.Batch != &batch) {
+		if (element.Batch != nullptr && element.QuadCapacity > 0) {
+			__FreeQuads(*element.Batch, element.QuadOffset, element.QuadCapacity);
+		}
+		element.Batch = &batch;
+		element.QuadOffset = 0;
+		element.QuadCapacity = 0;
+	}
+	element.Texture = tex.get();
+
+	// Redirect PushRect and RenderText into our capture mesh
+	__captureElement = handle;
+	__captureMesh.Builder.Reset();
+
+	return true;
+}
+
+void GuiBatcher::EndElement(ElementHandle handle)
+{
+	LOG_ASSERT(__captureElement == handle, "EndElement called with a different handle than BeginElement!");
+	__captureElement = InvalidElement;
+
+	RetainedElement& element = __retainedElements[handle];
+	RetainedBatch& batch = *element.Batch;
+
+	// All GUI geometry is made of quads, so we can ignore the captured indices
+	uint32_t quadCount = static_cast<uint32_t>(__captureMesh.Builder.GetVertexCount() / 4);
+
+	// Grow the element's slice if the new geometry no longer fits, or move it if it's out of
+	// painter's order. We add some slack so that text that grows by a character or two does not need to move
+	bool outOfOrder = element.QuadCapacity > 0 && element.QuadOffset < batch.SubmitCursor;
+	if (quadCount > element.QuadCapacity || outOfOrder) {
+		if (element.QuadCapacity > 0) {
+			__FreeQuads(batch, element.QuadOffset, element.QuadCapacity);
+		}
+		element.QuadCapacity = glm::max(element.QuadCapacity, quadCount + quadCount / 2);
+		element.QuadOffset = __AllocateQuads(batch, element.QuadCapacity, batch.SubmitCursor);
+	}
+
+	// Copy the geometry into the batch, and collapse any unused quads in the slice
+	if (quadCount > 0) {
+		memcpy(&batch.Vertices[element.QuadOffset * 4], __captureMesh.Builder.GetVertexDataPtr(), quadCount * 4 * sizeof(VertexPosColTex));
+	}
+	__ClearQuads(batch, element.QuadOffset + quadCount, element.QuadCapacity - quadCount);
+
+	batch.DirtyMin = glm::min(batch.DirtyMin, element.QuadOffset);
+	batch.DirtyMax = glm::max(batch.DirtyMax, element.QuadOffset + element.QuadCapacity);
+	batch.SubmitCursor = glm::max(batch.SubmitCursor, element.QuadOffset + element.QuadCapacity);
+
+	element.Model = __model;
+	element.IsVisible = true;
+	element.IsDirty = false;
+
+	__captureMesh.Builder.Reset();
+	__SubmitRetained(element);
+}
+
+void GuiBatcher::ReleaseElement(ElementHandle& handle)
+{
+	if (handle == InvalidElement || handle >= static_cast<ElementHandle>(__retainedElements.size())) {
+		handle = InvalidElement;
+		return;
+	}
+
+	RetainedElement& element = __retainedElements[handle];
+	if (element.Batch != nullptr && element.QuadCapacity > 0) {
+		__FreeQuads(*element.Batch, element.QuadOffset, element.QuadCapacity);
+	}
+	element = RetainedElement();
+	__freeElements.push_back(handle);
+	handle = InvalidElement;
+}
+
+void GuiBatcher::__UploadBatch(RetainedBatch& batch)
+{
+	if (batch.QuadHighWater == 0) {
+		return;
+	}
+
+	// If the batch has grown, we need to re-create the GPU side storage
+	if (batch.NeedsRealloc || batch.VAO == nullptr) {
+		if (batch.VAO == nullptr) {
+			batch.VBO = VertexBuffer::Create(BufferUsage::DynamicDraw);
+			batch.IBO = IndexBuffer::Create(BufferUsage::StaticDraw);
+			batch.VAO = VertexArrayObject::Create();
+			batch.VAO->AddVertexBuffer(batch.VBO, VertexPosColTex::V_DECL);
+			batch.VAO->SetIndexBuffer(batch.IBO);
+		}
+
+		// Every quad uses the same index pattern, so we only need to generate indices on resize
+		std::vector<uint32_t> indices;
+		indices.resize(batch.QuadCapacity * 6);
+		for (uint32_t ix = 0; ix < batch.QuadCapacity; ix++) {
+			uint32_t base = ix * 4;
+			indices[ix * 6 + 0] = base + 0;
+			indices[ix * 6 + 1] = base + 2;
+			indices[ix * 6 + 2] = base + 1;
+			indices[ix * 6 + 3] = base + 0;
+			indices[ix * 6 + 4] = base + 3;
+			indices[ix * 6 + 5] = base + 2;
+		}
+		batch.VBO->LoadData(batch.Vertices.data(), static_cast<uint32_t>(batch.Vertices.size()));
+		batch.IBO->LoadData(indices.data(), static_cast<uint32_t>(indices.size()));
+
+		batch.NeedsRealloc = false;
+		batch.DirtyMin = UINT32_MAX;
+		batch.DirtyMax = 0;
+	}
+	// Otherwise only upload the range that has changed since last frame
+	else if (batch.DirtyMax > batch.DirtyMin) {
+		batch.VBO->UpdateSubData(
+			&batch.Vertices[batch.DirtyMin * 4],
+			batch.DirtyMin * 4 * sizeof(VertexPosColTex),
+			(batch.DirtyMax - batch.DirtyMin) * 4 * sizeof(VertexPosColTex)
+		);
+		batch.DirtyMin = UINT32_MAX;
+		batch.DirtyMax = 0;
+	}
+}
+
+const ShaderProgram::Sptr& GuiBatcher::__GetShader(ShadeMode mode)
+{
+	switch (mode) {
+		case ShadeMode::Font:    return __fontShader;
+		case ShadeMode::SdfFont: return __sdfFontShader;
+		default:                 return __shader;
+	}
+}
+
+const Texture2D::Sptr& GuiBatcher::__ResolveTexture(const Texture2D::Sptr& tex, ShadeMode mode, glm::vec2& uvOffset, glm::vec2& uvScale)
+{
+	uvOffset = glm::vec2(0.0f);
+	uvScale  = glm::vec2(1.0f);
+
+	// Font atlases are already packed, so we only atlas sprites
+	if (__atlasEnabled && mode == ShadeMode::Sprite && tex != nullptr) {
+		if (__atlas == nullptr) {
+			__atlas = std::make_shared<TextureAtlas>();
+		}
+		const AtlasRegion* region = __atlas->GetRegion(tex);
+		if (region != nullptr) {
+			uvOffset = region->UvMin;
+			uvScale  = region->UvMax - region->UvMin;
+			return region->Page;
+		}
+	}
+	return tex;
+}
+
+float GuiBatcher::__GetBindlessSlot(const Texture2D::Sptr& tex, ShadeMode mode)
+{
+	// If the texture already has a slot, and is the same texture that created it, we can re-use it
+	uint32_t slot;
+	auto it = __bindlessSlotMap.find(tex.get());
+	if (it != __bindlessSlotMap.end()) {
+		slot = it->second;
+		if (!__bindlessTextures[slot].expired()) {
+			return static_cast<float>(slot);
+		}
+	} else if (__freeBindlessSlots.size() > 0) {
+		slot = __freeBindlessSlots.back();
+		__freeBindlessSlots.pop_back();
+		__bindlessSlotMap[tex.get()] = slot;
+	} else {
+		slot = static_cast<uint32_t>(__bindlessTable.size());
+		__bindlessTable.emplace_back();
+		__bindlessTextures.emplace_back();
+		__bindlessSlotMap[tex.get()] = slot;
+	}
+
+	// Handles are only valid while resident, they are released when the texture is deleted
+	uint64_t handle = 0;
+	#ifdef GL_ARB_bindless_texture
+	handle = glGetTextureHandleARB(tex->GetHandle());
+	glMakeTextureHandleResidentARB(handle);
+	#endif
+
+	__bindlessTextures[slot] = tex;
+	__bindlessTable[slot] = { handle, static_cast<uint32_t>(mode), 0u };
+	__bindlessTableDirty = true;
+
+	return static_cast<float>(slot);
+}
+
+void GuiBatcher::__CollectBindlessSlots()
+{
+	// The handles were released when their textures were deleted, so we only need to clear the table entries
+	for (auto it = __bindlessSlotMap.begin(); it != __bindlessSlotMap.end();) {
+		if (__bindlessTextures[it->second].expired()) {
+			__bindlessTable[it->second] = { 0ull, 0u, 0u };
+			__freeBindlessSlots.push_back(it->second);
+			__bindlessTableDirty = true;
+			it = __bindlessSlotMap.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+void GuiBatcher::__BindBindlessTable()
+{
+	if (__bindlessTableDirty && __bindlessTable.size() > 0) {
+		__bindlessBuffer->LoadData(__bindlessTable.data(), static_cast<uint32_t>(__bindlessTable.size()));
+		__bindlessTableDirty = false;
+	}
+	__bindlessBuffer->Bind(GUI_TEXTURE_TABLE_BINDING);
+}
+
+GuiBatcher::MeshData& GuiBatcher::__GetMesh(const Texture2D::Sptr& tex, ShadeMode mode, float& slot) {
+	__StaticInit();
+	__RenewFrameData();
+	slot = __bindlessEnabled ? __GetBindlessSlot(tex, mode) : 0.0f;
+
+	// When re-tessellating a retained element, all geometry goes to the capture mesh
+	if (__captureElement != InvalidElement) {
+		LOG_ASSERT(__retainedElements[__captureElement].Batch == &__GetBatch(tex, mode), "Retained GUI elements must use a single texture!");
+		return __captureMesh;
+	}
+
+	// Start a new run whenever the texture changes or retained geometry was submitted in between, the bindless
+	// path only needs a new run for the latter
+	Texture2D* runTexture = __bindlessEnabled ? nullptr : tex.get();
+	if (__drawRuns.size() == 0 || __drawRuns.back().Batch != nullptr || __drawRuns.back().Texture != runTexture || (!__bindlessEnabled && __drawRuns.back().Mode != mode)) {
+		__PushRun({ runTexture, mode, nullptr, static_cast<uint32_t>(__immediateMesh.Builder.GetIndexCount()), 0 });
+	}
+	return __immediateMesh;
+}
+
+void GuiBatcher::__RenewFrameData() {
+	// The last frame's meshes are in arena memory that is about to be reset, so we start over with
+	// enough room for what we needed last frame, rather than growing (and leaving copies behind) in the arena
+	if (FrameArena::Renew(__arenaFrame, __immediateMesh, __captureMesh, __drawRuns)) {
+		__immediateMesh.Builder.ReserveVertexSpace(__meshHighWater.x);
+		__immediateMesh.Builder.ReserveIndexSpace(__meshHighWater.y);
+		__meshHighWater = glm::uvec2(0);
+	}
+}
+
+void GuiBatcher::__PushQuad(MeshData& mesh, const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, float slot, const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+	// Create vertices and transform positions, Z stores the bindless texture slot
+	VertexPosColTex verts[4];
+	verts[0].Position = glm::vec3(glm::vec2(__model * glm::vec3(min.x, min.y, 1.0f)), slot);
+	verts[1].Position = glm::vec3(glm::vec2(__model * glm::vec3(min.x, max.y, 1.0f)), slot);
+	verts[2].Position = glm::vec3(glm::vec2(__model * glm::vec3(max.x, max.y, 1.0f)), slot);
+	verts[3].Position = glm::vec3(glm::vec2(__model * glm::vec3(max.x, min.y, 1.0f)), slot);
+
+	// Copy in all color
+	for (int ix = 0; ix < 4; ix++) {
+		verts[ix].Color = color;
+	}
+
+	// Copy over UV coords
+	verts[0].UV = glm::vec2(uvMin.x, uvMax.y);
+	verts[1].UV = glm::vec2(uvMin.x, uvMin.y);
+	verts[2].UV = glm::vec2(uvMax.x, uvMin.y);
+	verts[3].UV = glm::vec2(uvMax.x, uvMax.y);
+
+	// Add vertices and indices to range
+	uint32_t ix = mesh.Builder.AddVertexRange(verts, 4);
+	mesh.Builder.AddIndexTri(ix + 0, ix + 2, ix + 1);
+	mesh.Builder.AddIndexTri(ix + 0, ix + 3, ix + 2);
+}
+
+GuiBatcher::RetainedBatch& GuiBatcher::__GetBatch(const Texture2D::Sptr& resolved, ShadeMode mode)
+{
+	// With bindless textures, all geometry can share a single batch regardless of texture
+	if (__bindlessEnabled) {
+		return __bindlessBatch;
+	}
+
+	// The batch keeps the texture alive, so the key can't be re-used by another texture
+	RetainedBatch& result = __retainedBatches[resolved.get()];
+	if (result.Texture == nullptr) {
+		result.Texture = resolved;
+		result.Mode = mode;
+	}
+	return result;
+}
+
+uint32_t GuiBatcher::__AllocateQuads(RetainedBatch& batch, uint32_t count, uint32_t minOffset)
+{
+	// First fit search of the free ranges, only considering space after minOffset
+	for (size_t ix = 0; ix < batch.FreeRanges.size(); ix++) {
+		glm::uvec2 range = batch.FreeRanges[ix];
+		uint32_t start = glm::max(range.x, minOffset);
+		uint32_t end = range.x + range.y;
+		if (start + count <= end) {
+			// Split the free range around the allocation
+			batch.FreeRanges.erase(batch.FreeRanges.begin() + ix);
+			if (start > range.x) {
+				batch.FreeRanges.push_back({ range.x, start - range.x });
+			}
+			if (end > start + count) {
+				batch.FreeRanges.push_back({ start + count, end - (start + count) });
+			}
+			return start;
+		}
+	}
+
+	// Otherwise we append to the end of the batch, growing it if required
+	uint32_t offset = batch.QuadHighWater;
+	batch.QuadHighWater += count;
+	if (batch.QuadHighWater > batch.QuadCapacity) {
+		batch.QuadCapacity = glm::max(glm::max(batch.QuadCapacity * 2, batch.QuadHighWater), (uint32_t)RETAINED_MIN_QUADS);
+		batch.Vertices.resize(batch.QuadCapacity * 4, VertexPosColTex());
+		batch.NeedsRealloc = true;
+	}
+	return offset;
+}
+
+void GuiBatcher::__FreeQuads(RetainedBatch& batch, uint32_t offset, uint32_t count)
+{
+	__ClearQuads(batch, offset, count);
+	batch.DirtyMin = glm::min(batch.DirtyMin, offset);
+	batch.DirtyMax = glm::max(batch.DirtyMax, offset + count);
+
+	// If the range is at the end of the batch, we can simply shrink the high water mark
+	if (offset + count == batch.QuadHighWater) {
+		batch.QuadHighWater = offset;
+	} else {
+		batch.FreeRanges.push_back({ offset, count });
+	}
+}
+
+void GuiBatcher::__ClearQuads(RetainedBatch& batch, uint32_t offset, uint32_t count) {
+	// Zeroed quads are degenerate, so they will not produce any fragments
+	if (count > 0) {
+		memset(&batch.Vertices[offset * 4], 0, count * 4 * sizeof(VertexPosColTex));
+	}
+}
+
+void GuiBatcher::__InvalidateRetained() {
+	// Forces all elements to re-tessellate the next time they are submitted
+	for (RetainedElement& element : __retainedElements) {
+		element.IsDirty = true;
+	}
+}
@@ -7,8 +7,12 @@
 #include "Graphics/VertexArrayObject.h"
 #include "Graphics/VertexTypes.h"
 #include "Graphics/Font.h"
+#include "Graphics/Textures/TextureAtlas.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
 #include "Utils/MeshBuilder.h"
+#include "Utils/FrameArena.h"
 #include <unordered_map>
+#include <cstdint>
 
 	/// <summary>
 	/// The GUI Batcher class provides utilities for drawing rectangles and
@@ -16,6 +20,13 @@
 	/// </summary>
 	class GuiBatcher {
 	public:
+		/// <summary>
+		/// Identifies a retained GUI element, and the slice of the persistent vertex
+		/// buffer that it owns. Elements should start with InvalidElement
+		/// </summary>
+		typedef int32_t ElementHandle;
+		static const ElementHandle InvalidElement = -1;
+
 		/// <summary>
 		/// Adds a rectangle to the GUI batch, with a given border radius in pixels.
 		/// This can be used with textures to create rounded borders
@@ -66,7 +77,8 @@
 		/// </summary>
 		static void SetWindowSize(const glm::ivec2& size);
 		/// <summary>
-		/// Draws all geometry to the screen and prepares for the next batch
+		/// Draws all geometry submitted since the last flush to the screen, immediate and retained, in the
+		/// order it was submitted, and prepares for the next batch
 		/// </summary>
 		static void Flush();
 
@@ -82,8 +94,8 @@
 		static void PopModelTransform();
 
 		/// <summary>
-		/// Sets a new scissor region in model space. Note that this will invoke a 
-		/// flush
+		/// Sets a new scissor region in model space, clipping both immediate and retained
+		/// geometry. Note that this will invoke a flush
 		/// </summary>
 		/// <param name="min">The minimum bounds of the scissor rectangle</param>
 		/// <param name="min">The maximum bounds of the scissor rectangle</param>
@@ -112,15 +124,146 @@
 		/// </summary>
 		static int GetDefaultBorderRadius();
 
+		/// <summary>
+		/// Enables or disables the sprite atlas. When enabled, small GUI textures are packed
+		/// into shared atlas pages so that they can be drawn together
+		/// </summary>
+		static void SetAtlasEnabled(bool value);
+		/// <summary>
+		/// Returns true if small GUI textures are being packed into a shared atlas
+		/// </summary>
+		static bool GetAtlasEnabled();
+
+		/// <summary>
+		/// Enables or disables the bindless texture path. When enabled, all textures are
+		/// accessed via ARB_bindless_texture handles, so the entire GUI can be drawn in one
+		/// or two draw calls regardless of how many textures it uses. Has no effect if the
+		/// extension is not supported
+		/// 
+		/// Note that textures can no longer have their sampler state modified once they have
+		/// been used with the bindless path
+		/// </summary>
+		static void SetBindlessEnabled(bool value);
+		/// <summary>
+		/// Returns true if the bindless path is enabled and supported
+		/// </summary>
+		static bool GetBindlessEnabled();
+		/// <summary>
+		/// Returns true if the current context supports ARB_bindless_texture
+		/// </summary>
+		static bool IsBindlessSupported();
+
+		/// <summary>
+		/// Gets the number of draw calls issued since the last call to BeginFrame
+		/// </summary>
+		static uint32_t GetDrawCallCount();
+
+		/// <summary>
+		/// Enables or disables retained mode. In retained mode, GUI elements keep their
+		/// geometry in persistent vertex buffers between frames, and are only re-tessellated
+		/// and re-uploaded when their inputs have changed
+		/// </summary>
+		static void SetRetainedMode(bool value);
+		/// <summary>
+		/// Returns true if GUI elements should use the retained API (BeginElement/EndElement)
+		/// </summary>
+		static bool GetRetainedMode();
+
+		/// <summary>
+		/// Marks the start of a new GUI frame, should be called before the scene's GUI is
+		/// rendered. Retained elements are only drawn in the frames they are submitted in
+		/// </summary>
+		static void BeginFrame();
+		/// <summary>
+		/// Begins submission of a retained element. If the element's geometry is still valid,
+		/// this returns false and nothing else needs to be done. Otherwise this returns true,
+		/// and the caller should issue it's PushRect or RenderText calls, followed by EndElement
+		/// 
+		/// Note that all geometry for an element must use the same texture. Elements are layered
+		/// with each other and with immediate geometry in the order they were submitted
+		/// </summary>
+		/// <param name="handle">The element's handle, will be allocated if it is InvalidElement</param>
+		/// <param name="tex">The texture that the element will be rendered with</param>
+		/// <param name="isFont">True if the texture is a font atlas</param>
+		/// <param name="contentDirty">True if the element's color, size, text, etc... has changed</param>
+		/// <returns>True if the element must be re-tessellated</returns>
+		static bool BeginElement(ElementHandle& handle, const Texture2D::Sptr& tex, bool isFont, bool contentDirty);
+		/// <summary>
+		/// Begins submission of a retained text element, see the overload above. Text elements
+		/// are also re-tessellated if the font's atlas has evicted any glyphs
+		/// </summary>
+		/// <param name="handle">The element's handle, will be allocated if it is InvalidElement</param>
+		/// <param name="font">The font that the element will be rendered with</param>
+		/// <param name="contentDirty">True if the element's color, size, text, etc... has changed</param>
+		/// <returns>True if the element must be re-tessellated</returns>
+		static bool BeginElement(ElementHandle& handle, const Font::Sptr& font, bool contentDirty);
+		/// <summary>
+		/// Finishes re-tessellating an element, copying it's geometry into it's slice of
+		/// the persistent vertex buffer
+		/// </summary>
+		/// <param name="handle">The handle passed to BeginElement</param>
+		static void EndElement(ElementHandle handle);
+		/// <summary>
+		/// Releases a retained element and it's vertex buffer slice, should be called when
+		/// the owning component is destroyed. Resets the handle to InvalidElement
+		/// </summary>
+		static void ReleaseElement(ElementHandle& handle);
+
 	private:
 		struct IRect {
 			glm::ivec2 Min;
 			glm::ivec2 Max;
 		};
 
+		// Determines which shader is used to draw geometry, values match the bindless shader
+		enum class ShadeMode : uint32_t {
+			Sprite  = 0,
+			Font    = 1,
+			SdfFont = 2
+		};
+
+		// Immediate mode geometry is rebuilt every frame, so it lives in the frame arena
 		struct MeshData {
-			MeshBuilder<VertexPosColTex> Builder;
-			bool IsFont;
+			MeshBuilder<VertexPosColTex, FrameAllocator<VertexPosColTex>> Builder;
+		};
+
+		struct RetainedBatch;
+
+		// A contiguous run of geometry that uses the same texture, either indices in the immediate mode mesh or
+		// quads in a retained batch. Runs are drawn in the order they were pushed to keep painter's order layering
+		struct DrawRun {
+			Texture2D*     Texture;
+			ShadeMode      Mode;
+			RetainedBatch* Batch;  // nullptr for runs in the immediate mesh
+			uint32_t       Offset; // In indices for immediate runs, or in quads for retained runs
+			uint32_t       Count;  // Immediate runs only know this once the next run starts, see __CloseRun
+		};
+
+		// A single positioned glyph quad, relative to the origin of the text
+		struct GlyphQuad {
+			glm::vec2 Positions[4];
+			glm::vec2 UVs[4];
+			int32_t   Cell; // The font's glyph cache cell, so we can keep it alive
+		};
+
+		// Caches the glyph quads for a string, so that text that does not change does not
+		// need to be re-shaped every frame
+		struct TextLayout {
+			Font*                  FontPtr = nullptr;
+			Font::Wptr             FontRef;
+			float                  Scale = 1.0f;
+			bool                   IsWide = false;
+			uint32_t               AtlasVersion = 0;
+			std::string            Source; // Raw bytes of the source string, to resolve hash collisions
+			std::vector<GlyphQuad> Glyphs;
+			uint64_t               LastFrame = 0;
+		};
+
+		// An entry in the bindless texture table, matches the std430 layout in the shader
+		struct BindlessSlot {
+			uint64_t Handle;
+			uint32_t Mode;
+			uint32_t Padding;
 		};
 
 		static glm::ivec2 __windowSize;
@@ -130,13 +273,97 @@
 		static std::vector<IRect> __scissorRects;
 		static ShaderProgram::Sptr __shader;
 		static ShaderProgram::Sptr __fontShader;
-		static std::unordered_map<Texture2D*, MeshData> _meshBuilders;
+		static ShaderProgram::Sptr __sdfFontShader;
+		static ShaderProgram::Sptr __bindlessShader;
+		static MeshData __immediateMesh;
+		static FrameVector<DrawRun> __drawRuns;
 		static VertexArrayObject::Sptr __vao;
 		static VertexBuffer::Sptr __vbo;
 		static IndexBuffer::Sptr __ibo;
+		static uint32_t __drawCalls;
+
+		static std::unordered_map<uint64_t, TextLayout> __textLayouts;
+		static std::vector<uint32_t> __codepointScratch;
 
 		static Texture2D::Sptr __defaultUITexture;
 		static int __defaultEdgeRadius;
 
+		static bool __atlasEnabled;
+		static TextureAtlas::Sptr __atlas;
+
+		static bool __bindlessEnabled;
+		static std::unordered_map<Texture2D*, uint32_t> __bindlessSlotMap;
+		static std::vector<std::weak_ptr<Texture2D>> __bindlessTextures;
+		static std::vector<uint32_t> __freeBindlessSlots;
+		static std::vector<BindlessSlot> __bindlessTable;
+		static bool __bindlessTableDirty;
+		static ShaderStorageBuffer::Sptr __bindlessBuffer;
+
+		// Stores the persistent geometry for all retained elements using a texture. 
+		// Geometry is allocated in quads, so the index buffer never needs to change
+		// unless the batch grows
+		struct RetainedBatch {
+			std::vector<VertexPosColTex> Vertices;
+			std::vector<glm::uvec2>      FreeRanges; // Offset and count, in quads
+			uint32_t                     QuadCapacity = 0;
+			uint32_t                     QuadHighWater = 0;
+			uint32_t                     DirtyMin = UINT32_MAX;
+			uint32_t                     DirtyMax = 0;
+			uint32_t                     SubmitCursor = 0; // End of the last quad range submitted this frame
+			uint64_t                     SubmitFrame = 0;
+			bool                         NeedsRealloc = false;
+			ShadeMode                    Mode = ShadeMode::Sprite;
+			Texture2D::Sptr              Texture = nullptr; // nullptr for the bindless batches
+			VertexBuffer::Sptr           VBO = nullptr;
+			IndexBuffer::Sptr            IBO = nullptr;
+			VertexArrayObject::Sptr      VAO = nullptr;
+		};
+
+		// Stores the state of a single retained element, and the slice of the batch it owns
+		struct RetainedElement {
+			Texture2D*     Texture = nullptr;
+			RetainedBatch* Batch = nullptr;
+			uint32_t       QuadOffset = 0;
+			uint32_t       QuadCapacity = 0;
+			glm::mat3      Model = glm::mat3(1.0f);
+			uint64_t       LastFrame = 0;
+			uint32_t       AtlasVersion = 0; // For text elements, the font atlas version when tessellated
+			std::vector<int32_t> GlyphCells; // For text elements, the glyph cache cells the geometry uses
+			bool           IsVisible = false;
+			bool           IsDirty = true;
+			bool           InUse = false;
+		};
+
+		static bool __retainedMode;
+		static uint64_t __frameIndex;
+		static std::unordered_map<Texture2D*, RetainedBatch> __retainedBatches;
+		static RetainedBatch __bindlessBatch; // The bindless shader handles every texture and mode, so all elements share it
+		static std::vector<RetainedElement> __retainedElements;
+		static std::vector<ElementHandle> __freeElements;
+		static MeshData __captureMesh;
+		static ElementHandle __captureElement;
+		static uint64_t __arenaFrame; // The frame arena index that the immediate and capture meshes were allocated in
+		static glm::uvec2 __meshHighWater; // The most vertices and indices the immediate mesh held at once during the last frame
+
 		static void __StaticInit();
-	};
+		static void __RenewFrameData();
+		static bool __BeginElement(ElementHandle& handle, const Texture2D::Sptr& tex, ShadeMode mode, bool contentDirty);
+		static const ShaderProgram::Sptr& __GetShader(ShadeMode mode);
+		static const Texture2D::Sptr& __ResolveTexture(const Texture2D::Sptr& tex, ShadeMode mode, glm::vec2& uvOffset, glm::vec2& uvScale);
+		static float __GetBindlessSlot(const Texture2D::Sptr& tex, ShadeMode mode);
+		static void __CollectBindlessSlots();
+		static MeshData& __GetMesh(const Texture2D::Sptr& tex, ShadeMode mode, float& slot);
+		static void __PushQuad(MeshData& mesh, const glm::vec2& min, const glm::vec2& max, const glm::vec4& color, float slot, const glm::vec2& uvMin, const glm::vec2& uvMax);
+		static const TextLayout& __GetTextLayout(const void* bytes, size_t size, bool isWide, const Font::Sptr& font, float scale);
+		static void __RenderTextLayout(const TextLayout& layout, const Font::Sptr& font, const glm::vec2& position, const glm::vec4& color);
+		static RetainedBatch& __GetBatch(const Texture2D::Sptr& resolved, ShadeMode mode);
+		static void __UploadBatch(RetainedBatch& batch);
+		static void __PushRun(const DrawRun& run);
+		static void __CloseRun();
+		static void __SubmitRetained(const RetainedElement& element);
+		static void __BindBindlessTable();
+		static uint32_t __AllocateQuads(RetainedBatch& batch, uint32_t count, uint32_t minOffset);
+		static void __FreeQuads(RetainedBatch& batch, uint32_t offset, uint32_t count);
+		static void __ClearQuads(RetainedBatch& batch, uint32_t offset, uint32_t count);
+		static void __InvalidateRetained();
+	};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "Graphics/HiZPyramid.h"
+
+HiZPyramid::HiZPyramid() :
+	_downsampleShader(nullptr),
+	_handle(0),
+	_size(glm::ivec2(0)),
+	_levels(0),
+	_viewProjection(glm::mat4(1.0f)),
+	_isValid(false)
+{
+	_downsampleShader = ShaderProgram::Create();
+	_downsampleShader->LoadShaderPartFromFile("shaders/compute_shaders/hiz_downsample.glsl", ShaderPartType::Compute);
+	_downsampleShader->Link();
+}
+
+HiZPyramid::~HiZPyramid() {
+	if (_handle != 0) {
+		glDeleteTextures(1, &_handle);
+		_handle = 0;
+	}
+}
+
+void HiZPyramid::Build(const Texture2D::Sptr& depth, const glm::mat4& viewProjection) {
+	if (depth == nullptr || !_downsampleShader->IsLinked()) {
+		_isValid = false;
+		return;
+	}
+
+	glm::ivec2 size = glm::ivec2(depth->GetWidth(), depth->GetHeight());
+	if (size.x * size.y == 0) {
+		_isValid = false;
+		return;
+	}
+	if (size != _size) {
+		_Resize(size);
+	}
+
+	_downsampleShader->Bind();
+
+	// Level 0 is a straight copy, since depth formats can't be bound as images
+	bool fromDepth = true;
+	depth->Bind(0);
+	glBindImageTexture(1, _handle, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	_downsampleShader->SetUniform(0, &fromDepth);
+	_downsampleShader->SetUniform(1, &_size);
+	_downsampleShader->SetUniform(2, &_size);
+	glDispatchCompute((_size.x + 7) / 8, (_size.y + 7) / 8, 1);
+
+	fromDepth = false;
+	_downsampleShader->SetUniform(0, &fromDepth);
+	glm::ivec2 sourceSize = _size;
+	for (int level = 1; level < _levels; level++) {
+		glm::ivec2 destSize = glm::max(sourceSize / 2, glm::ivec2(1));
+
+		// Each level reads the one we just wrote
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glBindImageTexture(0, _handle, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, _handle, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		_downsampleShader->SetUniform(1, &sourceSize);
+		_downsampleShader->SetUniform(2, &destSize);
+		glDispatchCompute((destSize.x + 7) / 8, (destSize.y + 7) / 8, 1);
+
+		sourceSize = destSize;
+	}
+
+	// The cull pass samples the pyramid as a texture
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	_viewProjection = viewProjection;
+	_isValid = true;
+}
+
+void HiZPyramid::Bind(int slot) const {
+	glBindTextureUnit(slot, _handle);
+}
+
+void HiZPyramid::_Resize(const glm::ivec2& size) {
+	if (_handle != 0) {
+		glDeleteTextures(1, &_handle);
+	}
+
+	_size = size;
+	_levels = 1 + static_cast<int>(glm::floor(glm::log2(static_cast<float>(glm::max(size.x, size.y)))));
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &_handle);
+	glTextureStorage2D(_handle, _levels, GL_R32F, size.x, size.y);
+	// The cull pass picks an exact level, so we never want filtering between texels or levels
+	glTextureParameteri(_handle, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(_handle, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(_handle, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	_isValid = false;
+}
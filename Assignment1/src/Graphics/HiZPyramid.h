@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/Textures/Texture2D.h"
+
+/// <summary>
+/// A mip chain built from a depth buffer, where every texel holds the furthest depth of the
+/// area it covers. Used for occlusion culling against the previous frame's depth
+/// </summary>
+class HiZPyramid {
+public:
+	MAKE_PTRS(HiZPyramid);
+
+	static inline Sptr Create() {
+		return std::make_shared<HiZPyramid>();
+	}
+
+	HiZPyramid();
+	~HiZPyramid();
+
+	/// <summary>
+	/// Rebuilds the pyramid from the given depth texture, resizing it if needed
+	/// </summary>
+	/// <param name="depth">The depth texture to build from, must not be multisampled</param>
+	/// <param name="viewProjection">The view projection that the depth was rendered with</param>
+	void Build(const Texture2D::Sptr& depth, const glm::mat4& viewProjection);
+
+	/// <summary>
+	/// Binds the pyramid to the given texture slot for sampling
+	/// </summary>
+	void Bind(int slot) const;
+
+	/// <summary>
+	/// Marks the pyramid as out of date, so it is not used until it is built again
+	/// </summary>
+	void Invalidate() { _isValid = false; }
+
+	bool IsValid() const { return _isValid; }
+	const glm::ivec2& GetSize() const { return _size; }
+	int GetNumLevels() const { return _levels; }
+	const glm::mat4& GetViewProjection() const { return _viewProjection; }
+
+protected:
+	ShaderProgram::Sptr _downsampleShader;
+
+	// We need per-level image bindings, which our Texture2D wrapper does not expose, so we own the handle
+	GLuint     _handle;
+	glm::ivec2 _size;
+	int        _levels;
+	glm::mat4  _viewProjection;
+	bool       _isValid;
+
+	void _Resize(const glm::ivec2& size);
+};
@@ -1,9 +1,20 @@
 #include "Graphics/IGraphicsResource.h"
 
+std::mutex IGraphicsResource::__liveResourcesMutex;
+std::unordered_set<IGraphicsResource*> IGraphicsResource::__liveResources;
+
 IGraphicsResource::IGraphicsResource() :
 	_debugName(""),
 	_rendererId(0)
-{ }
+{
+	std::lock_guard<std::mutex> lock(__liveResourcesMutex);
+	__liveResources.insert(this);
+}
+
+IGraphicsResource::~IGraphicsResource() {
+	std::lock_guard<std::mutex> lock(__liveResourcesMutex);
+	__liveResources.erase(this);
+}
 
 void IGraphicsResource::SetDebugName(const std::string& name)
 {
@@ -22,6 +33,22 @@ uint32_t IGraphicsResource::GetHandle() const {
 	return _rendererId;
 }
 
+size_t IGraphicsResource::GetMemoryEstimate() const {
+	return 0;
+}
+
+std::map<GlResourceType, size_t> IGraphicsResource::GetMemoryEstimates() {
+	std::map<GlResourceType, size_t> result;
+	std::lock_guard<std::mutex> lock(__liveResourcesMutex);
+	for (const IGraphicsResource* resource : __liveResources) {
+		size_t estimate = resource->GetMemoryEstimate();
+		if (estimate > 0) {
+			result[resource->GetResourceClass()] += estimate;
+		}
+	}
+	return result;
+}
+
 void IGraphicsResource::_SetRenderId(uint32_t renderId)
 {
 	_rendererId = renderId;
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <unordered_set>
 #include <glad/glad.h>
 #include <EnumToString.h>
 
@@ -35,7 +38,7 @@ public:
 	// For pointers and deletion of move and copy
 	DEFINE_RESOURCE(IGraphicsResource)
 
-	virtual ~IGraphicsResource() = default;
+	virtual ~IGraphicsResource();
 
 	/**
 	 * Should be overridden in derived classes to return a resource type identifier
@@ -58,6 +61,18 @@ public:
 	 */
 	virtual uint32_t GetHandle() const;
 
+	/**
+	 * Gets a rough estimate of how much video memory this resource owns, in bytes. Resources
+	 * that don't own storage of their own (framebuffers, VAOs) return 0
+	 */
+	virtual size_t GetMemoryEstimate() const;
+
+	/**
+	 * Adds up the memory estimates of every live graphics resource, grouped by resource class.
+	 * Must be called from the thread that owns the GL context
+	 */
+	static std::map<GlResourceType, size_t> GetMemoryEstimates();
+
 protected:
 	IGraphicsResource();
 	
@@ -69,4 +84,9 @@ protected:
 
 	std::string _debugName;
 	uint32_t    _rendererId;
+
+private:
+	// Every resource that is currently alive, so we can estimate video memory use without a registry per type
+	static std::mutex __liveResourcesMutex;
+	static std::unordered_set<IGraphicsResource*> __liveResources;
 };
\ No newline at end of file
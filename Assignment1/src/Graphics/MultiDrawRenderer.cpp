@@ -0,0 +1,237 @@
+#include "Graphics/MultiDrawRenderer.h"
+#include <algorithm>
+#include "Graphics/GeometryArena.h"
+#include "Utils/Profiler.h"
+
+MultiDrawRenderer::MultiDrawRenderer() :
+	EnableCulling(true),
+	EnableOcclusionCulling(false),
+	_draws(std::vector<QueuedDraw>()),
+	_batches(std::vector<Batch>()),
+	_commands(std::vector<DrawElementsIndirectCommand>()),
+	_drawData(std::vector<DrawData>()),
+	_cullData(std::vector<CullData>()),
+	_commandBuffer(nullptr),
+	_drawDataBuffer(nullptr),
+	_cullShader(nullptr),
+	_inputCommandBuffer(nullptr),
+	_cullDataBuffer(nullptr),
+	_batchCountBuffer(nullptr),
+	_hiZ(nullptr),
+	_stats(Stats())
+{
+	_commandBuffer = IndirectBuffer::Create(BufferUsage::DynamicDraw);
+	_drawDataBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+
+	_cullShader = ShaderProgram::Create();
+	_cullShader->LoadShaderPartFromFile("shaders/compute_shaders/draw_cull.glsl", ShaderPartType::Compute);
+	_cullShader->Link();
+
+	_inputCommandBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+	_cullDataBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+	_batchCountBuffer = ShaderStorageBuffer::Create(BufferUsage::DynamicCopy);
+
+	_hiZ = HiZPyramid::Create();
+}
+
+MultiDrawRenderer::~MultiDrawRenderer() = default;
+
+bool MultiDrawRenderer::IsSupported() {
+	#ifdef GL_ARB_shader_draw_parameters
+	return GLAD_GL_ARB_shader_draw_parameters != 0 && GLAD_GL_ARB_multi_draw_indirect != 0;
+	#else
+	return false;
+	#endif
+}
+
+bool MultiDrawRenderer::_IsDrawCountSupported() {
+	#ifdef GL_ARB_indirect_parameters
+	return GLAD_GL_ARB_indirect_parameters != 0;
+	#else
+	return false;
+	#endif
+}
+
+void MultiDrawRenderer::Begin() {
+	_draws.clear();
+}
+
+bool MultiDrawRenderer::Submit(const Gameplay::Material::Sptr& material, const VertexArrayObject::Sptr& mesh, const glm::mat4& transform) {
+	const GeometryAllocation::Sptr& allocation = mesh->GetArenaAllocation();
+	if (allocation == nullptr || allocation->IndexCount == 0 || !material->IsReady()) {
+		return false;
+	}
+
+	// The variant gets compiled the first time we ask for it, until then the object is drawn normally
+	const ShaderProgram::Sptr& shader = material->GetMultiDrawShader();
+	if (shader == nullptr || !shader->IsReady()) {
+		return false;
+	}
+
+	QueuedDraw draw;
+	draw.Material = material.get();
+	draw.PageVao = allocation->Arena->GetPageVao(allocation->Page).get();
+	draw.Transform = transform;
+	draw.BoundingSphere = allocation->BoundingSphere;
+	draw.FirstIndex = allocation->FirstIndex;
+	draw.IndexCount = allocation->IndexCount;
+	draw.BaseVertex = allocation->BaseVertex;
+	_draws.push_back(draw);
+	return true;
+}
+
+void MultiDrawRenderer::Flush(const glm::mat4& viewProjection, const BatchCallback& onBatch) {
+	_stats.Draws = static_cast<uint32_t>(_draws.size());
+	_stats.Batches = 0;
+	if (_draws.empty()) {
+		return;
+	}
+
+	// Grouping by material first keeps shader changes to a minimum, then by page so each group is one call
+	std::sort(_draws.begin(), _draws.end(), [](const QueuedDraw& a, const QueuedDraw& b) {
+		return a.Material != b.Material ? a.Material < b.Material : a.PageVao < b.PageVao;
+	});
+
+	_batches.clear();
+	_commands.resize(_draws.size());
+	_drawData.resize(_draws.size());
+	_cullData.resize(_draws.size());
+	for (uint32_t ix = 0; ix < _draws.size(); ix++) {
+		const QueuedDraw& draw = _draws[ix];
+
+		if (_batches.empty() || _batches.back().Material != draw.Material || _batches.back().PageVao != draw.PageVao) {
+			_batches.push_back({ draw.Material, draw.PageVao, ix, 0 });
+		}
+		Batch& batch = _batches.back();
+		batch.CommandCount++;
+
+		// The base instance doesn't offset any attributes (we have no instanced ones), the shader adds it to
+		// gl_DrawID to find it's draw data, since gl_DrawID restarts at 0 for every call
+		DrawElementsIndirectCommand& command = _commands[ix];
+		command.Count = draw.IndexCount;
+		command.InstanceCount = 1;
+		command.FirstIndex = draw.FirstIndex;
+		command.BaseVertex = static_cast<int32_t>(draw.BaseVertex);
+		command.BaseInstance = batch.FirstCommand;
+
+		DrawData& data = _drawData[ix];
+		data.Model = draw.Transform;
+		data.ModelViewProjection = viewProjection * draw.Transform;
+		data.NormalMatrix = glm::mat3(glm::transpose(glm::inverse(draw.Transform)));
+
+		CullData& cull = _cullData[ix];
+		cull.BoundingSphere = draw.BoundingSphere;
+		cull.Batch = static_cast<uint32_t>(_batches.size() - 1);
+		cull.BatchStart = batch.FirstCommand;
+	}
+
+	uint32_t numDraws = static_cast<uint32_t>(_draws.size());
+	_drawDataBuffer->UpdateData(_drawData.data(), sizeof(DrawData), numDraws, true);
+
+	bool cull = EnableCulling && _cullShader->IsLinked();
+	bool compact = cull && _IsDrawCountSupported();
+	if (cull) {
+		_Cull(viewProjection, compact);
+	} else {
+		_commandBuffer->UpdateData(_commands.data(), sizeof(DrawElementsIndirectCommand), numDraws, true);
+	}
+
+	_commandBuffer->Bind();
+	_drawDataBuffer->Bind(DRAW_DATA_BINDING);
+	#ifdef GL_ARB_indirect_parameters
+	if (compact) {
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, _batchCountBuffer->GetHandle());
+	}
+	#endif
+
+	for (uint32_t ix = 0; ix < _batches.size(); ix++) {
+		const Batch& batch = _batches[ix];
+
+		batch.Material->GetMultiDrawShader()->Bind();
+		batch.Material->ApplyMultiDraw();
+		if (onBatch) {
+			onBatch(batch.Material);
+		}
+
+		batch.PageVao->Bind();
+		const void* commands = (const void*)(batch.FirstCommand * sizeof(DrawElementsIndirectCommand));
+		#ifdef GL_ARB_indirect_parameters
+		if (compact) {
+			// The cull pass wrote how many of the batch's commands survived, the rest of it's range is garbage
+			glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commands, (GLintptr)ix * sizeof(uint32_t), batch.CommandCount, 0);
+		} else
+		#endif
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, batch.CommandCount, 0);
+		}
+		_stats.Batches++;
+		Profiler::CountDrawCalls();
+	}
+
+	VertexArrayObject::Unbind();
+	IndirectBuffer::UnBind();
+}
+
+void MultiDrawRenderer::UpdateOcclusion(const Texture2D::Sptr& depth, const glm::mat4& viewProjection) {
+	if (EnableCulling && EnableOcclusionCulling) {
+		_hiZ->Build(depth, viewProjection);
+	} else {
+		_hiZ->Invalidate();
+	}
+}
+
+void MultiDrawRenderer::_Cull(const glm::mat4& viewProjection, bool compact) {
+	uint32_t numDraws = static_cast<uint32_t>(_draws.size());
+	uint32_t numBatches = static_cast<uint32_t>(_batches.size());
+
+	_inputCommandBuffer->UpdateData(_commands.data(), sizeof(DrawElementsIndirectCommand), numDraws, true);
+	_cullDataBuffer->UpdateData(_cullData.data(), sizeof(CullData), numDraws, true);
+
+	// The output and counts are only ever written by the GPU, so we just need enough room for them
+	if (_commandBuffer->GetElementCount() < numDraws) {
+		_commandBuffer->LoadData(nullptr, sizeof(DrawElementsIndirectCommand), numDraws);
+	}
+	if (_batchCountBuffer->GetElementCount() < numBatches) {
+		_batchCountBuffer->LoadData(nullptr, sizeof(uint32_t), numBatches);
+	}
+	uint32_t zero = 0;
+	glClearNamedBufferData(_batchCountBuffer->GetHandle(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	// Gribb-Hartmann plane extraction, each plane is a sum or difference of the matrix's rows
+	glm::mat4 rows = glm::transpose(viewProjection);
+	glm::vec4 planes[6] = {
+		rows[3] + rows[0], rows[3] - rows[0],
+		rows[3] + rows[1], rows[3] - rows[1],
+		rows[3] + rows[2], rows[3] - rows[2]
+	};
+	for (glm::vec4& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	int  drawCount = static_cast<int>(numDraws);
+	bool useHiZ = EnableOcclusionCulling && _hiZ->IsValid();
+	glm::vec2 hiZSize = glm::vec2(_hiZ->GetSize());
+	int  hiZLevels = _hiZ->GetNumLevels();
+
+	_cullShader->Bind();
+	_cullShader->SetUniform(0, &drawCount);
+	_cullShader->SetUniform(1, &compact);
+	_cullShader->SetUniform(2, &useHiZ);
+	_cullShader->SetUniformMatrix(3, &_hiZ->GetViewProjection());
+	_cullShader->SetUniform(4, &hiZSize);
+	_cullShader->SetUniform(5, &hiZLevels);
+	_cullShader->SetUniform(6, planes, 6);
+	if (useHiZ) {
+		_hiZ->Bind(HIZ_TEXTURE_SLOT);
+	}
+
+	_drawDataBuffer->Bind(DRAW_DATA_BINDING);
+	_inputCommandBuffer->Bind(INPUT_COMMAND_BINDING);
+	_cullDataBuffer->Bind(CULL_DATA_BINDING);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OUTPUT_COMMAND_BINDING, _commandBuffer->GetHandle());
+	_batchCountBuffer->Bind(BATCH_COUNT_BINDING);
+	glDispatchCompute((numDraws + 63) / 64, 1, 1);
+
+	// The commands and counts are read by the draw calls, not by shaders
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
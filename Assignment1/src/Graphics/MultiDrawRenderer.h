@@ -0,0 +1,164 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Gameplay/Material.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/Buffers/IndirectBuffer.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+#include "Graphics/HiZPyramid.h"
+
+/// <summary>
+/// Collects draws of meshes that live in a geometry arena, and submits them with
+/// glMultiDrawElementsIndirect. Draws are grouped by material and arena page, so each group
+/// only needs one shader bind, one VAO bind and one API call no matter how many objects are in it.
+///
+/// Materials are drawn with their MULTI_DRAW shader variant, which reads each draw's transforms
+/// from a storage buffer indexed by gl_DrawID instead of the per-object instance UBO.
+///
+/// With culling enabled, a compute pass tests every draw's bounding sphere against the frustum
+/// (and optionally a Hi-Z pyramid of the previous frame's depth) and writes only the visible
+/// commands into the indirect buffer, so visibility never has to come back to the CPU
+/// </summary>
+class MultiDrawRenderer {
+public:
+	MAKE_PTRS(MultiDrawRenderer);
+
+	static inline Sptr Create() {
+		return std::make_shared<MultiDrawRenderer>();
+	}
+
+	// Binding slot for the per-draw data, must match vs_common.glsl
+	static const int DRAW_DATA_BINDING = 11;
+	// Binding slots used by the cull pass, must match draw_cull.glsl
+	static const int INPUT_COMMAND_BINDING = 12;
+	static const int CULL_DATA_BINDING = 13;
+	static const int OUTPUT_COMMAND_BINDING = 14;
+	static const int BATCH_COUNT_BINDING = 15;
+	static const int HIZ_TEXTURE_SLOT = 0;
+
+	/// <summary>
+	/// Per-frame statistics about the work submitted
+	/// </summary>
+	struct Stats {
+		// The number of objects drawn through multi-draw
+		uint32_t Draws;
+		// The number of glMultiDrawElementsIndirect calls issued
+		uint32_t Batches;
+	};
+
+	/// <summary>
+	/// Called when a batch's material has been bound, before it's draws are issued
+	/// </summary>
+	typedef std::function<void(Gameplay::Material*)> BatchCallback;
+
+	/// <summary>
+	/// True to cull draws against the camera's frustum on the GPU before they are drawn
+	/// </summary>
+	bool EnableCulling;
+	/// <summary>
+	/// True to also cull draws hidden behind the previous frame's depth, requires EnableCulling and
+	/// UpdateOcclusion to be called every frame. Fast moving objects may pop in a frame late
+	/// </summary>
+	bool EnableOcclusionCulling;
+
+	MultiDrawRenderer();
+	~MultiDrawRenderer();
+
+	/// <summary>
+	/// Returns true if the driver supports everything needed for multi-draw submission
+	/// </summary>
+	static bool IsSupported();
+
+	/// <summary>
+	/// Clears all the draws collected for the previous frame
+	/// </summary>
+	void Begin();
+
+	/// <summary>
+	/// Attempts to queue a mesh for drawing. This will fail for meshes that are not indexed meshes in
+	/// a geometry arena, or when the material's multi-draw variant is not ready yet
+	/// </summary>
+	/// <returns>True if the draw was queued, false if the caller needs to draw it themselves</returns>
+	bool Submit(const Gameplay::Material::Sptr& material, const VertexArrayObject::Sptr& mesh, const glm::mat4& transform);
+
+	/// <summary>
+	/// Uploads the draws queued since Begin and issues one multi-draw call per batch
+	/// </summary>
+	/// <param name="viewProjection">The camera's view projection matrix</param>
+	/// <param name="onBatch">Optional callback to adjust state before each batch is drawn</param>
+	void Flush(const glm::mat4& viewProjection, const BatchCallback& onBatch = nullptr);
+
+	/// <summary>
+	/// Rebuilds the Hi-Z pyramid that next frame's draws are occlusion culled against
+	/// </summary>
+	/// <param name="depth">This frame's depth buffer</param>
+	/// <param name="viewProjection">The view projection this frame was rendered with</param>
+	void UpdateOcclusion(const Texture2D::Sptr& depth, const glm::mat4& viewProjection);
+
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// Matches DrawData in vs_common.glsl
+	struct DrawData {
+		glm::mat4 ModelViewProjection;
+		glm::mat4 Model;
+		glm::mat4 NormalMatrix;
+	};
+
+	// Matches CullData in draw_cull.glsl
+	struct CullData {
+		glm::vec4 BoundingSphere;
+		uint32_t  Batch;
+		uint32_t  BatchStart;
+		uint32_t  Padding[2];
+	};
+
+	// A draw waiting to be submitted
+	struct QueuedDraw {
+		Gameplay::Material* Material;
+		VertexArrayObject*  PageVao;
+		glm::mat4           Transform;
+		glm::vec4           BoundingSphere;
+		uint32_t            FirstIndex;
+		uint32_t            IndexCount;
+		uint32_t            BaseVertex;
+	};
+
+	// A run of draws that share a material and page, and go out in a single call
+	struct Batch {
+		Gameplay::Material* Material;
+		VertexArrayObject*  PageVao;
+		uint32_t            FirstCommand;
+		uint32_t            CommandCount;
+	};
+
+	std::vector<QueuedDraw>                  _draws;
+	std::vector<Batch>                       _batches;
+	std::vector<DrawElementsIndirectCommand> _commands;
+	std::vector<DrawData>                    _drawData;
+	std::vector<CullData>                    _cullData;
+
+	IndirectBuffer::Sptr      _commandBuffer;
+	ShaderStorageBuffer::Sptr _drawDataBuffer;
+
+	ShaderProgram::Sptr       _cullShader;
+	ShaderStorageBuffer::Sptr _inputCommandBuffer;
+	ShaderStorageBuffer::Sptr _cullDataBuffer;
+	ShaderStorageBuffer::Sptr _batchCountBuffer;
+	HiZPyramid::Sptr          _hiZ;
+
+	/// <summary>
+	/// Returns true if the driver can draw with a GPU written draw count, letting the cull pass compact commands
+	/// </summary>
+	static bool _IsDrawCountSupported();
+
+	/// <summary>
+	/// Dispatches the cull pass, filling the command buffer from the input commands
+	/// </summary>
+	void _Cull(const glm::mat4& viewProjection, bool compact);
+
+	Stats _stats;
+};
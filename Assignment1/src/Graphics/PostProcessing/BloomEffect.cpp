@@ -0,0 +1,79 @@
+#include "Graphics/PostProcessing/BloomEffect.h"
+#include "Utils/ImGuiHelper.h"
+
+BloomEffect::BloomEffect() :
+	PostProcessingEffect("Bloom"),
+	Threshold(1.0f),
+	SoftKnee(0.5f),
+	Intensity(0.5f),
+	BlurPasses(2),
+	_prefilterShader(nullptr),
+	_blurShader(nullptr)
+{
+	ResolutionScale = 0.5f;
+
+	_shader = _LoadShader("shaders/fragment_shaders/post/bloom_composite.glsl");
+	_prefilterShader = _LoadShader("shaders/fragment_shaders/post/bloom_prefilter.glsl");
+	_blurShader = _LoadShader("shaders/fragment_shaders/post/gaussian_blur.glsl");
+}
+
+BloomEffect::~BloomEffect() = default;
+
+bool BloomEffect::IsActive() const {
+	return PostProcessingEffect::IsActive() && _prefilterShader->IsReady() && _blurShader->IsReady() && Intensity > 0.0f;
+}
+
+void BloomEffect::Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) {
+	glm::ivec2 size = PostProcessingEffect::GetOutputSize(input->GetSize());
+	glm::vec2 texelSize = 1.0f / glm::vec2(size);
+
+	// Two targets to ping-pong the blur between, the highlights need to stay in HDR
+	Framebuffer::Sptr targets[2] = {
+		pool.Acquire(size, RenderTargetType::ColorRgba16F),
+		pool.Acquire(size, RenderTargetType::ColorRgba16F)
+	};
+	glViewport(0, 0, size.x, size.y);
+
+	// Extract the highlights, the downsample is done by the bilinear fetch
+	targets[0]->Bind();
+	_prefilterShader->Bind();
+	_prefilterShader->SetUniform(0, &Threshold);
+	_prefilterShader->SetUniform(1, &SoftKnee);
+	input->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+	_DrawFullscreen();
+
+	// Separable blur, each pass goes horizontal into the second target then vertical back into the first
+	_blurShader->Bind();
+	for (int ix = 0; ix < BlurPasses; ix++) {
+		glm::vec2 horizontal = glm::vec2(texelSize.x, 0.0f);
+		targets[1]->Bind();
+		_blurShader->SetUniform(0, &horizontal);
+		targets[0]->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+		_DrawFullscreen();
+
+		glm::vec2 vertical = glm::vec2(0.0f, texelSize.y);
+		targets[0]->Bind();
+		_blurShader->SetUniform(0, &vertical);
+		targets[1]->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+		_DrawFullscreen();
+	}
+
+	// Add the highlights back on top of the full resolution image
+	output->Bind();
+	glViewport(0, 0, output->GetWidth(), output->GetHeight());
+	_shader->Bind();
+	_shader->SetUniform(0, &Intensity);
+	input->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+	targets[0]->BindAttachment(RenderTargetAttachment::Color0, BLOOM_TEXTURE_SLOT);
+	_DrawFullscreen();
+
+	pool.Release(targets[0]);
+	pool.Release(targets[1]);
+}
+
+void BloomEffect::RenderImGui() {
+	LABEL_LEFT(ImGui::DragFloat, "Threshold", &Threshold, 0.01f, 0.0f, 16.0f);
+	LABEL_LEFT(ImGui::SliderFloat, "Soft Knee", &SoftKnee, 0.0f, 1.0f);
+	LABEL_LEFT(ImGui::DragFloat, "Intensity", &Intensity, 0.01f, 0.0f, 4.0f);
+	LABEL_LEFT(ImGui::SliderInt, "Blur Passes", &BlurPasses, 1, 8);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+
+/// <summary>
+/// Makes bright areas of the image bleed into their surroundings. The bright parts of the image are
+/// extracted and blurred at ResolutionScale (half resolution by default), then added back on top of the
+/// full resolution input. Should run before tone mapping, so it can see HDR values
+/// </summary>
+class BloomEffect : public PostProcessingEffect {
+public:
+	MAKE_PTRS(BloomEffect);
+
+	static inline Sptr Create() {
+		return std::make_shared<BloomEffect>();
+	}
+
+	// The texture slot the blurred highlights are bound to in the composite pass, must match bloom_composite.glsl
+	static const int BLOOM_TEXTURE_SLOT = 1;
+
+	/// <summary>
+	/// The brightness above which pixels start to bloom
+	/// </summary>
+	float Threshold;
+	/// <summary>
+	/// How far below the threshold pixels fade in, as a fraction of the threshold
+	/// </summary>
+	float SoftKnee;
+	/// <summary>
+	/// How much of the blurred highlights is added to the image
+	/// </summary>
+	float Intensity;
+	/// <summary>
+	/// The number of horizontal + vertical blur iterations, more passes gives a wider glow
+	/// </summary>
+	int BlurPasses;
+
+	BloomEffect();
+	virtual ~BloomEffect();
+
+	// Inherited from PostProcessingEffect
+
+	virtual bool IsActive() const override;
+	// The blur runs at reduced resolution, but the composite is done at the input's resolution
+	virtual glm::ivec2 GetOutputSize(const glm::ivec2& inputSize) const override { return inputSize; }
+	virtual void Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) override;
+	virtual void RenderImGui() override;
+
+protected:
+	ShaderProgram::Sptr _prefilterShader;
+	ShaderProgram::Sptr _blurShader;
+};
@@ -0,0 +1,31 @@
+#include "Graphics/PostProcessing/ColorGradingEffect.h"
+#include "Utils/ImGuiHelper.h"
+
+ColorGradingEffect::ColorGradingEffect() :
+	PostProcessingEffect("Color Grading"),
+	LUT(nullptr),
+	Strength(1.0f)
+{
+	_shader = _LoadShader("shaders/fragment_shaders/post/color_grading.glsl");
+}
+
+ColorGradingEffect::~ColorGradingEffect() = default;
+
+bool ColorGradingEffect::IsActive() const {
+	return PostProcessingEffect::IsActive() && LUT != nullptr && Strength > 0.0f;
+}
+
+void ColorGradingEffect::Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) {
+	_shader->Bind();
+	_shader->SetUniform(0, &Strength);
+	input->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+	LUT->Bind(LUT_TEXTURE_SLOT);
+	_DrawFullscreen();
+}
+
+void ColorGradingEffect::RenderImGui() {
+	if (LUT == nullptr) {
+		ImGui::TextDisabled("No LUT set on the scene, or color correction is disabled");
+	}
+	LABEL_LEFT(ImGui::SliderFloat, "Strength", &Strength, 0.0f, 1.0f);
+}
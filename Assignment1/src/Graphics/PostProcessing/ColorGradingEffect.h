@@ -0,0 +1,37 @@
+#pragma once
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+#include "Graphics/Textures/Texture3D.h"
+
+/// <summary>
+/// Remaps the image's colors through a 3D lookup table. Since this runs once per pixel after
+/// the scene is drawn, overdrawn fragments no longer pay for the lookup
+/// </summary>
+class ColorGradingEffect : public PostProcessingEffect {
+public:
+	MAKE_PTRS(ColorGradingEffect);
+
+	static inline Sptr Create() {
+		return std::make_shared<ColorGradingEffect>();
+	}
+
+	// The texture slot the LUT is bound to, must match color_grading.glsl
+	static const int LUT_TEXTURE_SLOT = 1;
+
+	/// <summary>
+	/// The lookup table to grade with, the effect is skipped when this is not set
+	/// </summary>
+	Texture3D::Sptr LUT;
+	/// <summary>
+	/// How much of the graded color to use, where 0 is the original image and 1 is fully graded
+	/// </summary>
+	float Strength;
+
+	ColorGradingEffect();
+	virtual ~ColorGradingEffect();
+
+	// Inherited from PostProcessingEffect
+
+	virtual bool IsActive() const override;
+	virtual void Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) override;
+	virtual void RenderImGui() override;
+};
@@ -0,0 +1,30 @@
+#include "Graphics/PostProcessing/FxaaEffect.h"
+#include "Utils/ImGuiHelper.h"
+
+FxaaEffect::FxaaEffect() :
+	PostProcessingEffect("FXAA"),
+	EdgeThreshold(0.125f),
+	EdgeThresholdMin(0.0312f),
+	SubpixelQuality(0.75f)
+{
+	_shader = _LoadShader("shaders/fragment_shaders/post/fxaa.glsl");
+}
+
+FxaaEffect::~FxaaEffect() = default;
+
+void FxaaEffect::Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) {
+	glm::vec2 texelSize = 1.0f / glm::vec2(input->GetSize());
+	_shader->Bind();
+	_shader->SetUniform(0, &texelSize);
+	_shader->SetUniform(1, &EdgeThreshold);
+	_shader->SetUniform(2, &EdgeThresholdMin);
+	_shader->SetUniform(3, &SubpixelQuality);
+	input->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+	_DrawFullscreen();
+}
+
+void FxaaEffect::RenderImGui() {
+	LABEL_LEFT(ImGui::SliderFloat, "Edge Threshold", &EdgeThreshold, 0.063f, 0.333f);
+	LABEL_LEFT(ImGui::SliderFloat, "Edge Threshold Min", &EdgeThresholdMin, 0.0f, 0.0833f);
+	LABEL_LEFT(ImGui::SliderFloat, "Subpixel Quality", &SubpixelQuality, 0.0f, 1.0f);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+
+/// <summary>
+/// Fast approximate anti-aliasing, blurs along edges found from the image's luminance. Should run
+/// after tone mapping, since the edge thresholds assume LDR colors
+/// </summary>
+class FxaaEffect : public PostProcessingEffect {
+public:
+	MAKE_PTRS(FxaaEffect);
+
+	static inline Sptr Create() {
+		return std::make_shared<FxaaEffect>();
+	}
+
+	/// <summary>
+	/// The minimum local contrast needed before a pixel is treated as an edge, relative to it's brightest neighbour
+	/// </summary>
+	float EdgeThreshold;
+	/// <summary>
+	/// The minimum local contrast needed before a pixel is treated as an edge, keeps dark areas from being blurred
+	/// </summary>
+	float EdgeThresholdMin;
+	/// <summary>
+	/// How much sub-pixel aliasing is removed, higher values are softer
+	/// </summary>
+	float SubpixelQuality;
+
+	FxaaEffect();
+	virtual ~FxaaEffect();
+
+	// Inherited from PostProcessingEffect
+
+	virtual void Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) override;
+	virtual void RenderImGui() override;
+};
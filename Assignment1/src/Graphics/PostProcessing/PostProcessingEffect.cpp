@@ -0,0 +1,38 @@
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+#include "Utils/Profiler.h"
+
+VertexArrayObject::Sptr PostProcessingEffect::__fullscreenVao = nullptr;
+
+PostProcessingEffect::PostProcessingEffect(const std::string& name) :
+	Name(name),
+	Enabled(true),
+	ResolutionScale(1.0f),
+	_shader(nullptr)
+{ }
+
+bool PostProcessingEffect::IsActive() const {
+	return Enabled && _shader != nullptr && _shader->IsReady();
+}
+
+glm::ivec2 PostProcessingEffect::GetOutputSize(const glm::ivec2& inputSize) const {
+	float scale = glm::clamp(ResolutionScale, 0.1f, 1.0f);
+	return glm::max(glm::ivec2(glm::vec2(inputSize) * scale), glm::ivec2(1));
+}
+
+ShaderProgram::Sptr PostProcessingEffect::_LoadShader(const std::string& fragmentPath) {
+	ShaderProgram::Sptr result = ShaderProgram::Create();
+	result->LoadShaderPartFromFile("shaders/vertex_shaders/fullscreen_triangle.glsl", ShaderPartType::Vertex);
+	result->LoadShaderPartFromFile(fragmentPath, ShaderPartType::Fragment);
+	result->Link();
+	return result;
+}
+
+void PostProcessingEffect::_DrawFullscreen() {
+	if (__fullscreenVao == nullptr) {
+		__fullscreenVao = VertexArrayObject::Create();
+		__fullscreenVao->SetDebugName("Fullscreen Triangle");
+	}
+	__fullscreenVao->Bind();
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	Profiler::CountDrawCalls();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Framebuffer.h"
+#include "Graphics/FramebufferPool.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/VertexArrayObject.h"
+
+/// <summary>
+/// Base class for a single full-screen pass in the post processing chain. The chain hands each
+/// effect the previous pass's output, and an output target from the pool that it should fill
+/// </summary>
+class PostProcessingEffect {
+public:
+	MAKE_PTRS(PostProcessingEffect);
+	NO_MOVE(PostProcessingEffect);
+	NO_COPY(PostProcessingEffect);
+
+	// The texture slot that the pass's input is bound to, must match the post shaders
+	static const int INPUT_TEXTURE_SLOT = 0;
+
+	/// <summary>
+	/// Human readable name for the effect, for debugging purposes
+	/// </summary>
+	std::string Name;
+	/// <summary>
+	/// When disabled, the effect is skipped and the input goes to the next pass unchanged
+	/// </summary>
+	bool Enabled;
+	/// <summary>
+	/// The fraction of the input's resolution that the effect does it's work at, in the range (0, 1].
+	/// Lower values trade quality for fill rate
+	/// </summary>
+	float ResolutionScale;
+
+	virtual ~PostProcessingEffect() = default;
+
+	/// <summary>
+	/// Returns true if the effect should run this frame
+	/// </summary>
+	virtual bool IsActive() const;
+
+	/// <summary>
+	/// Gets the size of the target the effect will write it's result to, by default the input's size
+	/// scaled by ResolutionScale
+	/// </summary>
+	virtual glm::ivec2 GetOutputSize(const glm::ivec2& inputSize) const;
+	/// <summary>
+	/// Gets the format of the target the effect will write it's result to, by default the input's format
+	/// </summary>
+	virtual RenderTargetType GetOutputFormat(RenderTargetType inputFormat) const { return inputFormat; }
+
+	/// <summary>
+	/// Runs the effect. The output target is bound with a matching viewport when this is called,
+	/// and must still be bound when it returns
+	/// </summary>
+	/// <param name="input">The result of the previous pass</param>
+	/// <param name="output">The target to write the result to</param>
+	/// <param name="pool">The pool to grab any intermediate targets from, they must be released before returning</param>
+	virtual void Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) = 0;
+
+	/// <summary>
+	/// Draws the effect's settings
+	/// </summary>
+	virtual void RenderImGui() {}
+
+protected:
+	PostProcessingEffect(const std::string& name);
+
+	ShaderProgram::Sptr _shader;
+
+	/// <summary>
+	/// Loads the shared full-screen vertex shader and the given fragment shader into _shader
+	/// </summary>
+	static ShaderProgram::Sptr _LoadShader(const std::string& fragmentPath);
+
+	/// <summary>
+	/// Draws a single triangle that covers the entire viewport, the vertex shader builds it from gl_VertexID
+	/// </summary>
+	static void _DrawFullscreen();
+
+	// We don't need any vertex data, but GL still wants a VAO bound to draw
+	static VertexArrayObject::Sptr __fullscreenVao;
+};
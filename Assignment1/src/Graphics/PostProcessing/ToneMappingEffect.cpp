@@ -0,0 +1,33 @@
+#include "Graphics/PostProcessing/ToneMappingEffect.h"
+#include "Utils/ImGuiHelper.h"
+
+ToneMappingEffect::ToneMappingEffect() :
+	PostProcessingEffect("Tone Mapping"),
+	Operator(ToneMapOperator::Aces),
+	Exposure(1.0f)
+{
+	_shader = _LoadShader("shaders/fragment_shaders/post/tone_mapping.glsl");
+}
+
+ToneMappingEffect::~ToneMappingEffect() = default;
+
+void ToneMappingEffect::Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) {
+	int op = *Operator;
+	_shader->Bind();
+	_shader->SetUniform(0, &op);
+	_shader->SetUniform(1, &Exposure);
+	input->BindAttachment(RenderTargetAttachment::Color0, INPUT_TEXTURE_SLOT);
+	_DrawFullscreen();
+}
+
+void ToneMappingEffect::RenderImGui() {
+	if (ImGui::BeginCombo("Operator", (~Operator).c_str())) {
+		for (ToneMapOperator op : { ToneMapOperator::Reinhard, ToneMapOperator::Aces, ToneMapOperator::Clamp }) {
+			if (ImGui::Selectable((~op).c_str(), op == Operator)) {
+				Operator = op;
+			}
+		}
+		ImGui::EndCombo();
+	}
+	LABEL_LEFT(ImGui::DragFloat, "Exposure", &Exposure, 0.01f, 0.0f, 16.0f);
+}
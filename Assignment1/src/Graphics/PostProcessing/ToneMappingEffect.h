@@ -0,0 +1,45 @@
+#pragma once
+#include <EnumToString.h>
+#include "Graphics/PostProcessing/PostProcessingEffect.h"
+
+/// <summary>
+/// The curves that ToneMappingEffect can map HDR colors with, values must match tone_mapping.glsl
+/// </summary>
+ENUM(ToneMapOperator, int,
+	Reinhard = 0,
+	// Narkowicz's fit of the ACES filmic curve
+	Aces     = 1,
+	// Only applies exposure, and clamps the result
+	Clamp    = 2
+);
+
+/// <summary>
+/// Maps the scene's HDR colors down to displayable LDR colors
+/// </summary>
+class ToneMappingEffect : public PostProcessingEffect {
+public:
+	MAKE_PTRS(ToneMappingEffect);
+
+	static inline Sptr Create() {
+		return std::make_shared<ToneMappingEffect>();
+	}
+
+	/// <summary>
+	/// The curve used to map colors into the [0, 1] range
+	/// </summary>
+	ToneMapOperator Operator;
+	/// <summary>
+	/// Multiplier applied to colors before they are mapped
+	/// </summary>
+	float Exposure;
+
+	ToneMappingEffect();
+	virtual ~ToneMappingEffect();
+
+	// Inherited from PostProcessingEffect
+
+	// Everything after tone mapping is in LDR, so we can drop down to 8 bit targets
+	virtual RenderTargetType GetOutputFormat(RenderTargetType inputFormat) const override { return RenderTargetType::ColorRgba8; }
+	virtual void Apply(const Framebuffer::Sptr& input, const Framebuffer::Sptr& output, FramebufferPool& pool) override;
+	virtual void RenderImGui() override;
+};
@@ -32,4 +32,23 @@ RenderTargetType Renderbuffer::GetFormat() const {
 
 GlResourceType Renderbuffer::GetResourceClass() const {
 	return GlResourceType::RenderBuffer;
+}
+
+size_t Renderbuffer::GetMemoryEstimate() const {
+	if (_rendererId == 0) {
+		return 0;
+	}
+	// Ask the driver for the actual bit depths, since the format enum doesn't tell us what was picked
+	const GLenum sizeParams[] = {
+		GL_RENDERBUFFER_RED_SIZE, GL_RENDERBUFFER_GREEN_SIZE, GL_RENDERBUFFER_BLUE_SIZE,
+		GL_RENDERBUFFER_ALPHA_SIZE, GL_RENDERBUFFER_DEPTH_SIZE, GL_RENDERBUFFER_STENCIL_SIZE
+	};
+	GLint bits = 0;
+	for (GLenum param : sizeParams) {
+		GLint value = 0;
+		glGetNamedRenderbufferParameteriv(_rendererId, param, &value);
+		bits += value;
+	}
+	size_t samples = _description.MultisampleCount > 1 ? _description.MultisampleCount : 1;
+	return (static_cast<size_t>(_description.Width) * _description.Height * bits / 8) * samples;
 }
\ No newline at end of file
@@ -45,6 +45,7 @@ public:
 	// Inherited from IGraphicsResource
 
 	virtual GlResourceType GetResourceClass() const override;
+	virtual size_t GetMemoryEstimate() const override;
 
 protected:
 	RenderbufferDescription _description;
@@ -0,0 +1,141 @@
+#include "Graphics/ShaderPreprocessor.h"
+#include <algorithm>
+#include <Logging.h>
+
+#include "Utils/FileHelpers.h"
+#include "Utils/StringUtils.h"
+
+std::string ShaderPreprocessor::ResolveIncludes(const std::string& path) {
+	std::string result;
+	std::vector<std::string> included;
+	included.push_back(std::filesystem::path(path).lexically_normal().string());
+	__Resolve(included.back(), result, included);
+	return result;
+}
+
+std::string ShaderPreprocessor::InjectDefines(const std::string& source, const ShaderDefines& defines) {
+	if (defines.empty()) {
+		return source;
+	}
+
+	std::string block;
+	for (auto& [name, value] : defines) {
+		block += "#define " + name;
+		if (!value.empty()) {
+			block += " " + value;
+		}
+		block += "\n";
+	}
+
+	// The #version directive must stay the first line, so defines go right after it
+	size_t version = source.find("#version");
+	if (version == std::string::npos) {
+		return block + source;
+	}
+	size_t eol = source.find('\n', version);
+	if (eol == std::string::npos) {
+		return source + "\n" + block;
+	}
+	std::string result = source;
+	result.insert(eol + 1, block);
+	return result;
+}
+
+std::string ShaderPreprocessor::MakeKey(const ShaderDefines& defines) {
+	std::string result;
+	for (auto& [name, value] : defines) {
+		if (!result.empty()) {
+			result += ";";
+		}
+		result += name;
+		if (!value.empty()) {
+			result += "=" + value;
+		}
+	}
+	return result;
+}
+
+void ShaderPreprocessor::ClearCache() {
+	__cache.clear();
+}
+
+const ShaderPreprocessor::CachedFile* ShaderPreprocessor::__GetFile(const std::string& path) {
+	std::error_code error;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	if (error) {
+		LOG_ERROR("Could not open shader file \"{}\"", path);
+		return nullptr;
+	}
+
+	// If we have it and it hasn't changed on disk, we can skip reading and parsing it
+	auto it = __cache.find(path);
+	if (it != __cache.end() && it->second.WriteTime == writeTime) {
+		__stats.Hits++;
+		return &it->second;
+	}
+	__stats.Misses++;
+
+	CachedFile& file = __cache[path];
+	file.Contents = FileHelpers::ReadFile(path);
+	file.WriteTime = writeTime;
+	file.Includes.clear();
+
+	// Determine where the file resides on the filesystem, includes are relative to it
+	const std::filesystem::path folder = std::filesystem::path(path).parent_path();
+
+	// The token we're looking for, and it's length
+	const char* includeToken = "#include";
+	const size_t includeTokenLen = const_strlen(includeToken);
+
+	size_t seek = file.Contents.find(includeToken, 0);
+	while (seek != std::string::npos) {
+		// Find the end of the line
+		size_t eol = file.Contents.find_first_of("\r\n", seek);
+		if (eol == std::string::npos) {
+			eol = file.Contents.size();
+		}
+
+		// Calculate the area from end of token to end of line, snip out as the path
+		size_t begin = std::min(seek + includeTokenLen + 1, eol);
+		std::string target = file.Contents.substr(begin, eol - begin);
+
+		// Trim whitespace and any quotes
+		StringTools::Trim(target);
+		StringTools::Trim(target, '"');
+
+		IncludeDirective directive;
+		directive.Start = seek;
+		directive.End = eol;
+		// If it starts with '/', relative to application directory, otherwise relative to this file
+		if (!target.empty() && target[0] == '/') {
+			directive.Target = std::filesystem::path(target).lexically_normal().string();
+		} else {
+			directive.Target = (folder / target).lexically_normal().string();
+		}
+		file.Includes.push_back(directive);
+
+		seek = file.Contents.find(includeToken, eol);
+	}
+
+	return &file;
+}
+
+void ShaderPreprocessor::__Resolve(const std::string& path, std::string& output, std::vector<std::string>& included) {
+	const CachedFile* file = __GetFile(path);
+	if (file == nullptr) {
+		return;
+	}
+
+	// Copy the text between includes, splicing in any files we haven't seen yet
+	size_t cursor = 0;
+	for (const IncludeDirective& directive : file->Includes) {
+		output.append(file->Contents, cursor, directive.Start - cursor);
+		cursor = directive.End;
+
+		if (std::find(included.begin(), included.end(), directive.Target) == included.end()) {
+			included.push_back(directive.Target);
+			__Resolve(directive.Target, output, included);
+		}
+	}
+	output.append(file->Contents, cursor, std::string::npos);
+}
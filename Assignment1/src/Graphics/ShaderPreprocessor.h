@@ -0,0 +1,80 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <filesystem>
+
+/// <summary>
+/// A set of preprocessor definitions used to select a shader variant. This is an ordered
+/// map so that the same set of defines always produces the same variant key
+/// </summary>
+typedef std::map<std::string, std::string> ShaderDefines;
+
+/// <summary>
+/// Handles resolving #include directives and injecting #define blocks into GLSL source.
+/// Parsed files are cached, so fragments shared between many shaders (ex: frame_uniforms.glsl)
+/// are only read from disk once, and are re-read only if they change on disk
+/// </summary>
+class ShaderPreprocessor {
+public:
+	ShaderPreprocessor() = delete;
+
+	struct CacheStats {
+		uint32_t Hits;
+		uint32_t Misses;
+	};
+
+	/// <summary>
+	/// Reads a file and recursively resolves any #include directives within it. Each
+	/// file is only included once per call, regardless of how many files include it
+	/// </summary>
+	/// <param name="path">The path to the file to load, relative to the working directory</param>
+	/// <returns>The source with all includes resolved</returns>
+	static std::string ResolveIncludes(const std::string& path);
+
+	/// <summary>
+	/// Inserts a #define line for each define directly after the #version directive
+	/// (or at the start of the source if it has none)
+	/// </summary>
+	/// <param name="source">The GLSL source to inject into</param>
+	/// <param name="defines">The defines to inject, empty values produce a bare #define</param>
+	/// <returns>The source with the defines injected</returns>
+	static std::string InjectDefines(const std::string& source, const ShaderDefines& defines);
+
+	/// <summary>
+	/// Creates a compact, stable key for a set of defines, ex: "NORMAL_MAP;SAMPLES=4"
+	/// </summary>
+	static std::string MakeKey(const ShaderDefines& defines);
+
+	/// <summary>
+	/// Drops all cached files, forcing them to be re-read on next use
+	/// </summary>
+	static void ClearCache();
+
+	static const CacheStats& GetCacheStats() { return __stats; }
+
+private:
+	// The location of an #include within a file, and the normalized path it refers to
+	struct IncludeDirective {
+		size_t      Start;
+		size_t      End;
+		std::string Target;
+	};
+
+	struct CachedFile {
+		std::string                     Contents;
+		std::vector<IncludeDirective>   Includes;
+		std::filesystem::file_time_type WriteTime;
+	};
+
+	inline static std::unordered_map<std::string, CachedFile> __cache;
+	inline static CacheStats __stats = { 0, 0 };
+
+	/// <summary>
+	/// Gets the parsed file at the given path, loading it if it is not cached or has changed
+	/// </summary>
+	/// <returns>The cached file, or nullptr if the file could not be read</returns>
+	static const CachedFile* __GetFile(const std::string& path);
+	static void __Resolve(const std::string& path, std::string& output, std::vector<std::string>& included);
+};
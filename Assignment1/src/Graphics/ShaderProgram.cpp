@@ -3,29 +3,82 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
-#include "Utils/FileHelpers.h"
 #include "Utils/JsonGlmHelpers.h"
 
+namespace {
+	// FNV-1a is used over std::hash since the keys must be stable between runs and builds
+	constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+	constexpr uint64_t FNV_PRIME        = 0x100000001b3ull;
+
+	uint64_t HashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t ix = 0; ix < size; ix++) {
+			hash ^= bytes[ix];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	// Hashes the string including its terminator, so that "ab"+"c" and "a"+"bc" differ
+	uint64_t HashString(const char* value, uint64_t hash) {
+		return HashBytes(value, value != nullptr ? strlen(value) + 1 : 0, hash);
+	}
+
+	// Header written in front of every cached program binary
+	struct BinaryCacheHeader {
+		uint32_t Magic;
+		uint32_t Version;
+		uint64_t Key;
+		uint32_t Format;
+		uint32_t Length;
+	};
+	constexpr uint32_t BINARY_CACHE_MAGIC   = 0x42505347; // 'GSPB'
+	constexpr uint32_t BINARY_CACHE_VERSION = 1;
+}
+
 ShaderProgram::ShaderProgram() : 
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_varyingsInterleaved(true),
+	_linkState(ShaderLinkState::Unlinked),
+	_pendingKey(0),
+	_defines(__globalDefines),
+	_variantKey(ShaderPreprocessor::MakeKey(__globalDefines))
 {
 	_rendererId = glCreateProgram();
 }
 
 ShaderProgram::ShaderProgram(const std::unordered_map<ShaderPartType, std::string>& filePaths) :
 	IGraphicsResource(),
-	IResource()
+	IResource(),
+	_varyingsInterleaved(true),
+	_linkState(ShaderLinkState::Unlinked),
+	_pendingKey(0),
+	_defines(__globalDefines),
+	_variantKey(ShaderPreprocessor::MakeKey(__globalDefines))
 {
 	_rendererId = glCreateProgram();
 	for (auto& [type, path] : filePaths) {
 		LoadShaderPartFromFile(path.c_str(), type);
 	}
-	Link();
+	_LinkOrDefer();
 }
 
 ShaderProgram::~ShaderProgram() {
+	// Make sure a pending link doesn't leak its shader parts or get polled after we're gone
+	if (_linkState == ShaderLinkState::Pending) {
+		for (const CompiledPart& part : _pendingHandles) {
+			glDeleteShader(part.Handle);
+		}
+		__pendingPrograms.erase(std::remove(__pendingPrograms.begin(), __pendingPrograms.end(), this), __pendingPrograms.end());
+	}
+	for (auto& [type, part] : _compiledParts) {
+		glDeleteShader(part.Handle);
+	}
 	if (_rendererId != 0) {
 		glDeleteProgram(_rendererId);
 		_rendererId = 0;
@@ -33,13 +86,58 @@ ShaderProgram::~ShaderProgram() {
 }
 
 bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
+	if (source == nullptr || source[0] == '\0') {
+		LOG_WARN("Cannot load empty source into shader part {}", ~type);
+		return false;
+	}
+
+	// If we're overwriting, warn before we replace the source
+	if (_resolvedSources.find(type) != _resolvedSources.end()) {
+		LOG_WARN("Another shader has been attached to this slot, overwriting");
+	}
+
+	// We hold on to the source until link time, compilation is skipped if we hit the binary cache
+	_resolvedSources[type] = ShaderPreprocessor::InjectDefines(source, _defines);
+
+	// Store info about where we got this data from
+	_fileSourceMap[type].IsFilePath = false;
+	_fileSourceMap[type].Source = source;
+
+	// Without a usable binary cache there's nothing to gain by waiting, so the part is compiled now
+	if (!__binaryCacheEnabled || __GetDriverHash() == 0) {
+		return _CompilePart(type);
+	}
+
+	// Otherwise the part stays queued until link, and a cache hit will skip compiling it
+	return true;
+}
+
+bool ShaderProgram::_CompilePart(ShaderPartType type) {
+	// Replace any part we compiled for this slot earlier
+	auto it = _compiledParts.find(type);
+	if (it != _compiledParts.end()) {
+		glDeleteShader(it->second.Handle);
+		_compiledParts.erase(it);
+	}
+
 	// Creates a new shader part (VS, FS, GS, etc...)
 	GLuint handle = glCreateShader((GLenum)type);
-
-	// Load the GLSL source and compile it
-	glShaderSource(handle, 1, &source, nullptr);
+	const char* sourcePtr = _resolvedSources[type].c_str();
+	glShaderSource(handle, 1, &sourcePtr, nullptr);
 	glCompileShader(handle);
 
+	// With parallel compilation the driver is still working on it, querying the status now would make us
+	// wait, so the part is reported as queued and checked when the link finishes
+	if (IsParallelCompileSupported()) {
+		_compiledParts[type] = { handle, false };
+		return true;
+	}
+
+	_compiledParts[type] = { handle, true };
+	return _ReportCompileStatus(handle, type);
+}
+
+bool ShaderProgram::_ReportCompileStatus(GLuint handle, ShaderPartType type) {
 	// Get the compilation status for the shader part
 	GLint status = 0;
 	glGetShaderiv(handle, GL_COMPILE_STATUS, &status);
@@ -57,27 +155,13 @@ bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
 
 		// Dump error log
 		LOG_ERROR("Failed to compile shader part:\n{}", log);
+		if (_fileSourceMap[type].IsFilePath) {
+			LOG_ERROR("Source File: {}", _fileSourceMap[type].Source);
+		}
 
 		// Clean up our log memory
 		delete[] log;
-
-		// Delete the broken shader result
-		glDeleteShader(handle);
-		handle = 0;
-
-		return false;
-	}
-
-	// If we're overwriting, warn and clean up the old program before we store
-	if (_handles[type] != 0) {
-		LOG_WARN("Another shader has been attached to this slot, overwriting");
-		glDeleteShader(_handles[type]);
 	}
-	_handles[type] = handle;
-
-	// Store info about where we got this data from
-	_fileSourceMap[type].IsFilePath = false;
-	_fileSourceMap[type].Source = source;
 
 	return status != GL_FALSE;
 }
@@ -85,9 +169,9 @@ bool ShaderProgram::LoadShaderPart(const char* source, ShaderPartType type) {
 bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type) {
 	// Make sure that the file exists before we try reading
 	if (std::filesystem::exists(path)) {
-		// Load the source from the file, using our helper that will
-		// resolve #include directives
-		std::string source = FileHelpers::ReadResolveIncludes(path);
+		// Load the source from the file, using the preprocessor to resolve #include directives
+		// from it's cache of parsed files
+		std::string source = ShaderPreprocessor::ResolveIncludes(path);
 		// Pass off to LoadShaderPart
 		bool result =  LoadShaderPart(source.c_str(), type);
 		_fileSourceMap[type].IsFilePath = true;
@@ -103,29 +187,207 @@ bool ShaderProgram::LoadShaderPartFromFile(const char* path, ShaderPartType type
 }
 
 bool ShaderProgram::Link() {
+	LinkAsync();
+	WaitUntilReady();
+	return _linkState == ShaderLinkState::Linked;
+}
+
+bool ShaderProgram::LinkAsync() {
+	if (_linkState == ShaderLinkState::Pending) {
+		LOG_WARN("Shader \"{}\" is already linking, ignoring", _debugName);
+		return true;
+	}
+	if (_resolvedSources.empty()) {
+		LOG_WARN("Shader \"{}\" has no shader parts to link", _debugName);
+		return false;
+	}
 
 	LOG_TRACE("Starting shader link:");
-	
-	// Attach all our shaders
-	for (auto& [type, id] : _handles) {
-		if (id != 0) {
-			glAttachShader(_rendererId, id);
-			LOG_TRACE("\t{} - {}", ~type, _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Note that the driver hash query may disable the cache if the driver has no binary formats
+	_pendingKey = 0;
+	bool loaded = false;
+	if (__binaryCacheEnabled && __GetDriverHash() != 0) {
+		_pendingKey = _ComputeBinaryKey();
+		loaded = _TryLoadBinary(_pendingKey);
+	}
+
+	if (loaded) {
+		// Cached binaries are already linked, so there's nothing to wait on
+		__binaryCacheStats.Hits++;
+		LOG_TRACE("\tLoaded from binary cache ({:016x})", _pendingKey);
+		_resolvedSources.clear();
+		for (auto& [type, part] : _compiledParts) {
+			glDeleteShader(part.Handle);
+		}
+		_compiledParts.clear();
+		_linkState = ShaderLinkState::Linked;
+		_Introspect();
+	} else {
+		__binaryCacheStats.Misses++;
+		_SubmitCompile();
+		_linkState = ShaderLinkState::Pending;
+		__pendingPrograms.push_back(this);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	__binaryCacheStats.LinkTimeMs += std::chrono::duration<float, std::milli>(end - start).count();
+
+	return true;
+}
+
+bool ShaderProgram::IsReady() {
+	if (_linkState != ShaderLinkState::Pending) {
+		return true;
+	}
+
+	#ifdef GL_KHR_parallel_shader_compile
+	// Without the extension the completion status does not exist, so we fall through and block
+	if (IsParallelCompileSupported()) {
+		GLint complete = GL_FALSE;
+		glGetProgramiv(_rendererId, GL_COMPLETION_STATUS_KHR, &complete);
+		if (complete == GL_FALSE) {
+			return false;
 		}
 	}
+	#endif
+
+	_FinishLink();
+	return true;
+}
+
+void ShaderProgram::WaitUntilReady() {
+	if (_linkState == ShaderLinkState::Pending) {
+		_FinishLink();
+	}
+}
+
+ShaderProgram::Sptr ShaderProgram::GetVariant(const ShaderDefines& defines) {
+	// Variants are always owned by the program that was loaded
+	if (Sptr base = _base.lock()) {
+		return base->GetVariant(defines);
+	}
+
+	ShaderDefines merged = __globalDefines;
+	for (auto& [name, value] : defines) {
+		merged[name] = value;
+	}
+	std::string key = ShaderPreprocessor::MakeKey(merged);
+	if (key == _variantKey) {
+		return shared_from_this();
+	}
+
+	auto it = _variants.find(key);
+	if (it != _variants.end()) {
+		return it->second;
+	}
+
+	Sptr variant = std::make_shared<ShaderProgram>();
+	variant->_defines = merged;
+	variant->_variantKey = key;
+	variant->_base = weak_from_this();
+	variant->SetDebugName(_debugName + " [" + key + "]");
+
+	if (!_varyings.empty()) {
+		std::vector<const char*> names;
+		for (const std::string& varying : _varyings) {
+			names.push_back(varying.c_str());
+		}
+		variant->RegisterVaryings(names.data(), (int)names.size(), _varyingsInterleaved);
+	}
+	for (auto& [type, source] : _fileSourceMap) {
+		if (source.IsFilePath) {
+			variant->LoadShaderPartFromFile(source.Source.c_str(), type);
+		} else {
+			variant->LoadShaderPart(source.Source.c_str(), type);
+		}
+	}
+
+	// Variants get requested while rendering, so we never block on them here
+	variant->LinkAsync();
+	_variants[key] = variant;
+	return variant;
+}
+
+void ShaderProgram::SetGlobalDefine(const std::string& name, const std::string& value) {
+	auto it = __globalDefines.find(name);
+	if (it == __globalDefines.end() || it->second != value) {
+		__globalDefines[name] = value;
+		__globalDefinesVersion++;
+	}
+}
+
+void ShaderProgram::RemoveGlobalDefine(const std::string& name) {
+	if (__globalDefines.erase(name) > 0) {
+		__globalDefinesVersion++;
+	}
+}
+
+void ShaderProgram::_LinkOrDefer() {
+	if (__compileBatchDepth > 0) {
+		LinkAsync();
+	} else {
+		Link();
+	}
+}
+
+void ShaderProgram::_SubmitCompile() {
+	_pendingHandles.clear();
+	_pendingHandles.reserve(_resolvedSources.size());
+
+	for (auto& [type, source] : _resolvedSources) {
+		// Parts compiled by LoadShaderPart are used as they are
+		CompiledPart part = { 0, false };
+		auto it = _compiledParts.find(type);
+		if (it != _compiledParts.end()) {
+			part = it->second;
+		} else {
+			// Creates a new shader part (VS, FS, GS, etc...)
+			part.Handle = glCreateShader((GLenum)type);
+
+			// Load the GLSL source and compile it, we don't check the status until the link is finished
+			// since that would force the driver to wait for the compile
+			const char* sourcePtr = source.c_str();
+			glShaderSource(part.Handle, 1, &sourcePtr, nullptr);
+			glCompileShader(part.Handle);
+		}
+
+		glAttachShader(_rendererId, part.Handle);
+		_pendingHandles.push_back(part);
+		LOG_TRACE("\t{} - {}", ~type, _fileSourceMap[type].IsFilePath ? _fileSourceMap[type].Source : "<from source>");
+	}
+
+	_compiledParts.clear();
+
+	// Let the driver know we intend to read the binary back out for the cache
+	if (__binaryCacheEnabled) {
+		glProgramParameteri(_rendererId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
 	// Perform linking
 	glLinkProgram(_rendererId);
+}
 
-	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
-	for (auto& [type, id] : _handles) { 
-		if (id != 0) {
-			glDetachShader(_rendererId, id);
-			glDeleteShader(id);
+void ShaderProgram::_FinishLink() {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Report any parts that failed to compile, _pendingHandles is in the same order as _resolvedSources. Parts
+	// that LoadShaderPart already checked have had their errors reported
+	size_t ix = 0;
+	for (auto& [type, source] : _resolvedSources) {
+		const CompiledPart& part = _pendingHandles[ix++];
+		if (!part.Checked) {
+			_ReportCompileStatus(part.Handle, type);
 		}
 	}
-	// Remove all the handles so we don't accidentally use them
-	_handles.clear();
+
+	// Remove shader parts to save space (we can do this since we only needed the shader parts to compile an actual shader program)
+	for (const CompiledPart& part : _pendingHandles) {
+		glDetachShader(_rendererId, part.Handle);
+		glDeleteShader(part.Handle);
+	}
+	_pendingHandles.clear();
 
 	GLint status = 0;
 	glGetProgramiv(_rendererId, GL_LINK_STATUS, &status);
@@ -146,14 +408,228 @@ bool ShaderProgram::Link() {
 		} else {
 			LOG_ERROR("Shader failed to link for an unknown reason!");
 		}
+		_linkState = ShaderLinkState::Failed;
 	} else {
+		// Store the freshly linked program so the next launch can skip compilation
+		if (__binaryCacheEnabled && _pendingKey != 0) {
+			_SaveBinary(_pendingKey);
+		}
+		_linkState = ShaderLinkState::Linked;
 		LOG_TRACE("Linking complete, starting introspection");
 	}
 
+	// We no longer need the sources, the program holds everything now
+	_resolvedSources.clear();
+	__pendingPrograms.erase(std::remove(__pendingPrograms.begin(), __pendingPrograms.end(), this), __pendingPrograms.end());
+
 	// Perform our uniform introspection to see what uniforms are in the shader
 	_Introspect();
 
-	return status != GL_FALSE;
+	auto end = std::chrono::high_resolution_clock::now();
+	__binaryCacheStats.LinkTimeMs += std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+uint64_t ShaderProgram::_ComputeBinaryKey() const {
+	uint64_t hash = __GetDriverHash();
+
+	// Iteration order of the unordered map is not stable, so sort the stage set first
+	std::vector<ShaderPartType> stages;
+	stages.reserve(_resolvedSources.size());
+	for (auto& [type, source] : _resolvedSources) {
+		stages.push_back(type);
+	}
+	std::sort(stages.begin(), stages.end());
+
+	for (ShaderPartType type : stages) {
+		const std::string& source = _resolvedSources.at(type);
+		GLenum stage = (GLenum)type;
+		hash = HashBytes(&stage, sizeof(GLenum), hash);
+		hash = HashString(source.c_str(), hash);
+	}
+
+	// Transform feedback varyings are baked into the linked program, so they are part of the key
+	uint32_t numVaryings = static_cast<uint32_t>(_varyings.size());
+	hash = HashBytes(&numVaryings, sizeof(uint32_t), hash);
+	for (const std::string& varying : _varyings) {
+		hash = HashString(varying.c_str(), hash);
+	}
+	hash = HashBytes(&_varyingsInterleaved, sizeof(bool), hash);
+
+	return hash;
+}
+
+bool ShaderProgram::_TryLoadBinary(uint64_t key) {
+	std::string path = __GetBinaryPath(key);
+	if (!std::filesystem::exists(path)) {
+		return false;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	BinaryCacheHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(BinaryCacheHeader));
+	if (!file || header.Magic != BINARY_CACHE_MAGIC || header.Version != BINARY_CACHE_VERSION || header.Key != key || header.Length == 0) {
+		LOG_WARN("Discarding malformed program binary \"{}\"", path);
+		file.close();
+		std::filesystem::remove(path);
+		__binaryCacheStats.Rejected++;
+		return false;
+	}
+
+	std::vector<char> binary(header.Length);
+	file.read(binary.data(), header.Length);
+	if (!file) {
+		LOG_WARN("Discarding truncated program binary \"{}\"", path);
+		file.close();
+		std::filesystem::remove(path);
+		__binaryCacheStats.Rejected++;
+		return false;
+	}
+	file.close();
+
+	glProgramBinary(_rendererId, header.Format, binary.data(), static_cast<GLsizei>(header.Length));
+
+	// The driver is free to reject binaries (ex: after an update), in which case we recompile
+	GLint status = GL_FALSE;
+	glGetProgramiv(_rendererId, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE) {
+		LOG_INFO("Driver rejected cached program binary \"{}\", recompiling", path);
+		std::filesystem::remove(path);
+		__binaryCacheStats.Rejected++;
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderProgram::_SaveBinary(uint64_t key) {
+	GLint length = 0;
+	glGetProgramiv(_rendererId, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(_rendererId, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(__binaryCacheDirectory, error);
+
+	std::string path = __GetBinaryPath(key);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		LOG_WARN("Failed to open \"{}\" for writing program binary", path);
+		return;
+	}
+
+	BinaryCacheHeader header;
+	header.Magic   = BINARY_CACHE_MAGIC;
+	header.Version = BINARY_CACHE_VERSION;
+	header.Key     = key;
+	header.Format  = format;
+	header.Length  = static_cast<uint32_t>(length);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(BinaryCacheHeader));
+	file.write(binary.data(), length);
+	__binaryCacheStats.Saved++;
+}
+
+uint64_t ShaderProgram::__GetDriverHash() {
+	if (__driverHash == 0) {
+		// Without any binary formats glProgramBinary can never succeed, so don't bother
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		if (numFormats == 0) {
+			LOG_INFO("Driver does not support any program binary formats, disabling shader cache");
+			__binaryCacheEnabled = false;
+			return 0;
+		}
+
+		uint64_t hash = FNV_OFFSET_BASIS;
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+		hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+		__driverHash = hash;
+	}
+	return __driverHash;
+}
+
+std::string ShaderProgram::__GetBinaryPath(uint64_t key) {
+	char name[24];
+	snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path(__binaryCacheDirectory) / name).string();
+}
+
+void ShaderProgram::SetBinaryCacheEnabled(bool enabled) {
+	__binaryCacheEnabled = enabled;
+}
+
+bool ShaderProgram::GetBinaryCacheEnabled() {
+	return __binaryCacheEnabled;
+}
+
+void ShaderProgram::SetBinaryCacheDirectory(const std::string& directory) {
+	__binaryCacheDirectory = directory;
+}
+
+const std::string& ShaderProgram::GetBinaryCacheDirectory() {
+	return __binaryCacheDirectory;
+}
+
+void ShaderProgram::ClearBinaryCache() {
+	std::error_code error;
+	if (!std::filesystem::is_directory(__binaryCacheDirectory, error)) {
+		return;
+	}
+	for (auto& entry : std::filesystem::directory_iterator(__binaryCacheDirectory, error)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".bin") {
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+}
+
+void ShaderProgram::ResetBinaryCacheStats() {
+	__binaryCacheStats = { 0, 0, 0, 0, 0.0f };
+}
+
+void ShaderProgram::BeginCompileBatch() {
+	__compileBatchDepth++;
+}
+
+void ShaderProgram::EndCompileBatch() {
+	LOG_ASSERT(__compileBatchDepth > 0, "EndCompileBatch called without a matching BeginCompileBatch");
+	__compileBatchDepth--;
+}
+
+size_t ShaderProgram::PollPendingPrograms() {
+	// IsReady removes finished programs from the list, so we iterate over a copy
+	std::vector<ShaderProgram*> pending = __pendingPrograms;
+	for (ShaderProgram* program : pending) {
+		program->IsReady();
+	}
+	return __pendingPrograms.size();
+}
+
+bool ShaderProgram::IsParallelCompileSupported() {
+	#ifdef GL_KHR_parallel_shader_compile
+	return GLAD_GL_KHR_parallel_shader_compile != 0;
+	#else
+	return false;
+	#endif
+}
+
+void ShaderProgram::SetMaxCompilerThreads(uint32_t count) {
+	#ifdef GL_KHR_parallel_shader_compile
+	if (IsParallelCompileSupported()) {
+		glMaxShaderCompilerThreadsKHR(count);
+		LOG_INFO("Parallel shader compilation enabled");
+		return;
+	}
+	#endif
+	LOG_INFO("GL_KHR_parallel_shader_compile not supported, shaders will compile on the main thread");
 }
 
 void ShaderProgram::Bind() {
@@ -201,19 +677,19 @@ void ShaderProgram::SetUniform(int location, const glm::ivec4* value, int count)
 
 void ShaderProgram::SetUniform(int location, const bool* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform1i(location, *value, 1);
+	glProgramUniform1i(_rendererId, location, *value);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec2* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform2i(location, value->x, value->y, 1);
+	glProgramUniform2i(_rendererId, location, value->x, value->y);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec3* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform3i(location, value->x, value->y, value->z, 1);
+	glProgramUniform3i(_rendererId, location, value->x, value->y, value->z);
 }
 void ShaderProgram::SetUniform(int location, const glm::bvec4* value, int count) {
 	LOG_ASSERT(count == 1, "SetUniform for bools only supports setting single values at a time!");
-	glProgramUniform4i(location, value->x, value->y, value->z, value->w, 1);
+	glProgramUniform4i(_rendererId, location, value->x, value->y, value->z, value->w);
 }
 
 void ShaderProgram::SetUniform(int location, ShaderDataType type, void* data, int count /*= 1*/, bool transposed  /* =false*/) {
@@ -313,6 +789,19 @@ int ShaderProgram::__GetUniformLocation(const std::string& name) {
 	return _uniforms[name].Location;
 }
 
+std::string ShaderProgram::GetStagePath(ShaderPartType type) const {
+	auto it = _fileSourceMap.find(type);
+	return it != _fileSourceMap.end() && it->second.IsFilePath ? it->second.Source : std::string();
+}
+
+std::string ShaderProgram::GetStageSource(ShaderPartType type) const {
+	auto it = _fileSourceMap.find(type);
+	if (it == _fileSourceMap.end()) {
+		return std::string();
+	}
+	return it->second.IsFilePath ? ShaderPreprocessor::ResolveIncludes(it->second.Source) : it->second.Source;
+}
+
 nlohmann::json ShaderProgram::ToJson() const {
 	nlohmann::json result;
 	result["name"] = _debugName;
@@ -342,7 +831,7 @@ ShaderProgram::Sptr ShaderProgram::FromJson(const nlohmann::json& data) {
 			// Otherwise do nothing
 		}
 	}
-	result->Link();
+	result->_LinkOrDefer();
 	return result;
 }
 
@@ -460,17 +949,21 @@ void ShaderProgram::_IntrospectUnifromBlocks() {
 				GL_NAME_LENGTH,
 				GL_TYPE,
 				GL_ARRAY_SIZE,
-				GL_OFFSET
+				GL_OFFSET,
+				GL_ARRAY_STRIDE,
+				GL_MATRIX_STRIDE
 			};
 			// Query data from the program
-			int props[4];
-			glGetProgramResourceiv(_rendererId, GL_UNIFORM, activeVars[v], 4, pNames, 4, NULL, props);
+			int props[6];
+			glGetProgramResourceiv(_rendererId, GL_UNIFORM, activeVars[v], 6, pNames, 6, NULL, props);
 
 			// Store properties into the UniformInfo
 			UniformInfo var = UniformInfo();
 			var.Type = FromGLShaderDataType(props[1]);
 			var.Location = props[3];
 			var.ArraySize = props[2];
+			var.ArrayStride = props[4];
+			var.MatrixStride = props[5];
 
 			// Get the uniform name
 			var.Name.resize(props[0] - 1);
@@ -501,6 +994,11 @@ void ShaderProgram::BindUniformBlockToSlot(const std::string& name, int uboSlot)
 	}
 }
 
+const ShaderProgram::UniformBlockInfo* ShaderProgram::FindUniformBlock(const std::string& name) const {
+	auto it = _uniformBlocks.find(name);
+	return it != _uniformBlocks.end() ? &it->second : nullptr;
+}
+
 bool ShaderProgram::FindUniform(const std::string& name, UniformInfo* out) {
 	for (auto& [key, uniform] : _uniforms) {
 		if (uniform.Name == name) {
@@ -520,4 +1018,7 @@ GlResourceType ShaderProgram::GetResourceClass() const {
 void ShaderProgram::RegisterVaryings(const char* const* names, int numVaryings, bool interleaved /*= true*/)
 {
 	glTransformFeedbackVaryings(_rendererId, numVaryings, names, interleaved ? GL_INTERLEAVED_ATTRIBS : GL_SEPARATE_ATTRIBS);
+
+	_varyings.assign(names, names + numVaryings);
+	_varyingsInterleaved = interleaved;
 }
@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>               // for std::string
 #include <unordered_map>        // for std::unordered_map
+#include <vector>
 #include <GLM/glm.hpp>          // for our GLM types
 #include <GLM/gtc/type_ptr.hpp> // for glm::value_ptr
 #include <Logging.h>            // for the logging functions
@@ -11,11 +12,23 @@
 #include "Utils/ResourceManager/IResource.h"
 #include "Graphics/GlEnums.h"
 #include "Graphics/IGraphicsResource.h"
+#include "Graphics/ShaderPreprocessor.h"
+
+/// <summary>
+/// The states a shader program moves through while linking, Pending programs have been
+/// submitted to the driver but may still be compiling in the background
+/// </summary>
+ENUM(ShaderLinkState, int,
+	Unlinked = 0,
+	Pending,
+	Linked,
+	Failed
+);
 
 /// <summary>
 /// This class will wrap around an OpenGL shader program
 /// </summary>
-class ShaderProgram final : public IGraphicsResource, public IResource
+class ShaderProgram final : public IGraphicsResource, public IResource, public std::enable_shared_from_this<ShaderProgram>
 {
 public:
 	DEFINE_RESOURCE(ShaderProgram);
@@ -31,6 +44,9 @@ public:
 		int            ArraySize;
 		int            Location;
 		int            Binding;
+		// For uniforms in blocks, the byte stride between array elements and matrix columns
+		int            ArrayStride;
+		int            MatrixStride;
 		std::string    Name;
 
 		UniformInfo() :
@@ -38,6 +54,8 @@ public:
 			ArraySize(0),
 			Location(-1),
 			Binding(-1),
+			ArrayStride(0),
+			MatrixStride(0),
 			Name("") {}
 	};
 
@@ -57,6 +75,18 @@ public:
 
 		std::vector<UniformInfo> SubUniforms;
 	};
+
+	/// <summary>
+	/// Running totals for the on-disk program binary cache, used to compare
+	/// cold and warm startup times
+	/// </summary>
+	struct BinaryCacheStats {
+		uint32_t Hits;
+		uint32_t Misses;
+		uint32_t Rejected;
+		uint32_t Saved;
+		float    LinkTimeMs;
+	};
 	
 public:
 	/// <summary>
@@ -71,10 +101,15 @@ public:
 
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader)
+	/// While the binary cache is in use, compilation is deferred until Link so that a cached program binary
+	/// can skip it entirely. Otherwise the stage is compiled right away
 	/// </summary>
 	/// <param name="source">The source code of the shader to load</param>
 	/// <param name="type">The stage to load (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)</param>
-	/// <returns>True if the shader is loaded, false if there was an issue</returns>
+	/// <returns>
+	/// False if the stage failed to compile. True if it compiled, or if it was queued to compile at link time
+	/// or in the background, in which case errors are reported when the link finishes
+	/// </returns>
 	bool LoadShaderPart(const char* source, ShaderPartType type);
 	/// <summary>
 	/// Loads a single shader stage into this shader object (ex: Vertex Shader or Fragment Shader) from an external file (in res)
@@ -94,9 +129,55 @@ public:
 
 	/// <summary>
 	/// Links the vertex and fragment shader, and allows this shader program to be used
+	/// If the binary cache is enabled and holds a matching program, it is loaded instead
+	/// of compiling the shader parts, otherwise the freshly linked program is saved to it
 	/// </summary>
 	/// <returns>True if the linking was successful, false if otherwise</returns>
 	bool Link();
+	/// <summary>
+	/// Submits the shader parts for compilation and linking without waiting for the result.
+	/// With GL_KHR_parallel_shader_compile the driver will compile on its own threads, use
+	/// IsReady to poll for completion
+	/// </summary>
+	/// <returns>True if the program was submitted (or loaded from the binary cache), false if there was nothing to link</returns>
+	bool LinkAsync();
+	/// <summary>
+	/// Polls a pending link without blocking when parallel compilation is supported, and
+	/// finishes the link (error logging, caching and introspection) once the driver is done.
+	/// Without parallel compilation support this will block until the link completes
+	/// </summary>
+	/// <returns>True if the program is no longer pending (note that it may have failed)</returns>
+	bool IsReady();
+	/// <summary>
+	/// Blocks until any pending link has completed
+	/// </summary>
+	void WaitUntilReady();
+
+	/// <summary>
+	/// Gets the variant of this program compiled with the given defines, on top of the global
+	/// defines. Variants are created and submitted with LinkAsync the first time they are
+	/// requested, so only the permutations that are actually used get compiled
+	/// </summary>
+	/// <param name="defines">The defines to compile the variant with</param>
+	/// <returns>The variant, which may still be pending, or this program if the defines match its own</returns>
+	ShaderProgram::Sptr GetVariant(const ShaderDefines& defines = ShaderDefines());
+	/// <summary>
+	/// Gets the defines this program was compiled with, including the global defines
+	/// at the time it was created
+	/// </summary>
+	const ShaderDefines& GetDefines() const { return _defines; }
+	/// <summary>
+	/// Gets the file a stage was loaded from, or an empty string if it was loaded from source or isn't set
+	/// </summary>
+	std::string GetStagePath(ShaderPartType type) const;
+	/// <summary>
+	/// Gets the source of a stage with it's includes resolved, or an empty string if the stage isn't set
+	/// </summary>
+	std::string GetStageSource(ShaderPartType type) const;
+
+	ShaderLinkState GetLinkState() const { return _linkState; }
+	bool IsPending() const { return _linkState == ShaderLinkState::Pending; }
+	bool IsLinked() const { return _linkState == ShaderLinkState::Linked; }
 
 	/// <summary>
 	/// Binds this shader for use
@@ -118,8 +199,74 @@ public:
 	virtual nlohmann::json ToJson() const override;
 	static ShaderProgram::Sptr FromJson(const nlohmann::json& data);
 
+	/// <summary>
+	/// Enables or disables the on-disk program binary cache (enabled by default)
+	/// </summary>
+	static void SetBinaryCacheEnabled(bool enabled);
+	static bool GetBinaryCacheEnabled();
+	/// <summary>
+	/// Sets the directory that program binaries are stored in, relative to the working directory
+	/// </summary>
+	static void SetBinaryCacheDirectory(const std::string& directory);
+	static const std::string& GetBinaryCacheDirectory();
+	/// <summary>
+	/// Removes all cached program binaries from the cache directory
+	/// </summary>
+	static void ClearBinaryCache();
+
+	static const BinaryCacheStats& GetBinaryCacheStats() { return __binaryCacheStats; }
+	static void ResetBinaryCacheStats();
+
+	/// <summary>
+	/// Starts a compile batch, shader programs created from files or JSON while a batch
+	/// is open will use LinkAsync instead of Link, so that the driver can compile them in parallel.
+	/// Batches can be nested
+	/// </summary>
+	static void BeginCompileBatch();
+	static void EndCompileBatch();
+	/// <summary>
+	/// Polls all pending programs, finishing those the driver has completed. Does not block
+	/// when parallel compilation is supported, should be called once per frame
+	/// </summary>
+	/// <returns>The number of programs that are still pending</returns>
+	static size_t PollPendingPrograms();
+	static size_t GetPendingProgramCount() { return __pendingPrograms.size(); }
+
+	/// <summary>
+	/// Returns true if the driver supports GL_KHR_parallel_shader_compile
+	/// </summary>
+	static bool IsParallelCompileSupported();
+
+	/// <summary>
+	/// Sets a define that is applied to every shader program and variant created after this
+	/// point. This is how renderer-wide features are compiled in or out, rather than branching
+	/// on a uniform at runtime. Materials will pick up the new variants on their next use
+	/// </summary>
+	/// <param name="name">The name of the define</param>
+	/// <param name="value">The value for the define, or empty for a bare #define</param>
+	static void SetGlobalDefine(const std::string& name, const std::string& value = "");
+	static void RemoveGlobalDefine(const std::string& name);
+	static const ShaderDefines& GetGlobalDefines() { return __globalDefines; }
+	/// <summary>
+	/// Gets a counter that is incremented whenever the global defines change, so that users
+	/// of GetVariant know when to re-query it
+	/// </summary>
+	static uint32_t GetGlobalDefinesVersion() { return __globalDefinesVersion; }
+	/// <summary>
+	/// Sets the number of background threads the driver may use for compiling shaders,
+	/// 0xFFFFFFFF lets the driver pick. Does nothing if parallel compilation is not supported
+	/// </summary>
+	static void SetMaxCompilerThreads(uint32_t count);
+
 public:
 	bool FindUniform(const std::string& name, UniformInfo* out);
+	/// <summary>
+	/// Gets the introspected info for the uniform block with the given name. Note that
+	/// for uniforms within the block, Location stores the byte offset into the block
+	/// </summary>
+	/// <param name="name">The name of the block to search for</param>
+	/// <returns>The block info, or nullptr if the block does not exist in this program</returns>
+	const UniformBlockInfo* FindUniformBlock(const std::string& name) const;
 
 	void SetUniformMatrix(int location, const glm::mat3* value, int count = 1, bool transposed = false);
 	void SetUniformMatrix(int location, const glm::mat4* value, int count = 1, bool transposed = false);
@@ -177,10 +324,6 @@ public:
 	void BindUniformBlockToSlot(const std::string& name, int uboSlot);
 
 protected:
-	// Stores all the handles to our shaders until we
-	// are ready to compile them into a program
-	std::unordered_map<ShaderPartType, int> _handles;
-	
 	// Map access to look up uniform locations and blocks
 	std::unordered_map<std::string, UniformInfo> _uniforms;
 	std::unordered_map<std::string, UniformBlockInfo> _uniformBlocks;
@@ -194,6 +337,84 @@ protected:
 	};
 	std::unordered_map<ShaderPartType, ShaderSource> _fileSourceMap;
 
+	// The fully resolved source for each stage, kept until link time
+	std::unordered_map<ShaderPartType, std::string> _resolvedSources;
+
+	// Transform feedback varyings, stored so they can be part of the cache key
+	std::vector<std::string> _varyings;
+	bool                     _varyingsInterleaved;
+
+	// A shader part that has been submitted to the driver, Checked is true once it's compile status has been
+	// read and any errors reported
+	struct CompiledPart {
+		GLuint Handle;
+		bool   Checked;
+	};
+	// Parts compiled by LoadShaderPart when the binary cache isn't in use, they are attached on link
+	std::unordered_map<ShaderPartType, CompiledPart> _compiledParts;
+
+	// The shader parts and cache key for a link that has been submitted but not finished
+	ShaderLinkState          _linkState;
+	std::vector<CompiledPart> _pendingHandles;
+	uint64_t                 _pendingKey;
+
+	// The defines this program was compiled with, and the variants created from it
+	ShaderDefines            _defines;
+	std::string              _variantKey;
+	std::unordered_map<std::string, Sptr> _variants;
+	std::weak_ptr<ShaderProgram> _base;
+
+	inline static ShaderDefines __globalDefines;
+	inline static uint32_t      __globalDefinesVersion = 0;
+
+	inline static std::vector<ShaderProgram*> __pendingPrograms;
+	inline static int                         __compileBatchDepth = 0;
+
+	inline static bool             __binaryCacheEnabled = true;
+	inline static std::string      __binaryCacheDirectory = "shader_cache/";
+	inline static BinaryCacheStats __binaryCacheStats = { 0, 0, 0, 0, 0.0f };
+	// Hash of the GL vendor, renderer and version strings, 0 until first queried
+	inline static uint64_t         __driverHash = 0;
+
+	/// <summary>
+	/// Computes the key used to look up this program in the binary cache, from the driver,
+	/// the stage set, the resolved sources and the transform feedback varyings
+	/// </summary>
+	uint64_t _ComputeBinaryKey() const;
+	/// <summary>
+	/// Attempts to load a program binary for the given key, returns true if the driver accepted it
+	/// </summary>
+	bool _TryLoadBinary(uint64_t key);
+	/// <summary>
+	/// Writes the linked program's binary to the cache under the given key
+	/// </summary>
+	void _SaveBinary(uint64_t key);
+	/// <summary>
+	/// Submits all resolved shader parts for compilation and starts the link, without
+	/// querying any status so that the driver is free to do the work in the background
+	/// </summary>
+	void _SubmitCompile();
+	/// <summary>
+	/// Compiles a resolved shader part ahead of link, returns the compile status, or true if the driver
+	/// is compiling it in the background
+	/// </summary>
+	bool _CompilePart(ShaderPartType type);
+	/// <summary>
+	/// Reads a shader part's compile status, logging the errors if it failed
+	/// </summary>
+	bool _ReportCompileStatus(GLuint handle, ShaderPartType type);
+	/// <summary>
+	/// Completes a submitted link, logging errors, saving to the binary cache and introspecting
+	/// </summary>
+	void _FinishLink();
+	/// <summary>
+	/// Links from the constructors and FromJson, deferring if a compile batch is open
+	/// </summary>
+	void _LinkOrDefer();
+
+	static uint64_t __GetDriverHash();
+	static std::string __GetBinaryPath(uint64_t key);
+
 	/// <summary>
 	/// Performs program introspection, where we examine the uniforms that
 	/// the program contains
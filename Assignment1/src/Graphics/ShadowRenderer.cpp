@@ -0,0 +1,345 @@
+#include "Graphics/ShadowRenderer.h"
+#include <GLM/gtc/matrix_transform.hpp>
+#include <GLM/gtc/constants.hpp>
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/Components/Camera.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Graphics/GeometryArena.h"
+
+// How far behind each cascade (towards the sun) we still pick up shadow casters
+static const float CASCADE_CASTER_DISTANCE = 100.0f;
+// How much of the split between cascades comes from a log distribution vs a linear one
+static const float CASCADE_SPLIT_LAMBDA = 0.8f;
+
+// Tests a world space sphere against the frustum of a view projection matrix, using the planes of the clip volume
+static bool SphereInView(const glm::mat4& viewProjection, const glm::vec4& sphere) {
+	if (sphere.w < 0.0f) {
+		return true;
+	}
+	glm::mat4 rows = glm::transpose(viewProjection);
+	for (int axis = 0; axis < 3; axis++) {
+		for (float side : { 1.0f, -1.0f }) {
+			glm::vec4 plane = rows[3] + rows[axis] * side;
+			float distance = glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w;
+			if (distance < -sphere.w * glm::length(glm::vec3(plane))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static_assert(ShadowRenderer::NUM_CASCADES * ShadowRenderer::CASCADE_SIZE <= ShadowRenderer::ATLAS_SIZE, "Cascades do not fit in the shadow atlas");
+static_assert(ShadowRenderer::CASCADE_SIZE + ((ShadowRenderer::MAX_SHADOWED_POINT_LIGHTS * 6 * ShadowRenderer::POINT_FACE_SIZE + ShadowRenderer::ATLAS_SIZE - 1) / ShadowRenderer::ATLAS_SIZE) * ShadowRenderer::POINT_FACE_SIZE <= ShadowRenderer::ATLAS_SIZE, "Point light faces do not fit in the shadow atlas");
+
+ShadowRenderer::ShadowRenderer() :
+	MaxShadowDistance(100.0f),
+	_atlas(nullptr),
+	_staticAtlas(nullptr),
+	_depthShader(nullptr),
+	_uniforms(nullptr),
+	_lightShadows(nullptr),
+	_lightShadowData(std::vector<int>()),
+	_staticCasters(std::vector<Caster>()),
+	_dynamicCasters(std::vector<Caster>()),
+	_viewCasters(std::vector<Caster>()),
+	_stats(Stats())
+{
+	FramebufferDescriptor descriptor;
+	descriptor.Width = ATLAS_SIZE;
+	descriptor.Height = ATLAS_SIZE;
+	descriptor.RenderTargets[RenderTargetAttachment::Depth] = { true, RenderTargetType::Depth24 };
+
+	_atlas = std::make_shared<Framebuffer>(descriptor);
+	_staticAtlas = std::make_shared<Framebuffer>(descriptor);
+
+	// The final atlas is sampled with sampler2DShadow, so we want hardware depth comparisons
+	// and linear filtering to get a little bit of free PCF
+	Texture2D::Sptr depth = _atlas->GetTextureAttachment(RenderTargetAttachment::Depth);
+	glTextureParameteri(depth->GetHandle(), GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTextureParameteri(depth->GetHandle(), GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glTextureParameteri(depth->GetHandle(), GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(depth->GetHandle(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	_depthShader = ShaderProgram::Create();
+	_depthShader->LoadShaderPartFromFile("shaders/vertex_shaders/shadow_depth.glsl", ShaderPartType::Vertex);
+	_depthShader->LoadShaderPartFromFile("shaders/fragment_shaders/shadow_depth.glsl", ShaderPartType::Fragment);
+	_depthShader->Link();
+
+	// Where each view lives in the atlas never changes, so we can fill that in once
+	_uniforms = std::make_shared<UniformBuffer<ShadowUniforms>>(BufferUsage::DynamicDraw);
+	ShadowUniforms& data = _uniforms->GetData();
+	data.CascadeSplits = glm::vec4(0.0f);
+	data.Params = glm::vec4(0.0f);
+	for (uint32_t ix = 0; ix < MAX_SHADOW_VIEWS; ix++) {
+		data.Views[ix].ViewProjection = glm::mat4(1.0f);
+		data.Views[ix].AtlasRect = glm::vec4(_GetViewport(ix)) / (float)ATLAS_SIZE;
+	}
+	_uniforms->Update();
+
+	_lightShadowData.push_back(-1);
+	_lightShadows = ShaderStorageBuffer::Create(BufferUsage::DynamicDraw);
+	_lightShadows->LoadData(_lightShadowData.data(), 1);
+
+	InvalidateCache();
+}
+
+ShadowRenderer::~ShadowRenderer() = default;
+
+void ShadowRenderer::Render(Gameplay::Scene* scene, const std::shared_ptr<Gameplay::Camera>& camera) {
+	using namespace Gameplay;
+
+	_stats.ViewsRendered = 0;
+	_stats.StaticViewsRendered = 0;
+	_stats.ViewsCached = 0;
+	_stats.DrawCalls = 0;
+	_stats.DrawsPerView.clear();
+
+	if (!_depthShader->IsLinked()) {
+		return;
+	}
+
+	// Sort everything that can cast a shadow by whether it's allowed to move. Grabbing the transforms
+	// here also lets any static objects that moved notify the scene before we check it's version
+	_staticCasters.clear();
+	_dynamicCasters.clear();
+	scene->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		VertexArrayObject::Sptr mesh = renderable->GetMesh();
+		if (mesh == nullptr) {
+			return;
+		}
+		GameObject* object = renderable->GetGameObject();
+		const glm::mat4& transform = object->GetTransform();
+
+		// Arena meshes know their bounds, which lets us skip dynamic casters in views they don't touch
+		glm::vec4 bounds = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+		if (mesh->GetArenaAllocation() != nullptr) {
+			glm::vec4 sphere = mesh->GetArenaAllocation()->BoundingSphere;
+			float scale = glm::max(glm::length(glm::vec3(transform[0])), glm::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+			bounds = glm::vec4(glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w * scale);
+		}
+		(object->IsStatic ? _staticCasters : _dynamicCasters).push_back({ mesh, transform, bounds });
+	});
+	uint32_t staticVersion = scene->GetStaticGeometryVersion();
+
+	ShadowUniforms& data = _uniforms->GetData();
+
+	// The sun's cascades always take the first views in the atlas
+	glm::vec3 sunColor = scene->GetSunColor();
+	bool hasSun = glm::dot(sunColor, sunColor) > 0.0f;
+	if (hasSun) {
+		glm::mat4 matrices[NUM_CASCADES];
+		_CalcCascades(camera, scene->GetSunDirection(), matrices, data.CascadeSplits);
+		for (uint32_t ix = 0; ix < NUM_CASCADES; ix++) {
+			data.Views[ix].ViewProjection = matrices[ix];
+		}
+	}
+	data.Params = glm::vec4(hasSun ? NUM_CASCADES : 0, 1.0f / ATLAS_SIZE, 0.0005f, 0.02f);
+
+	// Hand out 6 views to each shadowed point light, in the same order as the scene's lights
+	static const glm::vec3 faceDirs[6] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+	};
+	static const glm::vec3 faceUps[6] = {
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f },  { 0.0f, 0.0f, -1.0f },
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+	};
+	_lightShadowData.assign(glm::max(scene->Lights.size(), (size_t)1), -1);
+	uint32_t numViews = NUM_CASCADES;
+	for (size_t ix = 0; ix < scene->Lights.size() && numViews + 6 <= MAX_SHADOW_VIEWS; ix++) {
+		const Light& light = scene->Lights[ix];
+		if (!light.CastShadows) {
+			continue;
+		}
+		_lightShadowData[ix] = static_cast<int>(numViews);
+
+		float radius = glm::max(Scene::CalcLightRadius(light), 0.1f);
+		glm::mat4 projection = glm::perspective(glm::half_pi<float>(), 1.0f, 0.05f, radius);
+		for (int face = 0; face < 6; face++) {
+			data.Views[numViews + face].ViewProjection = projection * glm::lookAt(light.Position, light.Position + faceDirs[face], faceUps[face]);
+		}
+		numViews += 6;
+	}
+	_lightShadows->UpdateData(_lightShadowData.data(), sizeof(int), (uint32_t)_lightShadowData.size(), true);
+	_uniforms->Update();
+
+	_stats.DrawsPerView.resize(numViews, 0);
+
+	_depthShader->Bind();
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	// Planes and other open meshes still need to cast shadows from behind
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 4.0f);
+	// Clears need to stay within each view's region of the atlas
+	glEnable(GL_SCISSOR_TEST);
+
+	for (uint32_t view = hasSun ? 0 : NUM_CASCADES; view < numViews; view++) {
+		_RenderView(view, data.Views[view].ViewProjection, staticVersion);
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glEnable(GL_CULL_FACE);
+	VertexArrayObject::Unbind();
+}
+
+void ShadowRenderer::Bind() const {
+	_atlas->BindAttachment(RenderTargetAttachment::Depth, ATLAS_TEXTURE_SLOT);
+	_uniforms->Bind(SHADOW_UBO_BINDING);
+	_lightShadows->Bind(LIGHT_SHADOW_BINDING);
+}
+
+void ShadowRenderer::InvalidateCache() {
+	for (uint32_t ix = 0; ix < MAX_SHADOW_VIEWS; ix++) {
+		_cache[ix].ViewProjection = glm::mat4(1.0f);
+		_cache[ix].StaticVersion = 0;
+		_cache[ix].IsValid = false;
+		_cache[ix].HasDynamic = false;
+	}
+}
+
+glm::ivec4 ShadowRenderer::_GetViewport(uint32_t view) {
+	if (view < NUM_CASCADES) {
+		return glm::ivec4(view * CASCADE_SIZE, 0, CASCADE_SIZE, CASCADE_SIZE);
+	}
+	uint32_t face = view - NUM_CASCADES;
+	uint32_t perRow = ATLAS_SIZE / POINT_FACE_SIZE;
+	return glm::ivec4((face % perRow) * POINT_FACE_SIZE, CASCADE_SIZE + (face / perRow) * POINT_FACE_SIZE, POINT_FACE_SIZE, POINT_FACE_SIZE);
+}
+
+void ShadowRenderer::_CalcCascades(const std::shared_ptr<Gameplay::Camera>& camera, const glm::vec3& sunDir, glm::mat4* outMatrices, glm::vec4& outSplits) const {
+	// Find the corners of the camera's frustum in view space
+	glm::mat4 inverseProjection = glm::inverse(camera->GetProjection());
+	glm::vec3 nearCorners[4];
+	glm::vec3 farCorners[4];
+	for (int ix = 0; ix < 4; ix++) {
+		glm::vec2 ndc = glm::vec2((ix & 1) ? 1.0f : -1.0f, (ix & 2) ? 1.0f : -1.0f);
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+		nearCorners[ix] = glm::vec3(nearPoint) / nearPoint.w;
+		farCorners[ix] = glm::vec3(farPoint) / farPoint.w;
+	}
+	glm::mat4 inverseView = glm::inverse(camera->GetView());
+
+	float nearPlane = camera->GetNearPlane();
+	float farPlane = camera->GetFarPlane();
+	float shadowFar = glm::min(farPlane, MaxShadowDistance);
+
+	// Avoid a degenerate view matrix when the sun points straight up or down
+	glm::vec3 up = glm::abs(sunDir.z) > 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+	float sliceStart = nearPlane;
+	for (uint32_t cascade = 0; cascade < NUM_CASCADES; cascade++) {
+		// Blend log and uniform splits, log splits give the cascades near the camera more resolution
+		float t = (cascade + 1) / (float)NUM_CASCADES;
+		float logSplit = nearPlane * glm::pow(shadowFar / nearPlane, t);
+		float uniformSplit = nearPlane + (shadowFar - nearPlane) * t;
+		float sliceEnd = glm::mix(uniformSplit, logSplit, CASCADE_SPLIT_LAMBDA);
+		outSplits[cascade] = sliceEnd;
+
+		// Corners of this slice of the frustum in world space, the frustum edges are linear in view depth
+		glm::vec3 corners[8];
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int ix = 0; ix < 4; ix++) {
+			float startT = (sliceStart - nearPlane) / (farPlane - nearPlane);
+			float endT = (sliceEnd - nearPlane) / (farPlane - nearPlane);
+			corners[ix * 2] = glm::vec3(inverseView * glm::vec4(glm::mix(nearCorners[ix], farCorners[ix], startT), 1.0f));
+			corners[ix * 2 + 1] = glm::vec3(inverseView * glm::vec4(glm::mix(nearCorners[ix], farCorners[ix], endT), 1.0f));
+			center += corners[ix * 2] + corners[ix * 2 + 1];
+		}
+		center /= 8.0f;
+
+		// Fit a sphere instead of a box, so the cascade's size doesn't change as the camera rotates
+		float radius = 0.0f;
+		for (int ix = 0; ix < 8; ix++) {
+			radius = glm::max(radius, glm::length(corners[ix] - center));
+		}
+		radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+		// Snap the center to whole texels in light space before building the matrices, so the shadow edges
+		// don't shimmer, and so the matrix stays exactly the same (and the cached static depth can be re-used)
+		// until the camera has moved at least a texel. Depth is snapped by the same step so the range doesn't creep
+		glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), sunDir, up);
+		float texelSize = (radius * 2.0f) / CASCADE_SIZE;
+		glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		lightCenter = glm::floor(lightCenter / texelSize) * texelSize;
+
+		// The center is at the origin of the view, the eye used to sit radius units behind it towards the sun
+		glm::mat4 view = glm::translate(glm::mat4(1.0f), -lightCenter) * lightRotation;
+		glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, -(CASCADE_CASTER_DISTANCE + radius), radius);
+
+		outMatrices[cascade] = projection * view;
+		sliceStart = sliceEnd;
+	}
+}
+
+void ShadowRenderer::_RenderView(uint32_t view, const glm::mat4& viewProjection, uint32_t staticVersion) {
+	ViewCache& cache = _cache[view];
+	glm::ivec4 viewport = _GetViewport(view);
+	uint32_t draws = 0;
+
+	// Static depth only needs to be rebuilt if the view or the static geometry has changed
+	bool isStaticDirty = !cache.IsValid || cache.StaticVersion != staticVersion || cache.ViewProjection != viewProjection;
+	if (isStaticDirty) {
+		_staticAtlas->Bind();
+		glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+		glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		draws += _DrawCasters(_staticCasters, viewProjection);
+
+		cache.ViewProjection = viewProjection;
+		cache.StaticVersion = staticVersion;
+		cache.IsValid = true;
+		_stats.StaticViewsRendered++;
+	}
+
+	// Only dynamic casters inside this view need to be drawn over the static depth
+	_viewCasters.clear();
+	for (const Caster& caster : _dynamicCasters) {
+		if (SphereInView(viewProjection, caster.Bounds)) {
+			_viewCasters.push_back(caster);
+		}
+	}
+
+	// If nothing moved and there's nothing dynamic to draw (now or last frame), the final atlas is already correct
+	bool hasDynamic = !_viewCasters.empty();
+	if (!isStaticDirty && !hasDynamic && !cache.HasDynamic) {
+		_stats.ViewsCached++;
+		return;
+	}
+
+	// Start from the cached static depth, then draw the dynamic casters over top
+	glCopyImageSubData(
+		_staticAtlas->GetTextureAttachment(RenderTargetAttachment::Depth)->GetHandle(), GL_TEXTURE_2D, 0, viewport.x, viewport.y, 0,
+		_atlas->GetTextureAttachment(RenderTargetAttachment::Depth)->GetHandle(), GL_TEXTURE_2D, 0, viewport.x, viewport.y, 0,
+		viewport.z, viewport.w, 1
+	);
+	if (hasDynamic) {
+		_atlas->Bind();
+		glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+		glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+		draws += _DrawCasters(_viewCasters, viewProjection);
+	}
+	cache.HasDynamic = hasDynamic;
+
+	if (draws > 0) {
+		_stats.ViewsRendered++;
+	}
+	_stats.DrawCalls += draws;
+	_stats.DrawsPerView[view] = draws;
+}
+
+uint32_t ShadowRenderer::_DrawCasters(const std::vector<Caster>& casters, const glm::mat4& viewProjection) {
+	_depthShader->SetUniformMatrix(0, &viewProjection);
+	for (const Caster& caster : casters) {
+		_depthShader->SetUniformMatrix(1, &caster.Transform);
+		caster.Mesh->Draw();
+	}
+	return static_cast<uint32_t>(casters.size());
+}
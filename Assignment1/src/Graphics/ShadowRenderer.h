@@ -0,0 +1,159 @@
+#pragma once
+#include <vector>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Graphics/Framebuffer.h"
+#include "Graphics/ShaderProgram.h"
+#include "Graphics/VertexArrayObject.h"
+#include "Graphics/Buffers/ShaderStorageBuffer.h"
+#include "Graphics/Buffers/UniformBuffer.h"
+
+namespace Gameplay {
+	class Scene;
+	class Camera;
+}
+
+/// <summary>
+/// Renders shadow maps for the scene's sun (as a set of cascades that follow the camera) and
+/// for any point lights with CastShadows set (as 6 cube faces each). All shadow maps are packed
+/// into a single depth atlas so shaders only need one sampler.
+///
+/// Static geometry (GameObject::IsStatic) is rendered into a separate cached atlas, which is only
+/// re-rendered for a view when the view moves or the scene's static geometry changes. Each frame
+/// the cached depth is copied into the final atlas and only dynamic casters are drawn on top
+/// </summary>
+class ShadowRenderer {
+public:
+	MAKE_PTRS(ShadowRenderer);
+
+	static inline Sptr Create() {
+		return std::make_shared<ShadowRenderer>();
+	}
+
+	// Atlas layout, cascades fill the top row and point light faces fill the rest
+	static const uint32_t ATLAS_SIZE = 4096;
+	static const uint32_t NUM_CASCADES = 4;
+	static const uint32_t CASCADE_SIZE = 1024;
+	static const uint32_t POINT_FACE_SIZE = 512;
+	static const uint32_t MAX_SHADOWED_POINT_LIGHTS = 8;
+	// Must match MAX_SHADOW_VIEWS in shadows.glsl
+	static const uint32_t MAX_SHADOW_VIEWS = NUM_CASCADES + MAX_SHADOWED_POINT_LIGHTS * 6;
+
+	// Binding slots, must match shadows.glsl
+	static const int SHADOW_UBO_BINDING = 5;
+	static const int LIGHT_SHADOW_BINDING = 10;
+	static const int ATLAS_TEXTURE_SLOT = 13;
+
+	/// <summary>
+	/// Per-frame statistics about the shadow work that was done
+	/// </summary>
+	struct Stats {
+		// The number of views that issued any draws this frame
+		uint32_t ViewsRendered;
+		// The number of views whose cached static shadows had to be rebuilt
+		uint32_t StaticViewsRendered;
+		// The number of views that were reused without any work
+		uint32_t ViewsCached;
+		// The total number of draw calls issued for shadows
+		uint32_t DrawCalls;
+		// The number of draws issued by each active view, indexed the same as the atlas views
+		std::vector<uint32_t> DrawsPerView;
+	};
+
+	/// <summary>
+	/// The distance from the camera that the sun's cascades cover, clamped to the camera's far plane
+	/// </summary>
+	float MaxShadowDistance;
+
+	ShadowRenderer();
+	~ShadowRenderer();
+
+	/// <summary>
+	/// Updates and renders all shadow views for the given scene. This binds it's own
+	/// framebuffer and viewport, so should be called before the main scene is drawn
+	/// </summary>
+	void Render(Gameplay::Scene* scene, const std::shared_ptr<Gameplay::Camera>& camera);
+
+	/// <summary>
+	/// Binds the shadow atlas and shadow view data for use by lighting shaders
+	/// </summary>
+	void Bind() const;
+
+	/// <summary>
+	/// Marks every cached view as invalid, forcing all shadows to be re-rendered next frame
+	/// </summary>
+	void InvalidateCache();
+
+	const Stats& GetStats() const { return _stats; }
+	const Framebuffer::Sptr& GetAtlas() const { return _atlas; }
+
+protected:
+	// Matches ShadowView in shadows.glsl
+	struct ShadowView {
+		glm::mat4 ViewProjection;
+		glm::vec4 AtlasRect;
+	};
+
+	// Matches b_ShadowBlock in shadows.glsl
+	struct ShadowUniforms {
+		glm::vec4  CascadeSplits;
+		glm::vec4  Params;
+		ShadowView Views[MAX_SHADOW_VIEWS];
+	};
+
+	// What each view's cached static depth was last rendered with
+	struct ViewCache {
+		glm::mat4 ViewProjection;
+		uint32_t  StaticVersion;
+		bool      IsValid;
+		// True if the final atlas has dynamic casters drawn over the cached depth
+		bool      HasDynamic;
+	};
+
+	// A mesh and transform to draw into the shadow maps
+	struct Caster {
+		VertexArrayObject::Sptr Mesh;
+		glm::mat4               Transform;
+		// A world space sphere around the mesh, center in xyz and radius in w. A negative radius means the
+		// bounds are unknown, and the caster is drawn into every view
+		glm::vec4               Bounds;
+	};
+
+	Framebuffer::Sptr   _atlas;
+	Framebuffer::Sptr   _staticAtlas;
+	ShaderProgram::Sptr _depthShader;
+
+	UniformBuffer<ShadowUniforms>::Sptr _uniforms;
+	ShaderStorageBuffer::Sptr           _lightShadows;
+	std::vector<int>                    _lightShadowData;
+
+	ViewCache              _cache[MAX_SHADOW_VIEWS];
+	std::vector<Caster>    _staticCasters;
+	std::vector<Caster>    _dynamicCasters;
+	// The dynamic casters that touch the view being rendered
+	std::vector<Caster>    _viewCasters;
+	Stats                  _stats;
+
+	/// <summary>
+	/// Gets the pixel rectangle (x, y, width, height) of the given view within the atlas
+	/// </summary>
+	static glm::ivec4 _GetViewport(uint32_t view);
+
+	/// <summary>
+	/// Calculates the sun's view projection matrices for each cascade, and the view depth each one ends at
+	/// </summary>
+	void _CalcCascades(const std::shared_ptr<Gameplay::Camera>& camera, const glm::vec3& sunDir, glm::mat4* outMatrices, glm::vec4& outSplits) const;
+
+	/// <summary>
+	/// Brings a single view up to date, re-rendering cached static depth if needed
+	/// and drawing dynamic casters over top
+	/// </summary>
+	void _RenderView(uint32_t view, const glm::mat4& viewProjection, uint32_t staticVersion);
+
+	/// <summary>
+	/// Draws the given casters into the currently bound framebuffer
+	/// </summary>
+	/// <returns>The number of draw calls issued</returns>
+	uint32_t _DrawCasters(const std::vector<Caster>& casters, const glm::mat4& viewProjection);
+};
@@ -0,0 +1,266 @@
+#include "Graphics/StaticBatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "Gameplay/Scene.h"
+#include "Gameplay/Components/RenderComponent.h"
+#include "Graphics/GeometryArena.h"
+#include "Utils/Profiler.h"
+#include "Utils/MemoryTracker.h"
+#include "Logging.h"
+
+const float StaticBatcher::DEFAULT_CELL_SIZE = 32.0f;
+
+static uint64_t PackCell(const glm::ivec3& cell) {
+	// 21 bits per axis, cells only need to be unique, not ordered
+	return ((uint64_t)(cell.x & 0x1FFFFF) << 42) | ((uint64_t)(cell.y & 0x1FFFFF) << 21) | (uint64_t)(cell.z & 0x1FFFFF);
+}
+
+// Gets the offset of a vec3 attribute within a vertex, or -1 if the layout doesn't have one
+static int FindVec3(const VertexArrayObject::VertexDeclaration& vDecl, AttribUsage usage) {
+	for (const BufferAttribute& attrib : vDecl) {
+		if (attrib.Usage == usage && attrib.Type == AttributeType::Float && attrib.Size >= 3) {
+			return attrib.Offset;
+		}
+	}
+	return -1;
+}
+
+// Transforms a vec3 attribute in place, vertices are tightly packed so the attribute may not be aligned
+static void TransformVec3(uint8_t* vertex, int offset, const glm::mat4& transform, float w, bool normalize) {
+	if (offset < 0) {
+		return;
+	}
+	glm::vec3 value;
+	memcpy(&value, vertex + offset, sizeof(glm::vec3));
+	value = glm::vec3(transform * glm::vec4(value, w));
+	if (normalize && glm::dot(value, value) > 0.0f) {
+		value = glm::normalize(value);
+	}
+	memcpy(vertex + offset, &value, sizeof(glm::vec3));
+}
+
+StaticBatcher::StaticBatcher() :
+	CellSize(DEFAULT_CELL_SIZE),
+	PreserveEditorObjects(true),
+	_scene(nullptr),
+	_staticVersion(0),
+	_builtCellSize(0.0f),
+	_isDirty(true),
+	_isActive(false),
+	_batches(std::vector<Batch>()),
+	_members(std::unordered_map<const RenderComponent*, Member>()),
+	_meshData(std::unordered_map<const GeometryAllocation*, MeshData>()),
+	_stats({ 0, 0, 0, 0, 0.0f })
+{ }
+
+StaticBatcher::~StaticBatcher() = default;
+
+bool StaticBatcher::Update(Gameplay::Scene* scene) {
+	_isActive = scene != nullptr && (scene->IsPlaying || !PreserveEditorObjects);
+	if (!_isActive) {
+		return false;
+	}
+
+	if (_isDirty || scene != _scene || scene->GetStaticGeometryVersion() != _staticVersion || CellSize != _builtCellSize) {
+		_Rebuild(scene);
+	}
+	return true;
+}
+
+bool StaticBatcher::IsBatched(const RenderComponent* renderable) {
+	if (!_isActive) {
+		return false;
+	}
+	auto it = _members.find(renderable);
+	if (it == _members.end()) {
+		return false;
+	}
+
+	// The object is drawn on it's own until the batches catch up, it's old geometry stays in the batch for a frame
+	if (it->second.Material != renderable->GetMaterial().get() || it->second.Mesh != renderable->GetMesh().get()) {
+		_members.erase(it);
+		_isDirty = true;
+		return false;
+	}
+	return true;
+}
+
+void StaticBatcher::Clear() {
+	_batches.clear();
+	_members.clear();
+	_scene = nullptr;
+	_isDirty = true;
+}
+
+void StaticBatcher::_Rebuild(Gameplay::Scene* scene) {
+	using namespace Gameplay;
+
+	PROFILE_SCOPE("Static Batching");
+	MEMORY_SCOPE(Render);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	_batches.clear();
+	_members.clear();
+	_scene = scene;
+	_staticVersion = scene->GetStaticGeometryVersion();
+	_builtCellSize = CellSize;
+	_isDirty = false;
+
+	// Find everything we can merge, and which cell it's centered in
+	struct Candidate {
+		const RenderComponent*   Renderable;
+		GameObject*              Object;
+		Gameplay::Material::Sptr Material;
+		VertexArrayObject::Sptr  Mesh;
+		GeometryAllocation*      Allocation;
+		uint64_t                 Cell;
+	};
+	std::vector<Candidate> candidates;
+	float invCellSize = 1.0f / glm::max(CellSize, 0.01f);
+	scene->Components().Each<RenderComponent>([&](const RenderComponent::Sptr& renderable) {
+		GameObject* object = renderable->GetGameObject();
+		if (!object->IsStatic || renderable->GetMaterial() == nullptr) {
+			return;
+		}
+		VertexArrayObject::Sptr mesh = renderable->GetMesh();
+		if (mesh == nullptr || mesh->GetArenaAllocation() == nullptr || mesh->GetArenaAllocation()->IndexCount == 0) {
+			return;
+		}
+		GeometryAllocation* allocation = mesh->GetArenaAllocation().get();
+		glm::vec3 center = glm::vec3(object->GetTransform() * glm::vec4(glm::vec3(allocation->BoundingSphere), 1.0f));
+		candidates.push_back({ renderable.get(), object, renderable->GetMaterial(), mesh, allocation, PackCell(glm::ivec3(glm::floor(center * invCellSize))) });
+	});
+
+	// Objects that can share a batch end up next to each other
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+		if (a.Material != b.Material) {
+			return a.Material < b.Material;
+		}
+		if (a.Allocation->Arena != b.Allocation->Arena) {
+			return a.Allocation->Arena < b.Allocation->Arena;
+		}
+		return a.Cell < b.Cell;
+	});
+	auto canShare = [](const Candidate& a, const Candidate& b) {
+		return a.Material == b.Material && a.Allocation->Arena == b.Allocation->Arena && a.Cell == b.Cell;
+	};
+
+	// Drop the copies of meshes that have been released, so a new allocation at the same address isn't mistaken for them
+	for (auto it = _meshData.begin(); it != _meshData.end();) {
+		if (it->second.Allocation.expired()) {
+			it = _meshData.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	// Meshes are usually shared by many objects, and kept between rebuilds, so each one is only read back once
+	auto getMeshData = [&](const Candidate& candidate) -> const MeshData& {
+		auto it = _meshData.find(candidate.Allocation);
+		if (it != _meshData.end()) {
+			return it->second;
+		}
+		const GeometryAllocation* allocation = candidate.Allocation;
+		uint32_t stride = allocation->Arena->GetStride();
+		MeshData& data = _meshData[allocation];
+		data.Allocation = candidate.Mesh->GetArenaAllocation();
+		data.Vertices.resize((size_t)allocation->VertexCount * stride);
+		data.Indices.resize(allocation->IndexCount);
+		candidate.Mesh->GetBufferBinding(AttribUsage::Position)->GetBuffer()->ReadSubData(data.Vertices.data(), allocation->BaseVertex * stride, allocation->VertexCount * stride);
+		candidate.Mesh->GetIndexBuffer()->ReadSubData(data.Indices.data(), allocation->FirstIndex * sizeof(uint32_t), allocation->IndexCount * sizeof(uint32_t));
+		return data;
+	};
+
+	std::vector<uint8_t>  vertices;
+	std::vector<uint32_t> indices;
+	uint32_t totalObjects = 0;
+	uint32_t totalVertices = 0;
+
+	size_t ix = 0;
+	while (ix < candidates.size()) {
+		size_t groupEnd = ix + 1;
+		while (groupEnd < candidates.size() && canShare(candidates[ix], candidates[groupEnd])) {
+			groupEnd++;
+		}
+
+		GeometryArena* arena = candidates[ix].Allocation->Arena.get();
+		uint32_t stride = arena->GetStride();
+		int positionOffset = FindVec3(arena->GetVDecl(), AttribUsage::Position);
+		int normalOffset = FindVec3(arena->GetVDecl(), AttribUsage::Normal);
+		int tangentOffset = FindVec3(arena->GetVDecl(), AttribUsage::Tangent);
+		int bitangentOffset = FindVec3(arena->GetVDecl(), AttribUsage::BiTangent);
+		if (positionOffset < 0) {
+			ix = groupEnd;
+			continue;
+		}
+
+		// Split the group into batches that stay under the vertex limit
+		while (ix < groupEnd) {
+			size_t batchEnd = ix;
+			uint32_t vertexCount = 0;
+			while (batchEnd < groupEnd && (batchEnd == ix || vertexCount + candidates[batchEnd].Allocation->VertexCount <= MAX_BATCH_VERTICES)) {
+				vertexCount += candidates[batchEnd].Allocation->VertexCount;
+				batchEnd++;
+			}
+
+			// Merging a lone object wouldn't save anything
+			if (batchEnd - ix < 2) {
+				ix = batchEnd;
+				continue;
+			}
+
+			Batch batch;
+			batch.Material = candidates[ix].Material;
+			vertices.clear();
+			indices.clear();
+
+			for (size_t cx = ix; cx < batchEnd; cx++) {
+				const Candidate& candidate = candidates[cx];
+				const MeshData& data = getMeshData(candidate);
+
+				const glm::mat4& model = candidate.Object->GetTransform();
+				glm::mat4 normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+				// Mirrored objects turn their triangles inside out, so we flip them back
+				bool flipWinding = glm::determinant(glm::mat3(model)) < 0.0f;
+
+				uint32_t baseVertex = static_cast<uint32_t>(vertices.size() / stride);
+				vertices.insert(vertices.end(), data.Vertices.begin(), data.Vertices.end());
+				for (uint32_t vx = 0; vx < candidate.Allocation->VertexCount; vx++) {
+					uint8_t* vertex = vertices.data() + ((size_t)baseVertex + vx) * stride;
+					TransformVec3(vertex, positionOffset, model, 1.0f, false);
+					TransformVec3(vertex, normalOffset, normalMatrix, 0.0f, true);
+					TransformVec3(vertex, tangentOffset, model, 0.0f, true);
+					TransformVec3(vertex, bitangentOffset, model, 0.0f, true);
+				}
+
+				for (size_t tx = 0; tx + 2 < data.Indices.size(); tx += 3) {
+					indices.push_back(baseVertex + data.Indices[tx]);
+					indices.push_back(baseVertex + data.Indices[flipWinding ? tx + 2 : tx + 1]);
+					indices.push_back(baseVertex + data.Indices[flipWinding ? tx + 1 : tx + 2]);
+				}
+			}
+
+			batch.Mesh = arena->Upload(vertices.data(), vertexCount, indices.data(), static_cast<uint32_t>(indices.size()));
+			if (batch.Mesh != nullptr) {
+				batch.Mesh->SetDebugName("Static Batch " + std::to_string(_batches.size()));
+				for (size_t cx = ix; cx < batchEnd; cx++) {
+					_members[candidates[cx].Renderable] = { candidates[cx].Material.get(), candidates[cx].Mesh.get() };
+				}
+				totalObjects += static_cast<uint32_t>(batchEnd - ix);
+				totalVertices += vertexCount;
+				_batches.push_back(std::move(batch));
+			}
+			ix = batchEnd;
+		}
+	}
+
+	_stats.Objects = totalObjects;
+	_stats.Batches = static_cast<uint32_t>(_batches.size());
+	_stats.Vertices = totalVertices;
+	_stats.Rebuilds++;
+	_stats.BuildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	LOG_INFO("Merged {} static objects into {} batches in {:.2f}ms", totalObjects, _batches.size(), _stats.BuildMilliseconds);
+}
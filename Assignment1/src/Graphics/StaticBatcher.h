@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <GLM/glm.hpp>
+
+#include "Utils/Macros.h"
+#include "Gameplay/Material.h"
+#include "Gameplay/GameObject.h"
+#include "Graphics/VertexArrayObject.h"
+
+class RenderComponent;
+namespace Gameplay {
+	class Scene;
+}
+
+/// <summary>
+/// Merges the meshes of static objects (GameObject::IsStatic) that share a material into a few large
+/// meshes, pre-transformed into world space, so static scenery costs one draw per material per cell
+/// instead of one per object. Objects are grouped by the grid cell their bounds are centered in, so each
+/// batch stays small enough for the multi-draw cull pass to reject on it's own.
+///
+/// Only indexed meshes in a geometry arena can be merged, anything else is still drawn on it's own. The
+/// batches are rebuilt when the scene's static geometry version changes. Each source mesh is read back
+/// from the GPU the first time it is batched and kept on the CPU while it's alive, so only the first
+/// build stalls and later rebuilds only cost the merge itself
+/// </summary>
+class StaticBatcher {
+public:
+	MAKE_PTRS(StaticBatcher);
+	NO_COPY(StaticBatcher);
+	NO_MOVE(StaticBatcher);
+
+	static const float DEFAULT_CELL_SIZE;
+	// Batches are split once they reach this many vertices, so a single batch never covers too much of the world
+	static const uint32_t MAX_BATCH_VERTICES = 1 << 16;
+
+	/// <summary>
+	/// A merged mesh, drawn with an identity model matrix
+	/// </summary>
+	struct Batch {
+		Gameplay::Material::Sptr Material;
+		VertexArrayObject::Sptr  Mesh;
+	};
+
+	/// <summary>
+	/// Describes the last time the batches were built
+	/// </summary>
+	struct Stats {
+		// The number of objects that were merged
+		uint32_t Objects;
+		uint32_t Batches;
+		uint32_t Vertices;
+		// The number of times the batches have been built
+		uint32_t Rebuilds;
+		float    BuildMilliseconds;
+	};
+
+	/// <summary>
+	/// The size of the grid cells objects are grouped by, in world units. Changing this rebuilds the batches
+	/// </summary>
+	float CellSize;
+	/// <summary>
+	/// True to leave static objects unbatched while the scene is not playing, so they can still be picked and
+	/// moved individually in the editor
+	/// </summary>
+	bool  PreserveEditorObjects;
+
+	static inline Sptr Create() {
+		return std::make_shared<StaticBatcher>();
+	}
+
+	StaticBatcher();
+	~StaticBatcher();
+
+	/// <summary>
+	/// Rebuilds the batches if the scene or it's static geometry has changed since the last call. Should be
+	/// called after the scene's transforms are up to date for the frame
+	/// </summary>
+	/// <returns>True if static objects should be drawn through the batches this frame</returns>
+	bool Update(Gameplay::Scene* scene);
+
+	/// <summary>
+	/// Returns true if the renderable has been merged into a batch, and shouldn't be drawn on it's own. If it's
+	/// mesh or material has changed since, this returns false and the batches are rebuilt on the next update
+	/// </summary>
+	bool IsBatched(const RenderComponent* renderable);
+
+	/// <summary>
+	/// Gets the batches to draw, only valid while Update returns true
+	/// </summary>
+	const std::vector<Batch>& GetBatches() const { return _batches; }
+
+	/// <summary>
+	/// Releases all batches, they will be rebuilt on the next update. The CPU copies of source meshes are kept
+	/// </summary>
+	void Clear();
+
+	const Stats& GetStats() const { return _stats; }
+
+protected:
+	// What a merged renderable looked like when it was batched
+	struct Member {
+		const Gameplay::Material* Material;
+		const VertexArrayObject*  Mesh;
+	};
+
+	// A CPU copy of a source mesh's vertices and indices. Arena allocations never change once uploaded, so the
+	// copy stays valid for as long as the allocation is alive
+	struct MeshData {
+		std::weak_ptr<GeometryAllocation> Allocation;
+		std::vector<uint8_t>              Vertices;
+		std::vector<uint32_t>             Indices;
+	};
+
+	// The scene and static geometry version the batches were built for
+	const Gameplay::Scene* _scene;
+	uint32_t               _staticVersion;
+	float                  _builtCellSize;
+	bool                   _isDirty;
+	bool                   _isActive;
+
+	std::vector<Batch>                                  _batches;
+	std::unordered_map<const RenderComponent*, Member>  _members;
+	std::unordered_map<const GeometryAllocation*, MeshData> _meshData;
+
+	Stats _stats;
+
+	void _Rebuild(Gameplay::Scene* scene);
+};
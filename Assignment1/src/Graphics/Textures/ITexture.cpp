@@ -5,7 +5,8 @@ bool ITexture::__isStaticInit = false;
 
 ITexture::ITexture(TextureType type) :
 	IGraphicsResource(),
-	_type(type)
+	_type(type),
+	_contentVersion(0)
 {
 	__StaticInit();
 	_Recreate();
@@ -40,6 +41,7 @@ void ITexture::Unbind(int slot) {
 void ITexture::Clear(const glm::vec4& color) {
 	if (_rendererId != 0) {
 		glClearTexImage(_rendererId, 0, GL_RGBA, GL_FLOAT, &color.x);
+		_contentVersion++;
 	}
 }
 
@@ -47,6 +49,53 @@ GlResourceType ITexture::GetResourceClass() const {
 	return GlResourceType::Texture;
 }
 
+size_t ITexture::GetMemoryEstimate() const {
+	if (_rendererId == 0) {
+		return 0;
+	}
+
+	const GLenum sizeParams[] = {
+		GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE,
+		GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE
+	};
+
+	// Walk the mip chain the driver actually allocated, stopping at the first empty level
+	size_t result = 0;
+	for (GLint level = 0; level < 32; level++) {
+		GLint width = 0, height = 0, depth = 0;
+		glGetTextureLevelParameteriv(_rendererId, level, GL_TEXTURE_WIDTH, &width);
+		if (width == 0) {
+			break;
+		}
+		glGetTextureLevelParameteriv(_rendererId, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTextureLevelParameteriv(_rendererId, level, GL_TEXTURE_DEPTH, &depth);
+
+		// Cubemaps accessed through DSA may or may not report their faces as layers
+		size_t layers = depth > 0 ? depth : 1;
+		if (_type == TextureType::Cubemap && layers < 6) {
+			layers = 6;
+		}
+
+		GLint compressed = GL_FALSE;
+		glGetTextureLevelParameteriv(_rendererId, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint size = 0;
+			glGetTextureLevelParameteriv(_rendererId, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			result += size;
+			continue;
+		}
+
+		GLint bits = 0;
+		for (GLenum param : sizeParams) {
+			GLint value = 0;
+			glGetTextureLevelParameteriv(_rendererId, level, param, &value);
+			bits += value;
+		}
+		result += static_cast<size_t>(width) * (height > 0 ? height : 1) * layers * bits / 8;
+	}
+	return result;
+}
+
 void ITexture::__StaticInit()
 {
 	// If we've already run the static initializer, abort now
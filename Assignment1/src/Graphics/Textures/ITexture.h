@@ -48,9 +48,17 @@ public:
 	/// <param name="color">The color to clear to</param>
 	void Clear(const glm::vec4& color);
 
+	/// <summary>
+	/// Gets a counter that is incremented whenever this texture's texels are changed through LoadData or
+	/// Clear, so copies of the texture can tell when they are out of date. Rendering into the texture
+	/// through a framebuffer is not tracked
+	/// </summary>
+	uint32_t GetContentVersion() const { return _contentVersion; }
+
 	// Inherited from IGraphicsResource
 
 	virtual GlResourceType GetResourceClass() const override;
+	virtual size_t GetMemoryEstimate() const override;
 
 protected:
 	ITexture(TextureType type);
@@ -61,6 +69,7 @@ protected:
 	virtual void _Recreate();
 
 	TextureType _type; // The type for this texture, mainly used for debugging
+	uint32_t    _contentVersion;
 
 // STATIC SECTION
 private:
@@ -139,6 +139,7 @@ void Texture2D::LoadData(uint32_t width, uint32_t height, PixelFormat format, Pi
 
 	// Upload our data to our image
 	glTextureSubImage2D(_rendererId, 0, offsetX, offsetY, width, height, (GLenum)format, (GLenum)type, data);
+	_contentVersion++;
 
 	// If requested, generate mip-maps for our texture
 	if (_description.GenerateMipMaps) {
@@ -0,0 +1,190 @@
+#include "Graphics/Textures/TextureAtlas.h"
+#include "Logging.h"
+
+TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t maxSpriteSize, uint32_t padding) :
+	_pageSize(pageSize),
+	_maxSpriteSize(maxSpriteSize),
+	_padding(padding),
+	_pages(std::vector<Page*>()),
+	_entries(std::unordered_map<const Texture2D*, Entry>())
+{ }
+
+TextureAtlas::~TextureAtlas() {
+	Clear();
+}
+
+const AtlasRegion* TextureAtlas::GetRegion(const Texture2D::Sptr& texture)
+{
+	if (texture == nullptr) {
+		return nullptr;
+	}
+
+	// If we've seen the texture before, we can use the cached result. We need to make sure
+	// that the texture is still alive, since another texture may re-use the same address
+	auto it = _entries.find(texture.get());
+	if (it != _entries.end() && it->second.Source.lock() == texture) {
+		Entry& entry = it->second;
+		// Textures can't be resized, so if the texels have changed we can copy them over the old ones
+		if (entry.IsPacked && entry.Version != texture->GetContentVersion()) {
+			_Upload(texture, entry);
+		}
+		return entry.IsPacked ? &entry.Region : nullptr;
+	}
+
+	// Try to pack the texture, and cache the result either way so we don't re-attempt it every frame
+	Entry& entry = _entries[texture.get()];
+	_Release(entry);
+	entry.Source = texture;
+	entry.Region = AtlasRegion();
+	entry.IsPacked = _Pack(texture, entry);
+
+	return entry.IsPacked ? &entry.Region : nullptr;
+}
+
+bool TextureAtlas::IsPage(const Texture2D* texture) const {
+	for (const Page* page : _pages) {
+		if (page->Texture.get() == texture) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void TextureAtlas::Clear() {
+	for (Page* page : _pages) {
+		delete page;
+	}
+	_pages.clear();
+	_entries.clear();
+}
+
+void TextureAtlas::CollectGarbage() {
+	for (auto it = _entries.begin(); it != _entries.end();) {
+		if (it->second.Source.expired()) {
+			_Release(it->second);
+			it = _entries.erase(it);
+		} else {
+			it++;
+		}
+	}
+}
+
+TextureAtlas::Page* TextureAtlas::_CreatePage(MagFilter filter)
+{
+	Texture2DDescription desc = Texture2DDescription();
+	desc.Width = _pageSize;
+	desc.Height = _pageSize;
+	desc.Format = InternalFormat::RGBA8;
+	desc.MinificationFilter = filter == MagFilter::Nearest ? MinFilter::Nearest : MinFilter::Linear;
+	desc.MagnificationFilter = filter;
+	desc.HorizontalWrap = WrapMode::ClampToEdge;
+	desc.VerticalWrap = WrapMode::ClampToEdge;
+	desc.GenerateMipMaps = false;
+
+	Page* page = new Page();
+	page->Texture = std::make_shared<Texture2D>(desc);
+	page->Texture->SetDebugName("GUI Atlas Page " + std::to_string(_pages.size()));
+	page->Texture->Clear(glm::vec4(0.0f));
+	page->Filter = filter;
+	page->LiveEntries = 0;
+
+	// stb_rect_pack recommends having as many nodes as the width of the target
+	page->Nodes.resize(_pageSize);
+	stbrp_init_target(&page->Context, _pageSize, _pageSize, page->Nodes.data(), static_cast<int>(page->Nodes.size()));
+
+	_pages.push_back(page);
+	return page;
+}
+
+bool TextureAtlas::_Pack(const Texture2D::Sptr& texture, Entry& entry)
+{
+	const Texture2DDescription& desc = texture->GetDescription();
+
+	// Only small, single sampled textures are worth atlasing
+	if (desc.Width == 0 || desc.Height == 0 || 
+		desc.Width > _maxSpriteSize || desc.Height > _maxSpriteSize ||
+		desc.MultisampleCount > 1) {
+		return false;
+	}
+
+	// Repeating textures would wrap into their neighbours, and the pages have no mips to match the source's
+	if (desc.HorizontalWrap != WrapMode::ClampToEdge || desc.VerticalWrap != WrapMode::ClampToEdge ||
+		desc.GenerateMipMaps || (desc.MinificationFilter != MinFilter::Nearest && desc.MinificationFilter != MinFilter::Linear)) {
+		return false;
+	}
+
+	stbrp_rect rect;
+	rect.id = 0;
+	rect.w = desc.Width  + _padding * 2;
+	rect.h = desc.Height + _padding * 2;
+	rect.was_packed = 0;
+
+	// Find a page with the same filtering that has space for the sprite, or create a new one
+	Page* target = nullptr;
+	for (Page* page : _pages) {
+		if (page->Filter == desc.MagnificationFilter && stbrp_pack_rects(&page->Context, &rect, 1) && rect.was_packed) {
+			target = page;
+			break;
+		}
+	}
+	if (target == nullptr) {
+		target = _CreatePage(desc.MagnificationFilter);
+		if (!stbrp_pack_rects(&target->Context, &rect, 1) || !rect.was_packed) {
+			LOG_WARN("Failed to pack texture \"{}\" into a new atlas page", texture->GetDebugName());
+			return false;
+		}
+	}
+
+	entry.Owner = target;
+	entry.Rect = rect;
+	target->LiveEntries++;
+	_Upload(texture, entry);
+
+	float size = static_cast<float>(_pageSize);
+	entry.Region.Page  = target->Texture;
+	entry.Region.UvMin = glm::vec2(rect.x + _padding, rect.y + _padding) / size;
+	entry.Region.UvMax = glm::vec2(rect.x + _padding + desc.Width, rect.y + _padding + desc.Height) / size;
+
+	return true;
+}
+
+void TextureAtlas::_Upload(const Texture2D::Sptr& texture, Entry& entry)
+{
+	const Texture2DDescription& desc = texture->GetDescription();
+	const stbrp_rect& rect = entry.Rect;
+
+	// Read back the sprite's texels, we convert everything to RGBA so that all sprites can share a page
+	std::vector<glm::u8vec4> source(desc.Width * (size_t)desc.Height);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTextureImage(texture->GetHandle(), 0, GL_RGBA, GL_UNSIGNED_BYTE, static_cast<GLsizei>(source.size() * sizeof(glm::u8vec4)), source.data());
+
+	// Copy into a padded buffer, extending the edge texels into the padding so that
+	// filtering at the edge of the sprite matches clamp-to-edge sampling
+	uint32_t paddedWidth  = rect.w;
+	uint32_t paddedHeight = rect.h;
+	std::vector<glm::u8vec4> padded(paddedWidth * (size_t)paddedHeight);
+	for (uint32_t iy = 0; iy < paddedHeight; iy++) {
+		int sy = glm::clamp((int)iy - (int)_padding, 0, (int)desc.Height - 1);
+		for (uint32_t ix = 0; ix < paddedWidth; ix++) {
+			int sx = glm::clamp((int)ix - (int)_padding, 0, (int)desc.Width - 1);
+			padded[iy * paddedWidth + ix] = source[sy * desc.Width + sx];
+		}
+	}
+	entry.Owner->Texture->LoadData(paddedWidth, paddedHeight, PixelFormat::RGBA, PixelType::UByte, padded.data(), rect.x, rect.y);
+	entry.Version = texture->GetContentVersion();
+}
+
+void TextureAtlas::_Release(Entry& entry)
+{
+	if (!entry.IsPacked) {
+		return;
+	}
+	entry.IsPacked = false;
+
+	// We can't free the rectangle on it's own, but once the page is empty the whole thing can be re-used
+	Page* page = entry.Owner;
+	entry.Owner = nullptr;
+	if (page != nullptr && --page->LiveEntries == 0) {
+		stbrp_init_target(&page->Context, _pageSize, _pageSize, page->Nodes.data(), static_cast<int>(page->Nodes.size()));
+	}
+}
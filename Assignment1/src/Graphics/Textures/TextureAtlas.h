@@ -0,0 +1,117 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include <stb_rect_pack.h>
+
+#include "Graphics/Textures/Texture2D.h"
+#include "Utils/Macros.h"
+
+/// <summary>
+/// Describes where a sprite was packed within a texture atlas
+/// </summary>
+struct AtlasRegion {
+	/// <summary>
+	/// The atlas page that contains the sprite
+	/// </summary>
+	Texture2D::Sptr Page;
+	/// <summary>
+	/// The minimum UV coordinate of the sprite within the page
+	/// </summary>
+	glm::vec2       UvMin;
+	/// <summary>
+	/// The maximum UV coordinate of the sprite within the page
+	/// </summary>
+	glm::vec2       UvMax;
+
+	AtlasRegion() : Page(nullptr), UvMin(glm::vec2(0.0f)), UvMax(glm::vec2(1.0f)) {}
+};
+
+/// <summary>
+/// A texture atlas packs small textures into large shared pages at runtime using
+/// stb_rect_pack, so that geometry using different sprites can be drawn in a single batch.
+/// 
+/// Sprites are copied into the atlas the first time they are requested, and copied again
+/// when their content version changes (see ITexture::GetContentVersion). Only textures that
+/// clamp to their edges and have no mip-maps are atlased, since repeating or sampling lower
+/// mips would read from neighbouring sprites.
+///
+/// stb_rect_pack can't free single rectangles, so the space of released sprites is only
+/// reclaimed once every sprite on a page has been released
+/// </summary>
+class TextureAtlas {
+public:
+	MAKE_PTRS(TextureAtlas);
+	NO_COPY(TextureAtlas);
+	NO_MOVE(TextureAtlas);
+
+	/// <summary>
+	/// Creates a new empty texture atlas
+	/// </summary>
+	/// <param name="pageSize">The width and height of each atlas page, in pixels</param>
+	/// <param name="maxSpriteSize">The largest width or height that a sprite may have to be packed</param>
+	/// <param name="padding">The number of pixels to extend each sprite's edges by, to avoid bleeding when filtering</param>
+	TextureAtlas(uint32_t pageSize = 1024, uint32_t maxSpriteSize = 256, uint32_t padding = 2);
+	~TextureAtlas();
+
+	/// <summary>
+	/// Gets the region that a texture occupies in the atlas, packing it into a page if
+	/// it has not been seen before. Returns nullptr if the texture cannot be atlased (for
+	/// instance if it is too large, or multisampled)
+	/// </summary>
+	/// <param name="texture">The texture to look up</param>
+	/// <returns>The region the texture occupies, or nullptr if it is not in the atlas</returns>
+	const AtlasRegion* GetRegion(const Texture2D::Sptr& texture);
+
+	/// <summary>
+	/// Returns true if the given texture is one of this atlas' pages
+	/// </summary>
+	bool IsPage(const Texture2D* texture) const;
+
+	/// <summary>
+	/// Gets the number of pages that have been allocated by this atlas
+	/// </summary>
+	size_t GetPageCount() const { return _pages.size(); }
+
+	/// <summary>
+	/// Removes all sprites and pages from the atlas
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Drops the entries of textures that have been destroyed, and resets any pages that no
+	/// longer hold a live sprite. Should be called periodically, ex once per frame
+	/// </summary>
+	void CollectGarbage();
+
+protected:
+	struct Page {
+		Texture2D::Sptr        Texture;
+		stbrp_context          Context;
+		std::vector<stbrp_node> Nodes;
+		MagFilter              Filter;
+		uint32_t               LiveEntries;
+	};
+
+	struct Entry {
+		std::weak_ptr<Texture2D> Source;
+		AtlasRegion              Region;
+		// The page and padded rectangle the sprite was packed into, so it can be re-copied in place
+		Page*                    Owner = nullptr;
+		stbrp_rect               Rect;
+		// The source's content version when it was copied into the page
+		uint32_t                 Version = 0;
+		bool                     IsPacked = false;
+	};
+
+	uint32_t _pageSize;
+	uint32_t _maxSpriteSize;
+	uint32_t _padding;
+
+	std::vector<Page*> _pages;
+	std::unordered_map<const Texture2D*, Entry> _entries;
+
+	Page* _CreatePage(MagFilter filter);
+	bool _Pack(const Texture2D::Sptr& texture, Entry& entry);
+	void _Upload(const Texture2D::Sptr& texture, Entry& entry);
+	void _Release(Entry& entry);
+};
@@ -1,6 +1,8 @@
 #include "VertexArrayObject.h"
 #include "Buffers/IndexBuffer.h"
 #include "Buffers/VertexBuffer.h"
+#include "Graphics/GeometryArena.h"
+#include "Utils/Profiler.h"
 #include "Logging.h"
 
 VertexArrayObject::VertexArrayObject() :
@@ -8,7 +10,11 @@ VertexArrayObject::VertexArrayObject() :
 	_handle(0),
 	_vertexCount(0),
 	_elementCount(0),
-	_vertexBuffers(std::vector<VertexBufferBinding*>())
+	_baseVertex(0),
+	_firstIndex(0),
+	_arenaAllocation(nullptr),
+	_vertexBuffers(std::vector<VertexBufferBinding*>()),
+	_positionStream(nullptr)
 {
 	glCreateVertexArrays(1, &_handle);
 }
@@ -24,6 +30,7 @@ VertexArrayObject::~VertexArrayObject()
 void VertexArrayObject::SetIndexBuffer(const IndexBuffer::Sptr& ibo) {
 	// TODO: What if we already have a buffer? should we delete it? who owns the buffer?
 	_indexBuffer = ibo;
+	_positionStream = nullptr;
 	Bind();
 	if (_indexBuffer != nullptr) {
 		_indexBuffer->Bind();
@@ -43,10 +50,12 @@ VertexArrayObject::VertexBufferBinding* VertexArrayObject::AddVertexBuffer(const
 			_elementCount = _vertexCount;
 		}
 	} 
-	else if (buffer->GetElementCount() != _vertexCount) {
+	else if (!instanced && buffer->GetElementCount() != _vertexCount) {
 		LOG_WARN("Buffer element count does not match vertex count of this VAO!!!");
 	}
 
+	_positionStream = nullptr;
+
 	VertexBufferBinding* binding = new VertexBufferBinding();
 	binding->Buffer = buffer;
 	binding->Attributes = attributes;
@@ -83,6 +92,7 @@ void VertexArrayObject::ReplaceVertexBuffer(VertexBufferBinding* binding, const
 
 		// Update the buffer the binding is pointing to
 		binding->Buffer = buffer;
+		_positionStream = nullptr;
 
 		// Re-bind the buffer and attributes
 		Bind();
@@ -105,11 +115,13 @@ void VertexArrayObject::Draw(DrawMode mode) {
 	Bind();
 	if (_indexBuffer == nullptr) {
 		uint32_t elements = _elementCount == 0 ? _vertexBuffers[0]->Buffer->GetElementCount() : _elementCount;
-		glDrawArrays((GLenum)mode, 0, elements);
+		glDrawArrays((GLenum)mode, _baseVertex, elements);
 	} else {
 		uint32_t elements = _elementCount == 0 ? _indexBuffer->GetElementCount() : _elementCount;
-		glDrawElements((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), nullptr);
+		void* offset = (void*)(_firstIndex * GetIndexTypeSize(_indexBuffer->GetElementType()));
+		glDrawElementsBaseVertex((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), offset, _baseVertex);
 	}
+	Profiler::CountDrawCalls();
 	Unbind();
 }
 
@@ -118,16 +130,31 @@ void VertexArrayObject::DrawInstanced(uint32_t instanceCount, DrawMode mode /*=
 	Bind();
 	if (_indexBuffer == nullptr) {
 		uint32_t elements = _elementCount == 0 ? _vertexBuffers[0]->Buffer->GetElementCount() : _elementCount;
-		glDrawArraysInstanced((GLenum)mode, 0, elements, instanceCount);
+		glDrawArraysInstanced((GLenum)mode, _baseVertex, elements, instanceCount);
 	}
 	else {
 		uint32_t elements = _elementCount == 0 ? _indexBuffer->GetElementCount() : _elementCount;
-		glDrawElementsInstanced((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), nullptr, instanceCount);
+		void* offset = (void*)(_firstIndex * GetIndexTypeSize(_indexBuffer->GetElementType()));
+		glDrawElementsInstancedBaseVertex((GLenum)mode, elements, (GLenum)_indexBuffer->GetElementType(), offset, instanceCount, _baseVertex);
 	}
+	Profiler::CountDrawCalls();
 	Unbind();
 	
 }
 
+void VertexArrayObject::SetArenaAllocation(const std::shared_ptr<GeometryAllocation>& allocation) {
+	_arenaAllocation = allocation;
+	if (allocation != nullptr) {
+		_baseVertex = allocation->BaseVertex;
+		_firstIndex = allocation->FirstIndex;
+		_vertexCount = allocation->VertexCount;
+		_elementCount = _indexBuffer != nullptr ? allocation->IndexCount : allocation->VertexCount;
+	} else {
+		_baseVertex = 0;
+		_firstIndex = 0;
+	}
+}
+
 void VertexArrayObject::Bind() {
 	glBindVertexArray(_handle);
 }
@@ -163,6 +190,37 @@ VertexArrayObject::VertexBufferBinding* VertexArrayObject::GetBufferBinding(Attr
 	return nullptr;
 }
 
+VertexArrayObject::Sptr VertexArrayObject::GetPositionStream()
+{
+	if (_positionStream != nullptr) {
+		return _positionStream;
+	}
+
+	VertexArrayObject::Sptr result = Create();
+	result->SetDebugName(GetDebugName() + " - positions");
+	if (_indexBuffer != nullptr) {
+		result->SetIndexBuffer(_indexBuffer);
+	}
+
+	// Only carry over the per-vertex position attribute, everything else stays disabled
+	for (const auto& binding : _vertexBuffers) {
+		if (binding->Instanced) {
+			continue;
+		}
+		for (const BufferAttribute& attrib : binding->Attributes) {
+			if (attrib.Usage == AttribUsage::Position) {
+				result->AddVertexBuffer(binding->Buffer, { attrib }, false);
+				result->SetArenaAllocation(_arenaAllocation);
+				_positionStream = result;
+				return _positionStream;
+			}
+		}
+	}
+
+	// No positions to pull out, callers will need to draw with the full VAO
+	return nullptr;
+}
+
 VertexArrayObject::Sptr VertexArrayObject::Clone() const
 {
 	VertexArrayObject::Sptr result = Create();
@@ -177,6 +235,7 @@ VertexArrayObject::Sptr VertexArrayObject::Clone() const
 	}
 
 	result->SetVDecl(_vDecl);
+	result->SetArenaAllocation(_arenaAllocation);
 
 	return result;
 }
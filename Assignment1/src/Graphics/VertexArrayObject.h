@@ -10,6 +10,8 @@
 #include "Graphics/GlEnums.h"
 #include "Graphics/IGraphicsResource.h"
 
+struct GeometryAllocation;
+
 /// <summary>
 /// This structure will represent the parameters passed to the glVertexAttribPointer commands
 /// </summary>
@@ -86,8 +88,27 @@ public:
 	~VertexArrayObject();
 
 	uint32_t GetVertexCount() const { return _vertexCount; }
-	uint32_t GetIndexCount() const { return _indexBuffer != nullptr ? _indexBuffer->GetElementCount() : 0; }
+	uint32_t GetIndexCount() const { return _indexBuffer != nullptr ? _elementCount : 0; }
 	uint32_t GetElementCount() const { return _elementCount; }
+	/// <summary>
+	/// Gets the offset of this VAO's first vertex within it's vertex buffers, non-zero when the buffers are shared
+	/// </summary>
+	uint32_t GetBaseVertex() const { return _baseVertex; }
+	/// <summary>
+	/// Gets the offset of this VAO's first index within it's index buffer, non-zero when the buffer is shared
+	/// </summary>
+	uint32_t GetFirstIndex() const { return _firstIndex; }
+
+	/// <summary>
+	/// Restricts this VAO to the range of a geometry arena page that the allocation covers. The VAO
+	/// keeps the allocation alive, so the range is freed when the last VAO using it is destroyed.
+	/// Must be called after the buffers are attached
+	/// </summary>
+	void SetArenaAllocation(const std::shared_ptr<GeometryAllocation>& allocation);
+	/// <summary>
+	/// Gets the geometry arena range that this VAO draws from, or nullptr if it owns it's buffers
+	/// </summary>
+	const std::shared_ptr<GeometryAllocation>& GetArenaAllocation() const { return _arenaAllocation; }
 
 	/// <summary>
 	/// Creates a copy of this VAO pointing to the same buffers, with the same attributes
@@ -95,6 +116,14 @@ public:
 	/// <returns>A duplicate VAO</returns>
 	Sptr Clone() const;
 
+	/// <summary>
+	/// Gets a VAO that shares this VAO's buffers, but only enables the per-vertex position
+	/// attribute. Depth-only passes can use this so the other attributes are never fetched.
+	/// Created the first time it is requested, and rebuilt if this VAO's buffers change
+	/// </summary>
+	/// <returns>The position-only VAO, or nullptr if this VAO has no position attribute</returns>
+	Sptr GetPositionStream();
+
 	/// <summary>
 	/// Sets the index buffer for this VAO, note that for now, this will not delete the buffer when the VAO is deleted, more on that later
 	/// </summary>
@@ -164,6 +193,14 @@ protected:
 
 	uint32_t _vertexCount;
 	uint32_t _elementCount;
+	uint32_t _baseVertex;
+	uint32_t _firstIndex;
+
+	// Set if our buffers belong to a geometry arena, and we only draw part of them
+	std::shared_ptr<GeometryAllocation> _arenaAllocation;
+
+	// Lazily created by GetPositionStream
+	Sptr _positionStream;
 
 	// The underlying OpenGL handle that this class is wrapping around
 	GLuint _handle;
@@ -0,0 +1,110 @@
+#include "Utils/FrameArena.h"
+#include <algorithm>
+#include "Logging.h"
+
+FrameArena::Buffer         FrameArena::__buffers[2];
+std::atomic<uint32_t>      FrameArena::__current;
+std::atomic<uint64_t>      FrameArena::__frameIndex;
+std::atomic<uint64_t>      FrameArena::__overflows;
+size_t                     FrameArena::__lastFrameBytes;
+size_t                     FrameArena::__peakBytes;
+std::mutex                 FrameArena::__mutex;
+
+// Rounds a pointer up to the given power of 2 alignment
+static uintptr_t AlignUp(uintptr_t value, size_t alignment) {
+	return (value + (alignment - 1)) & ~static_cast<uintptr_t>(alignment - 1);
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+	Buffer& buffer = __buffers[__current.load(std::memory_order_acquire)];
+	uint8_t* data = __EnsureStorage(buffer);
+
+	// Other threads may be bumping the same buffer, so we claim our range with a CAS
+	size_t offset = buffer.Offset.load(std::memory_order_relaxed);
+	size_t start, end;
+	do {
+		start = static_cast<size_t>(AlignUp(reinterpret_cast<uintptr_t>(data) + offset, alignment) - reinterpret_cast<uintptr_t>(data));
+		end = start + size;
+		if (end > buffer.Capacity) {
+			return __AllocateOverflow(buffer, size, alignment);
+		}
+	} while (!buffer.Offset.compare_exchange_weak(offset, end, std::memory_order_relaxed));
+
+	return data + start;
+}
+
+void FrameArena::BeginFrame() {
+	std::lock_guard<std::mutex> lock(__mutex);
+
+	uint32_t previous = __current.load(std::memory_order_relaxed);
+	Buffer& finished = __buffers[previous];
+	__lastFrameBytes = std::min(finished.Offset.load(std::memory_order_relaxed), finished.Capacity) + finished.OverflowBytes;
+	__peakBytes = std::max(__peakBytes, __lastFrameBytes);
+
+	// The buffer we're switching to was last used two frames ago, so nothing can still be using it
+	Buffer& buffer = __buffers[1 - previous];
+	size_t used = std::min(buffer.Offset.load(std::memory_order_relaxed), buffer.Capacity) + buffer.OverflowBytes;
+	if (buffer.Overflow != nullptr) {
+		while (buffer.Overflow != nullptr) {
+			OverflowBlock* next = buffer.Overflow->Next;
+			::operator delete(buffer.Overflow);
+			buffer.Overflow = next;
+		}
+
+		// Grow so that a frame like that one would have fit, with some headroom for the next spike
+		size_t capacity = std::max(buffer.Capacity * 2, used + used / 2);
+		LOG_INFO("Growing frame arena buffer from {} to {} bytes", buffer.Capacity, capacity);
+		::operator delete(buffer.Data.load(std::memory_order_relaxed));
+		buffer.Data.store(static_cast<uint8_t*>(::operator new(capacity)), std::memory_order_relaxed);
+		buffer.Capacity = capacity;
+		buffer.OverflowBytes = 0;
+	}
+	buffer.Offset.store(0, std::memory_order_relaxed);
+
+	__current.store(1 - previous, std::memory_order_release);
+	__frameIndex.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t FrameArena::GetFrameIndex() {
+	return __frameIndex.load(std::memory_order_acquire);
+}
+
+FrameArena::Stats FrameArena::GetStats() {
+	std::lock_guard<std::mutex> lock(__mutex);
+	Stats result;
+	result.Capacity = std::max(__buffers[0].Capacity, __buffers[1].Capacity);
+	result.LastFrameBytes = __lastFrameBytes;
+	result.PeakBytes = __peakBytes;
+	result.Overflows = __overflows.load(std::memory_order_relaxed);
+	result.FrameIndex = __frameIndex.load(std::memory_order_relaxed);
+	return result;
+}
+
+uint8_t* FrameArena::__EnsureStorage(Buffer& buffer) {
+	uint8_t* data = buffer.Data.load(std::memory_order_acquire);
+	if (data == nullptr) {
+		std::lock_guard<std::mutex> lock(__mutex);
+		data = buffer.Data.load(std::memory_order_relaxed);
+		if (data == nullptr) {
+			data = static_cast<uint8_t*>(::operator new(DEFAULT_CAPACITY));
+			buffer.Capacity = DEFAULT_CAPACITY;
+			buffer.Data.store(data, std::memory_order_release);
+		}
+	}
+	return data;
+}
+
+void* FrameArena::__AllocateOverflow(Buffer& buffer, size_t size, size_t alignment) {
+	// Room for the header, plus enough slack to align the block within it
+	size_t blockSize = sizeof(OverflowBlock) + alignment + size;
+	OverflowBlock* block = static_cast<OverflowBlock*>(::operator new(blockSize));
+
+	std::lock_guard<std::mutex> lock(__mutex);
+	block->Size = size;
+	block->Next = buffer.Overflow;
+	buffer.Overflow = block;
+	buffer.OverflowBytes += size;
+	__overflows.fetch_add(1, std::memory_order_relaxed);
+
+	return reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(block + 1), alignment));
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+/// <summary>
+/// A double-buffered bump allocator for data that only lives for a frame. Allocations are a pointer
+/// bump out of the current buffer, and frees do nothing. Application::_Run calls BeginFrame at the
+/// start of each frame, which swaps to the other buffer and resets it, so anything allocated during
+/// a frame stays valid until the end of the next one
+///
+/// Allocating is safe from any thread. If a buffer runs out, the allocation falls back to the heap
+/// and the buffer is grown the next time it is reset, so steady state frames never touch the heap
+/// </summary>
+class FrameArena {
+public:
+	FrameArena() = delete;
+
+	// The starting size of each of the two buffers, in bytes
+	static const size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+	/// <summary>
+	/// Describes how much of the arena is being used
+	/// </summary>
+	struct Stats {
+		// The size of a single buffer in bytes
+		size_t   Capacity;
+		// The bytes allocated during the last full frame, including any overflow
+		size_t   LastFrameBytes;
+		// The most bytes allocated in a single frame
+		size_t   PeakBytes;
+		// The number of allocations that did not fit in a buffer and went to the heap
+		uint64_t Overflows;
+		// The number of frames that have been started
+		uint64_t FrameIndex;
+	};
+
+	/// <summary>
+	/// Allocates a block from the current frame's buffer, never returns nullptr
+	/// </summary>
+	/// <param name="size">The size of the block in bytes</param>
+	/// <param name="alignment">The alignment of the block, must be a power of 2</param>
+	static void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	/// <summary>
+	/// Does nothing, memory is reclaimed when the buffer is reset. Exists so the allocator adapters
+	/// read like any other allocator
+	/// </summary>
+	static void Deallocate(void* ptr, size_t size) noexcept { (void)ptr; (void)size; }
+
+	/// <summary>
+	/// Swaps to the other buffer and resets it, any memory allocated two frames ago is invalidated
+	/// </summary>
+	static void BeginFrame();
+
+	/// <summary>
+	/// Gets the number of times BeginFrame has been called
+	/// </summary>
+	static uint64_t GetFrameIndex();
+
+	/// <summary>
+	/// Gets a snapshot of the arena's usage
+	/// </summary>
+	static Stats GetStats();
+
+	/// <summary>
+	/// Replaces values that outlive a single call but keep their storage in the arena with fresh default
+	/// constructed ones, at most once per frame. If the values' storage was from the last frame, it is still
+	/// valid and they are destroyed normally. Anything older has already been reset, so it is abandoned
+	/// without running it's destructor
+	/// </summary>
+	/// <param name="frame">The frame the values were last renewed in, updated by this call</param>
+	/// <param name="values">The values to renew</param>
+	/// <returns>True if the values were replaced</returns>
+	template <typename... T>
+	static bool Renew(uint64_t& frame, T&... values) {
+		uint64_t current = GetFrameIndex();
+		if (frame == current) {
+			return false;
+		}
+		bool isValid = frame + 1 == current;
+		(__Replace(values, isValid), ...);
+		frame = current;
+		return true;
+	}
+
+private:
+	// Heap blocks for allocations that did not fit, freed when their buffer is reset
+	struct OverflowBlock {
+		OverflowBlock* Next;
+		size_t         Size;
+	};
+
+	// Everything in here is trivially constructible, so the arena can be used during static initialization.
+	// The buffers are never freed, since containers in other statics may still point into them at exit
+	struct Buffer {
+		std::atomic<uint8_t*> Data;
+		std::atomic<size_t>   Offset;
+		size_t                Capacity;
+		OverflowBlock*        Overflow;
+		size_t                OverflowBytes;
+	};
+
+	static Buffer                __buffers[2];
+	static std::atomic<uint32_t> __current;
+	static std::atomic<uint64_t> __frameIndex;
+	static std::atomic<uint64_t> __overflows;
+	static size_t                __lastFrameBytes;
+	static size_t                __peakBytes;
+	static std::mutex            __mutex;
+
+	static uint8_t* __EnsureStorage(Buffer& buffer);
+	static void* __AllocateOverflow(Buffer& buffer, size_t size, size_t alignment);
+
+	template <typename T>
+	static void __Replace(T& value, bool isValid) {
+		if (isValid) {
+			value = T();
+		} else {
+			new (&value) T();
+		}
+	}
+};
+
+/// <summary>
+/// STL allocator adapter that allocates from the FrameArena. All instances are interchangeable
+/// </summary>
+template <typename T>
+class FrameAllocator {
+public:
+	typedef T value_type;
+
+	FrameAllocator() noexcept = default;
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>&) noexcept {}
+
+	T* allocate(size_t count) {
+		return static_cast<T*>(FrameArena::Allocate(count * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* ptr, size_t count) noexcept {
+		FrameArena::Deallocate(ptr, count * sizeof(T));
+	}
+
+	template <typename U>
+	bool operator ==(const FrameAllocator<U>&) const noexcept { return true; }
+	template <typename U>
+	bool operator !=(const FrameAllocator<U>&) const noexcept { return false; }
+};
+
+// Containers for transient, per-frame data. Don't keep these around for more than a frame, see FrameArena::Renew
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+template <typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<T>>
+using FrameUnorderedSet = std::unordered_set<T, Hash, Equal, FrameAllocator<T>>;
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+using FrameUnorderedMap = std::unordered_map<Key, Value, Hash, Equal, FrameAllocator<std::pair<const Key, Value>>>;
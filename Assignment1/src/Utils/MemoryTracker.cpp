@@ -0,0 +1,192 @@
+#include "Utils/MemoryTracker.h"
+#include <cstdlib>
+#include <new>
+#include "Logging.h"
+
+// Every allocation is prefixed with this much space, so the pointer we hand back keeps the alignment operator new promises
+#ifdef __STDCPP_DEFAULT_NEW_ALIGNMENT__
+static constexpr size_t HEADER_SIZE = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+#else
+static constexpr size_t HEADER_SIZE = 16;
+#endif
+
+struct AllocationHeader {
+	size_t    Size;
+	MemoryTag Tag;
+};
+static_assert(sizeof(AllocationHeader) <= HEADER_SIZE, "Allocation header does not fit in the reserved space");
+
+MemoryTracker::TagCounters MemoryTracker::__counters[MemoryTracker::TAG_COUNT];
+thread_local MemoryTag     MemoryTracker::__currentTag = MemoryTag::General;
+thread_local uint64_t      MemoryTracker::__threadAllocations = 0;
+
+MemoryTracker::Scope::Scope(MemoryTag tag) :
+	_previous(MemoryTracker::__currentTag)
+{
+	MemoryTracker::__currentTag = tag;
+}
+
+MemoryTracker::Scope::~Scope() {
+	MemoryTracker::__currentTag = _previous;
+}
+
+bool MemoryTracker::IsEnabled() {
+	#ifdef DISABLE_MEMORY_TRACKING
+	return false;
+	#else
+	return true;
+	#endif
+}
+
+MemoryTracker::TagStats MemoryTracker::GetStats(MemoryTag tag) {
+	const TagCounters& counters = __counters[static_cast<size_t>(tag)];
+	TagStats result;
+	result.CurrentBytes = counters.Bytes.load(std::memory_order_relaxed);
+	result.PeakBytes = counters.Peak.load(std::memory_order_relaxed);
+	result.LiveAllocations = counters.Live.load(std::memory_order_relaxed);
+	result.TotalAllocations = counters.Total.load(std::memory_order_relaxed);
+	result.FrameAllocations = counters.FrameAllocations;
+	result.BudgetBytes = counters.Budget;
+	return result;
+}
+
+MemoryTracker::TagStats MemoryTracker::GetTotalStats() {
+	TagStats result = { 0, 0, 0, 0, 0, 0 };
+	for (size_t ix = 0; ix < TAG_COUNT; ix++) {
+		TagStats stats = GetStats(static_cast<MemoryTag>(ix));
+		result.CurrentBytes += stats.CurrentBytes;
+		// Tags don't all peak at the same time, so this is an upper bound
+		result.PeakBytes += stats.PeakBytes;
+		result.LiveAllocations += stats.LiveAllocations;
+		result.TotalAllocations += stats.TotalAllocations;
+		result.FrameAllocations += stats.FrameAllocations;
+		result.BudgetBytes += stats.BudgetBytes;
+	}
+	return result;
+}
+
+void MemoryTracker::SetBudget(MemoryTag tag, int64_t bytes) {
+	TagCounters& counters = __counters[static_cast<size_t>(tag)];
+	counters.Budget = bytes < 0 ? 0 : bytes;
+	counters.OverBudget = false;
+}
+
+void MemoryTracker::ResetPeaks() {
+	for (TagCounters& counters : __counters) {
+		counters.Peak.store(counters.Bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+}
+
+uint64_t MemoryTracker::GetThreadAllocationCount() {
+	return __threadAllocations;
+}
+
+void MemoryTracker::EndFrame() {
+	for (size_t ix = 0; ix < TAG_COUNT; ix++) {
+		TagCounters& counters = __counters[ix];
+		uint64_t total = counters.Total.load(std::memory_order_relaxed);
+		counters.FrameAllocations = total - counters.TotalAtFrameStart;
+		counters.TotalAtFrameStart = total;
+
+		// Only warn when we cross the line, not every frame we stay over it
+		if (counters.Budget > 0) {
+			int64_t bytes = counters.Bytes.load(std::memory_order_relaxed);
+			bool overBudget = bytes > counters.Budget;
+			if (overBudget && !counters.OverBudget) {
+				LOG_WARN("{} memory is over budget ({} / {} bytes)", ~static_cast<MemoryTag>(ix), bytes, counters.Budget);
+			}
+			counters.OverBudget = overBudget;
+		}
+	}
+}
+
+void* MemoryTracker::__Allocate(size_t size) {
+	void* block = std::malloc(size + HEADER_SIZE);
+	if (block == nullptr) {
+		return nullptr;
+	}
+
+	AllocationHeader* header = static_cast<AllocationHeader*>(block);
+	header->Size = size;
+	header->Tag = __currentTag;
+
+	TagCounters& counters = __counters[static_cast<size_t>(header->Tag)];
+	int64_t bytes = counters.Bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) + static_cast<int64_t>(size);
+	counters.Live.fetch_add(1, std::memory_order_relaxed);
+	counters.Total.fetch_add(1, std::memory_order_relaxed);
+
+	int64_t peak = counters.Peak.load(std::memory_order_relaxed);
+	while (bytes > peak && !counters.Peak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+
+	__threadAllocations++;
+
+	return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void MemoryTracker::__Free(void* ptr) {
+	if (ptr == nullptr) {
+		return;
+	}
+
+	AllocationHeader* header = reinterpret_cast<AllocationHeader*>(static_cast<char*>(ptr) - HEADER_SIZE);
+	TagCounters& counters = __counters[static_cast<size_t>(header->Tag)];
+	counters.Bytes.fetch_sub(static_cast<int64_t>(header->Size), std::memory_order_relaxed);
+	counters.Live.fetch_sub(1, std::memory_order_relaxed);
+
+	std::free(header);
+}
+
+#ifndef DISABLE_MEMORY_TRACKING
+
+// Replacing these in one translation unit replaces them for the whole program. The aligned overloads are left
+// alone, they pair with their own deletes so anything allocated through them just isn't counted
+
+void* operator new(size_t size) {
+	void* result = MemoryTracker::__Allocate(size);
+	if (result == nullptr) {
+		throw std::bad_alloc();
+	}
+	return result;
+}
+
+void* operator new[](size_t size) {
+	void* result = MemoryTracker::__Allocate(size);
+	if (result == nullptr) {
+		throw std::bad_alloc();
+	}
+	return result;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return MemoryTracker::__Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return MemoryTracker::__Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+	MemoryTracker::__Free(ptr);
+}
+
+#endif
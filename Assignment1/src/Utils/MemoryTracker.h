@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <EnumToString.h>
+
+#include "Utils/Macros.h"
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+
+// Tags every allocation made on this thread for the rest of the enclosing scope, the innermost scope wins
+#define MEMORY_SCOPE(tag) MemoryTracker::Scope MEMORY_CONCAT(__memoryScope, __LINE__)(MemoryTag::tag)
+
+// The subsystems that allocations are counted against
+ENUM(MemoryTag, uint8_t,
+	General   = 0,
+	Scene     = 1,
+	Render    = 2,
+	GUI       = 3,
+	Physics   = 4,
+	Resources = 5
+);
+
+/// <summary>
+/// Counts heap allocations made through operator new/delete, grouped by the MemoryTag that was active on the
+/// allocating thread. Each allocation carries a small header with it's size and tag, so frees are counted
+/// against the same tag even if they happen somewhere else
+///
+/// The global new/delete replacements live in MemoryTracker.cpp, and can be compiled out by defining
+/// DISABLE_MEMORY_TRACKING, in which case all stats read as zero
+/// </summary>
+class MemoryTracker {
+public:
+	MemoryTracker() = delete;
+
+	static const size_t TAG_COUNT = 6;
+
+	/// <summary>
+	/// RAII helper that sets the calling thread's tag until it goes out of scope, see MEMORY_SCOPE
+	/// </summary>
+	class Scope {
+	public:
+		NO_COPY(Scope);
+		NO_MOVE(Scope);
+		Scope(MemoryTag tag);
+		~Scope();
+	private:
+		MemoryTag _previous;
+	};
+
+	/// <summary>
+	/// A snapshot of the counters for a single tag
+	/// </summary>
+	struct TagStats {
+		// Bytes currently allocated
+		int64_t  CurrentBytes;
+		// The most bytes that have been allocated at once, since the last ResetPeaks
+		int64_t  PeakBytes;
+		// The number of allocations that have not been freed
+		int64_t  LiveAllocations;
+		// The number of allocations made since startup
+		uint64_t TotalAllocations;
+		// The number of allocations made during the last full frame
+		uint64_t FrameAllocations;
+		// The budget for this tag in bytes, or 0 for no budget
+		int64_t  BudgetBytes;
+	};
+
+	/// <summary>
+	/// Returns true if allocation tracking was compiled in
+	/// </summary>
+	static bool IsEnabled();
+
+	/// <summary>
+	/// Gets the counters for the given tag
+	/// </summary>
+	static TagStats GetStats(MemoryTag tag);
+	/// <summary>
+	/// Gets the counters for all tags added together, the budget is the sum of all budgets
+	/// </summary>
+	static TagStats GetTotalStats();
+
+	/// <summary>
+	/// Sets the number of bytes the given tag is expected to stay under, a warning is logged the first
+	/// time it goes over. Use 0 to remove the budget
+	/// </summary>
+	static void SetBudget(MemoryTag tag, int64_t bytes);
+
+	/// <summary>
+	/// Resets every tag's high water mark to it's current usage
+	/// </summary>
+	static void ResetPeaks();
+
+	/// <summary>
+	/// Gets the number of allocations the calling thread has made since startup, used by the profiler to count
+	/// allocations per zone
+	/// </summary>
+	static uint64_t GetThreadAllocationCount();
+
+	/// <summary>
+	/// Latches the per-frame allocation counts and checks budgets, should be called once at the end of each frame
+	/// </summary>
+	static void EndFrame();
+
+protected:
+	struct TagCounters {
+		std::atomic<int64_t>  Bytes;
+		std::atomic<int64_t>  Peak;
+		std::atomic<int64_t>  Live;
+		std::atomic<uint64_t> Total;
+		// These are only touched by the main thread in EndFrame
+		uint64_t              TotalAtFrameStart;
+		uint64_t              FrameAllocations;
+		int64_t               Budget;
+		bool                  OverBudget;
+	};
+
+	static TagCounters __counters[TAG_COUNT];
+	static thread_local MemoryTag __currentTag;
+	static thread_local uint64_t  __threadAllocations;
+
+public:
+	// Called by the global new/delete replacements, not meant to be used directly
+	static void* __Allocate(size_t size);
+	static void __Free(void* ptr);
+};
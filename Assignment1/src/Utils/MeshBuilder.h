@@ -1,19 +1,25 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include "Graphics/VertexArrayObject.h"
+#include "Graphics/GeometryArena.h"
 
 /// <summary>
 /// A utility class that lets us add vertices and indices, then bake it into a final mesh, using interleaved
 /// vertex buffers
 /// </summary>
 /// <typeparam name="VertType">The type of vertex that this mesh is using</typeparam>
-template <typename VertType>
+/// <typeparam name="Allocator">The allocator for the vertex and index storage, ex FrameAllocator for meshes that are rebuilt every frame</typeparam>
+template <typename VertType, typename Allocator = std::allocator<VertType>>
 class MeshBuilder
 {
 public:
+	typedef std::vector<VertType, Allocator> VertexList;
+	typedef std::vector<uint32_t, typename std::allocator_traits<Allocator>::template rebind_alloc<uint32_t>> IndexList;
+
 	MeshBuilder() :
-		_vertices(std::vector<VertType>()),
-		_indices(std::vector<uint32_t>()) {}
+		_vertices(VertexList()),
+		_indices(IndexList()) {}
 	~MeshBuilder() = default;
 
 	/// <summary>
@@ -117,10 +123,25 @@ public:
 	size_t GetTriangleCount() const { return _indices.size() > 0 ? _indices.size() / 3 : _vertices.size() / 3; }
 
 	/// <summary>
-	/// Creates and returns a VertexArraybject from the current data
+	/// Creates and returns a VertexArraybject from the current data. The data is placed in the
+	/// geometry arena for our vertex type, so meshes baked this way can be batched together
 	/// </summary>
 	/// <returns>A VertexArrayObject</returns>
 	VertexArrayObject::Sptr Bake() {
+		if (_vertices.size() > 0) {
+			return GeometryArena::Get<VertType>()->Upload(
+				GetVertexDataPtr(), static_cast<uint32_t>(_vertices.size()),
+				_indices.size() > 0 ? GetIndexDataPtr() : nullptr, static_cast<uint32_t>(_indices.size())
+			);
+		}
+		return BakeStandalone();
+	}
+
+	/// <summary>
+	/// Creates and returns a VertexArraybject from the current data, with it's own vertex and index buffers
+	/// </summary>
+	/// <returns>A VertexArrayObject</returns>
+	VertexArrayObject::Sptr BakeStandalone() {
 		VertexBuffer::Sptr vbo = VertexBuffer::Create();
 		vbo->LoadData(GetVertexDataPtr(), _vertices.size());
 
@@ -167,6 +188,6 @@ public:
 protected:
 	friend class MeshFactory;
 	
-	std::vector<VertType> _vertices;
-	std::vector<uint32_t> _indices;
+	VertexList _vertices;
+	IndexList  _indices;
 };
@@ -9,6 +9,7 @@
 #include <filesystem>
 
 #include "Utils/StringUtils.h"
+#include "Graphics/GeometryArena.h"
 #include "GLFW/glfw3.h"
 #include "Logging.h"
 
@@ -280,39 +281,41 @@ VertexArrayObject::Sptr OptimizedObjLoader::_LoadFromBinFile(const std::string&
 			file.read(reinterpret_cast<char*>(&vertexDeclaration[ix]), sizeof(BufferAttribute));
 		}
 
-		// These will have the buffer pointers
-		IndexBuffer::Sptr indices = nullptr;
-		VertexBuffer::Sptr vertices = nullptr;
-
-		// If we have index data, load it
-		if (header.NumIndices > 0) {
-			// Create index buffer
-			indices = IndexBuffer::Create(BufferUsage::StaticDraw);
-
-			// Create memory to store indices, then read from the file
-			void* dataStore = malloc(header.NumIndices * GetIndexTypeSize(header.IndicesType));
-			file.read(reinterpret_cast<char*>(dataStore), header.NumIndices * GetIndexTypeSize(header.IndicesType));
-			
-			// Load data into OpenGL and free the CPU memory we allocated
-			indices->LoadData(dataStore, GetIndexTypeSize(header.IndicesType), header.NumIndices, header.IndicesType);
-			free(dataStore);
+		// Read our index and vertex data into CPU memory
+		size_t indexBytes = header.NumIndices * GetIndexTypeSize(header.IndicesType);
+		void* dataStore = header.NumIndices > 0 ? malloc(indexBytes) : nullptr;
+		if (dataStore != nullptr) {
+			file.read(reinterpret_cast<char*>(dataStore), indexBytes);
 		}
-
-		// Create a new VBO
-		vertices = VertexBuffer::Create(BufferUsage::StaticDraw);
-
-		// Create memory to store vertices and load from file
 		void* vertexStore = malloc(header.NumVertices * (size_t)header.VertexStride);
 		file.read(reinterpret_cast<char*>(vertexStore), header.NumVertices * (size_t)header.VertexStride);
 
-		// Load data into OpenGL and free the CPU copy
-		vertices->LoadData(vertexStore, header.VertexStride, header.NumVertices);
-		free(vertexStore);
+		VertexArrayObject::Sptr result = nullptr;
+
+		// The geometry arena only stores 32 bit indices, anything else gets buffers of it's own
+		if (header.NumVertices > 0 && (header.NumIndices == 0 || header.IndicesType == IndexType::UInt)) {
+			result = GeometryArena::Get(vertexDeclaration, header.VertexStride)->Upload(
+				vertexStore, header.NumVertices, reinterpret_cast<const uint32_t*>(dataStore), header.NumIndices
+			);
+		} else {
+			IndexBuffer::Sptr indices = nullptr;
+			if (dataStore != nullptr) {
+				indices = IndexBuffer::Create(BufferUsage::StaticDraw);
+				indices->LoadData(dataStore, GetIndexTypeSize(header.IndicesType), header.NumIndices, header.IndicesType);
+			}
 
-		// Create the VAO and attach our index and vertex buffers
-		VertexArrayObject::Sptr result = VertexArrayObject::Create();
-		result->SetIndexBuffer(indices);
-		result->AddVertexBuffer(vertices, vertexDeclaration);
+			VertexBuffer::Sptr vertices = VertexBuffer::Create(BufferUsage::StaticDraw);
+			vertices->LoadData(vertexStore, header.VertexStride, header.NumVertices);
+
+			// Create the VAO and attach our index and vertex buffers
+			result = VertexArrayObject::Create();
+			result->SetIndexBuffer(indices);
+			result->AddVertexBuffer(vertices, vertexDeclaration);
+		}
+
+		// Free the CPU copies now that OpenGL has them
+		free(dataStore);
+		free(vertexStore);
 
 		// Copy in the vertex declaration we loaded
 		result->SetVDecl(vertexDeclaration);
@@ -0,0 +1,365 @@
+#include "Utils/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <json.hpp>
+#include "Utils/FileHelpers.h"
+#include "Utils/MemoryTracker.h"
+#include "Logging.h"
+
+std::atomic<bool>     Profiler::__enabled(true);
+bool                  Profiler::__paused = false;
+bool                  Profiler::__waitForGpu = false;
+uint64_t              Profiler::__frameIndex = 0;
+int64_t               Profiler::__frameStart = 0;
+std::atomic<uint64_t> Profiler::__droppedEvents(0);
+
+std::mutex                                           Profiler::__threadsMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::__threads;
+thread_local Profiler::ThreadBuffer*                 Profiler::__threadBuffer = nullptr;
+thread_local uint64_t                                Profiler::__drawCalls = 0;
+uint64_t                                             Profiler::__frameDrawCalls = 0;
+uint64_t                                             Profiler::__frameAllocations = 0;
+
+Profiler::GpuFrame  Profiler::__gpuFrames[Profiler::GPU_FRAME_LATENCY];
+Profiler::GpuFrame* Profiler::__currentGpuFrame = nullptr;
+uint32_t            Profiler::__gpuDepth = 0;
+
+std::deque<Profiler::FrameCapture> Profiler::__frames;
+
+Profiler::CpuZone::CpuZone(const char* name) :
+	_name(name),
+	_start(0),
+	_drawCalls(0),
+	_allocations(0),
+	_active(Profiler::IsEnabled())
+{
+	if (_active) {
+		Profiler::__GetThreadBuffer()->Depth++;
+		_drawCalls = Profiler::__drawCalls;
+		_allocations = MemoryTracker::GetThreadAllocationCount();
+		_start = Profiler::Now();
+	}
+}
+
+Profiler::CpuZone::~CpuZone() {
+	if (_active) {
+		int64_t end = Profiler::Now();
+		ThreadBuffer* buffer = Profiler::__GetThreadBuffer();
+		buffer->Depth--;
+		uint32_t drawCalls = static_cast<uint32_t>(Profiler::__drawCalls - _drawCalls);
+		uint32_t allocations = static_cast<uint32_t>(MemoryTracker::GetThreadAllocationCount() - _allocations);
+		Profiler::__Record(buffer, { _name, _start, end, buffer->ThreadId, buffer->Depth, drawCalls, allocations });
+	}
+}
+
+Profiler::GpuZone::GpuZone(const char* name) :
+	_zone(Profiler::__BeginGpuZone(name))
+{ }
+
+Profiler::GpuZone::~GpuZone() {
+	Profiler::__EndGpuZone(_zone);
+}
+
+void Profiler::SetEnabled(bool value) {
+	__enabled.store(value, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled() {
+	return __enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetPaused(bool value) {
+	__paused = value;
+}
+
+bool Profiler::IsPaused() {
+	return __paused;
+}
+
+void Profiler::SetWaitForGpu(bool value) {
+	__waitForGpu = value;
+}
+
+bool Profiler::IsWaitingForGpu() {
+	return __waitForGpu;
+}
+
+void Profiler::CountDrawCalls(uint32_t count) {
+	__drawCalls += count;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ThreadBuffer* buffer = __GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(__threadsMutex);
+	buffer->Name = name;
+}
+
+int64_t Profiler::Now() {
+	// Relative to the first call, so our timestamps stay small enough to survive the trip through a double
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::BeginFrame() {
+	__frameStart = Now();
+	__frameDrawCalls = __drawCalls;
+	__frameAllocations = MemoryTracker::GetThreadAllocationCount();
+	__currentGpuFrame = nullptr;
+	__gpuDepth = 0;
+
+	if (!IsEnabled()) {
+		return;
+	}
+
+	// This slot was last used GPU_FRAME_LATENCY frames ago, if the GPU still hasn't finished it we'd
+	// rather lose it than wait
+	GpuFrame& gpuFrame = __gpuFrames[__frameIndex % GPU_FRAME_LATENCY];
+	if (gpuFrame.Pending && __waitForGpu) {
+		PROFILE_SCOPE("Wait For GPU");
+		// Asking for the result blocks until the GPU gets there, after that the rest of the frame's queries are ready too
+		GLuint64 result = 0;
+		glGetQueryObjectui64v(gpuFrame.Queries[gpuFrame.LastQuery], GL_QUERY_RESULT, &result);
+	}
+	if (gpuFrame.Pending && !__ResolveGpuFrame(gpuFrame)) {
+		LOG_TRACE("Dropping GPU timings for frame {}, the queries were not ready", gpuFrame.FrameIndex);
+		gpuFrame.Pending = false;
+	}
+
+	// Reading the GPU's clock right now lets us line the query results up with our CPU timeline
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	gpuFrame.GpuToCpuOffset = Now() - gpuNow;
+
+	gpuFrame.FrameIndex = __frameIndex;
+	gpuFrame.QueriesUsed = 0;
+	gpuFrame.LastQuery = 0;
+	gpuFrame.Zones.clear();
+	__currentGpuFrame = &gpuFrame;
+}
+
+void Profiler::EndFrame() {
+	int64_t frameEnd = Now();
+
+	FrameCapture capture;
+	capture.Index = __frameIndex;
+	capture.StartNs = __frameStart;
+	capture.EndNs = frameEnd;
+	capture.GpuResolved = false;
+	capture.DrawCalls = static_cast<uint32_t>(__drawCalls - __frameDrawCalls);
+	capture.Allocations = static_cast<uint32_t>(MemoryTracker::GetThreadAllocationCount() - __frameAllocations);
+
+	// Drain every thread's ring, threads may keep writing while we read since we only consume
+	// up to what they had published when we looked
+	{
+		std::lock_guard<std::mutex> lock(__threadsMutex);
+		for (const auto& buffer : __threads) {
+			uint64_t read = buffer->Read.load(std::memory_order_relaxed);
+			uint64_t written = buffer->Written.load(std::memory_order_acquire);
+			for (; read < written; read++) {
+				capture.CpuEvents.push_back(buffer->Events[read % ThreadBuffer::CAPACITY]);
+			}
+			buffer->Read.store(read, std::memory_order_release);
+		}
+	}
+
+	if (__currentGpuFrame != nullptr) {
+		__currentGpuFrame->Pending = !__currentGpuFrame->Zones.empty();
+		__currentGpuFrame = nullptr;
+	}
+
+	if (!__paused && IsEnabled()) {
+		__frames.push_back(std::move(capture));
+		while (__frames.size() > HISTORY_SIZE) {
+			__frames.pop_front();
+		}
+	}
+
+	// Pick up any older frames whose queries have finished, without blocking on the ones that haven't
+	for (GpuFrame& gpuFrame : __gpuFrames) {
+		if (gpuFrame.Pending) {
+			__ResolveGpuFrame(gpuFrame);
+		}
+	}
+
+	__frameIndex++;
+}
+
+uint64_t Profiler::GetFrameIndex() {
+	return __frameIndex;
+}
+
+const std::deque<Profiler::FrameCapture>& Profiler::GetFrames() {
+	return __frames;
+}
+
+std::string Profiler::GetThreadName(uint32_t threadId) {
+	if (threadId == GPU_THREAD_ID) {
+		return "GPU";
+	}
+	std::lock_guard<std::mutex> lock(__threadsMutex);
+	if (threadId < __threads.size() && !__threads[threadId]->Name.empty()) {
+		return __threads[threadId]->Name;
+	}
+	return "Thread " + std::to_string(threadId);
+}
+
+uint64_t Profiler::GetDroppedEvents() {
+	return __droppedEvents.load(std::memory_order_relaxed);
+}
+
+void Profiler::Cleanup() {
+	for (GpuFrame& gpuFrame : __gpuFrames) {
+		if (!gpuFrame.Queries.empty()) {
+			glDeleteQueries(static_cast<GLsizei>(gpuFrame.Queries.size()), gpuFrame.Queries.data());
+		}
+		gpuFrame.Queries.clear();
+		gpuFrame.Zones.clear();
+		gpuFrame.QueriesUsed = 0;
+		gpuFrame.Pending = false;
+	}
+	__currentGpuFrame = nullptr;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) {
+	using namespace nlohmann;
+
+	json events = json::array();
+
+	// Metadata so the viewer shows readable names instead of IDs
+	events.push_back({ { "name", "process_name" }, { "ph", "M" }, { "pid", 0 }, { "args", { { "name", "CPU" } } } });
+	events.push_back({ { "name", "process_name" }, { "ph", "M" }, { "pid", 1 }, { "args", { { "name", "GPU" } } } });
+	{
+		std::lock_guard<std::mutex> lock(__threadsMutex);
+		for (const auto& buffer : __threads) {
+			std::string name = buffer->Name.empty() ? "Thread " + std::to_string(buffer->ThreadId) : buffer->Name;
+			events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 0 }, { "tid", buffer->ThreadId }, { "args", { { "name", name } } } });
+		}
+	}
+
+	// Trace event times are in microseconds
+	auto addEvent = [&](const Event& event, int pid, uint32_t tid) {
+		events.push_back({
+			{ "name", event.Name },
+			{ "ph",   "X" },
+			{ "ts",   event.StartNs / 1000.0 },
+			{ "dur",  (event.EndNs - event.StartNs) / 1000.0 },
+			{ "pid",  pid },
+			{ "tid",  tid },
+			{ "args", { { "draw_calls", event.DrawCalls }, { "allocations", event.Allocations } } }
+		});
+	};
+	for (const FrameCapture& frame : __frames) {
+		for (const Event& event : frame.CpuEvents) {
+			addEvent(event, 0, event.ThreadId);
+		}
+		for (const Event& event : frame.GpuEvents) {
+			addEvent(event, 1, 0);
+		}
+	}
+
+	json result = {
+		{ "traceEvents", events },
+		{ "displayTimeUnit", "ms" }
+	};
+
+	try {
+		FileHelpers::WriteContentsToFile(path, result.dump());
+	} catch (const std::exception& e) {
+		LOG_ERROR("Failed to write trace to \"{}\": {}", path, e.what());
+		return false;
+	}
+	LOG_INFO("Wrote {} frames of profiler data to \"{}\"", __frames.size(), path);
+	return true;
+}
+
+Profiler::ThreadBuffer* Profiler::__GetThreadBuffer() {
+	if (__threadBuffer == nullptr) {
+		// Only taken once per thread, the buffer is never freed so the main thread can always drain it
+		std::lock_guard<std::mutex> lock(__threadsMutex);
+		std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+		buffer->ThreadId = static_cast<uint32_t>(__threads.size());
+		buffer->Depth = 0;
+		buffer->Written.store(0);
+		buffer->Read.store(0);
+		__threadBuffer = buffer.get();
+		__threads.push_back(std::move(buffer));
+	}
+	return __threadBuffer;
+}
+
+void Profiler::__Record(ThreadBuffer* buffer, const Event& event) {
+	uint64_t written = buffer->Written.load(std::memory_order_relaxed);
+	uint64_t read = buffer->Read.load(std::memory_order_acquire);
+
+	// Overwriting events the main thread hasn't read yet would corrupt them, so we drop new ones instead
+	if (written - read >= ThreadBuffer::CAPACITY) {
+		__droppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer->Events[written % ThreadBuffer::CAPACITY] = event;
+	buffer->Written.store(written + 1, std::memory_order_release);
+}
+
+int32_t Profiler::__BeginGpuZone(const char* name) {
+	if (__currentGpuFrame == nullptr) {
+		return -1;
+	}
+
+	PendingGpuZone zone;
+	zone.Name = name;
+	zone.StartQuery = __AllocateQuery(*__currentGpuFrame);
+	zone.EndQuery = __AllocateQuery(*__currentGpuFrame);
+	zone.Depth = __gpuDepth++;
+
+	// Timestamps nest, unlike GL_TIME_ELAPSED where only one query can be active at a time
+	glQueryCounter(__currentGpuFrame->Queries[zone.StartQuery], GL_TIMESTAMP);
+	__currentGpuFrame->Zones.push_back(zone);
+	return static_cast<int32_t>(__currentGpuFrame->Zones.size() - 1);
+}
+
+void Profiler::__EndGpuZone(int32_t zone) {
+	if (zone < 0 || __currentGpuFrame == nullptr) {
+		return;
+	}
+	__gpuDepth--;
+	__currentGpuFrame->LastQuery = __currentGpuFrame->Zones[zone].EndQuery;
+	glQueryCounter(__currentGpuFrame->Queries[__currentGpuFrame->LastQuery], GL_TIMESTAMP);
+}
+
+GLuint Profiler::__AllocateQuery(GpuFrame& frame) {
+	// Queries are kept around between frames, we only grow the pool when a frame needs more than before
+	if (frame.QueriesUsed == frame.Queries.size()) {
+		GLuint query = 0;
+		glCreateQueries(GL_TIMESTAMP, 1, &query);
+		frame.Queries.push_back(query);
+	}
+	return frame.QueriesUsed++;
+}
+
+bool Profiler::__ResolveGpuFrame(GpuFrame& frame) {
+	// Queries complete in the order they were issued, so if the last one is done they all are
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(frame.Queries[frame.LastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE) {
+		return false;
+	}
+	frame.Pending = false;
+
+	// The frame may have already fallen out of the history, or been skipped while paused
+	auto it = std::find_if(__frames.begin(), __frames.end(), [&](const FrameCapture& capture) {
+		return capture.Index == frame.FrameIndex;
+	});
+	if (it == __frames.end()) {
+		return true;
+	}
+
+	for (const PendingGpuZone& zone : frame.Zones) {
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(frame.Queries[zone.StartQuery], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.Queries[zone.EndQuery], GL_QUERY_RESULT, &end);
+		it->GpuEvents.push_back({ zone.Name, (int64_t)start + frame.GpuToCpuOffset, (int64_t)end + frame.GpuToCpuOffset, GPU_THREAD_ID, zone.Depth, 0, 0 });
+	}
+	it->GpuResolved = true;
+	return true;
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "Utils/Macros.h"
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope on the CPU. The name is stored by pointer, so it must
+// outlive the capture (string literals, or names owned by long lived objects like layers)
+#define PROFILE_SCOPE(name) Profiler::CpuZone PROFILER_CONCAT(__profileZone, __LINE__)(name)
+// Times the GPU work issued in the rest of the enclosing scope, only valid on the thread that owns the GL context
+#define PROFILE_GPU_SCOPE(name) Profiler::GpuZone PROFILER_CONCAT(__profileGpuZone, __LINE__)(name)
+// Times the rest of the enclosing scope on both the CPU and GPU, for render passes
+#define PROFILE_RENDER_SCOPE(name) PROFILE_SCOPE(name); PROFILE_GPU_SCOPE(name)
+
+/// <summary>
+/// Collects CPU and GPU timings for named zones, and keeps a rolling history of frames that can be
+/// drawn as a timeline or exported as a Chrome trace (chrome://tracing, or ui.perfetto.dev)
+///
+/// CPU zones are written into a ring buffer owned by the thread that recorded them, and are only
+/// drained by the main thread at the end of a frame, so recording never takes a lock. GPU zones are
+/// timestamp queries that are read back a few frames later, once the GPU has caught up, so we never
+/// wait on the driver
+/// </summary>
+class Profiler {
+public:
+	Profiler() = delete;
+
+	// The thread ID that GPU events are reported under
+	static const uint32_t GPU_THREAD_ID = 0xFFFFFFFF;
+	// The number of frames of history that are kept
+	static const size_t HISTORY_SIZE = 300;
+	// The number of frames we wait before reading back timer queries
+	static const uint32_t GPU_FRAME_LATENCY = 4;
+
+	/// <summary>
+	/// A single timed zone, times are in nanoseconds since the profiler started
+	/// </summary>
+	struct Event {
+		const char* Name;
+		int64_t     StartNs;
+		int64_t     EndNs;
+		uint32_t    ThreadId;
+		uint32_t    Depth;
+		// Draw calls issued by this thread while the zone was open, including nested zones
+		uint32_t    DrawCalls;
+		// Heap allocations made by this thread while the zone was open, including nested zones
+		uint32_t    Allocations;
+	};
+
+	/// <summary>
+	/// All the events recorded for a single frame
+	/// </summary>
+	struct FrameCapture {
+		uint64_t           Index;
+		int64_t            StartNs;
+		int64_t            EndNs;
+		std::vector<Event> CpuEvents;
+		// Filled in a few frames after the frame itself was captured
+		std::vector<Event> GpuEvents;
+		bool               GpuResolved;
+		// Draw calls issued on the main thread during the frame
+		uint32_t           DrawCalls;
+		// Heap allocations made on the main thread during the frame
+		uint32_t           Allocations;
+	};
+
+	/// <summary>
+	/// RAII helper that records a CPU zone from construction to destruction, see PROFILE_SCOPE
+	/// </summary>
+	class CpuZone {
+	public:
+		NO_COPY(CpuZone);
+		NO_MOVE(CpuZone);
+		CpuZone(const char* name);
+		~CpuZone();
+	private:
+		const char* _name;
+		int64_t     _start;
+		uint64_t    _drawCalls;
+		uint64_t    _allocations;
+		bool        _active;
+	};
+
+	/// <summary>
+	/// RAII helper that records a GPU zone from construction to destruction, see PROFILE_GPU_SCOPE
+	/// </summary>
+	class GpuZone {
+	public:
+		NO_COPY(GpuZone);
+		NO_MOVE(GpuZone);
+		GpuZone(const char* name);
+		~GpuZone();
+	private:
+		int32_t _zone;
+	};
+
+	/// <summary>
+	/// Enables or disables recording, while disabled zones only cost a flag check
+	/// </summary>
+	static void SetEnabled(bool value);
+	static bool IsEnabled();
+
+	/// <summary>
+	/// While paused, zones are still recorded but frames are not added to the history, so it can be inspected
+	/// </summary>
+	static void SetPaused(bool value);
+	static bool IsPaused();
+
+	/// <summary>
+	/// When set, BeginFrame waits for GPU timings that are still in flight instead of dropping them.
+	/// This stalls the CPU, so it's only meant for benchmarks that need the GPU time of every frame
+	/// </summary>
+	static void SetWaitForGpu(bool value);
+	static bool IsWaitingForGpu();
+
+	/// <summary>
+	/// Counts draw calls against the calling thread, any zones that are open will include them. Should be
+	/// called next to every glDraw* call, multi-draws count as a single call
+	/// </summary>
+	/// <param name="count">The number of draw calls that were issued</param>
+	static void CountDrawCalls(uint32_t count = 1);
+
+	/// <summary>
+	/// Names the calling thread in timelines and exported traces
+	/// </summary>
+	static void SetThreadName(const std::string& name);
+
+	/// <summary>
+	/// Starts a new frame, must be called on the main thread with the GL context current
+	/// </summary>
+	static void BeginFrame();
+	/// <summary>
+	/// Ends the current frame, collecting all CPU zones recorded since BeginFrame and reading
+	/// back any GPU zones from earlier frames that have finished
+	/// </summary>
+	static void EndFrame();
+
+	/// <summary>
+	/// Gets the index of the frame that is currently being recorded
+	/// </summary>
+	static uint64_t GetFrameIndex();
+	/// <summary>
+	/// Gets the captured frames, oldest first
+	/// </summary>
+	static const std::deque<FrameCapture>& GetFrames();
+	/// <summary>
+	/// Gets the display name of the given thread ID
+	/// </summary>
+	static std::string GetThreadName(uint32_t threadId);
+	/// <summary>
+	/// Gets the number of CPU events that were dropped because a thread's buffer was full
+	/// </summary>
+	static uint64_t GetDroppedEvents();
+
+	/// <summary>
+	/// Releases all GL queries, should be called before the context is destroyed
+	/// </summary>
+	static void Cleanup();
+
+	/// <summary>
+	/// Writes the frame history to a Chrome trace event JSON file
+	/// </summary>
+	/// <param name="path">The path of the file to write</param>
+	/// <returns>True if the trace was written</returns>
+	static bool ExportChromeTrace(const std::string& path);
+
+	/// <summary>
+	/// Gets the current time on the profiler's clock, in nanoseconds
+	/// </summary>
+	static int64_t Now();
+
+protected:
+	// A ring of events owned by a single thread. Only that thread writes events and advances Written,
+	// only the main thread reads events and advances Read
+	struct ThreadBuffer {
+		static const uint32_t CAPACITY = 1 << 14;
+
+		uint32_t              ThreadId;
+		std::string           Name;
+		uint32_t              Depth;
+		std::atomic<uint64_t> Written;
+		std::atomic<uint64_t> Read;
+		Event                 Events[CAPACITY];
+	};
+
+	// A GPU zone waiting on it's queries
+	struct PendingGpuZone {
+		const char* Name;
+		uint32_t    StartQuery;
+		uint32_t    EndQuery;
+		uint32_t    Depth;
+	};
+
+	// The timer queries issued during a single frame
+	struct GpuFrame {
+		uint64_t                    FrameIndex;
+		bool                        Pending;
+		int64_t                     GpuToCpuOffset;
+		std::vector<GLuint>         Queries;
+		uint32_t                    QueriesUsed;
+		// The last query that was issued, once it's available the rest of the frame's are too
+		uint32_t                    LastQuery;
+		std::vector<PendingGpuZone> Zones;
+	};
+
+	static std::atomic<bool> __enabled;
+	static bool              __paused;
+	static bool              __waitForGpu;
+	static uint64_t          __frameIndex;
+	static int64_t           __frameStart;
+	static std::atomic<uint64_t> __droppedEvents;
+
+	static std::mutex                                 __threadsMutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>> __threads;
+	static thread_local ThreadBuffer*                 __threadBuffer;
+	static thread_local uint64_t                      __drawCalls;
+	static uint64_t                                   __frameDrawCalls;
+	static uint64_t                                   __frameAllocations;
+
+	static GpuFrame __gpuFrames[GPU_FRAME_LATENCY];
+	static GpuFrame* __currentGpuFrame;
+	static uint32_t  __gpuDepth;
+
+	static std::deque<FrameCapture> __frames;
+
+	static ThreadBuffer* __GetThreadBuffer();
+	static void __Record(ThreadBuffer* buffer, const Event& event);
+	static int32_t __BeginGpuZone(const char* name);
+	static void __EndGpuZone(int32_t zone);
+	static GLuint __AllocateQuery(GpuFrame& frame);
+	static bool __ResolveGpuFrame(GpuFrame& frame);
+};
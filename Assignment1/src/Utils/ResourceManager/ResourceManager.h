@@ -6,6 +6,7 @@
 
 #include "Utils/GUID.hpp"
 #include "Utils/ResourceManager/IResource.h"
+#include "Utils/MemoryTracker.h"
 #include "Utils/StringUtils.h"
 
 /// <summary>
@@ -29,6 +30,7 @@ public:
 	/// <returns>The GUID of the newly created asset</returns>
 	template <typename T, typename ... TArgs, typename = std::enable_if<is_valid_resource<T>()>::type>
 	static std::shared_ptr<T> CreateAsset(TArgs&&... args) {
+		MEMORY_SCOPE(Resources);
 		// Create and store the asset
 		std::shared_ptr<T> asset = std::make_shared<T>(std::forward<TArgs>(args)...);
 		_resources[std::type_index(typeid(T))][asset->IResource::GetGUID()] = asset;
@@ -58,6 +60,7 @@ public:
 
 		// If the asset is null, we can try finding it in the manifest to load it
 		if (result == nullptr) {
+			MEMORY_SCOPE(Resources);
 			// Get the type name it'll be stored under
 			std::string typeName = StringTools::SanitizeClassName(typeid(T).name());
 
@@ -65,3 +65,45 @@ int StringTools::Split(const std::string& s, std::vector<std::string>& results,
 	results.push_back(s.substr(lastPos, seek));
 	return ++result;
 }
+
+uint32_t StringTools::DecodeUtf8(const char*& it, const char* end)
+{
+	// The codepoint to return for malformed sequences
+	const uint32_t replacement = 0xFFFD;
+
+	uint8_t lead = static_cast<uint8_t>(*it++);
+
+	// Single byte (ASCII) is the common case
+	if (lead < 0x80) {
+		return lead;
+	}
+
+	// Determine the sequence length and the payload bits of the lead byte
+	uint32_t result;
+	int      extra;
+	uint32_t minimum;
+	if ((lead & 0xE0) == 0xC0) {
+		result = lead & 0x1F; extra = 1; minimum = 0x80;
+	} else if ((lead & 0xF0) == 0xE0) {
+		result = lead & 0x0F; extra = 2; minimum = 0x800;
+	} else if ((lead & 0xF8) == 0xF0) {
+		result = lead & 0x07; extra = 3; minimum = 0x10000;
+	} else {
+		// Stray continuation byte, or invalid lead byte
+		return replacement;
+	}
+
+	// Consume continuation bytes, stopping at the first byte that isn't one so we can resync
+	for (int ix = 0; ix < extra; ix++) {
+		if (it == end || (static_cast<uint8_t>(*it) & 0xC0) != 0x80) {
+			return replacement;
+		}
+		result = (result << 6) | (static_cast<uint8_t>(*it++) & 0x3F);
+	}
+
+	// Reject overlong encodings, surrogates and values outside of the unicode range
+	if (result < minimum || result > 0x10FFFF || (result >= 0xD800 && result <= 0xDFFF)) {
+		return replacement;
+	}
+	return result;
+}
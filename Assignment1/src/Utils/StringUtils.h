@@ -2,6 +2,7 @@
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <cstdint>
 
 // Borrowed from https://stackoverflow.com/questions/216823/whats-the-best-way-to-trim-stdstring
 int constexpr const_strlen(const char* str) {
@@ -115,4 +116,14 @@ public:
 	/// <param name="splitOn">The delimiter string to split on</param>
 	/// <returns>The number of tokens this command appended to the results</returns>
 	static int Split(const std::string& s, std::vector<std::string>& results, const std::string& splitOn = ",");
+
+	/// <summary>
+	/// Decodes a single unicode codepoint from a UTF-8 string, advancing the iterator
+	/// past it. Does not allocate any memory, so can be used to iterate over UTF-8 text
+	/// without converting it to a wide string. Malformed sequences decode to U+FFFD
+	/// </summary>
+	/// <param name="it">The current position in the string, will be advanced past the codepoint</param>
+	/// <param name="end">The end of the string</param>
+	/// <returns>The decoded codepoint</returns>
+	static uint32_t DecodeUtf8(const char*& it, const char* end);
 };
\ No newline at end of file
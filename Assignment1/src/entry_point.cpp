@@ -4,8 +4,6 @@
 int main(int argc, char** args) {
 	Logger::Init();
 
-	// TODO: parse arguments?
-
 	Application::Start(argc, args);
 
 	Logger::Uninitialize();